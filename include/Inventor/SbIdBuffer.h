@@ -0,0 +1,83 @@
+#ifndef COIN_SBIDBUFFER_H
+#define COIN_SBIDBUFFER_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbVec2s.h>
+#include <Inventor/system/inttypes.h>
+#include <Inventor/tools/SbPimplPtr.h>
+
+class SbMatrix;
+class SbVec3f;
+
+class COIN_DLL_API SbIdBuffer {
+public:
+  enum Culling {
+    CULL_NONE,
+    CULL_CLOCKWISE,
+    CULL_COUNTERCLOCKWISE
+  };
+
+  SbIdBuffer(void);
+  ~SbIdBuffer(void);
+
+  void setSize(const SbVec2s & size);
+  const SbVec2s & getSize(void) const;
+  void clear(void);
+
+  void addTriangle(const SbVec3f & v0, const SbVec3f & v1, const SbVec3f & v2,
+                   const SbMatrix & objtoclip, const uint32_t id,
+                   const Culling culling = CULL_NONE);
+  void addLine(const SbVec3f & v0, const SbVec3f & v1,
+               const SbMatrix & objtoclip, const uint32_t id);
+  void addPoint(const SbVec3f & v, const SbMatrix & objtoclip, const uint32_t id);
+
+  uint32_t getId(const SbVec2s & pixel) const;
+  float getDepth(const SbVec2s & pixel) const;
+  const uint32_t * getIdBuffer(void) const;
+  const float * getDepthBuffer(void) const;
+
+  static void setNumThreads(const int num);
+  static int getNumThreads(void);
+
+private:
+  class PImpl;
+  SbPimplPtr<PImpl> pimpl;
+
+  SbIdBuffer(const SbIdBuffer & rhs); // N/A
+  SbIdBuffer & operator = (const SbIdBuffer & rhs); // N/A
+
+}; // SbIdBuffer
+
+#endif // !COIN_SBIDBUFFER_H
@@ -0,0 +1,72 @@
+#ifndef COIN_SBOCCLUSIONBUFFER_H
+#define COIN_SBOCCLUSIONBUFFER_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbVec2s.h>
+#include <Inventor/tools/SbPimplPtr.h>
+
+class SbBox3f;
+class SbMatrix;
+class SbVec3f;
+
+class COIN_DLL_API SbOcclusionBuffer {
+public:
+  SbOcclusionBuffer(void);
+  ~SbOcclusionBuffer(void);
+
+  void setSize(const SbVec2s & size);
+  const SbVec2s & getSize(void) const;
+  void clear(void);
+
+  void addTriangles(const SbVec3f * coords, const int numtriangles,
+                    const SbMatrix & objtoclip);
+  void addBox(const SbBox3f & box, const SbMatrix & objtoclip);
+
+  SbBool isOccluded(const SbBox3f & box, const SbMatrix & objtoclip) const;
+  float getDepth(const SbVec2s & pixel) const;
+
+  int getNumQueries(void) const;
+  int getNumOccluded(void) const;
+
+private:
+  class PImpl;
+  SbPimplPtr<PImpl> pimpl;
+
+  SbOcclusionBuffer(const SbOcclusionBuffer & rhs); // N/A
+  SbOcclusionBuffer & operator = (const SbOcclusionBuffer & rhs); // N/A
+
+}; // SbOcclusionBuffer
+
+#endif // !COIN_SBOCCLUSIONBUFFER_H
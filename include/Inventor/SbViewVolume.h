@@ -61,6 +61,7 @@ public:
   void projectPointToLine(const SbVec2f& pt,
                           SbVec3f& line0, SbVec3f& line1) const;
   void projectToScreen(const SbVec3f& src, SbVec3f& dst) const;
+  void projectToScreen(const SbVec3f * src, SbVec3f * dst, const int num) const;
   SbPlane getPlane(const float distFromEye) const;
   SbVec3f getSightPoint(const float distFromEye) const;
   SbVec3f getPlanePoint(const float distFromEye,
@@ -104,6 +105,8 @@ public:
   SbBool intersect(const SbVec3f & p0, const SbVec3f & p1,
                    SbVec3f & closestpoint) const;
   SbBool intersect(const SbBox3f & box) const;
+  int intersect(const SbVec3f * pts, const int num,
+                SbBool * isinside = NULL) const;
   SbBox3f intersectionBox(const SbBox3f & box) const;
 
   SbBool outsideTest(const SbPlane & p,
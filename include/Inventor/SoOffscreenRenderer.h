@@ -78,6 +78,15 @@ public:
   SoGLRenderAction * getGLRenderAction(void) const;
   SbBool render(SoNode * scene);
   SbBool render(SoPath * scene);
+
+  typedef void TileRowCB(void * closure, const SoOffscreenRenderer * renderer,
+                         const unsigned char * rows, int firstrow, int numrows);
+  void setTileRowCallback(TileRowCB * func, void * closure);
+  SbBool renderToRGB(SoNode * scene, const char * filename);
+  SbBool renderToRGB(SoPath * scene, const char * filename);
+  SbBool writeRowsToRGB(FILE * fp, const unsigned char * rows,
+                        int firstrow, int numrows) const;
+
   unsigned char * getBuffer(void) const;
   const void * const & getDC(void) const;
 
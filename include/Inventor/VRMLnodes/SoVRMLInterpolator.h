@@ -50,12 +50,19 @@ public:
 
   static void initClass(void);
 
+  static void evaluateFractions(SoVRMLInterpolator * const * interpolators,
+                                const int numinterpolators, const float fraction);
+
 protected:
   
   int getKeyValueIndex(float & interp, int numvalues);
+  virtual void inputChanged(SoField * which);
 
   SoVRMLInterpolator(void);
   virtual ~SoVRMLInterpolator();
+
+private:
+  class SoVRMLInterpolatorP * pimpl;
 };
 
 #endif // ! COIN_SOVRMLINTERPOLATOR_H
@@ -182,6 +182,13 @@ public:
   void setCallbackAll(SbBool callbackall);
   SbBool isCallbackAll(void) const;
 
+  void setNumThreads(const int numthreads);
+  int getNumThreads(void) const;
+  void setKeepShapeOrder(const SbBool onoff);
+  SbBool isKeepShapeOrder(void) const;
+  int getThreadIndex(void) const;
+  int getShapeIndex(void) const;
+
 protected:
   virtual void beginTraversal(SoNode * node);
 
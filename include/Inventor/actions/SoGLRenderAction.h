@@ -46,6 +46,8 @@ typedef void SoGLPreRenderCB(void * userdata, class SoGLRenderAction * action);
 typedef float SoGLSortedObjectOrderCB(void * userdata, SoGLRenderAction * action);
 
 class SoGLRenderActionP;
+class SbBox3f;
+class SbOcclusionBuffer;
 
 class COIN_DLL_API SoGLRenderAction : public SoAction {
   typedef SoAction inherited;
@@ -138,6 +140,11 @@ public:
   SbBool hasTransparentShadowObject() const;
   void resetTransparentShadowObject();
 
+  void setOccluders(SoNode * occluders);
+  SoNode * getOccluders(void) const;
+  SbBool isOccluded(const SbBox3f & box);
+  const SbOcclusionBuffer & getOcclusionBuffer(void) const;
+
 protected:
   friend class SoGLRenderActionP; // calls beginTraversal
   virtual void beginTraversal(SoNode * node);
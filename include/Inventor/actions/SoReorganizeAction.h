@@ -36,6 +36,7 @@
 #include <Inventor/actions/SoSimplifyAction.h>
 
 class SoSimplifier;
+class SoPickedPoint;
 class SoSeparator;
 class SoReorganizeActionP;
 
@@ -62,6 +63,15 @@ public:
   void matchIndexArrays(SbBool onoff);
   SbBool areIndexArraysMatched(void) const;
   SoSimplifier * getSimplifier(void) const;
+  void optimizeVertexCache(SbBool onoff);
+  SbBool isVertexCacheOptimized(void) const;
+  void setVertexCacheSize(const int size);
+  int getVertexCacheSize(void) const;
+  void getAverageCacheMissRatio(float & original, float & optimized) const;
+  void mergeShapes(SbBool onoff);
+  SbBool areShapesMerged(void) const;
+  const SoPath * getOriginalPath(const SoNode * mergedshape, const int triangleindex) const;
+  const SoPath * getOriginalPath(const SoPickedPoint * pp) const;
 
   virtual void apply(SoNode * root);
   virtual void apply(SoPath * path);
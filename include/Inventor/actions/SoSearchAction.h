@@ -94,6 +94,7 @@ private:
 
 private:
   SbLazyPimplPtr<SoSearchActionP> pimpl;
+  friend class SoSearchActionP;
 
   // NOT IMPLEMENTED:
   SoSearchAction(const SoSearchAction & rhs);
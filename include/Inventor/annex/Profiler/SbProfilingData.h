@@ -79,6 +79,15 @@ public:
     INCLUDE_CHILDREN = 0x01
   };
 
+  enum ActionStatistic {
+    OCCLUSION_TESTS,
+    OCCLUSION_CULLED,
+    GL_CACHE_HITS,
+    GL_CACHE_MISSES,
+    GL_CACHE_BUILDS,
+    GL_CACHE_BUILD_TIME
+  };
+
   void setNodeTiming(const SoPath * path, SbTime timing);
   void setNodeTiming(int idx, SbTime timing);
   void preOffsetNodeTiming(int idx, SbTime timing);
@@ -109,6 +118,9 @@ public:
 
   int getNumNodeEntries(void) const;
 
+  void addActionStatistic(ActionStatistic stat, double value);
+  double getActionStatistic(ActionStatistic stat) const;
+
   typedef void SbProfilingDataCB(void * userdata, const SbProfilingData & data, const SbList<SoNode *> & pointers, SbList<int> & childindices, int idx);
   void reportAll(SbProfilingDataCB * callback, void * userdata) const;
 
@@ -53,6 +53,32 @@ public:
 
   void invalidateAll(void);
 
+  struct Statistics {
+    uint32_t numhits;
+    uint32_t nummisses;
+    uint32_t numbuilds;
+    uint32_t numfailedbuilds;
+    uint32_t numinvalidations;
+    uint32_t numdiscarded;
+    int numcaches;
+    int numframesok;
+    int numshapes;
+    double buildtime;
+    double traversaltime;
+    double cachedtime;
+    double framesbetweeninvalidations;
+    size_t memory;
+  };
+
+  void getStatistics(Statistics & stats) const;
+  void resetStatistics(void);
+
+  typedef SbBool CachePolicyCB(void * closure, const SoGLCacheList * list,
+                               const Statistics & stats);
+  static void setCachePolicyCallback(CachePolicyCB * func, void * closure);
+  static SbBool costBasedCachePolicy(void * closure, const SoGLCacheList * list,
+                                     const Statistics & stats);
+
 private:
   SoGLCacheListP * pimpl;
 };
@@ -69,12 +69,6 @@ protected:
 private:
   virtual void evaluate(void);
 
-  static void readfieldcb(const char *name, float *data, void *cbdata);
-  static void writefieldcb(const char *name, float *data, int comp, void *cbdata);
-
-  void evaluateExpression(struct so_eval_node *node, const int fieldidx);
-  void findUsed(struct so_eval_node *node, char *inused, char *outused);
-
   SoCalculatorP * pimpl;
 };
 
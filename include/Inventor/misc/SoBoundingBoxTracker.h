@@ -0,0 +1,69 @@
+#ifndef COIN_SOBOUNDINGBOXTRACKER_H
+#define COIN_SOBOUNDINGBOXTRACKER_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/tools/SbPimplPtr.h>
+
+class SbBox3f;
+class SbViewportRegion;
+class SoNode;
+class SoBoundingBoxTrackerP;
+
+class COIN_DLL_API SoBoundingBoxTracker {
+public:
+  SoBoundingBoxTracker(const SbViewportRegion & vp);
+  ~SoBoundingBoxTracker(void);
+
+  void setSceneGraph(SoNode * root);
+  SoNode * getSceneGraph(void) const;
+
+  void setViewportRegion(const SbViewportRegion & vp);
+  const SbViewportRegion & getViewportRegion(void) const;
+
+  const SbBox3f & getBoundingBox(void);
+  SbBool isValid(void) const;
+  void invalidate(void);
+
+  int getNumUpdatedNodes(void) const;
+
+private:
+  SbPimplPtr<SoBoundingBoxTrackerP> pimpl;
+
+  SoBoundingBoxTracker(const SoBoundingBoxTracker & rhs); // N/A
+  SoBoundingBoxTracker & operator = (const SoBoundingBoxTracker & rhs); // N/A
+
+}; // SoBoundingBoxTracker
+
+#endif // !COIN_SOBOUNDINGBOXTRACKER_H
@@ -153,6 +153,10 @@ private:
                          int & partnum, SbBool & islist, int & listidx,
                          const SbBool makeifneeded, SoPath * path = NULL,
                          const SbBool recsearch = FALSE);
+  static SbBool findPart(const SbName & partname, SoBaseKit *& kit,
+                         int & partnum, SbBool & islist, int & listidx,
+                         const SbBool makeifneeded, SoPath * path = NULL,
+                         const SbBool recsearch = FALSE);
   static void atexit_cleanupkit(void);
 
   SbBool makePart(const int partnum);
@@ -105,6 +105,7 @@ private:
   SoType getDefaultChildType(void) const;
 
   friend class SoBaseKit;
+  friend class SoBaseKitP;
 };
 
 #endif // !COIN_SONODEKITLISTPART_H
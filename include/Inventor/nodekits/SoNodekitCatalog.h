@@ -99,6 +99,9 @@ public:
 
   void printCheck(void) const;
 
+  SbBool isComplete(void) const;
+  void setComplete(void);
+
 private:
   SbBool hasEntry(const SbName & name) const;
   SbBool hasListItemType(const SbName & name, SoType type) const;
@@ -113,6 +116,7 @@ private:
 
   SbList<class CatalogItem *> items;
   SbList<class CatalogItem *> delayeditems;
+  class SoNodekitCatalogP * pimpl;
 };
 
 #endif // !COIN_SONODEKITCATALOG_H
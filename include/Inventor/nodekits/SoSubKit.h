@@ -152,65 +152,87 @@ PRIVATE_KIT_SOURCE(_class_)
 
 
 
+// The catalog is shared by all instances of a nodekit class, so after
+// the first instance has been constructed, the catalog macros only
+// need to initialize the part fields of the new instance.
+#define PRIVATE_KIT_CATALOG_IS_SET_UP() \
+  (!SO_KIT_IS_FIRST_INSTANCE() && classcatalog->isComplete())
+
+#define PRIVATE_KIT_ADD_PART_FIELD(_part_) \
+  do { \
+    if (PRIVATE_KIT_CATALOG_IS_SET_UP()) { \
+      this->_part_.setValue(NULL); \
+      this->_part_.setContainer(this); \
+    } \
+    else { \
+      SO_NODE_ADD_FIELD(_part_,(NULL)); \
+    } \
+  } WHILE_0
+
 #define SO_KIT_ADD_CATALOG_ENTRY(_part_, _partclass_, _isdefnull_ , _parent_, _sibling_, _ispublic_) \
   do { \
-    classcatalog->addEntry(SO__QUOTE(_part_), \
-                           SoType::fromName(SO__QUOTE(_partclass_)), \
-                           SoType::fromName(SO__QUOTE(_partclass_)), \
-                           _isdefnull_, \
-                           SO__QUOTE(_parent_), \
-                           SO__QUOTE(_sibling_), \
-                           FALSE, \
-                           SoType::badType(), \
-                           SoType::badType(), \
-                           _ispublic_); \
-    SO_NODE_ADD_FIELD(_part_,(NULL)); \
+    if (!PRIVATE_KIT_CATALOG_IS_SET_UP()) \
+      classcatalog->addEntry(SO__QUOTE(_part_), \
+                             SoType::fromName(SO__QUOTE(_partclass_)), \
+                             SoType::fromName(SO__QUOTE(_partclass_)), \
+                             _isdefnull_, \
+                             SO__QUOTE(_parent_), \
+                             SO__QUOTE(_sibling_), \
+                             FALSE, \
+                             SoType::badType(), \
+                             SoType::badType(), \
+                             _ispublic_); \
+    PRIVATE_KIT_ADD_PART_FIELD(_part_); \
   } WHILE_0
 
 
 
 #define SO_KIT_ADD_CATALOG_LIST_ENTRY(_part_, _containertype_, _isdefnull_, _parent_, _sibling_, _itemtype_, _ispublic_) \
-  do {  \
-    classcatalog->addEntry(SO__QUOTE(_part_), \
-                           SoNodeKitListPart::getClassTypeId(), \
-                           SoNodeKitListPart::getClassTypeId(), \
-                           _isdefnull_, \
-                           SO__QUOTE(_parent_), \
-                           SO__QUOTE(_sibling_), \
-                           TRUE, \
-                           _containertype_::getClassTypeId(), \
-                           _itemtype_::getClassTypeId(), \
-                           _ispublic_); \
-    SO_NODE_ADD_FIELD(_part_,(NULL)); \
+  do { \
+    if (!PRIVATE_KIT_CATALOG_IS_SET_UP()) \
+      classcatalog->addEntry(SO__QUOTE(_part_), \
+                             SoNodeKitListPart::getClassTypeId(), \
+                             SoNodeKitListPart::getClassTypeId(), \
+                             _isdefnull_, \
+                             SO__QUOTE(_parent_), \
+                             SO__QUOTE(_sibling_), \
+                             TRUE, \
+                             _containertype_::getClassTypeId(), \
+                             _itemtype_::getClassTypeId(), \
+                             _ispublic_); \
+    PRIVATE_KIT_ADD_PART_FIELD(_part_); \
   } WHILE_0
 
 
 
 #define SO_KIT_ADD_CATALOG_ABSTRACT_ENTRY(_part_, _class_, _defaultclass_, _isdefnull_, _parent_, _sibling_, _ispublic_) \
   do { \
-    classcatalog->addEntry(SO__QUOTE(_part_), \
-                           _class_::getClassTypeId(), \
-                           _defaultclass_::getClassTypeId(), \
-                           _isdefnull_, \
-                           SO__QUOTE(_parent_), \
-                           SO__QUOTE(_sibling_), \
-                           FALSE, \
-                           SoType::badType(), \
-                           SoType::badType(), \
-                           _ispublic_); \
-    SO_NODE_ADD_FIELD(_part_,(NULL)); \
+    if (!PRIVATE_KIT_CATALOG_IS_SET_UP()) \
+      classcatalog->addEntry(SO__QUOTE(_part_), \
+                             _class_::getClassTypeId(), \
+                             _defaultclass_::getClassTypeId(), \
+                             _isdefnull_, \
+                             SO__QUOTE(_parent_), \
+                             SO__QUOTE(_sibling_), \
+                             FALSE, \
+                             SoType::badType(), \
+                             SoType::badType(), \
+                             _ispublic_); \
+    PRIVATE_KIT_ADD_PART_FIELD(_part_); \
   } WHILE_0
 
 
 
 #define SO_KIT_ADD_LIST_ITEM_TYPE(_part_, _listitemtype_) \
   do { \
-    classcatalog->addListItemType(SO__QUOTE(_part_), \
-                                  _listitemtype_::getClassTypeId()); \
+    if (!PRIVATE_KIT_CATALOG_IS_SET_UP()) \
+      classcatalog->addListItemType(SO__QUOTE(_part_), \
+                                    _listitemtype_::getClassTypeId()); \
   } WHILE_0
 
 
 #define SO_KIT_INIT_INSTANCE() \
+  classcatalog->setComplete(); \
   this->createFieldList(); \
   this->createDefaultParts()
 
@@ -232,15 +254,17 @@ PRIVATE_KIT_SOURCE(_class_)
 
 #define SO_KIT_CHANGE_ENTRY_TYPE(_part_, _newpartclassname_, _newdefaultpartclassname_) \
   do { \
-    classcatalog->narrowTypes(SO__QUOTE(_part_), \
-                              SoType::fromName(SO__QUOTE(_newpartclassname_)), \
-                              SoType::fromName(SO__QUOTE(_newdefaultpartclassname_))); \
+    if (!PRIVATE_KIT_CATALOG_IS_SET_UP()) \
+      classcatalog->narrowTypes(SO__QUOTE(_part_), \
+                                SoType::fromName(SO__QUOTE(_newpartclassname_)), \
+                                SoType::fromName(SO__QUOTE(_newdefaultpartclassname_))); \
   } WHILE_0
 
 
 #define SO_KIT_CHANGE_NULL_BY_DEFAULT(_part_, _newnullbydefault_) \
   do { \
-    classcatalog->setNullByDefault(SO__QUOTE(_part_), _newnullbydefault_); \
+    if (!PRIVATE_KIT_CATALOG_IS_SET_UP()) \
+      classcatalog->setNullByDefault(SO__QUOTE(_part_), _newnullbydefault_); \
   } WHILE_0
 
 #endif // !COIN_SOSUBKIT_H
@@ -72,6 +72,10 @@ public:
   virtual void audioRender(SoAudioRenderAction * action);
   virtual SoChildList * getChildren(void) const;
   virtual void addWriteReference(SoOutput * out, SbBool isfromfield = FALSE);
+  virtual void notify(SoNotList * nl);
+
+  static void setChildCullingThreshold(const int numchildren);
+  static int getChildCullingThreshold(void);
 
 protected:
   virtual ~SoGroup();
@@ -93,6 +97,7 @@ protected:
 
 private:
   friend class SoUnknownNode; // Let SoUnknownNode access readChildren().
+  friend class SoGroupP;
   SoGroupP * pimpl;
 
   int changedIndex;
@@ -39,6 +39,7 @@
 #include <Inventor/tools/SbPimplPtr.h>
 
 class SoState;
+class SoGLCacheList;
 class SoSeparatorP;
 
 class COIN_DLL_API SoSeparator : public SoGroup {
@@ -78,6 +79,9 @@ public:
 
   static void setNumRenderCaches(const int howmany);
   static int getNumRenderCaches(void);
+  static void setCompiledTraversal(const SbBool onoff);
+  static SbBool isCompiledTraversal(void);
+  const SoGLCacheList * getGLCacheList(void) const;
   virtual SbBool affectsState(void) const;
 
 protected:
@@ -88,6 +92,7 @@ protected:
   virtual SbBool readInstance(SoInput * in, unsigned short flags);
 
 private:
+  friend class SoSeparatorP;
   void commonConstructor(void);
   SbBool cullTestNoPush(SoState * state);
 
@@ -48,6 +48,10 @@ public:
   static void initClass(void);
   SoText2(void);
 
+  static void prewarmGlyphs(const SbString & characters,
+                            const SbName & fontname = "defaultFont",
+                            const float size = 10.0f);
+
   enum Justification {
     LEFT = 1,
     RIGHT,
@@ -53,6 +53,10 @@ public:
   static void initClass(void);
   SoText3(void);
 
+  static void prewarmGlyphs(const SbString & characters,
+                            const SbName & fontname = "defaultFont",
+                            const float complexity = 0.5f);
+
   enum Part {
     FRONT = 1,
     SIDES = 2,
@@ -135,6 +135,10 @@
      return 0;
    }
   \endcode
+
+  Consumers which do a lot of work per primitive can have the
+  primitive callbacks invoked from several threads, see
+  setNumThreads().
 */
 
 /*!
@@ -179,7 +183,14 @@
 
 #include <Inventor/actions/SoCallbackAction.h>
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
 #include <Inventor/SoPath.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/details/SoFaceDetail.h>
+#include <Inventor/details/SoPointDetail.h>
 #include <Inventor/elements/SoComplexityElement.h>
 #include <Inventor/elements/SoCoordinateElement.h>
 #include <Inventor/elements/SoCreaseAngleElement.h>
@@ -218,6 +229,12 @@
 #include <Inventor/nodes/SoShape.h>
 #include <Inventor/SbViewportRegion.h>
 
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/wpool.h>
+#include <Inventor/threads/SbCondVar.h>
+#include <Inventor/threads/SbMutex.h>
+#endif // HAVE_THREADS
+
 #include "actions/SoSubActionP.h"
 #include "SbBasicP.h"
 
@@ -325,9 +342,307 @@ SoCallbackData::doPointCallbacks(SoCallbackAction * action,
   }
 }
 
+// max number of primitive vertices waiting for the worker threads
+// before traversal is held back
+#define CALLBACKACTION_MAX_PENDING_VERTICES (256*1024)
+
+// A primitive vertex. The detail is stored by type and index into
+// the detail lists of SoCallbackPrimitives.
+struct SoCallbackVertex {
+  enum DetailType { NONE, POINT, FACE, OTHER };
+
+  SbVec3f point;
+  SbVec3f normal;
+  SbVec4f texcoords;
+  int materialindex;
+  uint32_t packedcolor;
+  int detailtype;
+  int32_t detail;
+};
+
+// A face detail, with the points stored in the point detail list.
+struct SoCallbackFace {
+  int faceindex;
+  int partindex;
+  int firstpoint;
+  int numpoints;
+};
+
+// The primitives of one shape, along with a snapshot of the state
+// the callbacks may query while they run on a worker thread. The
+// instances are recycled to keep the lists allocated.
+class SoCallbackPrimitives {
+public:
+  SoCallbackPrimitives(void);
+  ~SoCallbackPrimitives();
+
+  void begin(SoState * state, const SoShape * shape, const int shapeindex);
+  void clear(void);
+  void addPrimitive(const int numvertices,
+                    const SoPrimitiveVertex * v1,
+                    const SoPrimitiveVertex * v2,
+                    const SoPrimitiveVertex * v3);
+  void getVertex(const int idx, SoPrimitiveVertex & v, SoFaceDetail & facedetail) const;
+
+  const SoShape * shape;
+  int shapeindex;
+
+  SbMatrix modelmatrix;
+  SbColor ambient;
+  SbColor specular;
+  SbColor emission;
+  float shininess;
+  SbList <SbColor> diffuse;
+  SbList <float> transparency;
+  SoMaterialBinding::Binding materialbinding;
+  SoNormalBinding::Binding normalbinding;
+  SoTextureCoordinateBinding::Binding texcoordbinding;
+  SoShapeHints::VertexOrdering vertexordering;
+  SoShapeHints::ShapeType shapetype;
+  SoShapeHints::FaceType facetype;
+
+  // 1, 2 or 3 vertices for each point, line segment and triangle
+  SbList <unsigned char> primitives;
+  SbList <SoCallbackVertex> vertices;
+  SbList <SoPointDetail> pointdetails;
+  SbList <SoCallbackFace> faces;
+  SbList <SoDetail *> details;
+
+private:
+  void copyDetail(const SoDetail * detail, SoCallbackVertex & cv);
+  SbBool isLastFace(const SoFaceDetail * face) const;
+  // the vertices of a primitive, and often the primitives of a face,
+  // share a detail
+  const SoDetail * lastdetail;
+  int lastdetailtype;
+  int32_t lastdetailindex;
+};
+
+SoCallbackPrimitives::SoCallbackPrimitives(void)
+{
+  this->clear();
+}
+
+SoCallbackPrimitives::~SoCallbackPrimitives()
+{
+  this->clear();
+}
+
+void
+SoCallbackPrimitives::begin(SoState * state, const SoShape * shapearg,
+                            const int shapeindexarg)
+{
+  this->shape = shapearg;
+  this->shapeindex = shapeindexarg;
+
+  this->modelmatrix = SoModelMatrixElement::get(state);
+  this->ambient = SoLazyElement::getAmbient(state);
+  this->specular = SoLazyElement::getSpecular(state);
+  this->emission = SoLazyElement::getEmissive(state);
+  this->shininess = SoLazyElement::getShininess(state);
+  this->materialbinding = static_cast<SoMaterialBinding::Binding>(
+    SoMaterialBindingElement::get(state));
+  // an overall binding only uses the first material, so don't copy
+  // the whole material arrays for each shape
+  const SoLazyElement * lazy = SoLazyElement::getInstance(state);
+  const SbBool overall = (this->materialbinding == SoMaterialBinding::OVERALL);
+  const int numdiffuse = overall ? 1 : SbMax(lazy->getNumDiffuse(), 1);
+  for (int i = 0; i < numdiffuse; i++) {
+    this->diffuse.append(SoLazyElement::getDiffuse(state, i));
+  }
+  const int numtransp = overall ? 1 : SbMax(lazy->getNumTransparencies(), 1);
+  for (int i = 0; i < numtransp; i++) {
+    this->transparency.append(SoLazyElement::getTransparency(state, i));
+  }
+  this->normalbinding = static_cast<SoNormalBinding::Binding>(
+    SoNormalBindingElement::get(state));
+  this->texcoordbinding = static_cast<SoTextureCoordinateBinding::Binding>(
+    SoTextureCoordinateBindingElement::get(state));
+  this->vertexordering = static_cast<SoShapeHints::VertexOrdering>(
+    SoShapeHintsElement::getVertexOrdering(state));
+  this->shapetype = static_cast<SoShapeHints::ShapeType>(
+    SoShapeHintsElement::getShapeType(state));
+  this->facetype = static_cast<SoShapeHints::FaceType>(
+    SoShapeHintsElement::getFaceType(state));
+}
+
+void
+SoCallbackPrimitives::clear(void)
+{
+  this->shape = NULL;
+  this->shapeindex = -1;
+  this->diffuse.truncate(0);
+  this->transparency.truncate(0);
+  this->primitives.truncate(0);
+  this->vertices.truncate(0);
+  this->pointdetails.truncate(0);
+  this->faces.truncate(0);
+  for (int i = 0; i < this->details.getLength(); i++) {
+    delete this->details[i];
+  }
+  this->details.truncate(0);
+  this->lastdetail = NULL;
+  this->lastdetailtype = SoCallbackVertex::NONE;
+  this->lastdetailindex = -1;
+}
+
+void
+SoCallbackPrimitives::addPrimitive(const int numvertices,
+                                   const SoPrimitiveVertex * v1,
+                                   const SoPrimitiveVertex * v2,
+                                   const SoPrimitiveVertex * v3)
+{
+  this->primitives.append(static_cast<unsigned char>(numvertices));
+  // the shape may change the detail of the last primitive when
+  // making the next one
+  this->lastdetail = NULL;
+
+  const SoPrimitiveVertex * v[3] = { v1, v2, v3 };
+  for (int i = 0; i < numvertices; i++) {
+    SoCallbackVertex cv;
+    cv.point = v[i]->getPoint();
+    cv.normal = v[i]->getNormal();
+    cv.texcoords = v[i]->getTextureCoords();
+    cv.materialindex = v[i]->getMaterialIndex();
+    cv.packedcolor = v[i]->getPackedColor();
+    this->copyDetail(v[i]->getDetail(), cv);
+    this->vertices.append(cv);
+  }
+}
+
+static SbBool
+callbackaction_same_point(const SoPointDetail * p0, const SoPointDetail * p1)
+{
+  return
+    p0->getCoordinateIndex() == p1->getCoordinateIndex() &&
+    p0->getMaterialIndex() == p1->getMaterialIndex() &&
+    p0->getNormalIndex() == p1->getNormalIndex() &&
+    p0->getTextureCoordIndex() == p1->getTextureCoordIndex();
+}
+
+// Returns TRUE if face equals the last face stored.
+SbBool
+SoCallbackPrimitives::isLastFace(const SoFaceDetail * face) const
+{
+  if (this->lastdetailtype != SoCallbackVertex::FACE) return FALSE;
+  const SoCallbackFace & last = this->faces[this->lastdetailindex];
+  if (face->getFaceIndex() != last.faceindex ||
+      face->getPartIndex() != last.partindex ||
+      face->getNumPoints() != last.numpoints) return FALSE;
+  for (int i = 0; i < last.numpoints; i++) {
+    if (!callbackaction_same_point(face->getPoint(i),
+                                   this->pointdetails.getArrayPtr() + last.firstpoint + i)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// The details are owned by the shape, and only valid until the
+// callback returns. Point and face details, which nearly all shapes
+// use, are stored by value. Other details are copied.
+void
+SoCallbackPrimitives::copyDetail(const SoDetail * detail, SoCallbackVertex & cv)
+{
+  if (detail == NULL) {
+    cv.detailtype = SoCallbackVertex::NONE;
+    cv.detail = -1;
+    return;
+  }
+  if (detail != this->lastdetail) {
+    const SoType type = detail->getTypeId();
+    if (type == SoPointDetail::getClassTypeId()) {
+      this->lastdetailtype = SoCallbackVertex::POINT;
+      this->lastdetailindex = this->pointdetails.getLength();
+      this->pointdetails.append(*static_cast<const SoPointDetail *>(detail));
+    }
+    else if (type == SoFaceDetail::getClassTypeId()) {
+      const SoFaceDetail * face = static_cast<const SoFaceDetail *>(detail);
+      if (!this->isLastFace(face)) {
+        SoCallbackFace cf;
+        cf.faceindex = face->getFaceIndex();
+        cf.partindex = face->getPartIndex();
+        cf.firstpoint = this->pointdetails.getLength();
+        cf.numpoints = face->getNumPoints();
+        for (int i = 0; i < cf.numpoints; i++) {
+          this->pointdetails.append(*face->getPoint(i));
+        }
+        this->lastdetailtype = SoCallbackVertex::FACE;
+        this->lastdetailindex = this->faces.getLength();
+        this->faces.append(cf);
+      }
+    }
+    else {
+      this->lastdetailtype = SoCallbackVertex::OTHER;
+      this->lastdetailindex = this->details.getLength();
+      this->details.append(detail->copy());
+    }
+    this->lastdetail = detail;
+  }
+  cv.detailtype = this->lastdetailtype;
+  cv.detail = this->lastdetailindex;
+}
+
+// Sets up v from vertex idx. A face detail is set up in facedetail,
+// which must be one per vertex of the primitive.
+void
+SoCallbackPrimitives::getVertex(const int idx, SoPrimitiveVertex & v,
+                                SoFaceDetail & facedetail) const
+{
+  const SoCallbackVertex & cv = this->vertices[idx];
+  v.setPoint(cv.point);
+  v.setNormal(cv.normal);
+  v.setTextureCoords(cv.texcoords);
+  v.setMaterialIndex(cv.materialindex);
+  v.setPackedColor(cv.packedcolor);
+
+  SoDetail * detail = NULL;
+  switch (cv.detailtype) {
+  case SoCallbackVertex::POINT:
+    detail = const_cast<SoPointDetail *>(this->pointdetails.getArrayPtr() + cv.detail);
+    break;
+  case SoCallbackVertex::FACE:
+    {
+      const SoCallbackFace & cf = this->faces[cv.detail];
+      facedetail.setFaceIndex(cf.faceindex);
+      facedetail.setPartIndex(cf.partindex);
+      facedetail.setNumPoints(cf.numpoints);
+      for (int i = 0; i < cf.numpoints; i++) {
+        facedetail.setPoint(i, this->pointdetails.getArrayPtr() + cf.firstpoint + i);
+      }
+      detail = &facedetail;
+    }
+    break;
+  case SoCallbackVertex::OTHER:
+    detail = this->details[cv.detail];
+    break;
+  default:
+    break;
+  }
+  v.setDetail(detail);
+}
+
 // class to hold private, hidden data
 class SoCallbackActionP {
 public:
+  SoCallbackActionP(void)
+    : numthreads(1),
+      keepshapeorder(FALSE),
+      parallel(FALSE),
+      shapeopen(FALSE),
+      shapeindex(-1),
+      currentshape(NULL),
+      current(NULL),
+      master(NULL),
+      threadindex(0),
+      batch(NULL)
+#ifdef HAVE_THREADS
+      , pool(NULL),
+      pendingvertices(0),
+      done(FALSE)
+#endif // HAVE_THREADS
+  { }
+
   SbBool viewportset;
   SbViewportRegion viewport;
   SoCallbackAction::Response response;
@@ -344,6 +659,55 @@ public:
   SbList <SoCallbackData *> pointcallback;
 
   SbBool callbackall;
+
+  int numthreads;
+  SbBool keepshapeorder;
+  // TRUE while primitives are passed on to the worker threads
+  SbBool parallel;
+
+  // set when the first primitive of a shape is generated, and cleared
+  // when traversal moves on to the next node
+  SbBool shapeopen;
+  int shapeindex;
+  const SoShape * currentshape;
+  SoCallbackPrimitives * current;
+
+  // for the actions which invoke the primitive callbacks in the
+  // worker threads
+  SoCallbackActionP * master;
+  int threadindex;
+  const SoCallbackPrimitives * batch;
+
+  void beginShape(SoCallbackAction * action, const SoShape * shape);
+  SbBool addPrimitive(SoCallbackAction * action, const SoShape * shape,
+                    const int numvertices,
+                    const SoPrimitiveVertex * v1,
+                    const SoPrimitiveVertex * v2 = NULL,
+                    const SoPrimitiveVertex * v3 = NULL);
+  void flush(void);
+
+  static void invokePrimitiveCallbacks(SoCallbackAction * worker,
+                                       SoCallbackPrimitives * prims);
+
+#ifdef HAVE_THREADS
+  void startWorkers(void);
+  void stopWorkers(void);
+  static void workerLoop(void * closure);
+
+  // the threads running the workers. Each action has its own pool, so
+  // an action can be applied from the callbacks of another.
+  cc_wpool * pool;
+  SbList <SoCallbackAction *> workers;
+  // one queue for each worker when keeping the shape order, else a
+  // single shared queue
+  SbList < SbList <SoCallbackPrimitives *> * > queues;
+  SbList <SoCallbackPrimitives *> unused;
+  SbMutex mutex;
+  SbCondVar workcond;
+  SbCondVar spacecond;
+  int pendingvertices;
+  SbBool done;
+#endif // HAVE_THREADS
 };
 
 #endif // !DOXYGEN_SKIP_THIS
@@ -412,6 +776,197 @@ SoCallbackAction::initClass(void)
 
 #define PRIVATE(obj) ((obj)->pimpl)
 
+// Called for the first primitive of each shape visit.
+void
+SoCallbackActionP::beginShape(SoCallbackAction * action, const SoShape * shape)
+{
+  this->flush();
+  this->shapeopen = TRUE;
+  this->currentshape = shape;
+  this->shapeindex++;
+  if (this->parallel) {
+    SoCallbackPrimitives * prims = NULL;
+#ifdef HAVE_THREADS
+    this->mutex.lock();
+    if (this->unused.getLength()) prims = this->unused.pop();
+    this->mutex.unlock();
+#endif // HAVE_THREADS
+    if (prims == NULL) prims = new SoCallbackPrimitives;
+    prims->begin(action->getState(), shape, this->shapeindex);
+    this->current = prims;
+  }
+}
+
+// Counts the shapes, and collects their primitives when they are to
+// be passed on to the worker threads. Returns FALSE if the callbacks
+// should be invoked right away.
+SbBool
+SoCallbackActionP::addPrimitive(SoCallbackAction * action, const SoShape * shape,
+                                const int numvertices,
+                                const SoPrimitiveVertex * v1,
+                                const SoPrimitiveVertex * v2,
+                                const SoPrimitiveVertex * v3)
+{
+  if (!this->shapeopen || shape != this->currentshape) {
+    this->beginShape(action, shape);
+  }
+  if (this->current == NULL) return FALSE;
+
+  this->current->addPrimitive(numvertices, v1, v2, v3);
+  return TRUE;
+}
+
+// Hands the primitives of the current shape over to the workers.
+void
+SoCallbackActionP::flush(void)
+{
+  SoCallbackPrimitives * prims = this->current;
+  if (prims == NULL) return;
+  this->current = NULL;
+
+#ifdef HAVE_THREADS
+  const int numvertices = prims->vertices.getLength();
+  this->mutex.lock();
+  while (this->pendingvertices > 0 &&
+         this->pendingvertices + numvertices > CALLBACKACTION_MAX_PENDING_VERTICES) {
+    this->spacecond.wait(this->mutex);
+  }
+  this->pendingvertices += numvertices;
+  const int queue = this->keepshapeorder ? prims->shapeindex % this->queues.getLength() : 0;
+  this->queues[queue]->append(prims);
+  this->mutex.unlock();
+  this->workcond.wakeAll();
+#else // HAVE_THREADS
+  assert(0 && "should not happen");
+  delete prims;
+#endif // ! HAVE_THREADS
+}
+
+void
+SoCallbackActionP::invokePrimitiveCallbacks(SoCallbackAction * worker,
+                                            SoCallbackPrimitives * prims)
+{
+  SoCallbackActionP * p = PRIVATE(worker)->master;
+  PRIVATE(worker)->batch = prims;
+  PRIVATE(worker)->currentnode = const_cast<SoShape *>(prims->shape);
+
+  const int idx = static_cast<int>(prims->shape->getTypeId().getData());
+  SoCallbackData * tricb =
+    idx < p->trianglecallback.getLength() ? p->trianglecallback[idx] : NULL;
+  SoCallbackData * linecb =
+    idx < p->linecallback.getLength() ? p->linecallback[idx] : NULL;
+  SoCallbackData * pointcb =
+    idx < p->pointcallback.getLength() ? p->pointcallback[idx] : NULL;
+
+  SoPrimitiveVertex v[3];
+  SoFaceDetail facedetails[3];
+  const int numprims = prims->primitives.getLength();
+  int vertex = 0;
+  for (int i = 0; i < numprims; i++) {
+    const int numvertices = prims->primitives[i];
+    for (int j = 0; j < numvertices; j++) {
+      prims->getVertex(vertex++, v[j], facedetails[j]);
+    }
+    switch (numvertices) {
+    case 3:
+      if (tricb) tricb->doTriangleCallbacks(worker, &v[0], &v[1], &v[2]);
+      break;
+    case 2:
+      if (linecb) linecb->doLineSegmentCallbacks(worker, &v[0], &v[1]);
+      break;
+    default:
+      if (pointcb) pointcb->doPointCallbacks(worker, &v[0]);
+      break;
+    }
+  }
+
+  PRIVATE(worker)->batch = NULL;
+  PRIVATE(worker)->currentnode = NULL;
+}
+
+#ifdef HAVE_THREADS
+
+void
+SoCallbackActionP::startWorkers(void)
+{
+  while (this->workers.getLength() < this->numthreads) {
+    SoCallbackAction * worker = new SoCallbackAction;
+    PRIVATE(worker)->master = this;
+    PRIVATE(worker)->threadindex = this->workers.getLength();
+    this->workers.append(worker);
+  }
+  const int numqueues = this->keepshapeorder ? this->numthreads : 1;
+  while (this->queues.getLength() < numqueues) {
+    this->queues.append(new SbList <SoCallbackPrimitives *>);
+  }
+  while (this->queues.getLength() > numqueues) {
+    delete this->queues.pop();
+  }
+  this->pendingvertices = 0;
+  this->done = FALSE;
+
+  // the pool grows to the largest number of threads the action has
+  // been applied with
+  if (this->pool == NULL) {
+    this->pool = cc_wpool_construct(this->numthreads);
+  }
+  else if (cc_wpool_get_num_workers(this->pool) < this->numthreads) {
+    cc_wpool_set_num_workers(this->pool, this->numthreads);
+  }
+  cc_wpool_begin(this->pool, this->numthreads);
+  for (int i = 0; i < this->numthreads; i++) {
+    cc_wpool_start_worker(this->pool, SoCallbackActionP::workerLoop, this->workers[i]);
+  }
+  cc_wpool_end(this->pool);
+}
+
+// Waits for the workers to finish the queued primitives.
+void
+SoCallbackActionP::stopWorkers(void)
+{
+  this->mutex.lock();
+  this->done = TRUE;
+  this->mutex.unlock();
+  this->workcond.wakeAll();
+
+  cc_wpool_wait_all(this->pool);
+}
+
+void
+SoCallbackActionP::workerLoop(void * closure)
+{
+  SoCallbackAction * worker = static_cast<SoCallbackAction *>(closure);
+  SoCallbackActionP * p = PRIVATE(worker)->master;
+  SbList <SoCallbackPrimitives *> * queue =
+    p->queues[p->keepshapeorder ? PRIVATE(worker)->threadindex : 0];
+
+  p->mutex.lock();
+  for (;;) {
+    if (queue->getLength() == 0) {
+      if (p->done) break;
+      p->workcond.wait(p->mutex);
+      continue;
+    }
+    SoCallbackPrimitives * prims = (*queue)[0];
+    queue->remove(0);
+    p->mutex.unlock();
+
+    SoCallbackActionP::invokePrimitiveCallbacks(worker, prims);
+    const int numvertices = prims->vertices.getLength();
+    prims->clear();
+
+    p->mutex.lock();
+    p->unused.append(prims);
+    p->pendingvertices -= numvertices;
+    p->spacecond.wakeAll();
+  }
+  p->mutex.unlock();
+}
+
+#endif // HAVE_THREADS
+
+// *************************************************************************
+
 /*!
   Default constructor. Will set the viewport to a standard
   viewport with size 640x512.
@@ -486,6 +1041,19 @@ SoCallbackAction::~SoCallbackAction()
   if (PRIVATE(this)->posttailcallback) {
     PRIVATE(this)->posttailcallback->deleteAll();
   }
+
+#ifdef HAVE_THREADS
+  if (PRIVATE(this)->pool) cc_wpool_destruct(PRIVATE(this)->pool);
+  for (int i = 0; i < PRIVATE(this)->workers.getLength(); i++) {
+    delete PRIVATE(this)->workers[i];
+  }
+  for (int i = 0; i < PRIVATE(this)->queues.getLength(); i++) {
+    delete PRIVATE(this)->queues[i];
+  }
+  for (int i = 0; i < PRIVATE(this)->unused.getLength(); i++) {
+    delete PRIVATE(this)->unused[i];
+  }
+#endif // HAVE_THREADS
 }
 
 //
@@ -749,6 +1317,17 @@ SoCallbackAction::getMaterial(SbColor & ambient, SbColor & diffuse,
                               float & shininess, float & transparency,
                               const int index) const
 {
+  const SoCallbackPrimitives * batch = PRIVATE(this)->batch;
+  if (batch) {
+    ambient = batch->ambient;
+    diffuse = batch->diffuse[index < batch->diffuse.getLength() ? index : 0];
+    emission = batch->emission;
+    specular = batch->specular;
+    shininess = batch->shininess;
+    transparency =
+      batch->transparency[index < batch->transparency.getLength() ? index : 0];
+    return;
+  }
   ambient = SoLazyElement::getAmbient(this->state);
   diffuse = SoLazyElement::getDiffuse(this->state, index);
   emission = SoLazyElement::getEmissive(this->state);
@@ -763,6 +1342,7 @@ SoCallbackAction::getMaterial(SbColor & ambient, SbColor & diffuse,
 SoMaterialBinding::Binding
 SoCallbackAction::getMaterialBinding(void) const
 {
+  if (PRIVATE(this)->batch) return PRIVATE(this)->batch->materialbinding;
   return static_cast<SoMaterialBinding::Binding>(
     SoMaterialBindingElement::get(this->state)
     );
@@ -792,6 +1372,7 @@ SoCallbackAction::getNormal(const int index) const
 SoNormalBinding::Binding
 SoCallbackAction::getNormalBinding(void) const
 {
+  if (PRIVATE(this)->batch) return PRIVATE(this)->batch->normalbinding;
   return static_cast<SoNormalBinding::Binding>(
     SoNormalBindingElement::get(this->state)
     );
@@ -844,6 +1425,7 @@ SoCallbackAction::getProfile(void) const
 SoShapeHints::VertexOrdering
 SoCallbackAction::getVertexOrdering(void) const
 {
+  if (PRIVATE(this)->batch) return PRIVATE(this)->batch->vertexordering;
   return static_cast<SoShapeHints::VertexOrdering>(
     SoShapeHintsElement::getVertexOrdering(this->state)
     );
@@ -860,6 +1442,7 @@ SoCallbackAction::getVertexOrdering(void) const
 SoShapeHints::ShapeType
 SoCallbackAction::getShapeType(void) const
 {
+  if (PRIVATE(this)->batch) return PRIVATE(this)->batch->shapetype;
   return static_cast<SoShapeHints::ShapeType>(
     SoShapeHintsElement::getShapeType(this->state)
     );
@@ -877,6 +1460,7 @@ SoCallbackAction::getShapeType(void) const
 SoShapeHints::FaceType
 SoCallbackAction::getFaceType(void) const
 {
+  if (PRIVATE(this)->batch) return PRIVATE(this)->batch->facetype;
   return static_cast<SoShapeHints::FaceType>(
     SoShapeHintsElement::getFaceType(this->state)
     );
@@ -944,6 +1528,7 @@ SoCallbackAction::getTextureCoordinate4(const int index) const
 SoTextureCoordinateBinding::Binding
 SoCallbackAction::getTextureCoordinateBinding(void) const
 {
+  if (PRIVATE(this)->batch) return PRIVATE(this)->batch->texcoordbinding;
   return static_cast<SoTextureCoordinateBinding::Binding>(
     SoTextureCoordinateBindingElement::get(this->state)
     );
@@ -1035,6 +1620,7 @@ SoCallbackAction::getTextureWrapR(void) const
 const SbMatrix &
 SoCallbackAction::getModelMatrix(void) const
 {
+  if (PRIVATE(this)->batch) return PRIVATE(this)->batch->modelmatrix;
   return SoModelMatrixElement::get(this->state);
 }
 
@@ -1199,6 +1785,7 @@ SoCallbackAction::invokeTriangleCallbacks(const SoShape * const shape,
                                           const SoPrimitiveVertex * const v2,
                                           const SoPrimitiveVertex * const v3)
 {
+  if (PRIVATE(this)->addPrimitive(this, shape, 3, v1, v2, v3)) return;
   int idx = static_cast<int>(shape->getTypeId().getData());
   if (idx < PRIVATE(this)->trianglecallback.getLength() && PRIVATE(this)->trianglecallback[idx] != NULL)
     PRIVATE(this)->trianglecallback[idx]->doTriangleCallbacks(this, v1, v2, v3);
@@ -1214,6 +1801,7 @@ SoCallbackAction::invokeLineSegmentCallbacks(const SoShape * const shape,
                                              const SoPrimitiveVertex * const v1,
                                              const SoPrimitiveVertex * const v2)
 {
+  if (PRIVATE(this)->addPrimitive(this, shape, 2, v1, v2)) return;
   int idx = static_cast<int>(shape->getTypeId().getData());
   if (idx < PRIVATE(this)->linecallback.getLength() && PRIVATE(this)->linecallback[idx] != NULL)
     PRIVATE(this)->linecallback[idx]->doLineSegmentCallbacks(this, v1, v2);
@@ -1228,6 +1816,7 @@ void
 SoCallbackAction::invokePointCallbacks(const SoShape * const shape,
                                        const SoPrimitiveVertex * const v)
 {
+  if (PRIVATE(this)->addPrimitive(this, shape, 1, v)) return;
   int idx = static_cast<int>(shape->getTypeId().getData());
   if (idx < PRIVATE(this)->pointcallback.getLength() && PRIVATE(this)->pointcallback[idx] != NULL)
     PRIVATE(this)->pointcallback[idx]->doPointCallbacks(this, v);
@@ -1271,6 +1860,7 @@ void
 SoCallbackAction::setCurrentNode(SoNode * const node)
 {
   PRIVATE(this)->currentnode = node;
+  PRIVATE(this)->shapeopen = FALSE;
 }
 
 // Documented in superclass. Overridden from parent class to
@@ -1286,7 +1876,27 @@ SoCallbackAction::beginTraversal(SoNode * node)
   if (PRIVATE(this)->viewportset) {
     SoViewportRegionElement::set(this->getState(), PRIVATE(this)->viewport);
   }
+
+  PRIVATE(this)->shapeopen = FALSE;
+  PRIVATE(this)->shapeindex = -1;
+#ifdef HAVE_THREADS
+  // an action re-applied from its own callbacks invokes the primitive
+  // callbacks itself, since its workers are busy
+  const SbBool wasparallel = PRIVATE(this)->parallel;
+  PRIVATE(this)->parallel = PRIVATE(this)->numthreads > 1 && !wasparallel;
+  if (PRIVATE(this)->parallel) PRIVATE(this)->startWorkers();
+#endif // HAVE_THREADS
+
   this->traverse(node);
+
+#ifdef HAVE_THREADS
+  if (PRIVATE(this)->parallel) {
+    PRIVATE(this)->flush();
+    PRIVATE(this)->stopWorkers();
+  }
+  PRIVATE(this)->parallel = wasparallel;
+#endif // HAVE_THREADS
+  PRIVATE(this)->currentshape = NULL;
 }
 
 void SoCallbackAction::setCallbackAll(SbBool callbackall)
@@ -1299,6 +1909,118 @@ SbBool SoCallbackAction::isCallbackAll(void) const
   return PRIVATE(this)->callbackall;
 }
 
+/*!
+  Sets the number of threads used to invoke the triangle, line segment
+  and point callbacks. The default is 1, which invokes the callbacks
+  from the traversing thread as the primitives are generated.
+
+  With more threads, the primitives of each shape are collected along
+  with the state the callbacks are likely to need, and handed over to
+  worker threads while traversal continues. The callbacks must then be
+  thread safe, and will be called with a per thread action instance.
+  Only getModelMatrix(), getMaterial(), getMaterialBinding(),
+  getNormalBinding(), getTextureCoordinateBinding(),
+  getVertexOrdering(), getShapeType(), getFaceType(),
+  getCurPathTail(), getThreadIndex() and getShapeIndex() can be used
+  on that action. With an OVERALL material binding, getMaterial()
+  returns the first material for any index on that action. The
+  details of the primitive vertices are copies which are only valid
+  while the callback runs. Node callbacks are
+  still invoked from the traversing thread.
+
+  All callbacks have been invoked when SoAction::apply() returns.
+  Each action has its own threads, so actions can be applied
+  concurrently, and from the callbacks of other actions. An action
+  re-applied from its own callbacks invokes the primitive callbacks
+  itself.
+
+  This method is an extension versus the Open Inventor API.
+
+  \sa setKeepShapeOrder()
+  \since Coin 4.0
+*/
+void
+SoCallbackAction::setNumThreads(const int numthreads)
+{
+  PRIVATE(this)->numthreads = SbMax(numthreads, 1);
+#ifndef HAVE_THREADS
+  PRIVATE(this)->numthreads = 1;
+#endif // !HAVE_THREADS
+}
+
+/*!
+  Returns the number of threads used to invoke the primitive
+  callbacks.
+
+  \sa setNumThreads()
+  \since Coin 4.0
+*/
+int
+SoCallbackAction::getNumThreads(void) const
+{
+  return PRIVATE(this)->numthreads;
+}
+
+/*!
+  When \a onoff is TRUE, shape number \e i in traversal order is
+  handled by thread number \e i modulo getNumThreads(), and each
+  thread handles its shapes in traversal order. This makes it possible
+  to keep per thread results which can be merged in a deterministic
+  order afterwards. The default is FALSE, which lets an idle thread
+  take the next shape.
+
+  \sa setNumThreads(), getThreadIndex(), getShapeIndex()
+  \since Coin 4.0
+*/
+void
+SoCallbackAction::setKeepShapeOrder(const SbBool onoff)
+{
+  PRIVATE(this)->keepshapeorder = onoff;
+}
+
+/*!
+  Returns whether shapes are assigned to the threads in traversal
+  order.
+
+  \sa setKeepShapeOrder()
+  \since Coin 4.0
+*/
+SbBool
+SoCallbackAction::isKeepShapeOrder(void) const
+{
+  return PRIVATE(this)->keepshapeorder;
+}
+
+/*!
+  Returns the index of the thread invoking the primitive callback,
+  from 0 to getNumThreads() - 1. Returns 0 when the callbacks are
+  invoked from the traversing thread.
+
+  \sa setNumThreads()
+  \since Coin 4.0
+*/
+int
+SoCallbackAction::getThreadIndex(void) const
+{
+  return PRIVATE(this)->threadindex;
+}
+
+/*!
+  Returns the index, in traversal order, of the shape the current
+  primitive callback is invoked for. Only shapes which generated
+  primitives are counted, and a shape traversed several times is
+  counted once for each time.
+
+  \sa setKeepShapeOrder()
+  \since Coin 4.0
+*/
+int
+SoCallbackAction::getShapeIndex(void) const
+{
+  if (PRIVATE(this)->batch) return PRIVATE(this)->batch->shapeindex;
+  return PRIVATE(this)->shapeindex;
+}
+
 #undef PRIVATE
 
 #ifdef COIN_TEST_SUITE
@@ -1337,4 +2059,252 @@ BOOST_AUTO_TEST_CASE(callbackall)
   sw->unref();
 }
 
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/SbVec3d.h>
+
+namespace {
+
+struct ThreadResult {
+  ThreadResult(void) : numtriangles(0), sum(0.0, 0.0, 0.0), lastshape(-1), inorder(TRUE) { }
+  int numtriangles;
+  SbVec3d sum;
+  int lastshape;
+  SbBool inorder;
+};
+
+void
+triangleCB(void * userdata, SoCallbackAction * action,
+           const SoPrimitiveVertex * v1,
+           const SoPrimitiveVertex * v2,
+           const SoPrimitiveVertex * v3)
+{
+  ThreadResult * result =
+    static_cast<ThreadResult *>(userdata) + action->getThreadIndex();
+  const SoPrimitiveVertex * v[3] = { v1, v2, v3 };
+  for (int i = 0; i < 3; i++) {
+    SbVec3f p;
+    action->getModelMatrix().multVecMatrix(v[i]->getPoint(), p);
+    result->sum += SbVec3d(p[0], p[1], p[2]);
+  }
+  result->numtriangles++;
+  const int shape = action->getShapeIndex();
+  if (shape < result->lastshape) result->inorder = FALSE;
+  if (action->isKeepShapeOrder() &&
+      shape % action->getNumThreads() != action->getThreadIndex()) {
+    result->inorder = FALSE;
+  }
+  result->lastshape = shape;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(threads)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  for (int i = 0; i < 20; i++) {
+    SoTranslation * t = new SoTranslation;
+    t->translation = SbVec3f(1.0f, 0.5f, 0.0f);
+    root->addChild(t);
+    root->addChild(i % 2 ? static_cast<SoNode *>(new SoSphere) : new SoCube);
+  }
+
+  ThreadResult serial;
+  SoCallbackAction cba;
+  cba.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, &serial);
+  cba.apply(root);
+  BOOST_CHECK_MESSAGE(serial.numtriangles > 0, "Should generate triangles");
+  BOOST_CHECK_MESSAGE(serial.inorder, "Should get shapes in traversal order");
+
+  for (int keeporder = 0; keeporder < 2; keeporder++) {
+    ThreadResult results[4];
+    SoCallbackAction threaded;
+    threaded.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, results);
+    threaded.setNumThreads(4);
+    threaded.setKeepShapeOrder(keeporder ? TRUE : FALSE);
+    threaded.apply(root);
+
+    ThreadResult total;
+    for (int i = 0; i < 4; i++) {
+      total.numtriangles += results[i].numtriangles;
+      total.sum += results[i].sum;
+      if (!results[i].inorder) total.inorder = FALSE;
+    }
+    BOOST_CHECK_MESSAGE(total.numtriangles == serial.numtriangles,
+                        "Should get the same triangles from the threads");
+    BOOST_CHECK_MESSAGE((total.sum - serial.sum).length() < 1.0e-3,
+                        "Should get the same model matrices in the threads");
+    if (keeporder) {
+      BOOST_CHECK_MESSAGE(total.inorder,
+                          "Should get the shapes of each thread in order");
+    }
+  }
+
+  root->unref();
+}
+
+#include <Inventor/threads/SbThread.h>
+
+namespace {
+
+struct ConcurrentApply {
+  SoNode * root;
+  ThreadResult results[2];
+};
+
+void *
+concurrent_apply(void * closure)
+{
+  ConcurrentApply * data = static_cast<ConcurrentApply *>(closure);
+  for (int i = 0; i < 5; i++) {
+    SoCallbackAction threaded;
+    threaded.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, data->results);
+    threaded.setNumThreads(2);
+    threaded.apply(data->root);
+  }
+  return NULL;
+}
+
+struct NestedApply {
+  SoNode * child;
+  ThreadResult results[2];
+  int numapplied;
+};
+
+SoCallbackAction::Response
+nested_apply(void * userdata, SoCallbackAction *, const SoNode *)
+{
+  NestedApply * data = static_cast<NestedApply *>(userdata);
+  SoCallbackAction nested;
+  nested.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, data->results);
+  nested.setNumThreads(2);
+  nested.apply(data->child);
+  data->numapplied++;
+  return SoCallbackAction::CONTINUE;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(concurrentThreads)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  for (int i = 0; i < 10; i++) {
+    root->addChild(new SoSphere);
+  }
+  ThreadResult serial;
+  SoCallbackAction cba;
+  cba.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, &serial);
+  cba.apply(root);
+
+  // threaded actions applied at the same time from different threads
+  ConcurrentApply data[3];
+  SbThread * threads[3];
+  for (int i = 0; i < 3; i++) {
+    data[i].root = root;
+    threads[i] = SbThread::create(concurrent_apply, &data[i]);
+  }
+  for (int i = 0; i < 3; i++) {
+    threads[i]->join();
+    SbThread::destroy(threads[i]);
+    BOOST_CHECK_MESSAGE(data[i].results[0].numtriangles + data[i].results[1].numtriangles ==
+                        5 * serial.numtriangles,
+                        "Should get all triangles from concurrent actions");
+  }
+
+  // a threaded action applied from the callbacks of another
+  NestedApply nested;
+  nested.child = root->getChild(0);
+  nested.numapplied = 0;
+  ThreadResult outer[2];
+  SoCallbackAction threaded;
+  threaded.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, outer);
+  threaded.addPreCallback(SoSphere::getClassTypeId(), nested_apply, &nested);
+  threaded.setNumThreads(2);
+  threaded.apply(root);
+  BOOST_CHECK_MESSAGE(outer[0].numtriangles + outer[1].numtriangles == serial.numtriangles,
+                      "Should get all triangles from the outer action");
+  BOOST_CHECK_MESSAGE(nested.results[0].numtriangles + nested.results[1].numtriangles ==
+                      nested.numapplied * serial.numtriangles / 10,
+                      "Should get all triangles from the nested actions");
+
+  root->unref();
+}
+
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+
+namespace {
+
+struct MaterialResult {
+  MaterialResult(void) : numtriangles(0), sum(0.0, 0.0, 0.0) { }
+  int numtriangles;
+  SbVec3d sum;
+};
+
+// sums the diffuse color and transparency of each triangle vertex
+void
+material_triangle_cb(void * userdata, SoCallbackAction * action,
+                     const SoPrimitiveVertex * v1,
+                     const SoPrimitiveVertex * v2,
+                     const SoPrimitiveVertex * v3)
+{
+  MaterialResult * result =
+    static_cast<MaterialResult *>(userdata) + action->getThreadIndex();
+  const SoPrimitiveVertex * v[3] = { v1, v2, v3 };
+  for (int i = 0; i < 3; i++) {
+    SbColor ambient, diffuse, specular, emission;
+    float shininess, transparency;
+    action->getMaterial(ambient, diffuse, specular, emission,
+                        shininess, transparency, v[i]->getMaterialIndex());
+    result->sum += SbVec3d(diffuse[0], diffuse[1], diffuse[2] + transparency);
+  }
+  result->numtriangles++;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(threadedMaterials)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoMaterial * material = new SoMaterial;
+  for (int i = 0; i < 6; i++) {
+    material->diffuseColor.set1Value(i, SbColor(0.1f * i, 0.5f, 1.0f - 0.1f * i));
+    material->transparency.set1Value(i, 0.05f * i);
+  }
+  root->addChild(material);
+  SoMaterialBinding * binding = new SoMaterialBinding;
+  root->addChild(binding);
+  root->addChild(new SoCube);
+
+  const SoMaterialBinding::Binding bindings[] = {
+    SoMaterialBinding::OVERALL, SoMaterialBinding::PER_FACE
+  };
+  for (int b = 0; b < 2; b++) {
+    binding->value = bindings[b];
+
+    MaterialResult serial;
+    SoCallbackAction cba;
+    cba.addTriangleCallback(SoShape::getClassTypeId(), material_triangle_cb, &serial);
+    cba.apply(root);
+
+    MaterialResult results[2];
+    SoCallbackAction threaded;
+    threaded.addTriangleCallback(SoShape::getClassTypeId(), material_triangle_cb, results);
+    threaded.setNumThreads(2);
+    threaded.apply(root);
+
+    const SbVec3d sum = results[0].sum + results[1].sum;
+    BOOST_CHECK_EQUAL(results[0].numtriangles + results[1].numtriangles, serial.numtriangles);
+    BOOST_CHECK_MESSAGE((sum - serial.sum).length() < 1.0e-4,
+                        "Should get the same materials in the threads, binding " << b);
+  }
+
+  root->unref();
+}
+
 #endif // COIN_TEST_SUITE
@@ -73,8 +73,11 @@
 #include <Inventor/C/glue/gl.h>
 #include <Inventor/C/tidbits.h>
 #include <Inventor/SbColor.h>
+#include <Inventor/SbOcclusionBuffer.h>
 #include <Inventor/SbPlane.h>
+#include <Inventor/SoPrimitiveVertex.h>
 #include <Inventor/SoFullPath.h>
+#include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
 #include <Inventor/actions/SoSearchAction.h>
 #include <Inventor/caches/SoBoundingBoxCache.h>
@@ -595,6 +598,22 @@ public:
 
   SbBool hasTransparentShadowObject;
 
+  // occlusion culling
+  SoNode * occluders;
+  SbOcclusionBuffer occlusionbuffer;
+  SbBool occlusionvalid;
+  SbUniqueId occludersid;
+  SbMatrix occlusionviewproj;
+  SbVec2s occlusionvpsize;
+  SbMatrix occludermodelmatrix;
+  SbMatrix occluderobjtoclip;
+  boost::scoped_ptr<SoCallbackAction> occluderaction;
+  void updateOcclusionBuffer(SoState * state);
+  static void occluderTriangleCB(void * closure, SoCallbackAction * action,
+                                 const SoPrimitiveVertex * v1,
+                                 const SoPrimitiveVertex * v2,
+                                 const SoPrimitiveVertex * v3);
+
   void setupSortedLayersBlendTextures(const SoState * state);
   void doSortedLayersBlendRendering(const SoState * state, SoNode * node);
   void initSortedLayersBlendRendering(const SoState * state);
@@ -742,6 +761,10 @@ SoGLRenderAction::SoGLRenderAction(const SbViewportRegion & viewportregion)
   PRIVATE(this)->sortedobjectclosure = NULL;
 
   PRIVATE(this)->hasTransparentShadowObject = FALSE;
+
+  PRIVATE(this)->occluders = NULL;
+  PRIVATE(this)->occlusionvalid = FALSE;
+  PRIVATE(this)->occludersid = 0;
 }
 
 /*!
@@ -749,6 +772,7 @@ SoGLRenderAction::SoGLRenderAction(const SbViewportRegion & viewportregion)
 */
 SoGLRenderAction::~SoGLRenderAction()
 {
+  if (PRIVATE(this)->occluders) PRIVATE(this)->occluders->unref();
 }
 
 /*!
@@ -767,6 +791,101 @@ SoGLRenderAction::resetTransparentShadowObject()
   PRIVATE(this)->hasTransparentShadowObject = FALSE;
 }
 
+/*!
+  Enables occlusion culling, using the shapes in \a occluders as
+  occluders. Pass \c NULL to disable occlusion culling again, which is
+  the default.
+
+  The occluder scene graph should contain a few large and simple
+  shapes, for instance simplified versions of walls and buildings, or
+  SoCube nodes covering the inside of large objects. Its coordinates
+  are in world space, and any camera in it is ignored. The occluders
+  must be inside the geometry they represent, otherwise objects that
+  are really visible may be culled.
+
+  The occluders are rasterized into a small software depth buffer
+  (see SbOcclusionBuffer) by the first occlusion test in each frame,
+  and again if the camera changes during the frame.
+  SoSeparator nodes with a valid bounding box cache then test their
+  bounding box against this buffer in addition to the view volume
+  when culling, and are not rendered if they are completely hidden.
+
+  Culled separators are marked with SbProfilingData::CULLED_FLAG when
+  the profiler is enabled, and the number of tests and culled boxes
+  are added to the SbProfilingData::OCCLUSION_TESTS and
+  SbProfilingData::OCCLUSION_CULLED action statistics.
+  getOcclusionBuffer() can also be used to read these numbers for the
+  last frame.
+
+  \sa isOccluded()
+  \since Coin 4.0
+*/
+void
+SoGLRenderAction::setOccluders(SoNode * occluders)
+{
+  if (occluders) occluders->ref();
+  if (PRIVATE(this)->occluders) PRIVATE(this)->occluders->unref();
+  PRIVATE(this)->occluders = occluders;
+  PRIVATE(this)->occlusionvalid = FALSE;
+}
+
+/*!
+  Returns the occluder scene graph set with setOccluders().
+
+  \since Coin 4.0
+*/
+SoNode *
+SoGLRenderAction::getOccluders(void) const
+{
+  return PRIVATE(this)->occluders;
+}
+
+/*!
+  Returns \c TRUE if \a box, which is in the current object space,
+  is completely hidden by the occluders. Always returns \c FALSE if
+  no occluders have been set.
+
+  This is used by SoSeparator when culling, but might also be useful
+  for custom nodes doing their own culling.
+
+  \sa setOccluders()
+  \since Coin 4.0
+*/
+SbBool
+SoGLRenderAction::isOccluded(const SbBox3f & box)
+{
+  if (PRIVATE(this)->occluders == NULL || box.isEmpty()) return FALSE;
+
+  SoState * state = this->getState();
+  PRIVATE(this)->updateOcclusionBuffer(state);
+  const SbBool occluded =
+    PRIVATE(this)->occlusionbuffer.isOccluded(box, SoModelMatrixElement::get(state) *
+                                              PRIVATE(this)->occlusionviewproj);
+
+  if (SoProfiler::isEnabled()) {
+    SoProfilerElement * elt = SoProfilerElement::get(state);
+    if (elt) {
+      SbProfilingData & data = elt->getProfilingData();
+      data.addActionStatistic(SbProfilingData::OCCLUSION_TESTS, 1.0);
+      if (occluded) data.addActionStatistic(SbProfilingData::OCCLUSION_CULLED, 1.0);
+    }
+  }
+  return occluded;
+}
+
+/*!
+  Returns the occlusion buffer used for occlusion culling. It is only
+  updated while rendering with occluders set.
+
+  \sa setOccluders()
+  \since Coin 4.0
+*/
+const SbOcclusionBuffer &
+SoGLRenderAction::getOcclusionBuffer(void) const
+{
+  return PRIVATE(this)->occlusionbuffer;
+}
+
 /*!
   Sets the viewport region for rendering. This will then override the
   region passed in with the constructor.
@@ -1657,6 +1776,68 @@ SoGLRenderAction::setSortedObjectOrderStrategy(const SortedObjectOrderStrategy s
 // *************************************************************************
 // methods in SoGLRenderActionP
 
+// Rasterizes the occluders into the occlusion buffer, unless it has
+// already been done for this frame with the same camera and viewport.
+void
+SoGLRenderActionP::updateOcclusionBuffer(SoState * state)
+{
+  const SbMatrix viewproj =
+    SoViewingMatrixElement::get(state) * SoProjectionMatrixElement::get(state);
+  const SbVec2s vpsize =
+    SoViewportRegionElement::get(state).getViewportSizePixels();
+
+  if (this->occlusionvalid &&
+      this->occludersid == this->occluders->getNodeId() &&
+      this->occlusionvpsize == vpsize &&
+      this->occlusionviewproj == viewproj) return;
+
+  this->occlusionvalid = TRUE;
+  this->occludersid = this->occluders->getNodeId();
+  this->occlusionvpsize = vpsize;
+  this->occlusionviewproj = viewproj;
+
+  // a buffer of at most 256 pixels along each axis is plenty for the
+  // coarse occluders we expect
+  const int maxdim = SbMax(vpsize[0], vpsize[1]);
+  SbVec2s size = vpsize;
+  if (maxdim > 256) {
+    size.setValue(short(SbMax(1, vpsize[0] * 256 / maxdim)),
+                  short(SbMax(1, vpsize[1] * 256 / maxdim)));
+  }
+  if (size != this->occlusionbuffer.getSize()) {
+    this->occlusionbuffer.setSize(size);
+  }
+  else {
+    this->occlusionbuffer.clear();
+  }
+
+  if (!this->occluderaction) {
+    this->occluderaction.reset(new SoCallbackAction);
+    this->occluderaction->addTriangleCallback(SoShape::getClassTypeId(),
+                                              occluderTriangleCB, this);
+  }
+  this->occluderaction->setViewportRegion(SoViewportRegionElement::get(state));
+  this->occludermodelmatrix.makeIdentity();
+  this->occluderobjtoclip = viewproj;
+  this->occluderaction->apply(this->occluders);
+}
+
+void
+SoGLRenderActionP::occluderTriangleCB(void * closure, SoCallbackAction * action,
+                                      const SoPrimitiveVertex * v1,
+                                      const SoPrimitiveVertex * v2,
+                                      const SoPrimitiveVertex * v3)
+{
+  SoGLRenderActionP * thisp = static_cast<SoGLRenderActionP *>(closure);
+  const SbMatrix & mm = action->getModelMatrix();
+  if (mm != thisp->occludermodelmatrix) {
+    thisp->occludermodelmatrix = mm;
+    thisp->occluderobjtoclip = mm * thisp->occlusionviewproj;
+  }
+  const SbVec3f tri[3] = { v1->getPoint(), v2->getPoint(), v3->getPoint() };
+  thisp->occlusionbuffer.addTriangles(tri, 1, thisp->occluderobjtoclip);
+}
+
 // Private function to save transparent paths that need to be sorted.
 // The transparent paths that don't need to be sorted are rendered
 // after the sorted ones.
@@ -1765,6 +1946,8 @@ void
 SoGLRenderActionP::render(SoNode * node)
 {
   this->isrendering = TRUE;
+  // rasterize occluders again for each frame
+  this->occlusionvalid = FALSE;
 
   SoState * state = this->action->getState();
   state->push();
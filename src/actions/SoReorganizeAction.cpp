@@ -244,6 +244,34 @@
 
   \endcode
 
+  Triangles are reordered for the post-transform vertex cache of the
+  graphics card, using Tom Forsyth's linear-speed vertex cache
+  optimization algorithm, and vertices are renumbered in the order
+  they are first used by the triangles, so that vertex data is read
+  sequentially from memory. The quality of the triangle order is
+  measured by the average cache miss ratio (ACMR), which is the
+  number of vertices transformed per triangle when rendered through a
+  FIFO vertex cache of a given size. The ACMR of the original and the
+  reorganized geometry can be read back using
+  getAverageCacheMissRatio() after the action has been applied. Set
+  the environment variable COIN_DEBUG_REORGANIZE to 1 to print the
+  ACMR for each reorganized shape.
+
+  If mergeShapes() is enabled, static triangle shapes rendered with
+  the same material, texture, draw style, light model and shape hints
+  are merged into a single SoIndexedFaceSet, with the transformations
+  baked into the vertices. This removes the traversal and draw
+  overhead of scenes made from many small shapes, each in its own
+  SoSeparator. The merged shapes are added to the end of the root
+  node, and separators left with only property nodes are removed. The
+  original shape of a picked triangle can be found using
+  getOriginalPath().
+
+  If generateTriangleStrips() is enabled, triangle shapes are
+  replaced by SoIndexedTriangleStripSet nodes, with strips separated
+  by -1 in the coordIndex field. Note that VRML97 has no triangle
+  strip node, so VRML shapes are always written as triangle lists.
+
   \since Coin 2.5
 
 */
@@ -256,6 +284,8 @@
 
 #include <cstring>
 #include <cassert>
+#include <cmath>
+#include <cstdlib>
 
 #include <Inventor/SbName.h>
 #include <Inventor/actions/SoCallbackAction.h>
@@ -267,6 +297,25 @@
 #include <Inventor/nodes/SoNormal.h>
 #include <Inventor/nodes/SoIndexedFaceSet.h>
 #include <Inventor/nodes/SoIndexedLineSet.h>
+#include <Inventor/nodes/SoIndexedTriangleStripSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoPackedColor.h>
+#include <Inventor/nodes/SoDrawStyle.h>
+#include <Inventor/nodes/SoLightModel.h>
+#include <Inventor/nodes/SoShapeHints.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoCoordinate4.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
+#include <Inventor/nodes/SoTexture.h>
+#include <Inventor/nodes/SoTransformation.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoInfo.h>
+#include <Inventor/nodes/SoLabel.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/nodes/SoLight.h>
 #include <Inventor/nodes/SoVertexProperty.h>
 #include <Inventor/nodes/SoTextureCoordinate2.h>
 #include <Inventor/nodes/SoGroup.h>
@@ -277,8 +326,23 @@
 #include <Inventor/elements/SoShapeStyleElement.h>
 #include <Inventor/elements/SoLightModelElement.h>
 #include <Inventor/elements/SoNormalElement.h>
+#include <Inventor/elements/SoModelMatrixElement.h>
+#include <Inventor/elements/SoDrawStyleElement.h>
+#include <Inventor/elements/SoPointSizeElement.h>
+#include <Inventor/elements/SoLineWidthElement.h>
+#include <Inventor/elements/SoLinePatternElement.h>
+#include <Inventor/elements/SoShapeHintsElement.h>
+#include <Inventor/elements/SoMultiTextureMatrixElement.h>
+#include <Inventor/details/SoFaceDetail.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/lists/SoNodeList.h>
+#include <Inventor/misc/SoTempPath.h>
 #include <Inventor/caches/SoPrimitiveVertexCache.h>
 #include <Inventor/SbColor4f.h>
+#include <Inventor/C/tidbits.h>
+#include <Inventor/errors/SoDebugError.h>
 
 #ifdef HAVE_VRML97
 #include <Inventor/VRMLnodes/SoVRMLCoordinate.h>
@@ -292,9 +356,82 @@
 #endif // HAVE_VRML97
 
 #include "coindefs.h" // COIN_STUB()
+#include "misc/SbHash.h"
 #include "SbBasicP.h"
 #include "actions/SoSubActionP.h"
 
+// The state a shape is rendered with. Shapes with the same state can
+// be merged.
+class SoReorganizeShapeState {
+public:
+  SbBool operator==(const SoReorganizeShapeState & s) const {
+    return
+      this->ambient == s.ambient &&
+      this->diffuse == s.diffuse &&
+      this->specular == s.specular &&
+      this->emissive == s.emissive &&
+      this->shininess == s.shininess &&
+      this->drawstyle == s.drawstyle &&
+      this->pointsize == s.pointsize &&
+      this->linewidth == s.linewidth &&
+      this->linepattern == s.linepattern &&
+      this->lighting == s.lighting &&
+      this->vertexordering == s.vertexordering &&
+      this->shapetype == s.shapetype &&
+      this->colorpervertex == s.colorpervertex &&
+      this->hastexture == s.hastexture &&
+      this->texture == s.texture;
+  }
+  uint32_t hash(void) const {
+    uint32_t h = this->diffuse;
+    h = h * 31 + this->ambient.getPackedValue();
+    h = h * 31 + this->specular.getPackedValue();
+    h = h * 31 + this->emissive.getPackedValue();
+    h = h * 31 + uint32_t(this->shininess * 255.0f);
+    h = h * 31 + uint32_t(this->drawstyle);
+    h = h * 31 + uint32_t(this->lighting);
+    h = h * 31 + uint32_t(this->vertexordering * 4 + this->shapetype);
+    h = h * 31 + uint32_t(this->colorpervertex * 2 + this->hastexture);
+    return h * 31 + uint32_t(reinterpret_cast<uintptr_t>(this->texture));
+  }
+
+  SbColor ambient;
+  uint32_t diffuse; // diffuse color and transparency, if not per vertex
+  SbColor specular;
+  SbColor emissive;
+  float shininess;
+  int drawstyle;
+  float pointsize;
+  float linewidth;
+  int32_t linepattern;
+  SbBool lighting;
+  int vertexordering;
+  int shapetype;
+  SbBool colorpervertex;
+  SbBool hastexture;
+  SoNode * texture;
+};
+
+// Shapes merged into one SoIndexedFaceSet.
+class SoReorganizeBatch {
+public:
+  SoReorganizeShapeState state;
+  int nextsamehash;
+
+  SbList <SbVec3f> vertices;
+  SbList <SbVec3f> normals;
+  SbList <SbVec2f> texcoords;
+  SbList <uint32_t> colors;
+  SbList <int32_t> indices;
+
+  // the first triangle of each merged shape, and the path to the
+  // shape in the original scene graph
+  SbList <int> firsttriangle;
+  SbList <SoTempPath *> paths;
+  SoNodeList pathnodes;
+  SoNode * mergedshape;
+};
+
 class SoReorganizeActionP {
  public:
   SoReorganizeActionP(void)
@@ -304,9 +441,18 @@ class SoReorganizeActionP {
       gentristrips(FALSE),
       genvp(FALSE),
       matchidx(TRUE),
+      optimizecache(TRUE),
+      cachesize(32),
+      mergeshapes(FALSE),
+      merging(FALSE),
+      applydepth(0),
       cbaction(SbViewportRegion(640, 480)),
       pvcache(NULL)
   {
+    this->resetStatistics();
+    this->roottransformed = FALSE;
+    this->lastrootstate = -1;
+
     cbaction.addTriangleCallback(SoVertexShape::getClassTypeId(), triangle_cb, this);
     cbaction.addLineSegmentCallback(SoVertexShape::getClassTypeId(), line_segment_cb, this);
 
@@ -340,6 +486,11 @@ class SoReorganizeActionP {
   SbBool gentristrips;
   SbBool genvp;
   SbBool matchidx;
+  SbBool optimizecache;
+  int cachesize;
+  SbBool mergeshapes;
+  SbBool merging;
+  int applydepth;
   SbList <SbBool> needtexcoords;
   int lastneeded;
   int numtriangles;
@@ -352,11 +503,38 @@ class SoReorganizeActionP {
   SbColor4f diffusecolor;
   SbBool lighting;
   SbBool normalsonstate;
+  SbMatrix modelmatrix;
+  SbBool roottransformed;
+  // the last child of the root which changes the state of the nodes
+  // after it, and the plain groups found to do so
+  int lastrootstate;
+  SbHash <const SoNode *, SbBool> leakinggroups;
+  SbBool texturematrixidentity;
+  SoReorganizeShapeState shapestate;
 
   SoCallbackAction cbaction;
   SoSearchAction sa;
   SoPrimitiveVertexCache * pvcache;
 
+  // the optimized triangle, strip or line indices of the current
+  // shape, and the vertex cache index of each new vertex
+  SbList <int32_t> indices;
+  SbList <int32_t> vertexorder;
+  SbBool isstrips;
+
+  // triangles and simulated cache misses for all shapes since the
+  // last apply()
+  double stattriangles;
+  double statmissesbefore;
+  double statmissesafter;
+
+  // batches of merged shapes, and the shapes to remove from the scene
+  // graph when done
+  SbList <SoReorganizeBatch *> batches;
+  SbHash <uint32_t, int> batchdict;
+  SbList <SoGroup *> removeparents;
+  SbList <SoNode *> removeshapes;
+
   static SoCallbackAction::Response pre_shape_cb(void * userdata, SoCallbackAction * action, const SoNode * node);
   static SoCallbackAction::Response post_shape_cb(void * userdata, SoCallbackAction * action, const SoNode * node);
   static void triangle_cb(void * userdata, SoCallbackAction * action,
@@ -369,8 +547,18 @@ class SoReorganizeActionP {
                               const SoPrimitiveVertex * v2);
 
   SbBool initShape(SoCallbackAction * action);
+  void resetStatistics(void);
+  void optimizeIndices(const GLint * src, const int numindices, const int primsize,
+                       const SbBool strips);
+  void copyVertexData(SoMFVec3f & field, const SbVec3f * src) const;
   void replaceNode(SoFullPath * path);
+  SbBool leaksState(const SoNode * node);
+  SbBool canMerge(SoFullPath * path);
+  void mergeShape(SoFullPath * path);
+  void finishMerge(SoNode * root);
+  void clearBatches(void);
   void replaceIfs(SoFullPath * path);
+  void replaceIts(SoFullPath * path);
   void replaceVrmlIfs(SoFullPath * path);
   void replaceIls(SoFullPath * path);
   void replaceVrmlIls(SoFullPath * path);
@@ -411,6 +599,7 @@ SoReorganizeAction::~SoReorganizeAction(void)
 {
   if (PRIVATE(this)->pvcache)
     PRIVATE(this)->pvcache->unref();
+  PRIVATE(this)->clearBatches();
 }
 
 SoSeparator *
@@ -431,6 +620,11 @@ SoReorganizeAction::areNormalGenerated(void) const
   return PRIVATE(this)->gennormals;
 }
 
+/*!
+  Sets whether triangle shapes should be replaced by
+  SoIndexedTriangleStripSet nodes instead of SoIndexedFaceSet
+  nodes. Default is \c FALSE.
+*/
 void
 SoReorganizeAction::generateTriangleStrips(SbBool onoff)
 {
@@ -485,10 +679,192 @@ SoReorganizeAction::getSimplifier(void) const
   return NULL;
 }
 
+/*!
+  Sets whether triangles should be reordered to make better use of
+  the post-transform vertex cache. Vertices are always renumbered in
+  the order they are used. Default is \c TRUE.
+
+  \since Coin 4.0
+*/
+void
+SoReorganizeAction::optimizeVertexCache(SbBool onoff)
+{
+  PRIVATE(this)->optimizecache = onoff;
+}
+
+/*!
+  Returns whether triangles are reordered for the vertex cache.
+
+  \sa optimizeVertexCache()
+  \since Coin 4.0
+*/
+SbBool
+SoReorganizeAction::isVertexCacheOptimized(void) const
+{
+  return PRIVATE(this)->optimizecache;
+}
+
+/*!
+  Sets the number of entries in the vertex cache that triangles are
+  optimized for. This size is also used when computing the average
+  cache miss ratio. Default is 32.
+
+  \since Coin 4.0
+*/
+void
+SoReorganizeAction::setVertexCacheSize(const int size)
+{
+  PRIVATE(this)->cachesize = SbClamp(size, 4, 64);
+}
+
+/*!
+  Returns the vertex cache size.
+
+  \sa setVertexCacheSize()
+  \since Coin 4.0
+*/
+int
+SoReorganizeAction::getVertexCacheSize(void) const
+{
+  return PRIVATE(this)->cachesize;
+}
+
+/*!
+  Returns the average cache miss ratio of the triangles in the shapes
+  reorganized by the last apply(), before and after reorganization.
+  The ratio is the average number of vertices transformed per
+  triangle, which is between 3.0 for unconnected triangles, and about
+  0.5 for large regular meshes. Both values are 0.0 if no triangles
+  were reorganized.
+
+  \sa setVertexCacheSize()
+  \since Coin 4.0
+*/
+void
+SoReorganizeAction::getAverageCacheMissRatio(float & original, float & optimized) const
+{
+  original = optimized = 0.0f;
+  if (PRIVATE(this)->stattriangles > 0.0) {
+    original = float(PRIVATE(this)->statmissesbefore / PRIVATE(this)->stattriangles);
+    optimized = float(PRIVATE(this)->statmissesafter / PRIVATE(this)->stattriangles);
+  }
+}
+
+/*!
+  Sets whether static triangle shapes with the same state should be
+  merged when the action is applied to a root node. Default is \c
+  FALSE.
+
+  A shape is merged if the path to it only contains SoSeparator and
+  SoGroup nodes, and all nodes preceding it in these groups are
+  separators, shapes or property nodes that are baked into the merged
+  shape, like materials, transformations, draw styles and shape
+  hints. Shapes with connected fields are not merged, and no shapes
+  are merged if the root has transformations as direct children, since
+  the merged shapes are added at the end of the root. For the same
+  reason, shapes are not merged if they are followed by textures,
+  lights or other state changes in the root, or if the SoGroup nodes
+  above them pass transformations or such state on to the rest of the
+  root.
+
+  \sa getOriginalPath()
+  \since Coin 4.0
+*/
+void
+SoReorganizeAction::mergeShapes(SbBool onoff)
+{
+  PRIVATE(this)->mergeshapes = onoff;
+}
+
+/*!
+  Returns whether shapes are merged.
+
+  \sa mergeShapes()
+  \since Coin 4.0
+*/
+SbBool
+SoReorganizeAction::areShapesMerged(void) const
+{
+  return PRIVATE(this)->mergeshapes;
+}
+
+/*!
+  Returns the path to the shape in the original scene graph which
+  triangle \a triangleindex in the merged shape \a mergedshape came
+  from, or \c NULL if \a mergedshape was not created by the last
+  apply(). The nodes in the path are kept until the action is applied
+  again or destructed.
+
+  For merged shapes, the triangle index equals the face index in the
+  SoFaceDetail of a picked point.
+
+  \since Coin 4.0
+*/
+const SoPath *
+SoReorganizeAction::getOriginalPath(const SoNode * mergedshape, const int triangleindex) const
+{
+  for (int i = 0; i < PRIVATE(this)->batches.getLength(); i++) {
+    const SoReorganizeBatch * batch = PRIVATE(this)->batches[i];
+    if (batch->mergedshape != mergedshape) continue;
+
+    // binary search for the last shape starting at or before the triangle
+    const SbList <int> & first = batch->firsttriangle;
+    if (triangleindex < 0) return NULL;
+    int lo = 0, hi = first.getLength() - 1;
+    while (lo < hi) {
+      const int mid = (lo + hi + 1) / 2;
+      if (first[mid] <= triangleindex) lo = mid;
+      else hi = mid - 1;
+    }
+    return batch->paths[lo];
+  }
+  return NULL;
+}
+
+/*!
+  Returns the path to the original shape of the picked triangle in \a
+  pp, or \c NULL if the picked shape was not created by merging
+  shapes.
+
+  \sa getOriginalPath(const SoNode *, const int)
+  \since Coin 4.0
+*/
+const SoPath *
+SoReorganizeAction::getOriginalPath(const SoPickedPoint * pp) const
+{
+  const SoDetail * detail = pp->getDetail();
+  if (!detail || !detail->isOfType(SoFaceDetail::getClassTypeId())) return NULL;
+  const SoFullPath * path = reclassify_cast<const SoFullPath *>(pp->getPath());
+  return this->getOriginalPath(path->getTail(),
+                               static_cast<const SoFaceDetail *>(detail)->getFaceIndex());
+}
+
 void
 SoReorganizeAction::apply(SoNode * root)
 {
   int i;
+  if (PRIVATE(this)->applydepth++ == 0) PRIVATE(this)->resetStatistics();
+
+  PRIVATE(this)->merging = PRIVATE(this)->mergeshapes &&
+    root->isOfType(SoGroup::getClassTypeId());
+  if (PRIVATE(this)->merging) {
+    PRIVATE(this)->clearBatches();
+    // the merged shapes are added at the end of the root, after any
+    // transformations in it, while their vertices are already
+    // transformed to world space
+    const SoGroup * rootgroup = coin_assert_cast<const SoGroup *>(root);
+    PRIVATE(this)->roottransformed = FALSE;
+    PRIVATE(this)->lastrootstate = -1;
+    PRIVATE(this)->leakinggroups.clear();
+    for (i = 0; i < rootgroup->getNumChildren(); i++) {
+      const SoNode * child = rootgroup->getChild(i);
+      if (child->isOfType(SoTransformation::getClassTypeId())) {
+        PRIVATE(this)->roottransformed = TRUE;
+      }
+      if (PRIVATE(this)->leaksState(child)) PRIVATE(this)->lastrootstate = i;
+    }
+  }
+
   PRIVATE(this)->sa.setType(SoVertexShape::getClassTypeId());
   PRIVATE(this)->sa.setSearchingAll(TRUE);
   PRIVATE(this)->sa.setInterest(SoSearchAction::ALL);
@@ -521,21 +897,31 @@ SoReorganizeAction::apply(SoNode * root)
   }
   PRIVATE(this)->sa.reset();
 #endif // HAVE_VRML97
+
+  if (PRIVATE(this)->merging) {
+    PRIVATE(this)->finishMerge(root);
+    PRIVATE(this)->merging = FALSE;
+  }
+  PRIVATE(this)->applydepth--;
 }
 
 void
 SoReorganizeAction::apply(SoPath * path)
 {
+  if (PRIVATE(this)->applydepth++ == 0) PRIVATE(this)->resetStatistics();
   PRIVATE(this)->cbaction.apply(path);
   PRIVATE(this)->replaceNode(reclassify_cast<SoFullPath *>(path));
+  PRIVATE(this)->applydepth--;
 }
 
 void
 SoReorganizeAction::apply(const SoPathList & pathlist, SbBool COIN_UNUSED_ARG(obeysrules))
 {
+  if (PRIVATE(this)->applydepth++ == 0) PRIVATE(this)->resetStatistics();
   for (int i = 0; i < pathlist.getLength(); i++) {
     this->apply(pathlist[i]);
   }
+  PRIVATE(this)->applydepth--;
 }
 
 void
@@ -713,6 +1099,28 @@ SoReorganizeActionP::initShape(SoCallbackAction * action)
     float transp = SoLazyElement::getTransparency(state, 0);
     this->diffusecolor = SbColor4f(diffuse, 1.0f - transp);
   }
+  if (canrenderasvertexarray && this->merging) {
+    this->modelmatrix = SoModelMatrixElement::get(state);
+    this->texturematrixidentity =
+      SoMultiTextureMatrixElement::get(state, 0) == SbMatrix::identity();
+
+    SoReorganizeShapeState & ss = this->shapestate;
+    ss.ambient = SoLazyElement::getAmbient(state);
+    ss.diffuse = this->diffusecolor.getPackedValue();
+    ss.specular = SoLazyElement::getSpecular(state);
+    ss.emissive = SoLazyElement::getEmissive(state);
+    ss.shininess = SoLazyElement::getShininess(state);
+    ss.drawstyle = SoDrawStyleElement::get(state);
+    ss.pointsize = SoPointSizeElement::get(state);
+    ss.linewidth = SoLineWidthElement::get(state);
+    ss.linepattern = SoLinePatternElement::get(state);
+    ss.lighting = this->lighting;
+    ss.vertexordering = SoShapeHintsElement::getVertexOrdering(state);
+    ss.shapetype = SoShapeHintsElement::getShapeType(state);
+    ss.hastexture = this->hastexture;
+    ss.colorpervertex = FALSE; // set when the shape is merged
+    ss.texture = NULL;
+  }
   return canrenderasvertexarray;
 }
 
@@ -722,15 +1130,29 @@ SoReorganizeActionP::replaceNode(SoFullPath * path)
   if (this->pvcache == NULL) return;
   this->pvcache->fit(); // needed to do optimize-sort of data
 
-  if (this->pvcache->getNumTriangleIndices()) {
+  if (this->pvcache->getNumTriangleIndices() && this->merging &&
+      !this->isvrml && this->canMerge(path)) {
+    this->optimizeIndices(this->pvcache->getTriangleIndices(),
+                          this->pvcache->getNumTriangleIndices(), 3, FALSE);
+    this->mergeShape(path);
+  }
+  else if (this->pvcache->getNumTriangleIndices()) {
+    this->optimizeIndices(this->pvcache->getTriangleIndices(),
+                          this->pvcache->getNumTriangleIndices(), 3,
+                          this->gentristrips && !this->isvrml);
     if (this->isvrml) {
       this->replaceVrmlIfs(path);
     }
+    else if (this->isstrips) {
+      this->replaceIts(path);
+    }
     else {
       this->replaceIfs(path);
     }
   }
   else if (this->pvcache->getNumLineIndices()) {
+    this->optimizeIndices(this->pvcache->getLineIndices(),
+                          this->pvcache->getNumLineIndices(), 2, FALSE);
     if (this->isvrml) {
       this->replaceVrmlIls(path);
     }
@@ -742,6 +1164,744 @@ SoReorganizeActionP::replaceNode(SoFullPath * path)
   this->pvcache = NULL;
 }
 
+// *************************************************************************
+
+namespace {
+
+  // The triangles using each vertex, in compressed row storage.
+  class ReorganizeVertexTriangles {
+  public:
+    ReorganizeVertexTriangles(const int32_t * indices, const int numtri, const int numv) {
+      int i;
+      this->offset = new int[numv + 1];
+      this->count = new int[numv];
+      this->triangles = new int[numtri * 3];
+      for (i = 0; i < numv; i++) this->count[i] = 0;
+      for (i = 0; i < numtri * 3; i++) this->count[indices[i]]++;
+      this->offset[0] = 0;
+      for (i = 0; i < numv; i++) {
+        this->offset[i+1] = this->offset[i] + this->count[i];
+        this->count[i] = 0;
+      }
+      for (i = 0; i < numtri * 3; i++) {
+        const int v = indices[i];
+        this->triangles[this->offset[v] + this->count[v]++] = i / 3;
+      }
+    }
+    ~ReorganizeVertexTriangles() {
+      delete[] this->offset;
+      delete[] this->count;
+      delete[] this->triangles;
+    }
+    // removes triangle t from the list of vertex v
+    void remove(const int v, const int t) {
+      int * tris = this->triangles + this->offset[v];
+      for (int i = 0; i < this->count[v]; i++) {
+        if (tris[i] == t) {
+          tris[i] = tris[--this->count[v]];
+          tris[this->count[v]] = t;
+          return;
+        }
+      }
+    }
+
+    int * offset;
+    int * count;
+    int * triangles;
+  };
+
+} // namespace
+
+//
+// Returns the number of vertex cache misses when rendering \a
+// indices through a FIFO cache with \a cachesize entries. Negative
+// indices are skipped.
+//
+static int
+reorganize_count_cache_misses(const int32_t * indices, const int numindices,
+                              const int numv, const int cachesize)
+{
+  int i;
+  // a vertex is in the cache if it was loaded less than cachesize
+  // misses ago
+  int * loaded = new int[numv];
+  for (i = 0; i < numv; i++) loaded[i] = -cachesize;
+  int misses = 0;
+  for (i = 0; i < numindices; i++) {
+    const int32_t idx = indices[i];
+    if (idx < 0) continue;
+    if (misses - loaded[idx] >= cachesize) {
+      loaded[idx] = misses++;
+    }
+  }
+  delete[] loaded;
+  return misses;
+}
+
+// vertex score in Forsyth's algorithm
+static float
+reorganize_vertex_score(const int cachepos, const int remaining, const int cachesize)
+{
+  if (remaining == 0) return -1.0f; // no triangles left to render
+
+  float score = 0.0f;
+  if (cachepos >= 0) {
+    if (cachepos < 3) {
+      // the vertices of the last triangle get a fixed score, to avoid
+      // favouring the last triangle's edges over the others
+      score = 0.75f;
+    }
+    else {
+      score = 1.0f - float(cachepos - 3) / float(cachesize - 3);
+      score = float(pow(score, 1.5f));
+    }
+  }
+  // boost vertices with few triangles left, to avoid leaving lone
+  // triangles to render later
+  return score + 2.0f / float(sqrt(float(remaining)));
+}
+
+//
+// Reorders the triangles in \a indices for a vertex cache with \a
+// cachesize entries, using Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation" algorithm. The winding of each triangle is kept.
+//
+static void
+reorganize_optimize_vertex_cache(int32_t * indices, const int numtri,
+                                 const int numv, const int cachesize)
+{
+  if (numtri < 2) return;
+
+  int i, j;
+  ReorganizeVertexTriangles vt(indices, numtri, numv);
+  int * cachepos = new int[numv];
+  float * vscore = new float[numv];
+  float * tscore = new float[numtri];
+  unsigned char * added = new unsigned char[numtri];
+  int32_t * result = new int32_t[numtri * 3];
+
+  for (i = 0; i < numv; i++) {
+    cachepos[i] = -1;
+    vscore[i] = reorganize_vertex_score(-1, vt.count[i], cachesize);
+  }
+  int besttri = 0;
+  for (i = 0; i < numtri; i++) {
+    added[i] = 0;
+    tscore[i] = vscore[indices[i*3]] + vscore[indices[i*3+1]] + vscore[indices[i*3+2]];
+    if (tscore[i] > tscore[besttri]) besttri = i;
+  }
+
+  int cache[64 + 3];
+  int newcache[64 + 3];
+  int cachelen = 0;
+  int scanpos = 0;
+
+  for (int n = 0; n < numtri; n++) {
+    if (besttri < 0) {
+      // no triangles left using the cached vertices, continue with
+      // the next triangle in the original order
+      while (added[scanpos]) scanpos++;
+      besttri = scanpos;
+    }
+    added[besttri] = 1;
+    const int32_t * tri = indices + besttri * 3;
+    int newlen = 0;
+    for (j = 0; j < 3; j++) {
+      result[n*3 + j] = tri[j];
+      vt.remove(tri[j], besttri);
+      newcache[newlen++] = tri[j];
+    }
+    for (i = 0; i < cachelen; i++) {
+      const int v = cache[i];
+      if (v != tri[0] && v != tri[1] && v != tri[2]) newcache[newlen++] = v;
+    }
+    // update the vertices in the new cache, including the ones that
+    // just fell out of it
+    for (i = 0; i < newlen; i++) {
+      const int v = newcache[i];
+      cachepos[v] = i < cachesize ? i : -1;
+      vscore[v] = reorganize_vertex_score(cachepos[v], vt.count[v], cachesize);
+    }
+    // find the best triangle using a vertex in the cache
+    besttri = -1;
+    float bestscore = -1.0f;
+    for (i = 0; i < newlen; i++) {
+      const int v = newcache[i];
+      const int * tris = vt.triangles + vt.offset[v];
+      for (j = 0; j < vt.count[v]; j++) {
+        const int t = tris[j];
+        const int32_t * ti = indices + t * 3;
+        tscore[t] = vscore[ti[0]] + vscore[ti[1]] + vscore[ti[2]];
+        if (tscore[t] > bestscore) {
+          bestscore = tscore[t];
+          besttri = t;
+        }
+      }
+    }
+    cachelen = SbMin(newlen, cachesize);
+    for (i = 0; i < cachelen; i++) cache[i] = newcache[i];
+  }
+
+  for (i = 0; i < numtri * 3; i++) indices[i] = result[i];
+
+  delete[] cachepos;
+  delete[] vscore;
+  delete[] tscore;
+  delete[] added;
+  delete[] result;
+}
+
+//
+// Renumbers the vertices in the order they are first used. \a
+// vertexorder is set to the old index of each new vertex. Unused
+// vertices are placed last.
+//
+static void
+reorganize_optimize_vertex_fetch(int32_t * indices, const int numindices,
+                                 const int numv, SbList <int32_t> & vertexorder)
+{
+  int i;
+  int32_t * remap = new int32_t[numv];
+  for (i = 0; i < numv; i++) remap[i] = -1;
+
+  vertexorder.truncate(0);
+  for (i = 0; i < numindices; i++) {
+    const int32_t idx = indices[i];
+    if (remap[idx] < 0) {
+      remap[idx] = vertexorder.getLength();
+      vertexorder.append(idx);
+    }
+    indices[i] = remap[idx];
+  }
+  for (i = 0; i < numv; i++) {
+    if (remap[i] < 0) vertexorder.append(i);
+  }
+  delete[] remap;
+}
+
+//
+// Finds a triangle before \a maxtri, not already in a strip, with the
+// directed edge a->b. Returns the triangle, and sets c to its third
+// vertex.
+//
+static int
+reorganize_find_strip_triangle(const int32_t * indices, const ReorganizeVertexTriangles & vt,
+                               const unsigned char * used, const int maxtri,
+                               const int32_t a, const int32_t b, int32_t & c)
+{
+  const int * tris = vt.triangles + vt.offset[a];
+  for (int i = 0; i < vt.count[a]; i++) {
+    const int t = tris[i];
+    if (used[t] || t >= maxtri) continue;
+    const int32_t * ti = indices + t * 3;
+    for (int j = 0; j < 3; j++) {
+      if (ti[j] == a && ti[(j+1)%3] == b) {
+        c = ti[(j+2)%3];
+        return t;
+      }
+    }
+  }
+  return -1;
+}
+
+//
+// Converts the triangles in \a indices to triangle strips, separated
+// by -1, keeping the winding of each triangle. Strips are started in
+// the triangle order, and are only continued with triangles less than
+// \a window triangles ahead of the first unused triangle, so that
+// long strips don't destroy the cache efficiency of the order.
+//
+static void
+reorganize_generate_strips(const int32_t * indices, const int numtri,
+                           const int numv, const int window,
+                           SbList <int32_t> & strips)
+{
+  int i;
+  ReorganizeVertexTriangles vt(indices, numtri, numv);
+  unsigned char * used = new unsigned char[numtri];
+  for (i = 0; i < numtri; i++) used[i] = 0;
+
+  strips.truncate(0);
+  for (int t = 0; t < numtri; t++) {
+    if (used[t]) continue;
+    used[t] = 1;
+
+    // start with the rotation of the triangle that can be continued
+    const int maxtri = t + window;
+    const int32_t * ti = indices + t * 3;
+    int start = 0;
+    for (i = 0; i < 3; i++) {
+      int32_t c;
+      if (reorganize_find_strip_triangle(indices, vt, used, maxtri,
+                                         ti[(i+2)%3], ti[(i+1)%3], c) >= 0) {
+        start = i;
+        break;
+      }
+    }
+    if (strips.getLength()) strips.append(-1);
+    const int first = strips.getLength();
+    for (i = 0; i < 3; i++) strips.append(ti[(start+i)%3]);
+
+    // triangle n in a strip is (v[n], v[n+1], v[n+2]) for even n, and
+    // (v[n+1], v[n], v[n+2]) for odd n
+    for (int n = 1; ; n++) {
+      const int32_t a = strips[first + n];
+      const int32_t b = strips[first + n + 1];
+      int32_t c;
+      const int next = (n & 1) ?
+        reorganize_find_strip_triangle(indices, vt, used, maxtri, b, a, c) :
+        reorganize_find_strip_triangle(indices, vt, used, maxtri, a, b, c);
+      if (next < 0) break;
+      used[next] = 1;
+      strips.append(c);
+    }
+  }
+  delete[] used;
+}
+
+void
+SoReorganizeActionP::resetStatistics(void)
+{
+  this->stattriangles = 0.0;
+  this->statmissesbefore = 0.0;
+  this->statmissesafter = 0.0;
+}
+
+//
+// Sets this->indices to the triangles or lines in \a src, reordered
+// for the vertex cache, and with vertices renumbered in the order they
+// are used. Triangles are converted to strips if \a strips is TRUE.
+//
+void
+SoReorganizeActionP::optimizeIndices(const GLint * src, const int numindices, const int primsize,
+                                     const SbBool strips)
+{
+  int i;
+  const int numv = this->pvcache->getNumVertices();
+  this->indices.truncate(0);
+  for (i = 0; i < numindices; i++) {
+    this->indices.append(static_cast<int32_t>(src[i]));
+  }
+  this->isstrips = FALSE;
+  int32_t * ptr = const_cast<int32_t *>(this->indices.getArrayPtr());
+
+  if (primsize == 2) {
+    reorganize_optimize_vertex_fetch(ptr, numindices, numv, this->vertexorder);
+    return;
+  }
+
+  const int numtri = numindices / 3;
+  const int missesbefore =
+    reorganize_count_cache_misses(ptr, numindices, numv, this->cachesize);
+  if (this->optimizecache) {
+    reorganize_optimize_vertex_cache(ptr, numtri, numv, this->cachesize);
+  }
+  reorganize_optimize_vertex_fetch(ptr, numindices, numv, this->vertexorder);
+
+  if (strips) {
+    SbList <int32_t> striplist;
+    reorganize_generate_strips(ptr, numtri, numv, this->cachesize, striplist);
+    this->indices = striplist;
+    this->isstrips = TRUE;
+  }
+  const int missesafter =
+    reorganize_count_cache_misses(this->indices.getArrayPtr(),
+                                  this->indices.getLength(), numv, this->cachesize);
+
+  this->stattriangles += numtri;
+  this->statmissesbefore += missesbefore;
+  this->statmissesafter += missesafter;
+
+  static int debug = -1;
+  if (debug < 0) {
+    const char * env = coin_getenv("COIN_DEBUG_REORGANIZE");
+    debug = env && (atoi(env) > 0);
+  }
+  if (debug) {
+    SoDebugError::postInfo("SoReorganizeAction",
+                           "%d triangles, %d vertices, ACMR %.3f -> %.3f%s",
+                           numtri, numv,
+                           float(missesbefore) / numtri,
+                           float(missesafter) / numtri,
+                           this->isstrips ? " (strips)" : "");
+  }
+}
+
+// *************************************************************************
+
+//
+// Returns TRUE for nodes that only set state that is baked into merged
+// shapes, or that doesn't affect them.
+//
+static SbBool
+reorganize_is_baked_state(const SoNode * node)
+{
+  static SoType types[17];
+  if (types[0] == SoType::badType()) {
+    int i = 0;
+    types[i++] = SoMaterial::getClassTypeId();
+    types[i++] = SoBaseColor::getClassTypeId();
+    types[i++] = SoPackedColor::getClassTypeId();
+    types[i++] = SoMaterialBinding::getClassTypeId();
+    types[i++] = SoNormalBinding::getClassTypeId();
+    types[i++] = SoTextureCoordinateBinding::getClassTypeId();
+    types[i++] = SoTransformation::getClassTypeId();
+    types[i++] = SoDrawStyle::getClassTypeId();
+    types[i++] = SoLightModel::getClassTypeId();
+    types[i++] = SoShapeHints::getClassTypeId();
+    types[i++] = SoCoordinate3::getClassTypeId();
+    types[i++] = SoCoordinate4::getClassTypeId();
+    types[i++] = SoNormal::getClassTypeId();
+    types[i++] = SoTextureCoordinate2::getClassTypeId();
+    types[i++] = SoComplexity::getClassTypeId();
+    types[i++] = SoInfo::getClassTypeId();
+    types[i++] = SoLabel::getClassTypeId();
+    assert(i == sizeof(types) / sizeof(types[0]));
+  }
+  for (int i = 0; i < int(sizeof(types) / sizeof(types[0])); i++) {
+    if (node->isOfType(types[i])) return TRUE;
+  }
+  return node->getTypeId() == SoVertexProperty::getClassTypeId();
+}
+
+//
+// Returns TRUE if \a node changes the state of the nodes after it in
+// a way the merged shapes don't override: transformations, which are
+// already applied to the merged vertices, textures, lights and any
+// other unknown node. Plain groups pass on the state of their
+// children.
+//
+SbBool
+SoReorganizeActionP::leaksState(const SoNode * node)
+{
+  if (node->isOfType(SoSeparator::getClassTypeId()) ||
+      node->isOfType(SoShape::getClassTypeId())) return FALSE;
+  if (node->isOfType(SoTransformation::getClassTypeId())) return TRUE;
+  if (reorganize_is_baked_state(node)) return FALSE;
+  if (node->getTypeId() != SoGroup::getClassTypeId()) return TRUE;
+
+  SbBool leaks = FALSE;
+  if (!this->leakinggroups.get(node, leaks)) {
+    const SoGroup * group = coin_assert_cast<const SoGroup *>(node);
+    for (int i = 0; i < group->getNumChildren() && !leaks; i++) {
+      leaks = this->leaksState(group->getChild(i));
+    }
+    this->leakinggroups.put(node, leaks);
+  }
+  return leaks;
+}
+
+//
+// Returns TRUE if the shape at the tail of \a path can be merged with
+// other shapes. Sets the texture in this->shapestate.
+//
+SbBool
+SoReorganizeActionP::canMerge(SoFullPath * path)
+{
+  if (this->roottransformed) return FALSE;
+
+  const int len = path->getLength();
+  // the merged shapes are added at the end of the root, so they get
+  // the state set after the shape in the root, and the state passed
+  // on by the plain groups above the shape
+  if (len > 1 && path->getIndex(1) < this->lastrootstate) return FALSE;
+  for (int i = 1; i < len - 1; i++) {
+    const SoNode * node = path->getNode(i);
+    if (node->getTypeId() != SoGroup::getClassTypeId()) break;
+    if (this->leaksState(node)) return FALSE;
+  }
+
+  const SoNode * shape = path->getTail();
+
+  // engines or other fields connected to the shape mean that it's not
+  // static
+  SoFieldList fields;
+  const int numfields = shape->getFields(fields);
+  for (int i = 0; i < numfields; i++) {
+    if (fields[i]->isConnected()) return FALSE;
+  }
+
+  SoNode * texture = NULL;
+  for (int i = 0; i < len - 1; i++) {
+    const SoNode * node = path->getNode(i);
+    if (i > 0 &&
+        node->getTypeId() != SoSeparator::getClassTypeId() &&
+        node->getTypeId() != SoGroup::getClassTypeId()) return FALSE;
+
+    const SoGroup * group = coin_assert_cast<const SoGroup *>(node);
+    const int childidx = path->getIndex(i + 1);
+    for (int j = 0; j < childidx; j++) {
+      SoNode * child = group->getChild(j);
+      if (child->getTypeId() == SoSeparator::getClassTypeId() ||
+          child->isOfType(SoShape::getClassTypeId()) ||
+          reorganize_is_baked_state(child)) continue;
+      if (child->isOfType(SoTexture::getClassTypeId())) {
+        texture = child;
+        continue;
+      }
+      // cameras and lights in the root also affect the merged shapes
+      if (i == 0 &&
+          (child->isOfType(SoCamera::getClassTypeId()) ||
+           child->isOfType(SoLight::getClassTypeId()))) continue;
+      return FALSE;
+    }
+  }
+  if (this->hastexture && (texture == NULL || !this->texturematrixidentity)) {
+    return FALSE;
+  }
+  this->shapestate.texture = this->hastexture ? texture : NULL;
+  this->shapestate.colorpervertex = this->pvcache->colorPerVertex();
+  if (this->shapestate.colorpervertex) this->shapestate.diffuse = 0;
+  return TRUE;
+}
+
+//
+// Adds the triangles in this->indices to the batch for the current
+// shape state, transformed to the root's coordinate system.
+//
+void
+SoReorganizeActionP::mergeShape(SoFullPath * path)
+{
+  int i;
+  const uint32_t hash = this->shapestate.hash();
+  SoReorganizeBatch * batch = NULL;
+  SbHash <uint32_t, int>::const_iterator it = this->batchdict.find(hash);
+  int next = (it != this->batchdict.const_end()) ? it->obj : -1;
+  while (next >= 0) {
+    if (this->batches[next]->state == this->shapestate) {
+      batch = this->batches[next];
+      break;
+    }
+    next = this->batches[next]->nextsamehash;
+  }
+  if (batch == NULL) {
+    batch = new SoReorganizeBatch;
+    batch->state = this->shapestate;
+    batch->nextsamehash = (it != this->batchdict.const_end()) ? it->obj : -1;
+    batch->mergedshape = NULL;
+    this->batchdict[hash] = this->batches.getLength();
+    this->batches.append(batch);
+  }
+
+  const SbMatrix & m = this->modelmatrix;
+  const SbMatrix nm = m.inverse().transpose();
+  // mirroring transforms change the winding of the triangles
+  const SbBool flip = m.det3() < 0.0f;
+
+  const int firstvertex = batch->vertices.getLength();
+  const int numv = this->vertexorder.getLength();
+  const SbVec3f * vertices = this->pvcache->getVertexArray();
+  const SbVec3f * normals = this->pvcache->getNormalArray();
+  const SbVec4f * texcoords = this->pvcache->getTexCoordArray();
+  const uint8_t * colors = this->pvcache->getColorArray();
+  for (i = 0; i < numv; i++) {
+    const int32_t src = this->vertexorder[i];
+    SbVec3f v;
+    m.multVecMatrix(vertices[src], v);
+    batch->vertices.append(v);
+    if (batch->state.lighting) {
+      nm.multDirMatrix(normals[src], v);
+      (void) v.normalize();
+      batch->normals.append(v);
+    }
+    if (batch->state.hastexture) {
+      SbVec4f tmp = texcoords[src];
+      if (tmp[3] != 0.0f) {
+        tmp[0] /= tmp[3];
+        tmp[1] /= tmp[3];
+      }
+      batch->texcoords.append(SbVec2f(tmp[0], tmp[1]));
+    }
+    if (batch->state.colorpervertex) {
+      const uint8_t * c = colors + src * 4;
+      batch->colors.append((c[0]<<24)|(c[1]<<16)|(c[2]<<8)|c[3]);
+    }
+  }
+
+  batch->firsttriangle.append(batch->indices.getLength() / 3);
+  const int32_t * indices = this->indices.getArrayPtr();
+  const int numtri = this->indices.getLength() / 3;
+  for (i = 0; i < numtri; i++) {
+    batch->indices.append(firstvertex + indices[i*3]);
+    batch->indices.append(firstvertex + indices[i*3 + (flip ? 2 : 1)]);
+    batch->indices.append(firstvertex + indices[i*3 + (flip ? 1 : 2)]);
+  }
+
+  // store a copy of the path that isn't truncated when the shape is
+  // removed from the scene graph. A temporary path doesn't reference
+  // its nodes, so they are referenced by the batch.
+  SoTempPath * copy = new SoTempPath(path->getLength());
+  copy->ref();
+  copy->setHead(path->getHead());
+  batch->pathnodes.append(path->getHead());
+  for (i = 1; i < path->getLength(); i++) {
+    copy->simpleAppend(path->getNode(i), path->getIndex(i));
+    batch->pathnodes.append(path->getNode(i));
+  }
+  batch->paths.append(copy);
+
+  this->removeparents.append(coin_assert_cast<SoGroup *>(path->getNodeFromTail(1)));
+  this->removeshapes.append(path->getTail());
+}
+
+//
+// Removes the merged shapes from the scene graph, together with the
+// separators that only contain property nodes after that, and adds the
+// merged shapes to \a root.
+//
+void
+SoReorganizeActionP::finishMerge(SoNode * root)
+{
+  int i, j;
+  SoGroup * rootgroup = coin_assert_cast<SoGroup *>(root);
+
+  for (i = 0; i < this->removeshapes.getLength(); i++) {
+    SoGroup * parent = this->removeparents[i];
+    const int idx = parent->findChild(this->removeshapes[i]);
+    if (idx >= 0) parent->removeChild(idx);
+  }
+  this->removeparents.truncate(0);
+  this->removeshapes.truncate(0);
+
+  for (i = 0; i < this->batches.getLength(); i++) {
+    const SoReorganizeBatch * batch = this->batches[i];
+    for (j = 0; j < batch->paths.getLength(); j++) {
+      const SoFullPath * path = reclassify_cast<const SoFullPath *>(batch->paths[j]);
+      for (int k = path->getLength() - 2; k > 0; k--) {
+        SoNode * node = path->getNode(k);
+        if (node->getTypeId() != SoSeparator::getClassTypeId()) break;
+        SoGroup * sep = coin_assert_cast<SoGroup *>(node);
+        int n;
+        for (n = 0; n < sep->getNumChildren(); n++) {
+          if (!reorganize_is_baked_state(sep->getChild(n))) break;
+        }
+        if (n < sep->getNumChildren()) break;
+        SoGroup * parent = coin_assert_cast<SoGroup *>(path->getNode(k - 1));
+        const int idx = parent->findChild(sep);
+        if (idx >= 0) parent->removeChild(idx);
+      }
+    }
+  }
+
+  for (i = 0; i < this->batches.getLength(); i++) {
+    SoReorganizeBatch * batch = this->batches[i];
+    const SoReorganizeShapeState & ss = batch->state;
+    SoSeparator * sep = new SoSeparator;
+
+    SoMaterial * mat = new SoMaterial;
+    mat->ambientColor = ss.ambient;
+    mat->specularColor = ss.specular;
+    mat->emissiveColor = ss.emissive;
+    mat->shininess = ss.shininess;
+    if (!ss.colorpervertex) {
+      float transp;
+      SbColor diffuse;
+      diffuse.setPackedValue(ss.diffuse, transp);
+      mat->diffuseColor = diffuse;
+      mat->transparency = transp;
+    }
+    sep->addChild(mat);
+
+    SoDrawStyle * ds = new SoDrawStyle;
+    ds->style = ss.drawstyle;
+    ds->pointSize = ss.pointsize;
+    ds->lineWidth = ss.linewidth;
+    ds->linePattern = static_cast<unsigned short>(ss.linepattern);
+    sep->addChild(ds);
+
+    SoLightModel * lm = new SoLightModel;
+    lm->model = ss.lighting ? SoLightModel::PHONG : SoLightModel::BASE_COLOR;
+    sep->addChild(lm);
+
+    SoShapeHints * sh = new SoShapeHints;
+    sh->vertexOrdering = ss.vertexordering;
+    sh->shapeType = ss.shapetype;
+    sep->addChild(sh);
+
+    if (ss.texture) sep->addChild(ss.texture);
+
+    SoVertexProperty * vp = new SoVertexProperty;
+    vp->vertex.setValues(0, batch->vertices.getLength(), batch->vertices.getArrayPtr());
+    vp->normalBinding = SoVertexProperty::OVERALL;
+    if (ss.lighting) {
+      vp->normalBinding = SoVertexProperty::PER_VERTEX_INDEXED;
+      vp->normal.setValues(0, batch->normals.getLength(), batch->normals.getArrayPtr());
+    }
+    if (ss.hastexture) {
+      vp->texCoord.setValues(0, batch->texcoords.getLength(), batch->texcoords.getArrayPtr());
+    }
+    vp->materialBinding = SoVertexProperty::OVERALL;
+    vp->orderedRGBA = ss.diffuse;
+    if (ss.colorpervertex) {
+      vp->materialBinding = SoVertexProperty::PER_VERTEX_INDEXED;
+      vp->orderedRGBA.setValues(0, batch->colors.getLength(), batch->colors.getArrayPtr());
+    }
+
+    SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+    ifs->vertexProperty = vp;
+    const int numtri = batch->indices.getLength() / 3;
+    const int32_t * indices = batch->indices.getArrayPtr();
+    ifs->coordIndex.setNum(numtri * 4);
+    int32_t * ptr = ifs->coordIndex.startEditing();
+    for (j = 0; j < numtri; j++) {
+      *ptr++ = indices[j*3];
+      *ptr++ = indices[j*3+1];
+      *ptr++ = indices[j*3+2];
+      *ptr++ = -1;
+    }
+    ifs->coordIndex.finishEditing();
+    sep->addChild(ifs);
+    rootgroup->addChild(sep);
+
+    batch->mergedshape = ifs;
+    ifs->ref();
+
+    // the geometry is no longer needed
+    batch->vertices.truncate(0, TRUE);
+    batch->normals.truncate(0, TRUE);
+    batch->texcoords.truncate(0, TRUE);
+    batch->colors.truncate(0, TRUE);
+    batch->indices.truncate(0, TRUE);
+  }
+  this->batchdict.clear();
+}
+
+//
+// Deletes the batches from the last merge, and the mapping tables.
+//
+void
+SoReorganizeActionP::clearBatches(void)
+{
+  for (int i = 0; i < this->batches.getLength(); i++) {
+    SoReorganizeBatch * batch = this->batches[i];
+    for (int j = 0; j < batch->paths.getLength(); j++) {
+      batch->paths[j]->unref();
+    }
+    if (batch->mergedshape) batch->mergedshape->unref();
+    delete batch;
+  }
+  this->batches.truncate(0);
+  this->batchdict.clear();
+  this->removeparents.truncate(0);
+  this->removeshapes.truncate(0);
+}
+
+//
+// Copies vertex data from the primitive vertex cache to \a field, in
+// the new vertex order.
+//
+void
+SoReorganizeActionP::copyVertexData(SoMFVec3f & field, const SbVec3f * src) const
+{
+  const int numv = this->vertexorder.getLength();
+  field.setNum(numv);
+  SbVec3f * dst = field.startEditing();
+  for (int i = 0; i < numv; i++) {
+    dst[i] = src[this->vertexorder[i]];
+  }
+  field.finishEditing();
+}
+
 SoVertexProperty *
 SoReorganizeActionP::createVertexProperty(const SbBool forlines)
 {
@@ -763,7 +1923,7 @@ SoReorganizeActionP::createVertexProperty(const SbBool forlines)
     const SbVec4f * src = this->pvcache->getTexCoordArray();
 
     for (int i = 0; i < numv; i++) {
-      SbVec4f tmp = src[i];
+      SbVec4f tmp = src[this->vertexorder[i]];
       if (tmp[3] != 0.0f) {
         tmp[0] /= tmp[3];
         tmp[1] /= tmp[3];
@@ -774,11 +1934,9 @@ SoReorganizeActionP::createVertexProperty(const SbBool forlines)
     vp->texCoord.finishEditing();
   }
 
-  vp->vertex.setValues(0, numv,
-                       this->pvcache->getVertexArray());
+  this->copyVertexData(vp->vertex, this->pvcache->getVertexArray());
   if (nbind == SoVertexProperty::PER_VERTEX_INDEXED) {
-    vp->normal.setValues(0, numv,
-                         this->pvcache->getNormalArray());
+    this->copyVertexData(vp->normal, this->pvcache->getNormalArray());
   }
 
   vp->materialBinding = SoVertexProperty::OVERALL;
@@ -786,12 +1944,12 @@ SoReorganizeActionP::createVertexProperty(const SbBool forlines)
 
   if (this->pvcache->colorPerVertex()) {
     vp->materialBinding = SoVertexProperty::PER_VERTEX_INDEXED;
-    uint8_t * src = const_cast<uint8_t *>(this->pvcache->getColorArray());
+    const uint8_t * colors = this->pvcache->getColorArray();
     vp->orderedRGBA.setNum(numv);
     uint32_t * dst = vp->orderedRGBA.startEditing();
     for (int i = 0; i < numv; i++) {
+      const uint8_t * src = colors + this->vertexorder[i] * 4;
       dst[i] = (src[0]<<24)|(src[1]<<16)|(src[2]<<8)|src[3];
-      src += 4;
     }
     vp->orderedRGBA.finishEditing();
   }
@@ -815,16 +1973,16 @@ SoReorganizeActionP::replaceIfs(SoFullPath * path)
   ifs->materialIndex.setNum(0);
   ifs->textureCoordIndex.setNum(0);
 
-  int numtri = this->pvcache->getNumTriangleIndices() / 3;
-  const GLint * indices = this->pvcache->getTriangleIndices();
+  int numtri = this->indices.getLength() / 3;
+  const int32_t * indices = this->indices.getArrayPtr();
   ifs->coordIndex.setNum(numtri * 4);
   int32_t * ptr = ifs->coordIndex.startEditing();
 
 
   for (int i = 0; i < numtri; i++) {
-    *ptr++ = static_cast<int32_t>(indices[i*3]);
-    *ptr++ = static_cast<int32_t>(indices[i*3+1]);
-    *ptr++ = static_cast<int32_t>(indices[i*3+2]);
+    *ptr++ = indices[i*3];
+    *ptr++ = indices[i*3+1];
+    *ptr++ = indices[i*3+2];
     *ptr++ = -1;
   }
   ifs->coordIndex.finishEditing();
@@ -837,6 +1995,32 @@ SoReorganizeActionP::replaceIfs(SoFullPath * path)
   ifs->unrefNoDelete();
 }
 
+void
+SoReorganizeActionP::replaceIts(SoFullPath * path)
+{
+  SoNode * parent = path->getNodeFromTail(1);
+  if (!parent->isOfType(SoGroup::getClassTypeId())) {
+    return;
+  }
+
+  SoVertexProperty * vp = this->createVertexProperty(FALSE);
+  SoIndexedTriangleStripSet * its = new SoIndexedTriangleStripSet;
+  its->ref();
+  its->vertexProperty = vp;
+  its->normalIndex.setNum(0);
+  its->materialIndex.setNum(0);
+  its->textureCoordIndex.setNum(0);
+  its->coordIndex.setValues(0, this->indices.getLength(),
+                            this->indices.getArrayPtr());
+
+  int idx = path->getIndexFromTail(0);
+  path->pop();
+  SoGroup * g = coin_assert_cast<SoGroup *>(parent);
+  g->replaceChild(idx, its);
+  path->push(idx);
+  its->unrefNoDelete();
+}
+
 void
 SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
 {
@@ -866,7 +2050,7 @@ SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
     const SbVec4f * src = this->pvcache->getTexCoordArray();
 
     for (int i = 0; i < numv; i++) {
-      SbVec4f tmp = src[i];
+      SbVec4f tmp = src[this->vertexorder[i]];
       if (tmp[3] != 0.0f) {
         tmp[0] /= tmp[3];
         tmp[1] /= tmp[3];
@@ -879,26 +2063,24 @@ SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
   }
 
   SoVRMLCoordinate * c = new SoVRMLCoordinate;
-  c->point.setValues(0, numv,
-                     this->pvcache->getVertexArray());
+  this->copyVertexData(c->point, this->pvcache->getVertexArray());
   ifs->coord = c;
 
   if (this->lighting) {
     SoVRMLNormal * norm = new SoVRMLNormal;
-    norm->vector.setValues(0, numv,
-                           this->pvcache->getNormalArray());
+    this->copyVertexData(norm->vector, this->pvcache->getNormalArray());
     ifs->normal = norm;
   }
   if (this->pvcache->colorPerVertex()) {
     SoVRMLColor * col = new SoVRMLColor;
     col->color.setNum(numv);
-    uint8_t * src = const_cast<uint8_t *>(this->pvcache->getColorArray());
+    const uint8_t * colors = this->pvcache->getColorArray();
     SbColor * dst = col->color.startEditing();
     for (int i = 0; i < numv; i++) {
+      const uint8_t * src = colors + this->vertexorder[i] * 4;
       dst[i] = SbColor(src[0]/255.0f,
                        src[1]/255.0f,
                        src[2]/255.0f);
-      src += 4;
     }
     col->color.finishEditing();
     ifs->color = col;
@@ -908,15 +2090,15 @@ SoReorganizeActionP::replaceVrmlIfs(SoFullPath * path)
   ifs->colorIndex.setNum(0);
   ifs->texCoordIndex.setNum(0);
 
-  int numtri = this->pvcache->getNumTriangleIndices() / 3;
-  const GLint * indices = this->pvcache->getTriangleIndices();
+  int numtri = this->indices.getLength() / 3;
+  const int32_t * indices = this->indices.getArrayPtr();
   ifs->coordIndex.setNum(numtri * 4);
   int32_t * ptr = ifs->coordIndex.startEditing();
 
   for (int i = 0; i < numtri; i++) {
-    *ptr++ = static_cast<int32_t>(indices[i*3]);
-    *ptr++ = static_cast<int32_t>(indices[i*3+1]);
-    *ptr++ = static_cast<int32_t>(indices[i*3+2]);
+    *ptr++ = indices[i*3];
+    *ptr++ = indices[i*3+1];
+    *ptr++ = indices[i*3+2];
     *ptr++ = -1;
   }
   ifs->coordIndex.finishEditing();
@@ -952,14 +2134,14 @@ SoReorganizeActionP::replaceIls(SoFullPath * path)
   ils->materialIndex.setNum(0);
   ils->textureCoordIndex.setNum(0);
 
-  int numlines = this->pvcache->getNumLineIndices() / 2;
-  const GLint * indices = this->pvcache->getLineIndices();
+  int numlines = this->indices.getLength() / 2;
+  const int32_t * indices = this->indices.getArrayPtr();
   ils->coordIndex.setNum(numlines * 3);
   int32_t * ptr = ils->coordIndex.startEditing();
 
   for (int i = 0; i < numlines; i++) {
-    *ptr++ = static_cast<int32_t>(indices[i*2]);
-    *ptr++ = static_cast<int32_t>(indices[i*2+1]);
+    *ptr++ = indices[i*2];
+    *ptr++ = indices[i*2+1];
     *ptr++ = -1;
   }
   ils->coordIndex.finishEditing();
@@ -986,34 +2168,33 @@ SoReorganizeActionP::replaceVrmlIls(SoFullPath * path)
   ils->ref();
 
   int numv = this->pvcache->getNumVertices();
-  int numlines = this->pvcache->getNumLineIndices() / 2;
-  const GLint * indices = this->pvcache->getLineIndices();
+  int numlines = this->indices.getLength() / 2;
+  const int32_t * indices = this->indices.getArrayPtr();
   ils->coordIndex.setNum(numlines * 3);
   int32_t * ptr = ils->coordIndex.startEditing();
 
   for (int i = 0; i < numlines; i++) {
-    *ptr++ = static_cast<int32_t>(indices[i*2]);
-    *ptr++ = static_cast<int32_t>(indices[i*2+1]);
+    *ptr++ = indices[i*2];
+    *ptr++ = indices[i*2+1];
     *ptr++ = -1;
   }
   ils->coordIndex.finishEditing();
 
   SoVRMLCoordinate * c = new SoVRMLCoordinate;
-  c->point.setValues(0, numv,
-                     this->pvcache->getVertexArray());
+  this->copyVertexData(c->point, this->pvcache->getVertexArray());
   ils->coord = c;
 
   if (this->pvcache->colorPerVertex()) {
     ils->colorPerVertex = TRUE;
     SoVRMLColor * col = new SoVRMLColor;
     col->color.setNum(numv);
-    uint8_t * src = const_cast<uint8_t *>(this->pvcache->getColorArray());
+    const uint8_t * colors = this->pvcache->getColorArray();
     SbColor * dst = col->color.startEditing();
     for (int i = 0; i < numv; i++) {
+      const uint8_t * src = colors + this->vertexorder[i] * 4;
       dst[i] = SbColor(src[0]/255.0f,
                        src[1]/255.0f,
                        src[2]/255.0f);
-      src += 4;
     }
     col->color.finishEditing();
     ils->color = col;
@@ -1036,3 +2217,358 @@ SoReorganizeActionP::replaceVrmlIls(SoFullPath * path)
 }
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoIndexedTriangleStripSet.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <algorithm>
+#include <vector>
+
+typedef std::vector<float> ReorganizeTestTriangle;
+
+static void
+reorganize_test_triangle_cb(void * userdata, SoCallbackAction * action,
+                            const SoPrimitiveVertex * v1,
+                            const SoPrimitiveVertex * v2,
+                            const SoPrimitiveVertex * v3)
+{
+  // store the triangle in world coordinates, starting with its
+  // smallest vertex, so that rotated triangles compare equal while
+  // the winding is kept
+  const SoPrimitiveVertex * pv[3] = { v1, v2, v3 };
+  SbVec3f v[3];
+  int first = 0;
+  for (int i = 0; i < 3; i++) {
+    action->getModelMatrix().multVecMatrix(pv[i]->getPoint(), v[i]);
+    if (v[i][0] < v[first][0] || (v[i][0] == v[first][0] && v[i][1] < v[first][1])) first = i;
+  }
+  ReorganizeTestTriangle tri;
+  for (int i = 0; i < 3; i++) {
+    const SbVec3f & p = v[(first + i) % 3];
+    tri.push_back(p[0]);
+    tri.push_back(p[1]);
+  }
+  static_cast<std::vector<ReorganizeTestTriangle> *>(userdata)->push_back(tri);
+}
+
+static std::vector<ReorganizeTestTriangle>
+reorganize_test_triangles(SoNode * root)
+{
+  std::vector<ReorganizeTestTriangle> triangles;
+  SoCallbackAction cba;
+  cba.addTriangleCallback(SoShape::getClassTypeId(), reorganize_test_triangle_cb, &triangles);
+  cba.apply(root);
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+// a grid of quads, in a scrambled order
+static SoSeparator *
+reorganize_test_grid(const int size)
+{
+  SoSeparator * root = new SoSeparator;
+  SoVertexProperty * vp = new SoVertexProperty;
+  SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+  ifs->vertexProperty = vp;
+  root->addChild(ifs);
+
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      vp->vertex.set1Value(y * (size+1) + x, SbVec3f(float(x), float(y), 0.0f));
+    }
+  }
+  const int numquads = size * size;
+  unsigned int rnd = 1;
+  std::vector<int> quads;
+  for (int i = 0; i < numquads; i++) quads.push_back(i);
+  for (int i = numquads - 1; i > 0; i--) {
+    rnd = rnd * 1103515245u + 12345u;
+    std::swap(quads[i], quads[(rnd >> 8) % (i + 1)]);
+  }
+  for (int i = 0; i < numquads; i++) {
+    const int x = quads[i] % size, y = quads[i] / size;
+    const int v = y * (size+1) + x;
+    const int32_t quad[] = { v, v + 1, v + size + 2, v + size + 1, -1 };
+    ifs->coordIndex.setValues(ifs->coordIndex.getNum(), 5, quad);
+  }
+  return root;
+}
+
+BOOST_AUTO_TEST_CASE(vertexCacheOptimization)
+{
+  SoSeparator * root = reorganize_test_grid(30);
+  root->ref();
+  const std::vector<ReorganizeTestTriangle> before = reorganize_test_triangles(root);
+
+  SoReorganizeAction ra;
+  ra.apply(root);
+  float original, optimized;
+  ra.getAverageCacheMissRatio(original, optimized);
+
+  BOOST_CHECK_MESSAGE(root->getChild(0)->isOfType(SoIndexedFaceSet::getClassTypeId()),
+                      "the shape should be replaced by an SoIndexedFaceSet");
+  BOOST_CHECK_MESSAGE(original > 1.0f, "the scrambled grid should have a poor ACMR");
+  BOOST_CHECK_MESSAGE(optimized < 0.75f, "the optimized grid should have a good ACMR");
+  BOOST_CHECK_MESSAGE(reorganize_test_triangles(root) == before,
+                      "the triangles should be unchanged");
+
+  // vertices are numbered in the order they are used
+  const SoIndexedFaceSet * ifs = static_cast<SoIndexedFaceSet *>(root->getChild(0));
+  int32_t next = 0;
+  SbBool sequential = TRUE;
+  for (int i = 0; i < ifs->coordIndex.getNum(); i++) {
+    const int32_t idx = ifs->coordIndex[i];
+    if (idx > next) sequential = FALSE;
+    if (idx == next) next++;
+  }
+  BOOST_CHECK_MESSAGE(sequential, "vertices should be numbered in the order they are used");
+
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(triangleStrips)
+{
+  SoSeparator * root = reorganize_test_grid(20);
+  root->ref();
+  const std::vector<ReorganizeTestTriangle> before = reorganize_test_triangles(root);
+
+  SoReorganizeAction ra;
+  ra.generateTriangleStrips(TRUE);
+  ra.apply(root);
+
+  BOOST_CHECK_MESSAGE(root->getChild(0)->isOfType(SoIndexedTriangleStripSet::getClassTypeId()),
+                      "the shape should be replaced by an SoIndexedTriangleStripSet");
+  const SoIndexedTriangleStripSet * its =
+    static_cast<SoIndexedTriangleStripSet *>(root->getChild(0));
+  BOOST_CHECK_MESSAGE(its->coordIndex.getNum() < int(before.size()) * 2,
+                      "the strips should use fewer indices than a triangle list");
+  float original, optimized;
+  ra.getAverageCacheMissRatio(original, optimized);
+  BOOST_CHECK_MESSAGE(optimized < 0.75f, "the strips should keep the cache efficiency");
+  BOOST_CHECK_MESSAGE(reorganize_test_triangles(root) == before,
+                      "the strips should have the same triangles, with the same winding");
+
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(mergeShapes)
+{
+  // quads, each in a separator with a translation and one of two
+  // materials
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoNode * quads[20];
+  for (int i = 0; i < 20; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * t = new SoTranslation;
+    t->translation = SbVec3f(float(i * 2), 0.0f, 0.0f);
+    sep->addChild(t);
+    SoMaterial * mat = new SoMaterial;
+    mat->diffuseColor = (i & 1) ? SbColor(1.0f, 0.0f, 0.0f) : SbColor(0.0f, 1.0f, 0.0f);
+    sep->addChild(mat);
+    SoCoordinate3 * coords = new SoCoordinate3;
+    coords->point.set1Value(0, SbVec3f(0.0f, 0.0f, 0.0f));
+    coords->point.set1Value(1, SbVec3f(1.0f, 0.0f, 0.0f));
+    coords->point.set1Value(2, SbVec3f(1.0f, 1.0f, 0.0f));
+    coords->point.set1Value(3, SbVec3f(0.0f, 1.0f, 0.0f));
+    sep->addChild(coords);
+    SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+    const int32_t idx[] = { 0, 1, 2, 3, -1 };
+    ifs->coordIndex.setValues(0, 5, idx);
+    sep->addChild(ifs);
+    quads[i] = ifs;
+    root->addChild(sep);
+  }
+  const std::vector<ReorganizeTestTriangle> before = reorganize_test_triangles(root);
+
+  SoReorganizeAction ra;
+  ra.mergeShapes(TRUE);
+  ra.apply(root);
+
+  BOOST_CHECK_MESSAGE(root->getNumChildren() == 2,
+                      "the quads should be merged into one shape per material");
+  BOOST_CHECK_MESSAGE(reorganize_test_triangles(root) == before,
+                      "the merged shapes should have the same triangles");
+
+  // pick each quad, and look up the original shape
+  SbBool found = TRUE;
+  for (int i = 0; i < 20; i++) {
+    SoRayPickAction rp(SbViewportRegion(100, 100));
+    rp.setRay(SbVec3f(i * 2.0f + 0.75f, 0.25f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+    rp.apply(root);
+    const SoPickedPoint * pp = rp.getPickedPoint();
+    const SoFullPath * path = pp ?
+      static_cast<const SoFullPath *>(ra.getOriginalPath(pp)) : NULL;
+    if (!path || path->getTail() != quads[i] || path->getHead() != root) found = FALSE;
+  }
+  BOOST_CHECK_MESSAGE(found, "picked triangles should map to the original shapes");
+
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(mergeShapesRootTransform)
+{
+  // quads in separators, after a transform directly in the root
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoTransform * transform = new SoTransform;
+  transform->translation = SbVec3f(5.0f, 0.0f, 0.0f);
+  transform->scaleFactor = SbVec3f(2.0f, 2.0f, 2.0f);
+  root->addChild(transform);
+  for (int i = 0; i < 4; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * t = new SoTranslation;
+    t->translation = SbVec3f(float(i * 2), 0.0f, 0.0f);
+    sep->addChild(t);
+    SoCoordinate3 * coords = new SoCoordinate3;
+    coords->point.set1Value(0, SbVec3f(0.0f, 0.0f, 0.0f));
+    coords->point.set1Value(1, SbVec3f(1.0f, 0.0f, 0.0f));
+    coords->point.set1Value(2, SbVec3f(1.0f, 1.0f, 0.0f));
+    sep->addChild(coords);
+    sep->addChild(new SoFaceSet);
+    root->addChild(sep);
+  }
+  SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+  bba.apply(root);
+  const SbBox3f before = bba.getBoundingBox();
+  const std::vector<ReorganizeTestTriangle> triangles = reorganize_test_triangles(root);
+
+  SoReorganizeAction ra;
+  ra.mergeShapes(TRUE);
+  ra.apply(root);
+
+  bba.apply(root);
+  const SbBox3f after = bba.getBoundingBox();
+  BOOST_CHECK_MESSAGE(after.getMin().equals(before.getMin(), 1e-5f) &&
+                      after.getMax().equals(before.getMax(), 1e-5f),
+                      "the root transform should be applied once");
+  BOOST_CHECK_MESSAGE(reorganize_test_triangles(root) == triangles,
+                      "the triangles should be unchanged");
+
+  root->unref();
+}
+
+#include <Inventor/nodes/SoTexture2.h>
+
+static SoSeparator *
+reorganize_test_quad(const float x)
+{
+  SoSeparator * sep = new SoSeparator;
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.set1Value(0, SbVec3f(x, 0.0f, 0.0f));
+  coords->point.set1Value(1, SbVec3f(x + 1.0f, 0.0f, 0.0f));
+  coords->point.set1Value(2, SbVec3f(x + 1.0f, 1.0f, 0.0f));
+  coords->point.set1Value(3, SbVec3f(x, 1.0f, 0.0f));
+  sep->addChild(coords);
+  SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+  const int32_t idx[] = { 0, 1, 2, 3, -1 };
+  ifs->coordIndex.setValues(0, 5, idx);
+  sep->addChild(ifs);
+  return sep;
+}
+
+static void
+reorganize_test_texture_cb(void * userdata, SoCallbackAction * action,
+                           const SoPrimitiveVertex *,
+                           const SoPrimitiveVertex *,
+                           const SoPrimitiveVertex *)
+{
+  SbVec2s size;
+  int nc;
+  if (action->getTextureImage(size, nc)) (*static_cast<int *>(userdata))++;
+}
+
+static int
+reorganize_test_textured_triangles(SoNode * root)
+{
+  int num = 0;
+  SoCallbackAction cba;
+  cba.addTriangleCallback(SoShape::getClassTypeId(), reorganize_test_texture_cb, &num);
+  cba.apply(root);
+  return num;
+}
+
+// merges the shapes in root, and checks that it looks the same after
+static void
+reorganize_test_merge(SoSeparator * root, const int numchildren)
+{
+  SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+  bba.apply(root);
+  const SbBox3f before = bba.getBoundingBox();
+  const std::vector<ReorganizeTestTriangle> triangles = reorganize_test_triangles(root);
+  const int textured = reorganize_test_textured_triangles(root);
+
+  SoReorganizeAction ra;
+  ra.mergeShapes(TRUE);
+  ra.apply(root);
+  BOOST_CHECK_MESSAGE(root->getNumChildren() == numchildren,
+                      "only the shapes which are unaffected should be merged");
+
+  bba.apply(root);
+  const SbBox3f after = bba.getBoundingBox();
+  BOOST_CHECK_MESSAGE(after.getMin().equals(before.getMin(), 1e-5f) &&
+                      after.getMax().equals(before.getMax(), 1e-5f),
+                      "the bounding box should be unchanged");
+  BOOST_CHECK_MESSAGE(reorganize_test_triangles(root) == triangles,
+                      "the triangles should have the same model matrices");
+  BOOST_CHECK_MESSAGE(reorganize_test_textured_triangles(root) == textured,
+                      "the same triangles should be textured");
+}
+
+BOOST_AUTO_TEST_CASE(mergeShapesLeakingState)
+{
+  // quads before a plain group with a transform, which also applies
+  // to the rest of the root
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  for (int i = 0; i < 2; i++) {
+    root->addChild(reorganize_test_quad(float(i * 2)));
+  }
+  SoGroup * group = new SoGroup;
+  SoTransform * transform = new SoTransform;
+  transform->translation = SbVec3f(0.0f, 5.0f, 0.0f);
+  transform->scaleFactor = SbVec3f(2.0f, 2.0f, 2.0f);
+  group->addChild(transform);
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.set1Value(0, SbVec3f(0.0f, 0.0f, 0.0f));
+  coords->point.set1Value(1, SbVec3f(1.0f, 0.0f, 0.0f));
+  coords->point.set1Value(2, SbVec3f(1.0f, 1.0f, 0.0f));
+  group->addChild(coords);
+  group->addChild(new SoFaceSet);
+  root->addChild(group);
+  reorganize_test_merge(root, 3);
+  root->unref();
+
+  // quads before and after a texture in the root. Only the ones after
+  // it are merged.
+  root = new SoSeparator;
+  root->ref();
+  for (int i = 0; i < 2; i++) {
+    root->addChild(reorganize_test_quad(float(i * 2)));
+  }
+  SoTexture2 * texture = new SoTexture2;
+  const unsigned char pixel[] = { 0xff, 0xff, 0xff };
+  texture->image.setValue(SbVec2s(1, 1), 3, pixel);
+  root->addChild(texture);
+  for (int i = 0; i < 2; i++) {
+    root->addChild(reorganize_test_quad(float(i * 2)));
+  }
+  reorganize_test_merge(root, 4);
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -67,15 +67,31 @@
   calling unrefNoDelete() on your object, since reset() truncates
   the path list.
 
+  Subgraphs which can not contain a matching node are not traversed.
+  Group nodes keep a summary of the node types below them for \c TYPE
+  searches, and for \c NODE and \c NAME searches the nodes above the
+  candidate nodes are found up front, through the node name
+  dictionary for \c NAME searches. If no node can match, the scene
+  graph is not traversed at all. Note that this means that the
+  SoNode::search() method of nodes in such subgraphs is not called.
+
   See the documentation of SoTexture2 for a full usage example of
   SoSearchAction.
 */
 
 #include <Inventor/actions/SoSearchAction.h>
 
+#include <cstdlib> // atoi()
+
+#include <Inventor/C/tidbits.h> // coin_getenv()
 #include <Inventor/nodes/SoNode.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/lists/SoBaseList.h>
+#include <Inventor/lists/SoAuditorList.h>
+#include <Inventor/fields/SoField.h>
 
 #include "actions/SoSubActionP.h"
+#include "actions/SoSearchActionP.h"
 
 // *************************************************************************
 
@@ -133,9 +149,122 @@
   in Coin.)
 */
 
-class SoSearchActionP {
-public:
-};
+uint32_t SoSearchActionP::structurestamp = 0;
+
+namespace {
+
+// Appends the nodes which have node as a child, either in a child
+// list or in a node field, to parents.
+void
+get_parent_nodes(SoNode * node, SbList<SoNode *> & parents)
+{
+  const SoAuditorList & auditors = node->getAuditors();
+  for (int i = 0; i < auditors.getLength(); i++) {
+    switch (auditors.getType(i)) {
+    case SoNotRec::PARENT:
+      parents.append((SoNode *) auditors.getObject(i));
+      break;
+    case SoNotRec::FIELD:
+      {
+        SoFieldContainer * container = ((SoField *) auditors.getObject(i))->getContainer();
+        if (container && container->isOfType(SoNode::getClassTypeId())) {
+          parents.append((SoNode *) container);
+        }
+      }
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+} // namespace
+
+// Sets up pruning of the traversal for the search criteria of the
+// action. Returns FALSE if no node can match.
+SbBool
+SoSearchActionP::setup(SoSearchAction * action)
+{
+  this->prune = FALSE;
+  this->typebit = -1;
+  this->namecandidates = FALSE;
+  this->candidates.clear();
+  this->ancestors.clear();
+
+  // pruning can be disabled for debugging, with the
+  // COIN_SEARCHACTION_NO_PRUNING environment variable
+  static int noprune = -1;
+  if (noprune < 0) {
+    const char * env = coin_getenv("COIN_SEARCHACTION_NO_PRUNING");
+    noprune = (env && atoi(env) > 0) ? 1 : 0;
+  }
+  if (noprune) return TRUE;
+
+  const int lookfor = action->getFind();
+  if (lookfor == 0) return FALSE;
+
+  SbList<SoNode *> nodes;
+  if (lookfor & SoSearchAction::NODE) {
+    if (action->getNode() == NULL) return FALSE;
+    nodes.append(action->getNode());
+  }
+  else if ((lookfor & SoSearchAction::NAME) && action->getName().getLength() > 0) {
+    // nodes without a name are not in the name dictionary, so this is
+    // only done for non-empty names
+    SoBaseList named;
+    named.addReferences(FALSE);
+    const int num = SoBase::getNamedBases(action->getName(), named,
+                                          SoNode::getClassTypeId());
+    if (num == 0) return FALSE;
+    for (int i = 0; i < num; i++) nodes.append((SoNode *) named[i]);
+    this->namecandidates = TRUE;
+  }
+
+  if (nodes.getLength() > 0) {
+    for (int i = 0; i < nodes.getLength(); i++) {
+      this->candidates.put(nodes[i], NULL);
+    }
+    // find all nodes above the candidates
+    SbList<SoNode *> parents;
+    for (int i = 0; i < nodes.getLength(); i++) {
+      get_parent_nodes(nodes[i], parents);
+    }
+    while (parents.getLength() > 0) {
+      SoNode * parent = parents.pop();
+      if (this->ancestors.put(parent, NULL)) {
+        get_parent_nodes(parent, parents);
+      }
+    }
+    this->prune = TRUE;
+  }
+
+  if ((lookfor & SoSearchAction::TYPE) && !(lookfor & SoSearchAction::NODE)) {
+    SbBool chkderived;
+    const SoType type = action->getType(chkderived);
+    if (type.isBad()) return FALSE;
+    this->typebit = SoSearchActionP::getTypeBit(type);
+    this->prune = TRUE;
+  }
+  return TRUE;
+}
+
+// Returns TRUE if no node below node can match the search.
+SbBool
+SoSearchActionP::skipChildren(SoNode * node) const
+{
+  if (!this->prune) return FALSE;
+
+  if (this->candidates.getNumElements() > 0) {
+    void * dummy;
+    if (!this->ancestors.get(node, dummy)) return TRUE;
+  }
+  if (this->typebit >= 0 && node->isOfType(SoGroup::getClassTypeId())) {
+    const uint32_t * summary = SoSearchActionP::getTypeSummary((SoGroup *) node);
+    const int bit = this->typebit;
+    if (summary && !(summary[bit >> 5] & (1u << (bit & 31)))) return TRUE;
+  }
+  return FALSE;
+}
 
 SO_ACTION_SOURCE(SoSearchAction);
 
@@ -471,7 +600,8 @@ SoSearchAction::beginTraversal(SoNode * nodeptr)
   // now obsoleted 'duringSearchAll' flag.
   SoSearchAction::duringSearchAll = this->isSearchingAll();
 
-  this->traverse(nodeptr); // begin traversal at root node
+  // begin traversal at root node, unless no node can match
+  if (SoSearchActionP::get(this)->setup(this)) this->traverse(nodeptr);
 
   SoSearchAction::duringSearchAll = FALSE;
 }
@@ -0,0 +1,116 @@
+#ifndef COIN_SOSEARCHACTIONP_H
+#define COIN_SOSEARCHACTIONP_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/misc/SoNotification.h>
+#include <Inventor/tools/SbLazyPimplPtr.hpp>
+
+#include "misc/SbHash.h"
+
+class SoGroup;
+
+// Private data for SoSearchAction, and the support for pruning search
+// traversals.
+//
+// SoGroup keeps a summary of the node types found in the subgraph
+// below it, so a TYPE search can skip subgraphs without any nodes of
+// the type. The summaries are bitsets indexed on a hash of the type
+// key, with bits set for the type of each node and all its parent
+// types, so they can only tell for sure that a type is *not* present.
+//
+// NODE and NAME searches collect the nodes which can match up front,
+// from the node itself or through the SoBase name dictionary, and
+// then walk up through the auditors of these nodes to find all the
+// nodes above them. Subgraphs of other nodes are skipped.
+
+class SoSearchActionP {
+public:
+  SoSearchActionP(void) : prune(FALSE), typebit(-1), namecandidates(FALSE) { }
+
+  enum { NUM_TYPE_BITS = 256 };
+  typedef uint32_t TypeSummary[NUM_TYPE_BITS / 32];
+
+  static int getTypeBit(const SoType type) {
+    return type.getKey() % NUM_TYPE_BITS;
+  }
+  static void addType(TypeSummary summary, SoType type) {
+    do {
+      const int bit = SoSearchActionP::getTypeBit(type);
+      summary[bit >> 5] |= 1u << (bit & 31);
+      type = type.getParent();
+    } while (!type.isBad());
+  }
+
+  // Notifications about anything but field changes might mean that
+  // nodes have been added or removed below the notified node.
+  static SbBool isStructuralChange(const SoNotList * nl) {
+    const SoNotRec * rec = nl->getFirstRec();
+    return !rec || (rec->getOperationType() != SoNotRec::FIELD_UPDATE);
+  }
+
+  // Increased when a structural change might not have been propagated
+  // to all groups above it, because notification was disabled or
+  // ignored on the way up. Summaries built before that are rebuilt.
+  static uint32_t structurestamp;
+  static void invalidateAllSummaries(void) { SoSearchActionP::structurestamp++; }
+
+  // Returns the type summary for the subgraph below the group, or
+  // NULL if it can't be summarized. Implemented in SoGroup.cpp.
+  static const uint32_t * getTypeSummary(SoGroup * group);
+
+  static SoSearchActionP * get(SoSearchAction * action) {
+    return &action->pimpl.get();
+  }
+
+  SbBool setup(SoSearchAction * action);
+  SbBool skipChildren(SoNode * node) const;
+
+  SbBool isCandidate(const SoNode * node) const {
+    void * dummy;
+    return this->candidates.get(node, dummy);
+  }
+
+  SbBool prune;
+  int typebit; // -1 if not pruning on type
+  SbBool namecandidates; // candidates were found from the search name
+  SbHash<const SoNode *, void *> candidates;
+  SbHash<const SoNode *, void *> ancestors;
+};
+
+#endif // !COIN_SOSEARCHACTIONP_H
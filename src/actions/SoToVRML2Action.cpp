@@ -44,6 +44,13 @@
   will typically be somewhat larger. To minimize this effect the
   action tries to reuse nodes when possible.
 
+  With reusePropertyNodes() enabled, equal coordinate, normal, color
+  and texture coordinate arrays are converted into a single VRML2
+  node, which is written once with DEF and then referenced with
+  USE. Arrays are matched on a hash of their content, so shapes
+  sharing an SoCoordinate3 or SoVertexProperty node get a shared
+  node in the VRML2 scene graph as well.
+
   VRML1 nodes will be converted to their equivalent VRML2 nodes,
   while Coin nodes with no VRML2 equivalent are converted to
   IndexedFaceSet. If the DrawStyle is POINTS, all geometry will be
@@ -146,6 +153,7 @@
 #include <Inventor/elements/SoNormalElement.h>
 #include <Inventor/elements/SoSwitchElement.h>
 #include <Inventor/elements/SoMultiTextureCoordinateElement.h>
+#include <Inventor/elements/SoMultiTextureEnabledElement.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/lists/SbList.h>
 #include <Inventor/lists/SoNodeList.h>
@@ -303,11 +311,97 @@ SbBool SoToVRML2Action::doReuseGeometryNodes(void) const { return FALSE; }
 #include <Inventor/VRMLnodes/SoVRMLNodes.h>
 #include <Inventor/VRMLnodes/SoVRML.h>
 
+// Finds the VRML2 property nodes converted from equal arrays, from a
+// hash of the array content. The cache keeps its own copy of each
+// array, so that entries never point into field storage which is
+// reallocated when the node is edited.
+class SoToVRML2PropertyCache {
+public:
+  SoToVRML2PropertyCache(void) { }
+  ~SoToVRML2PropertyCache() { this->clear(); }
+
+  SoNode * find(const void * data, const size_t size, uint32_t & hash) const;
+  void add(SoNode * node, const void * data, const size_t size, const uint32_t hash);
+  void clear(void);
+
+private:
+  struct Entry {
+    SoNode * node;
+    // a copy of the array node was converted from
+    unsigned char * data;
+    size_t size;
+    Entry * next;
+  };
+  static uint32_t hashData(const void * data, const size_t size);
+
+  SbHash<uint32_t, Entry *> entries;
+};
+
+// FNV-1a, a word at a time. The arrays all hold 32-bit values.
+uint32_t
+SoToVRML2PropertyCache::hashData(const void * data, const size_t size)
+{
+  const uint32_t * words = static_cast<const uint32_t *>(data);
+  const size_t numwords = size / sizeof(uint32_t);
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < numwords; i++) {
+    hash = (hash ^ words[i]) * 16777619u;
+  }
+  return hash;
+}
+
+SoNode *
+SoToVRML2PropertyCache::find(const void * data, const size_t size, uint32_t & hash) const
+{
+  hash = SoToVRML2PropertyCache::hashData(data, size);
+  Entry * entry;
+  if (this->entries.get(hash, entry)) {
+    for (; entry; entry = entry->next) {
+      if (entry->size == size && memcmp(entry->data, data, size) == 0) {
+        return entry->node;
+      }
+    }
+  }
+  return NULL;
+}
+
+void
+SoToVRML2PropertyCache::add(SoNode * node, const void * data,
+                            const size_t size, const uint32_t hash)
+{
+  Entry * entry = new Entry;
+  entry->node = node;
+  entry->node->ref();
+  entry->data = new unsigned char[size];
+  memcpy(entry->data, data, size);
+  entry->size = size;
+  entry->next = NULL;
+  if (!this->entries.get(hash, entry->next)) entry->next = NULL;
+  this->entries.put(hash, entry);
+}
+
+void
+SoToVRML2PropertyCache::clear(void)
+{
+  for (SbHash<uint32_t, Entry *>::const_iterator it = this->entries.const_begin();
+       it != this->entries.const_end(); ++it) {
+    Entry * entry = it->obj;
+    while (entry) {
+      Entry * next = entry->next;
+      entry->node->unref();
+      delete[] entry->data;
+      delete entry;
+      entry = next;
+    }
+  }
+  this->entries.clear();
+}
+
 class SoToVRML2ActionP {
 public:
   SoToVRML2ActionP(void)
-    : master(NULL),nodefuse(FALSE),reuseAppearanceNodes(FALSE),reuseGeometryNodes(FALSE),
-      bboxaction(NULL),vrml2path(NULL),vrml2root(NULL),vrmlcoords(NULL),vrmlnormals(NULL),vrmlcolors(NULL),vrmltexcoords(NULL)
+    : master(NULL),nodefuse(FALSE),reuseAppearanceNodes(FALSE),reusePropertyNodes(FALSE),reuseGeometryNodes(FALSE),
+      bboxaction(NULL),vrml2path(NULL),vrml2root(NULL)
   {}
 
   ~SoToVRML2ActionP(void)
@@ -319,10 +413,6 @@ public:
     if (this->vrml2root) {
         this->vrml2root->unref();
     }
-    delete this->vrmlcoords;
-    delete this->vrmlnormals;
-    delete this->vrmlcolors;
-    delete this->vrmltexcoords;
   }
 
   void init(void)
@@ -339,15 +429,10 @@ public:
     do_post_primitives = FALSE;
     didpush = FALSE;
 
-    delete this->vrmlcoords;
-    delete this->vrmlnormals;
-    delete this->vrmlcolors;
-    delete this->vrmltexcoords;
-
-    this->vrmlcoords = new SbList <SoVRMLCoordinate *>;
-    this->vrmlnormals = new SbList <SoVRMLNormal *>;
-    this->vrmlcolors = new SbList <SoVRMLColor *>;
-    this->vrmltexcoords = new SbList <SoVRMLTextureCoordinate *>;
+    this->vrmlcoords.clear();
+    this->vrmlnormals.clear();
+    this->vrmlcolors.clear();
+    this->vrmltexcoords.clear();
 
     if (this->vrml2path) {
       this->vrml2path->unref();
@@ -413,13 +498,15 @@ public:
 
   SoFullPath * vrml2path;
   SoVRMLGroup * vrml2root;
-  SbList <SoVRMLCoordinate *> * vrmlcoords;
-  SbList <SoVRMLNormal *> * vrmlnormals;
-  SbList <SoVRMLColor *> * vrmlcolors;
-  SbList <SoVRMLTextureCoordinate *> * vrmltexcoords;
+  SoToVRML2PropertyCache vrmlcoords;
+  SoToVRML2PropertyCache vrmlnormals;
+  SoToVRML2PropertyCache vrmlcolors;
+  SoToVRML2PropertyCache vrmltexcoords;
 
   SoNode * search_for_recent_node(SoAction * action, const SoType & type);
+  SoTexture2 * search_for_recent_texture(SoAction * action);
   SoGroup * get_current_tail(void);
+  void push_node(SoNode * node);
   SoVRMLCoordinate * get_or_create_coordinate(const SbVec4f *, int32_t num);
   SoVRMLCoordinate * get_or_create_coordinate(const SbVec3f *, int32_t num);
   SoVRMLNormal * get_or_create_normal(const SbVec3f *, int32_t num);
@@ -736,6 +823,28 @@ SoToVRML2ActionP::search_for_recent_node(SoAction * action, const SoType & type)
   return tail;
 }
 
+// Adds node as the last child of the current tail, and makes it the
+// new tail. The child index is passed to SoPath::append(), as finding
+// it costs time proportional to the number of children.
+void
+SoToVRML2ActionP::push_node(SoNode * node)
+{
+  SoGroup * tail = this->get_current_tail();
+  tail->addChild(node);
+  this->vrml2path->append(tail->getNumChildren() - 1);
+}
+
+// Searching the path costs time proportional to the number of
+// nodes traversed so far, so only search when a texture is enabled.
+SoTexture2 *
+SoToVRML2ActionP::search_for_recent_texture(SoAction * action)
+{
+  int lastenabled = -1;
+  (void) SoMultiTextureEnabledElement::getEnabledUnits(action->getState(), lastenabled);
+  if (lastenabled < 0) return NULL;
+  return coin_safe_cast<SoTexture2 *>(this->search_for_recent_node(action, SoTexture2::getClassTypeId()));
+}
+
 SoGroup *
 SoToVRML2ActionP::get_current_tail(void)
 {
@@ -761,44 +870,38 @@ SoToVRML2ActionP::get_or_create_coordinate(const SbVec4f * coord4, int32_t num)
 SoVRMLCoordinate *
 SoToVRML2ActionP::get_or_create_coordinate(const SbVec3f * coord3, int32_t num)
 {
+  uint32_t hash = 0;
   if (this->reusePropertyNodes) {
     // Search for a matching VRMLCoordinate
-    int n = this->vrmlcoords->getLength();
-    while (--n >= 0) {
-      SoVRMLCoordinate * c = (*this->vrmlcoords)[n];
-      if (c->point.getNum() == num &&
-          memcmp(coord3, c->point.getValues(0), num*sizeof(SbVec3f)) == 0) {
-        return c;
-      }
-    }
+    SoNode * c = this->vrmlcoords.find(coord3, num*sizeof(SbVec3f), hash);
+    if (c) return coin_assert_cast<SoVRMLCoordinate *>(c);
   }
 
   // Create new
   SoVRMLCoordinate * c = new SoVRMLCoordinate;
   c->point.setValues(0, num, coord3);
-  if (this->reusePropertyNodes) this->vrmlcoords->append(c);
+  if (this->reusePropertyNodes) {
+    this->vrmlcoords.add(c, coord3, num*sizeof(SbVec3f), hash);
+  }
   return c;
 }
 
 SoVRMLNormal *
 SoToVRML2ActionP::get_or_create_normal(const SbVec3f * normal, int32_t num)
 {
+  uint32_t hash = 0;
   if (this->reusePropertyNodes) {
     // Search for a matching VRMLNormal
-    int n = this->vrmlnormals->getLength();
-    while (--n >= 0) {
-      SoVRMLNormal * nor = (*this->vrmlnormals)[n];
-      if (nor->vector.getNum() == num &&
-          memcmp(normal, nor->vector.getValues(0), num*sizeof(SbVec3f)) == 0) {
-        return nor;
-      }
-    }
+    SoNode * nor = this->vrmlnormals.find(normal, num*sizeof(SbVec3f), hash);
+    if (nor) return coin_assert_cast<SoVRMLNormal *>(nor);
   }
 
   // Create new
   SoVRMLNormal * nor = new SoVRMLNormal;
   nor->vector.setValues(0, num, normal);
-  if (this->reusePropertyNodes) this->vrmlnormals->append(nor);
+  if (this->reusePropertyNodes) {
+    this->vrmlnormals.add(nor, normal, num*sizeof(SbVec3f), hash);
+  }
   return nor;
 }
 
@@ -819,44 +922,38 @@ SoToVRML2ActionP::get_or_create_color(const uint32_t * packedColor, int32_t num)
 SoVRMLColor *
 SoToVRML2ActionP::get_or_create_color(const SbColor * color, int32_t num)
 {
+  uint32_t hash = 0;
   if (this->reusePropertyNodes) {
     // Search for a matching VRMLColor
-    int n = this->vrmlcolors->getLength();
-    while (--n >= 0) {
-      SoVRMLColor * c = (*this->vrmlcolors)[n];
-      if (c->color.getNum() == num &&
-          memcmp(color, c->color.getValues(0), num*sizeof(SbColor)) == 0) {
-        return c;
-      }
-    }
+    SoNode * c = this->vrmlcolors.find(color, num*sizeof(SbColor), hash);
+    if (c) return coin_assert_cast<SoVRMLColor *>(c);
   }
 
   // Create new
   SoVRMLColor * c = new SoVRMLColor;
   c->color.setValues(0, num, color);
-  if (this->reusePropertyNodes) this->vrmlcolors->append(c);
+  if (this->reusePropertyNodes) {
+    this->vrmlcolors.add(c, color, num*sizeof(SbColor), hash);
+  }
   return c;
 }
 
 SoVRMLTextureCoordinate *
 SoToVRML2ActionP::get_or_create_texcoordinate(const SbVec2f * texcoord2, int32_t num)
 {
+  uint32_t hash = 0;
   if (this->reusePropertyNodes) {
     // Search for a matching VRMLTextureCoordinate
-    int n = this->vrmltexcoords->getLength();
-    while (--n >= 0) {
-      SoVRMLTextureCoordinate * tc = (*this->vrmltexcoords)[n];
-      if (tc->point.getNum() == num &&
-          memcmp(texcoord2, tc->point.getValues(0), num*sizeof(SbVec2f)) == 0) {
-        return tc;
-      }
-    }
+    SoNode * tc = this->vrmltexcoords.find(texcoord2, num*sizeof(SbVec2f), hash);
+    if (tc) return coin_assert_cast<SoVRMLTextureCoordinate *>(tc);
   }
 
   // Create new
   SoVRMLTextureCoordinate * tc = new SoVRMLTextureCoordinate;
   tc->point.setValues(0, num, texcoord2);
-  if (this->reusePropertyNodes) this->vrmltexcoords->append(tc);
+  if (this->reusePropertyNodes) {
+    this->vrmltexcoords.add(tc, texcoord2, num*sizeof(SbVec2f), hash);
+  }
   return tc;
 }
 
@@ -896,7 +993,7 @@ SoToVRML2ActionP::insert_shape(SoCallbackAction * action, SoVRMLGeometry * geom)
 
     // Texture
     if (this->recentTex2 == NULL) {
-      this->recentTex2 = coin_safe_cast<SoTexture2 *>(search_for_recent_node(action, SoTexture2::getClassTypeId()));
+      this->recentTex2 = this->search_for_recent_texture(action);
     }
 
     if (this->recentTex2 != NULL) {
@@ -983,8 +1080,7 @@ SoToVRML2ActionP::push_sep_cb(void * closure, SoCallbackAction * COIN_UNUSED_ARG
   }
 
   // Push a new SoVRMLGroup on the tail of the path
-  prevgroup->addChild(newgroup);
-  thisp->vrml2path->append(newgroup);
+  thisp->push_node(newgroup);
   thisp->separatorstack.append(newgroup);
 
   return SoCallbackAction::CONTINUE;
@@ -1048,8 +1144,7 @@ SoToVRML2ActionP::push_switch_cb(void * closure, SoCallbackAction * action, cons
     action->getSwitch() : oldswitch->whichChild.getValue();
 
   newswitch->whichChoice = wc;
-  prevgroup->addChild(newswitch);
-  thisp->vrml2path->append(newswitch);
+  thisp->push_node(newswitch);
 
   /* Traverse all children separately, that is, save and restore state
    * between each.  If there is a selected child, traverse it normally
@@ -1168,8 +1263,7 @@ SoToVRML2ActionP::push_levelofdetail_cb(void * closure, SoCallbackAction * actio
   }
   newlod->range.finishEditing();
 
-  prevgroup->addChild(newlod);
-  thisp->vrml2path->append(newlod);
+  thisp->push_node(newlod);
 
   // Traverse all children separately, with normal SoGroup traversal
   int n = oldlod->getNumChildren();
@@ -1205,8 +1299,7 @@ SoToVRML2ActionP::push_lod_cb(void * closure, SoCallbackAction * action, const S
   newlod->range.setValues(0, oldlod->range.getNum(), oldlod->range.getValues(0));
   newlod->center = oldlod->center.getValue();
 
-  prevgroup->addChild(newlod);
-  thisp->vrml2path->append(newlod);
+  thisp->push_node(newlod);
 
   // Traverse all children separately, with a normal SoGroup traversal
   int n = oldlod->getNumChildren();
@@ -1824,8 +1917,7 @@ SoToVRML2ActionP::somattrans_cb(void * closure, SoCallbackAction * COIN_UNUSED_A
   newt->rotation = rotation.getValue();
   newt->scale = scaleFactor.getValue();
   newt->scaleOrientation = scaleOrientation.getValue();
-  THISP(closure)->get_current_tail()->addChild(newt);
-  THISP(closure)->vrml2path->append(newt);
+  THISP(closure)->push_node(newt);
   return SoCallbackAction::CONTINUE;
 }
 
@@ -1835,8 +1927,7 @@ SoToVRML2ActionP::sorotation_cb(void * closure, SoCallbackAction * COIN_UNUSED_A
   const SoRotation * oldt = coin_assert_cast<const SoRotation *>(node);
   SoVRMLTransform * newt = NEW_NODE(SoVRMLTransform, node);
   newt->rotation = oldt->rotation.getValue();
-  THISP(closure)->get_current_tail()->addChild(newt);
-  THISP(closure)->vrml2path->append(newt);
+  THISP(closure)->push_node(newt);
   return SoCallbackAction::CONTINUE;
 }
 
@@ -1846,8 +1937,7 @@ SoToVRML2ActionP::sorotationxyz_cb(void * closure, SoCallbackAction * COIN_UNUSE
   const SoRotationXYZ * oldt = coin_assert_cast<const SoRotationXYZ *>(node);
   SoVRMLTransform * newt = NEW_NODE(SoVRMLTransform, node);
   newt->rotation = oldt->getRotation();
-  THISP(closure)->get_current_tail()->addChild(newt);
-  THISP(closure)->vrml2path->append(newt);
+  THISP(closure)->push_node(newt);
   return SoCallbackAction::CONTINUE;
 }
 
@@ -1857,8 +1947,7 @@ SoToVRML2ActionP::soscale_cb(void * closure, SoCallbackAction * COIN_UNUSED_ARG(
   const SoScale * oldt = coin_assert_cast<const SoScale *>(node);
   SoVRMLTransform * newt = NEW_NODE(SoVRMLTransform, node);
   newt->scale = oldt->scaleFactor.getValue();
-  THISP(closure)->get_current_tail()->addChild(newt);
-  THISP(closure)->vrml2path->append(newt);
+  THISP(closure)->push_node(newt);
   return SoCallbackAction::CONTINUE;
 }
 
@@ -1873,8 +1962,7 @@ SoToVRML2ActionP::sotransform_cb(void * closure, SoCallbackAction * COIN_UNUSED_
   newt->scale = oldt->scaleFactor.getValue();
   newt->scaleOrientation = oldt->scaleOrientation.getValue();
   newt->center = oldt->center.getValue();
-  THISP(closure)->get_current_tail()->addChild(newt);
-  THISP(closure)->vrml2path->append(newt);
+  THISP(closure)->push_node(newt);
   return SoCallbackAction::CONTINUE;
 }
 
@@ -1884,8 +1972,7 @@ SoToVRML2ActionP::sotranslation_cb(void * closure, SoCallbackAction * COIN_UNUSE
   const SoTranslation * oldt = coin_assert_cast<const SoTranslation *>(node);
   SoVRMLTransform * newt = NEW_NODE(SoVRMLTransform, node);
   newt->translation = oldt->translation.getValue();
-  THISP(closure)->get_current_tail()->addChild(newt);
-  THISP(closure)->vrml2path->append(newt);
+  THISP(closure)->push_node(newt);
   return SoCallbackAction::CONTINUE;
 }
 
@@ -1905,8 +1992,7 @@ SoToVRML2ActionP::sounits_cb(void * closure, SoCallbackAction * COIN_UNUSED_ARG(
   // read the value in the first matrix column/row to find the scale
   // factor.
   newt->scale = SbVec3f(m[0][0], m[0][0], m[0][0]);
-  THISP(closure)->get_current_tail()->addChild(newt);
-  THISP(closure)->vrml2path->append(newt);
+  THISP(closure)->push_node(newt);
   return SoCallbackAction::CONTINUE;
 }
 
@@ -2137,8 +2223,7 @@ SoToVRML2ActionP::sotoifs_cb(void * closure, SoCallbackAction * action, const So
     }
   }
 
-  thisp->recentTex2 =
-    coin_safe_cast<SoTexture2 *>(thisp->search_for_recent_node(action, SoTexture2::getClassTypeId()));
+  thisp->recentTex2 = thisp->search_for_recent_texture(action);
   if (thisp->recentTex2) {
     thisp->bsptreetex = new SbBSPTree;
     thisp->texidx = new SbList <int32_t>;
@@ -2348,3 +2433,80 @@ SoToVRML2ActionP::post_primitives_cb(void * closure, SoCallbackAction * action,
 #undef THISP
 
 #endif // HAVE_VRML97
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/SoFullPath.h>
+#include <Inventor/VRMLnodes/SoVRMLCoordinate.h>
+#include <Inventor/VRMLnodes/SoVRMLGroup.h>
+#include <Inventor/VRMLnodes/SoVRMLIndexedFaceSet.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+static SoIndexedFaceSet *
+tovrml2_test_triangle(const int32_t a, const int32_t b, const int32_t c)
+{
+  SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+  const int32_t indices[] = { a, b, c, -1 };
+  ifs->coordIndex.setValues(0, 4, indices);
+  return ifs;
+}
+
+BOOST_AUTO_TEST_CASE(reusePropertyNodes)
+{
+  const SbVec3f square[] = {
+    SbVec3f(0.0f, 0.0f, 0.0f), SbVec3f(1.0f, 0.0f, 0.0f),
+    SbVec3f(1.0f, 1.0f, 0.0f), SbVec3f(0.0f, 1.0f, 0.0f)
+  };
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * shared = new SoCoordinate3;
+  shared->point.setValues(0, 4, square);
+  root->addChild(shared);
+  root->addChild(tovrml2_test_triangle(0, 1, 2));
+  root->addChild(tovrml2_test_triangle(0, 2, 3));
+
+  // the same number of coordinates, with different values
+  SoSeparator * sep = new SoSeparator;
+  SoCoordinate3 * other = new SoCoordinate3;
+  other->point.setValues(0, 4, square);
+  other->point.set1Value(3, SbVec3f(0.0f, 2.0f, 0.0f));
+  sep->addChild(other);
+  sep->addChild(tovrml2_test_triangle(0, 2, 3));
+  root->addChild(sep);
+
+  SoToVRML2Action tovrml2;
+  tovrml2.reusePropertyNodes(TRUE);
+  tovrml2.apply(root);
+  SoVRMLGroup * vrmlroot = tovrml2.getVRML2SceneGraph();
+  BOOST_REQUIRE(vrmlroot != NULL);
+  vrmlroot->ref();
+
+  SoSearchAction sa;
+  sa.setType(SoVRMLIndexedFaceSet::getClassTypeId());
+  sa.setInterest(SoSearchAction::ALL);
+  sa.setSearchingAll(TRUE);
+  sa.apply(vrmlroot);
+  const SoPathList & paths = sa.getPaths();
+  BOOST_REQUIRE(paths.getLength() == 3);
+  SoNode * coords[3];
+  for (int i = 0; i < 3; i++) {
+    SoVRMLIndexedFaceSet * ifs =
+      static_cast<SoVRMLIndexedFaceSet *>(static_cast<SoFullPath *>(paths[i])->getTail());
+    coords[i] = ifs->coord.getValue();
+    BOOST_REQUIRE(coords[i] != NULL);
+  }
+  BOOST_CHECK_MESSAGE(coords[0] == coords[1],
+                      "shapes sharing coordinates should share one SoVRMLCoordinate");
+  BOOST_CHECK_MESSAGE(coords[2] != coords[0],
+                      "different coordinates should not be reused");
+  const SoMFVec3f & point = static_cast<SoVRMLCoordinate *>(coords[2])->point;
+  BOOST_CHECK_MESSAGE(point.getNum() == 4 && point[3] == SbVec3f(0.0f, 2.0f, 0.0f),
+                      "the converted coordinates should match the original");
+
+  vrmlroot->unref();
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,686 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SbIdBuffer SbIdBuffer.h Inventor/SbIdBuffer.h
+  \brief The SbIdBuffer class is a software rasterizer for primitive ids and depth.
+
+  \ingroup base
+
+  Triangles, lines and points are added together with a 32 bit id and
+  a matrix transforming from object space into clip space. The
+  buffer keeps, for each pixel, the id and depth of the closest
+  primitive covering the pixel center. It can be used for visibility
+  queries, like finding the primitives visible within some region of
+  the screen, without an OpenGL context and without the limit on the
+  number of primitives imposed by the color resolution of a frame
+  buffer.
+
+  Primitives are collected as they are added, and rasterized in
+  batches of a fixed size, and the first time the buffer contents are
+  read. Memory use is therefore independent of the number of
+  primitives added. The buffer is divided into
+  tiles which are rasterized in parallel when Coin is built with
+  thread support, see setNumThreads(). Primitives are drawn in the
+  order they were added within each tile, so the result does not
+  depend on the number of threads. Like OpenGL's GL_LEQUAL depth
+  function, a later primitive wins when two primitives have the same
+  depth.
+
+  Pixels not covered by any primitive have id 0 and depth \c
+  FLT_MAX. Id 0 can be used for primitives that should hide other
+  primitives without being reported themselves. Primitives with a
+  vertex on or behind the eye point are ignored.
+
+  \sa SbOcclusionBuffer
+  \since Coin 4.0
+*/
+
+#include <Inventor/SbIdBuffer.h>
+
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <Inventor/C/tidbits.h> // coin_getenv()
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/wpool.h>
+#endif // HAVE_THREADS
+
+
+// *************************************************************************
+
+// tiles are IDBUFFER_TILE_SIZE pixels wide and high
+#define IDBUFFER_TILE_SIZE 64
+
+// the minimum number of primitives before rasterizing in parallel
+#define IDBUFFER_MIN_PARALLEL 256
+
+// the number of queued primitives which triggers rasterization
+#define IDBUFFER_BATCH_SIZE 65536
+
+class SbIdBuffer::PImpl {
+public:
+  PImpl(void) : size(0, 0), numtilesx(0), numtilesy(0) {
+#ifdef HAVE_THREADS
+    this->pool = NULL;
+#endif // HAVE_THREADS
+  }
+  ~PImpl(void) {
+#ifdef HAVE_THREADS
+    if (this->pool) cc_wpool_destruct(this->pool);
+#endif // HAVE_THREADS
+  }
+
+  struct Primitive {
+    int numvertices;
+    float v[3][3];
+    uint32_t id;
+    // covered pixels, inclusive
+    int xmin, ymin, xmax, ymax;
+  };
+
+  SbVec2s size;
+  SbList <uint32_t> ids;
+  SbList <float> depth;
+  int numtilesx, numtilesy;
+
+  // primitives not rasterized yet
+  mutable SbList <Primitive> pending;
+
+#ifdef HAVE_THREADS
+  // each buffer has its own worker threads, so that buffers can be
+  // used from several threads at the same time
+  mutable cc_wpool * pool;
+#endif // HAVE_THREADS
+
+  SbBool toScreen(const SbVec3f & p, const SbMatrix & m, float * dst) const;
+  void add(Primitive & prim) const;
+  void flush(void) const;
+  void rasterizeTile(const int tile, const int * prims, const int numprims) const;
+
+  // a set of tiles to be rasterized by one thread
+  struct TileJob {
+    const PImpl * thisp;
+    const int * tileoffsets;
+    const int * tileprims;
+    int numtiles;
+    int first;
+    int step;
+  };
+  static void rasterizeTiles(void * closure);
+
+  static int numthreads;
+};
+
+int SbIdBuffer::PImpl::numthreads = -1;
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// clip space w values below this are considered to be on or behind
+// the eye point
+static const float IDBUFFER_EPS_W = 1.0e-6f;
+
+// *************************************************************************
+
+// worker function, rasterizing a set of tiles
+void
+SbIdBuffer::PImpl::rasterizeTiles(void * closure)
+{
+  const TileJob * job = static_cast<const TileJob *>(closure);
+  for (int i = job->first; i < job->numtiles; i += job->step) {
+    const int n = job->tileoffsets[i+1] - job->tileoffsets[i];
+    if (n) job->thisp->rasterizeTile(i, job->tileprims + job->tileoffsets[i], n);
+  }
+}
+
+// *************************************************************************
+
+// transform p into buffer coordinates (pixels in x and y, [0, 1] depth in z)
+SbBool
+SbIdBuffer::PImpl::toScreen(const SbVec3f & p, const SbMatrix & m, float * dst) const
+{
+  const float x = p[0], y = p[1], z = p[2];
+  const float w = x*m[0][3] + y*m[1][3] + z*m[2][3] + m[3][3];
+  if (w <= IDBUFFER_EPS_W) return FALSE;
+
+  const float invw = 1.0f / w;
+  const float cx = x*m[0][0] + y*m[1][0] + z*m[2][0] + m[3][0];
+  const float cy = x*m[0][1] + y*m[1][1] + z*m[2][1] + m[3][1];
+  const float cz = x*m[0][2] + y*m[1][2] + z*m[2][2] + m[3][2];
+  dst[0] = (cx * invw * 0.5f + 0.5f) * float(this->size[0]);
+  dst[1] = (cy * invw * 0.5f + 0.5f) * float(this->size[1]);
+  dst[2] = cz * invw * 0.5f + 0.5f;
+  return TRUE;
+}
+
+// clip the covered pixels of prim to the buffer, and queue it
+void
+SbIdBuffer::PImpl::add(Primitive & prim) const
+{
+  if (prim.xmin < 0) prim.xmin = 0;
+  if (prim.ymin < 0) prim.ymin = 0;
+  if (prim.xmax >= this->size[0]) prim.xmax = this->size[0] - 1;
+  if (prim.ymax >= this->size[1]) prim.ymax = this->size[1] - 1;
+  if (prim.xmin > prim.xmax || prim.ymin > prim.ymax) return;
+  this->pending.append(prim);
+  if (this->pending.getLength() >= IDBUFFER_BATCH_SIZE) this->flush();
+}
+
+// Rasterize the pending primitives. The primitives are sorted into
+// the tiles they cover, keeping the order they were added in, and
+// the tiles are then rasterized independently.
+void
+SbIdBuffer::PImpl::flush(void) const
+{
+  const int numprims = this->pending.getLength();
+  if (numprims == 0) return;
+
+  const int numtiles = this->numtilesx * this->numtilesy;
+  SbList <int> tileoffsets(numtiles + 1);
+  int i;
+  for (i = 0; i <= numtiles; i++) tileoffsets.append(0);
+
+  const Primitive * prims = this->pending.getArrayPtr();
+  for (i = 0; i < numprims; i++) {
+    const Primitive & p = prims[i];
+    for (int ty = p.ymin / IDBUFFER_TILE_SIZE; ty <= p.ymax / IDBUFFER_TILE_SIZE; ty++) {
+      for (int tx = p.xmin / IDBUFFER_TILE_SIZE; tx <= p.xmax / IDBUFFER_TILE_SIZE; tx++) {
+        tileoffsets[ty * this->numtilesx + tx + 1]++;
+      }
+    }
+  }
+  for (i = 0; i < numtiles; i++) tileoffsets[i+1] += tileoffsets[i];
+
+  SbList <int> tileprims(tileoffsets[numtiles]);
+  for (i = 0; i < tileoffsets[numtiles]; i++) tileprims.append(0);
+  SbList <int> fill(numtiles);
+  for (i = 0; i < numtiles; i++) fill.append(tileoffsets[i]);
+  for (i = 0; i < numprims; i++) {
+    const Primitive & p = prims[i];
+    for (int ty = p.ymin / IDBUFFER_TILE_SIZE; ty <= p.ymax / IDBUFFER_TILE_SIZE; ty++) {
+      for (int tx = p.xmin / IDBUFFER_TILE_SIZE; tx <= p.xmax / IDBUFFER_TILE_SIZE; tx++) {
+        tileprims[fill[ty * this->numtilesx + tx]++] = i;
+      }
+    }
+  }
+
+  int numjobs = 1;
+#ifdef HAVE_THREADS
+  if (numprims >= IDBUFFER_MIN_PARALLEL) {
+    numjobs = SbMin(SbIdBuffer::getNumThreads(), numtiles);
+  }
+#endif // HAVE_THREADS
+
+  SbList <TileJob> jobs(numjobs);
+  for (i = 0; i < numjobs; i++) {
+    TileJob job;
+    job.thisp = this;
+    job.tileoffsets = tileoffsets.getArrayPtr();
+    job.tileprims = tileprims.getArrayPtr();
+    job.numtiles = numtiles;
+    job.first = i;
+    job.step = numjobs;
+    jobs.append(job);
+  }
+
+#ifdef HAVE_THREADS
+  cc_wpool * pool = NULL;
+  if (numjobs > 1) {
+    const int numworkers = SbIdBuffer::getNumThreads() - 1;
+    if (this->pool == NULL) {
+      this->pool = cc_wpool_construct(numworkers);
+    }
+    else if (cc_wpool_get_num_workers(this->pool) != numworkers) {
+      cc_wpool_set_num_workers(this->pool, numworkers);
+    }
+    pool = this->pool;
+    cc_wpool_begin(pool, numjobs - 1);
+    for (i = 1; i < numjobs; i++) {
+      cc_wpool_start_worker(pool, PImpl::rasterizeTiles, &jobs[i]);
+    }
+    cc_wpool_end(pool);
+  }
+#endif // HAVE_THREADS
+  PImpl::rasterizeTiles(&jobs[0]);
+#ifdef HAVE_THREADS
+  if (pool) cc_wpool_wait_all(pool);
+#endif // HAVE_THREADS
+
+  this->pending.truncate(0);
+}
+
+// Rasterize the primitives prims into a tile. Only pixels within the
+// tile are written, so tiles can be rasterized in parallel.
+void
+SbIdBuffer::PImpl::rasterizeTile(const int tile, const int * primidx, const int numprims) const
+{
+  const int tx0 = (tile % this->numtilesx) * IDBUFFER_TILE_SIZE;
+  const int ty0 = (tile / this->numtilesx) * IDBUFFER_TILE_SIZE;
+  const int tx1 = SbMin(tx0 + IDBUFFER_TILE_SIZE, int(this->size[0])) - 1;
+  const int ty1 = SbMin(ty0 + IDBUFFER_TILE_SIZE, int(this->size[1])) - 1;
+  const int w = this->size[0];
+
+  // the lists are only resized by setSize(), never while rasterizing
+  uint32_t * idbuf = const_cast<uint32_t *>(this->ids.getArrayPtr());
+  float * depthbuf = const_cast<float *>(this->depth.getArrayPtr());
+  const Primitive * prims = this->pending.getArrayPtr();
+
+  for (int i = 0; i < numprims; i++) {
+    const Primitive & p = prims[primidx[i]];
+    const int xmin = SbMax(p.xmin, tx0);
+    const int xmax = SbMin(p.xmax, tx1);
+    const int ymin = SbMax(p.ymin, ty0);
+    const int ymax = SbMin(p.ymax, ty1);
+
+    switch (p.numvertices) {
+    case 1:
+      {
+        const float z = p.v[0][2];
+        const int idx = ymin * w + xmin;
+        if (z >= 0.0f && z <= 1.0f && z <= depthbuf[idx]) {
+          depthbuf[idx] = z;
+          idbuf[idx] = p.id;
+        }
+      }
+      break;
+    case 2:
+      {
+        const float dx = p.v[1][0] - p.v[0][0];
+        const float dy = p.v[1][1] - p.v[0][1];
+        const float dz = p.v[1][2] - p.v[0][2];
+        const int n = int(ceil(SbMax(float(fabs(dx)), float(fabs(dy)))));
+        for (int s = 0; s <= n; s++) {
+          const float t = n ? float(s) / float(n) : 0.0f;
+          const int x = int(floor(p.v[0][0] + t * dx));
+          const int y = int(floor(p.v[0][1] + t * dy));
+          if (x < xmin || x > xmax || y < ymin || y > ymax) continue;
+          const float z = p.v[0][2] + t * dz;
+          const int idx = y * w + x;
+          if (z >= 0.0f && z <= 1.0f && z <= depthbuf[idx]) {
+            depthbuf[idx] = z;
+            idbuf[idx] = p.id;
+          }
+        }
+      }
+      break;
+    case 3:
+      {
+        // the vertices are counterclockwise, see SbIdBuffer::addTriangle()
+        const float * v0 = p.v[0];
+        const float * v1 = p.v[1];
+        const float * v2 = p.v[2];
+        const float area =
+          (v1[0]-v0[0])*(v2[1]-v0[1]) - (v2[0]-v0[0])*(v1[1]-v0[1]);
+        const float invarea = 1.0f / area;
+
+        for (int y = ymin; y <= ymax; y++) {
+          const float py = float(y) + 0.5f;
+          for (int x = xmin; x <= xmax; x++) {
+            const float px = float(x) + 0.5f;
+            const float e0 = (v2[0]-v1[0])*(py-v1[1]) - (v2[1]-v1[1])*(px-v1[0]);
+            const float e1 = (v0[0]-v2[0])*(py-v2[1]) - (v0[1]-v2[1])*(px-v2[0]);
+            const float e2 = (v1[0]-v0[0])*(py-v0[1]) - (v1[1]-v0[1])*(px-v0[0]);
+            if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) continue;
+            const float z = (e0 * v0[2] + e1 * v1[2] + e2 * v2[2]) * invarea;
+            const int idx = y * w + x;
+            if (z >= 0.0f && z <= 1.0f && z <= depthbuf[idx]) {
+              depthbuf[idx] = z;
+              idbuf[idx] = p.id;
+            }
+          }
+        }
+      }
+      break;
+    default:
+      assert(0 && "unknown primitive");
+      break;
+    }
+  }
+}
+
+// *************************************************************************
+
+/*!
+  Constructor. The buffer is empty until setSize() is called.
+*/
+SbIdBuffer::SbIdBuffer(void)
+{
+}
+
+/*!
+  Destructor.
+*/
+SbIdBuffer::~SbIdBuffer(void)
+{
+}
+
+/*!
+  Sets the size of the buffer in pixels, and clears it.
+*/
+void
+SbIdBuffer::setSize(const SbVec2s & size)
+{
+  PRIVATE(this)->size = size;
+  const int n = SbMax(0, int(size[0]) * int(size[1]));
+  PRIVATE(this)->ids.truncate(0);
+  PRIVATE(this)->depth.truncate(0);
+  for (int i = 0; i < n; i++) {
+    PRIVATE(this)->ids.append(0);
+    PRIVATE(this)->depth.append(FLT_MAX);
+  }
+  PRIVATE(this)->numtilesx = (SbMax(0, int(size[0])) + IDBUFFER_TILE_SIZE - 1) / IDBUFFER_TILE_SIZE;
+  PRIVATE(this)->numtilesy = (SbMax(0, int(size[1])) + IDBUFFER_TILE_SIZE - 1) / IDBUFFER_TILE_SIZE;
+  PRIVATE(this)->pending.truncate(0);
+}
+
+/*!
+  Returns the size of the buffer.
+*/
+const SbVec2s &
+SbIdBuffer::getSize(void) const
+{
+  return PRIVATE(this)->size;
+}
+
+/*!
+  Clears all pixels to id 0 and depth \c FLT_MAX, and discards
+  primitives not rasterized yet.
+*/
+void
+SbIdBuffer::clear(void)
+{
+  const int n = PRIVATE(this)->ids.getLength();
+  for (int i = 0; i < n; i++) {
+    PRIVATE(this)->ids[i] = 0;
+    PRIVATE(this)->depth[i] = FLT_MAX;
+  }
+  PRIVATE(this)->pending.truncate(0);
+}
+
+/*!
+  Adds a triangle with the given \a id. Triangles are wound
+  counterclockwise when the vertices appear counterclockwise on the
+  screen, and \a culling can be used to skip back facing triangles.
+*/
+void
+SbIdBuffer::addTriangle(const SbVec3f & v0, const SbVec3f & v1, const SbVec3f & v2,
+                        const SbMatrix & objtoclip, const uint32_t id,
+                        const Culling culling)
+{
+  PImpl::Primitive prim;
+  prim.numvertices = 3;
+  prim.id = id;
+  if (!PRIVATE(this)->toScreen(v0, objtoclip, prim.v[0]) ||
+      !PRIVATE(this)->toScreen(v1, objtoclip, prim.v[1]) ||
+      !PRIVATE(this)->toScreen(v2, objtoclip, prim.v[2])) return;
+
+  const float area =
+    (prim.v[1][0]-prim.v[0][0])*(prim.v[2][1]-prim.v[0][1]) -
+    (prim.v[2][0]-prim.v[0][0])*(prim.v[1][1]-prim.v[0][1]);
+  if (fabs(area) < 1.0e-8f) return;
+  if (area < 0.0f) {
+    if (culling == CULL_CLOCKWISE) return;
+    for (int i = 0; i < 3; i++) {
+      const float tmp = prim.v[1][i];
+      prim.v[1][i] = prim.v[2][i];
+      prim.v[2][i] = tmp;
+    }
+  }
+  else if (culling == CULL_COUNTERCLOCKWISE) return;
+
+  // pixels with their centers inside the triangle
+  const float xmin = SbMin(prim.v[0][0], SbMin(prim.v[1][0], prim.v[2][0]));
+  const float xmax = SbMax(prim.v[0][0], SbMax(prim.v[1][0], prim.v[2][0]));
+  const float ymin = SbMin(prim.v[0][1], SbMin(prim.v[1][1], prim.v[2][1]));
+  const float ymax = SbMax(prim.v[0][1], SbMax(prim.v[1][1], prim.v[2][1]));
+  if (xmax < 0.0f || ymax < 0.0f ||
+      xmin > float(PRIVATE(this)->size[0]) || ymin > float(PRIVATE(this)->size[1])) return;
+  prim.xmin = int(ceil(xmin - 0.5f));
+  prim.xmax = int(floor(xmax - 0.5f));
+  prim.ymin = int(ceil(ymin - 0.5f));
+  prim.ymax = int(floor(ymax - 0.5f));
+  PRIVATE(this)->add(prim);
+}
+
+/*!
+  Adds a one pixel wide line with the given \a id.
+*/
+void
+SbIdBuffer::addLine(const SbVec3f & v0, const SbVec3f & v1,
+                    const SbMatrix & objtoclip, const uint32_t id)
+{
+  PImpl::Primitive prim;
+  prim.numvertices = 2;
+  prim.id = id;
+  if (!PRIVATE(this)->toScreen(v0, objtoclip, prim.v[0]) ||
+      !PRIVATE(this)->toScreen(v1, objtoclip, prim.v[1])) return;
+
+  const float xmin = SbMin(prim.v[0][0], prim.v[1][0]);
+  const float xmax = SbMax(prim.v[0][0], prim.v[1][0]);
+  const float ymin = SbMin(prim.v[0][1], prim.v[1][1]);
+  const float ymax = SbMax(prim.v[0][1], prim.v[1][1]);
+  if (xmax < 0.0f || ymax < 0.0f ||
+      xmin >= float(PRIVATE(this)->size[0]) || ymin >= float(PRIVATE(this)->size[1])) return;
+  prim.xmin = int(floor(xmin));
+  prim.xmax = int(floor(xmax));
+  prim.ymin = int(floor(ymin));
+  prim.ymax = int(floor(ymax));
+  PRIVATE(this)->add(prim);
+}
+
+/*!
+  Adds a one pixel point with the given \a id.
+*/
+void
+SbIdBuffer::addPoint(const SbVec3f & v, const SbMatrix & objtoclip, const uint32_t id)
+{
+  PImpl::Primitive prim;
+  prim.numvertices = 1;
+  prim.id = id;
+  if (!PRIVATE(this)->toScreen(v, objtoclip, prim.v[0])) return;
+  if (prim.v[0][0] < 0.0f || prim.v[0][1] < 0.0f ||
+      prim.v[0][0] >= float(PRIVATE(this)->size[0]) ||
+      prim.v[0][1] >= float(PRIVATE(this)->size[1])) return;
+  prim.xmin = prim.xmax = int(floor(prim.v[0][0]));
+  prim.ymin = prim.ymax = int(floor(prim.v[0][1]));
+  PRIVATE(this)->add(prim);
+}
+
+/*!
+  Returns the id of the closest primitive covering \a pixel, or 0 if
+  no primitive covers it.
+*/
+uint32_t
+SbIdBuffer::getId(const SbVec2s & pixel) const
+{
+  const SbVec2s & size = PRIVATE(this)->size;
+  if (pixel[0] < 0 || pixel[1] < 0 || pixel[0] >= size[0] || pixel[1] >= size[1]) return 0;
+  PRIVATE(this)->flush();
+  return PRIVATE(this)->ids[int(pixel[1]) * size[0] + pixel[0]];
+}
+
+/*!
+  Returns the depth, in the range [0, 1], of the closest primitive
+  covering \a pixel, or \c FLT_MAX if no primitive covers it.
+*/
+float
+SbIdBuffer::getDepth(const SbVec2s & pixel) const
+{
+  const SbVec2s & size = PRIVATE(this)->size;
+  if (pixel[0] < 0 || pixel[1] < 0 || pixel[0] >= size[0] || pixel[1] >= size[1]) return FLT_MAX;
+  PRIVATE(this)->flush();
+  return PRIVATE(this)->depth[int(pixel[1]) * size[0] + pixel[0]];
+}
+
+/*!
+  Returns the ids of all pixels, row by row from the lower left
+  corner.
+*/
+const uint32_t *
+SbIdBuffer::getIdBuffer(void) const
+{
+  PRIVATE(this)->flush();
+  return PRIVATE(this)->ids.getArrayPtr();
+}
+
+/*!
+  Returns the depth of all pixels, row by row from the lower left
+  corner.
+*/
+const float *
+SbIdBuffer::getDepthBuffer(void) const
+{
+  PRIVATE(this)->flush();
+  return PRIVATE(this)->depth.getArrayPtr();
+}
+
+/*!
+  Sets the number of threads used for rasterizing. The default is 4,
+  or the value of the COIN_IDBUFFER_THREADS environment variable. The
+  setting has no effect if Coin is built without thread support.
+*/
+void
+SbIdBuffer::setNumThreads(const int num)
+{
+  PImpl::numthreads = SbMax(1, num);
+}
+
+/*!
+  Returns the number of threads used for rasterizing.
+
+  \sa setNumThreads()
+*/
+int
+SbIdBuffer::getNumThreads(void)
+{
+  if (PImpl::numthreads < 0) {
+    const char * env = coin_getenv("COIN_IDBUFFER_THREADS");
+    PImpl::numthreads = SbMax(1, env ? atoi(env) : 4);
+  }
+  return PImpl::numthreads;
+}
+
+#undef PRIVATE
+#undef IDBUFFER_TILE_SIZE
+#undef IDBUFFER_MIN_PARALLEL
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbViewVolume.h>
+
+BOOST_AUTO_TEST_CASE(idsAndDepth)
+{
+  SbViewVolume vv;
+  vv.ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 100.0f);
+  SbMatrix affine, proj;
+  vv.getMatrices(affine, proj);
+  const SbMatrix objtoclip = affine * proj;
+
+  const int oldthreads = SbIdBuffer::getNumThreads();
+  for (int threads = 1; threads <= 3; threads += 2) {
+    SbIdBuffer::setNumThreads(threads);
+
+    SbIdBuffer buffer;
+    buffer.setSize(SbVec2s(200, 100));
+
+    // a far quad covering the whole buffer, made from many small
+    // triangles to trigger parallel rasterization
+    uint32_t id = 1;
+    for (int y = 0; y < 20; y++) {
+      for (int x = 0; x < 20; x++) {
+        const float x0 = -10.0f + x, x1 = x0 + 1.0f;
+        const float y0 = -10.0f + y, y1 = y0 + 1.0f;
+        buffer.addTriangle(SbVec3f(x0, y0, -50.0f), SbVec3f(x1, y0, -50.0f),
+                           SbVec3f(x1, y1, -50.0f), objtoclip, id);
+        buffer.addTriangle(SbVec3f(x0, y0, -50.0f), SbVec3f(x1, y1, -50.0f),
+                           SbVec3f(x0, y1, -50.0f), objtoclip, id);
+      }
+    }
+    // a near triangle, clockwise on screen, in the left half
+    buffer.addTriangle(SbVec3f(-9.0f, -9.0f, -10.0f), SbVec3f(-9.0f, 9.0f, -10.0f),
+                       SbVec3f(-1.0f, -9.0f, -10.0f), objtoclip, 1000);
+    // the same triangle in the right half, but culled
+    buffer.addTriangle(SbVec3f(1.0f, -9.0f, -10.0f), SbVec3f(1.0f, 9.0f, -10.0f),
+                       SbVec3f(9.0f, -9.0f, -10.0f), objtoclip, 2000,
+                       SbIdBuffer::CULL_CLOCKWISE);
+    // a point and a line in front of everything
+    buffer.addPoint(SbVec3f(5.0f, 5.0f, -5.0f), objtoclip, 3000);
+    buffer.addLine(SbVec3f(0.0f, 8.0f, -5.0f), SbVec3f(8.0f, 8.0f, -5.0f), objtoclip, 4000);
+
+    BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(20, 20)), uint32_t(1000));
+    BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(180, 80)), uint32_t(1));
+    BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(120, 20)), uint32_t(1));
+    BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(150, 75)), uint32_t(3000));
+    BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(130, 90)), uint32_t(4000));
+    BOOST_CHECK(buffer.getDepth(SbVec2s(20, 20)) < buffer.getDepth(SbVec2s(180, 80)));
+
+    buffer.clear();
+    BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(20, 20)), uint32_t(0));
+    BOOST_CHECK_EQUAL(buffer.getDepth(SbVec2s(20, 20)), FLT_MAX);
+  }
+  SbIdBuffer::setNumThreads(oldthreads);
+}
+
+BOOST_AUTO_TEST_CASE(batches)
+{
+  SbViewVolume vv;
+  vv.ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 100.0f);
+  SbMatrix affine, proj;
+  vv.getMatrices(affine, proj);
+  const SbMatrix objtoclip = affine * proj;
+
+  SbIdBuffer buffer;
+  buffer.setSize(SbVec2s(100, 100));
+
+  // more triangles than fit in one batch, all at the same depth, so
+  // the last one added must win in every pixel
+  const uint32_t num = 150000;
+  for (uint32_t id = 1; id <= num; id++) {
+    buffer.addTriangle(SbVec3f(0.0f, 0.0f, -50.0f), SbVec3f(1.0f, 0.0f, -50.0f),
+                       SbVec3f(0.0f, 1.0f, -50.0f), objtoclip, id);
+  }
+  BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(50, 50)), num);
+  BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(51, 51)), num);
+  BOOST_CHECK_EQUAL(buffer.getId(SbVec2s(40, 40)), uint32_t(0));
+}
+
+#endif // COIN_TEST_SUITE
@@ -1525,6 +1525,102 @@ SbMatrix::multDirMatrix(const SbVec3f & src, SbVec3f & dst) const
   dst[2] = s[0]*t0[2] + s[1]*t1[2] + s[2]*t2[2];
 }
 
+/*!
+  \overload
+
+  Multiply the \a num vectors in the \a src array with this matrix
+  and store the results in the \a dst array, i.e. dst[i] = src[i] * M.
+
+  This gives the same results as calling the single vector version
+  of multVecMatrix() \a num times, but the matrix is examined only
+  once, and the inner loop is laid out so that it can be vectorized
+  by the compiler. If the matrix has no projective component (which
+  is the common case for model matrices), the per-vector division is
+  skipped altogether.
+
+  \a src and \a dst can point to the same array, but the arrays
+  must otherwise not overlap.
+
+  \since Coin 4.0
+*/
+void
+SbMatrix::multVecMatrix(const SbVec3f * src, SbVec3f * dst, const int num) const
+{
+  if (num <= 0) return;
+
+  if (SbMatrixP::isIdentity(this->matrix)) {
+    if (src != dst) { for (int i = 0; i < num; i++) { dst[i] = src[i]; } }
+    return;
+  }
+
+  // copy the matrix to locals, so the compiler knows they can't
+  // alias the destination array
+  const float m00 = this->matrix[0][0], m01 = this->matrix[0][1], m02 = this->matrix[0][2], m03 = this->matrix[0][3];
+  const float m10 = this->matrix[1][0], m11 = this->matrix[1][1], m12 = this->matrix[1][2], m13 = this->matrix[1][3];
+  const float m20 = this->matrix[2][0], m21 = this->matrix[2][1], m22 = this->matrix[2][2], m23 = this->matrix[2][3];
+  const float m30 = this->matrix[3][0], m31 = this->matrix[3][1], m32 = this->matrix[3][2], m33 = this->matrix[3][3];
+
+  const float * s = src[0].getValue();
+  float * d = &dst[0][0];
+
+  if (m03 == 0.0f && m13 == 0.0f && m23 == 0.0f && m33 == 1.0f) {
+    // affine matrix, W is always 1
+    for (int i = 0; i < num; i++, s += 3, d += 3) {
+      const float x = s[0], y = s[1], z = s[2];
+      d[0] = x*m00 + y*m10 + z*m20 + m30;
+      d[1] = x*m01 + y*m11 + z*m21 + m31;
+      d[2] = x*m02 + y*m12 + z*m22 + m32;
+    }
+  }
+  else {
+    for (int i = 0; i < num; i++, s += 3, d += 3) {
+      const float x = s[0], y = s[1], z = s[2];
+      const float W = x*m03 + y*m13 + z*m23 + m33;
+      d[0] = (x*m00 + y*m10 + z*m20 + m30)/W;
+      d[1] = (x*m01 + y*m11 + z*m21 + m31)/W;
+      d[2] = (x*m02 + y*m12 + z*m22 + m32)/W;
+    }
+  }
+}
+
+/*!
+  \overload
+
+  Multiply the \a num direction vectors in the \a src array with this
+  matrix and store the results in the \a dst array. The translation
+  components of the matrix are ignored.
+
+  \a src and \a dst can point to the same array, but the arrays
+  must otherwise not overlap.
+
+  \sa multVecMatrix(const SbVec3f *, SbVec3f *, const int) const
+  \since Coin 4.0
+*/
+void
+SbMatrix::multDirMatrix(const SbVec3f * src, SbVec3f * dst, const int num) const
+{
+  if (num <= 0) return;
+
+  if (SbMatrixP::isIdentity(this->matrix)) {
+    if (src != dst) { for (int i = 0; i < num; i++) { dst[i] = src[i]; } }
+    return;
+  }
+
+  const float m00 = this->matrix[0][0], m01 = this->matrix[0][1], m02 = this->matrix[0][2];
+  const float m10 = this->matrix[1][0], m11 = this->matrix[1][1], m12 = this->matrix[1][2];
+  const float m20 = this->matrix[2][0], m21 = this->matrix[2][1], m22 = this->matrix[2][2];
+
+  const float * s = src[0].getValue();
+  float * d = &dst[0][0];
+
+  for (int i = 0; i < num; i++, s += 3, d += 3) {
+    const float x = s[0], y = s[1], z = s[2];
+    d[0] = x*m00 + y*m10 + z*m20;
+    d[1] = x*m01 + y*m11 + z*m21;
+    d[2] = x*m02 + y*m12 + z*m22;
+  }
+}
+
 /*!
   Multiplies line point with the full matrix and multiplies the
   line direction with the matrix without the translation components.
@@ -2053,6 +2149,8 @@ SbMatrixP::decomp_affine(SbMatrixP::HMatrix A, SbMatrixP::AffineParts * parts)
 
 #ifdef COIN_TEST_SUITE
 #include <Inventor/SbDPMatrix.h>
+#include <Inventor/SbRotation.h>
+#include <Inventor/SbVec3f.h>
 
 BOOST_AUTO_TEST_CASE(constructFromSbDPMatrix) {
   SbMatrixd a(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
@@ -2063,4 +2161,40 @@ BOOST_AUTO_TEST_CASE(constructFromSbDPMatrix) {
   BOOST_CHECK_MESSAGE(b == d,
                       "Equality comparison failed!");
 }
+
+BOOST_AUTO_TEST_CASE(multVecMatrixArray) {
+  SbMatrix affine, proj;
+  affine.setTransform(SbVec3f(1.0f, 2.0f, 3.0f),
+                      SbRotation(SbVec3f(1.0f, 1.0f, 0.0f), 0.7f),
+                      SbVec3f(2.0f, 0.5f, 1.5f));
+  proj = affine;
+  proj[0][3] = 0.1f; proj[2][3] = -0.2f;
+
+  SbVec3f src[7], dst[7], dir[7];
+  for (int i = 0; i < 7; i++) {
+    src[i].setValue(float(i) - 3.0f, float(i*i) * 0.25f, 1.0f - float(i));
+  }
+  const SbMatrix * mats[] = { &affine, &proj };
+  for (int m = 0; m < 2; m++) {
+    mats[m]->multVecMatrix(src, dst, 7);
+    mats[m]->multDirMatrix(src, dir, 7);
+    for (int i = 0; i < 7; i++) {
+      SbVec3f v, d;
+      mats[m]->multVecMatrix(src[i], v);
+      mats[m]->multDirMatrix(src[i], d);
+      BOOST_CHECK_MESSAGE(v.equals(dst[i], 1e-5f), "multVecMatrix() array mismatch");
+      BOOST_CHECK_MESSAGE(d.equals(dir[i], 1e-5f), "multDirMatrix() array mismatch");
+    }
+  }
+
+  // in-place transformation
+  SbVec3f inplace[7];
+  for (int i = 0; i < 7; i++) inplace[i] = src[i];
+  affine.multVecMatrix(inplace, inplace, 7);
+  for (int i = 0; i < 7; i++) {
+    SbVec3f v;
+    affine.multVecMatrix(src[i], v);
+    BOOST_CHECK_MESSAGE(v.equals(inplace[i], 1e-5f), "in-place multVecMatrix() array mismatch");
+  }
+}
 #endif //COIN_TEST_SUITE
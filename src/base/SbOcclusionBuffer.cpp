@@ -0,0 +1,566 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SbOcclusionBuffer SbOcclusionBuffer.h Inventor/SbOcclusionBuffer.h
+  \brief The SbOcclusionBuffer class is a small software depth buffer used for occlusion culling.
+
+  \ingroup base
+
+  Occluders are rasterized into the buffer as triangles, either
+  directly with addTriangles() or as the faces of a box with
+  addBox(). isOccluded() can then be used to test if a bounding box
+  is completely hidden behind the occluders rasterized so far.
+
+  The buffer is usually much smaller than the actual viewport, and
+  the depth test is done against a hierarchy of max depth values
+  built from the buffer, so that large boxes can be rejected (or
+  accepted) by looking at only a few values.
+
+  All coordinates are given in object space together with a matrix
+  transforming from object space into clip space (typically the
+  model matrix multiplied with the viewing and projection
+  matrices). Triangles crossing the near plane are ignored when
+  rasterizing occluders, and boxes crossing the near plane are never
+  reported as occluded, so the test is conservative.
+
+  The class does not use OpenGL, and can be used without a
+  rendering context.
+
+  \sa SoGLRenderAction::setOccluders()
+  \since Coin 4.0
+*/
+
+#include <Inventor/SbOcclusionBuffer.h>
+
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+
+// *************************************************************************
+
+class SbOcclusionBuffer::PImpl {
+public:
+  PImpl(void)
+    : size(0, 0), mipsvalid(FALSE), numqueries(0), numoccluded(0)
+  { }
+
+  SbVec2s size;
+  SbList <float> depth;
+
+  // max depth hierarchy, level 1 and up. Level i is stored at
+  // levelofs[i-1] and has dimension levelsize[i-1]
+  mutable SbList <float> mips;
+  mutable SbList <int> levelofs;
+  mutable SbList <SbVec2s> levelsize;
+  mutable SbBool mipsvalid;
+
+  mutable int numqueries;
+  mutable int numoccluded;
+
+  void toScreen(const SbVec3f & p, const SbMatrix & m, float * dst, float & w) const;
+  void rasterize(const float * const * v, const int num);
+  void buildMips(void) const;
+  const float * getLevel(const int level, SbVec2s & dim) const;
+};
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// clip space w values below this are considered to be on or behind
+// the eye point
+static const float OCCLUSION_EPS_W = 1.0e-6f;
+
+// transform p into buffer coordinates (pixels in x and y, [0, 1] depth in z)
+void
+SbOcclusionBuffer::PImpl::toScreen(const SbVec3f & p, const SbMatrix & m,
+                                   float * dst, float & w) const
+{
+  const float x = p[0], y = p[1], z = p[2];
+  const float cx = x*m[0][0] + y*m[1][0] + z*m[2][0] + m[3][0];
+  const float cy = x*m[0][1] + y*m[1][1] + z*m[2][1] + m[3][1];
+  const float cz = x*m[0][2] + y*m[1][2] + z*m[2][2] + m[3][2];
+  w = x*m[0][3] + y*m[1][3] + z*m[2][3] + m[3][3];
+  if (w <= OCCLUSION_EPS_W) return;
+
+  const float invw = 1.0f / w;
+  dst[0] = (cx * invw * 0.5f + 0.5f) * float(this->size[0]);
+  dst[1] = (cy * invw * 0.5f + 0.5f) * float(this->size[1]);
+  dst[2] = cz * invw * 0.5f + 0.5f;
+}
+
+// Rasterize a convex polygon in buffer coordinates. A pixel is only
+// covered if it is completely inside the polygon, so that geometry
+// seen through partly covered pixels along the edges isn't culled.
+// The depth written is the farthest depth within the pixel, so a box
+// is never reported as occluded by a surface it pokes through.
+void
+SbOcclusionBuffer::PImpl::rasterize(const float * const * v, const int num)
+{
+  // twice the signed area, and the vertex giving the largest triangle
+  // fan for the depth plane
+  float area = 0.0f, fanarea = 0.0f;
+  int fan = 2;
+  for (int i = 2; i < num; i++) {
+    const float a =
+      (v[i-1][0]-v[0][0])*(v[i][1]-v[0][1]) - (v[i][0]-v[0][0])*(v[i-1][1]-v[0][1]);
+    area += a;
+    if (fabs(a) > fabs(fanarea)) { fanarea = a; fan = i; }
+  }
+  if (fabs(area) < 1.0e-8f || fabs(fanarea) < 1.0e-8f) return;
+  const float sign = (area < 0.0f) ? -1.0f : 1.0f;
+
+  const int w = this->size[0];
+  const int h = this->size[1];
+
+  float minx = v[0][0], maxx = v[0][0];
+  float miny = v[0][1], maxy = v[0][1];
+  float zmax = v[0][2];
+  for (int i = 1; i < num; i++) {
+    minx = SbMin(minx, v[i][0]);
+    maxx = SbMax(maxx, v[i][0]);
+    miny = SbMin(miny, v[i][1]);
+    maxy = SbMax(maxy, v[i][1]);
+    zmax = SbMax(zmax, v[i][2]);
+  }
+
+  // pixel i covers [i, i + 1]
+  const int x0 = SbMax(0, int(ceil(minx)));
+  const int x1 = SbMin(w - 1, int(floor(maxx)) - 1);
+  const int y0 = SbMax(0, int(ceil(miny)));
+  const int y1 = SbMin(h - 1, int(floor(maxy)) - 1);
+  if (x0 > x1 || y0 > y1) return;
+
+  // edge functions, positive inside: e(x, y) = a*x + b*y + c. The
+  // smallest value within a pixel is the value at its center minus
+  // ofs.
+  float ea[4], eb[4], ec[4], eofs[4];
+  assert(num <= 4);
+  for (int i = 0; i < num; i++) {
+    const float * p = v[i];
+    const float * q = v[(i + 1) % num];
+    ea[i] = -(q[1] - p[1]) * sign;
+    eb[i] = (q[0] - p[0]) * sign;
+    ec[i] = -(ea[i] * p[0] + eb[i] * p[1]);
+    eofs[i] = 0.5f * (float(fabs(ea[i])) + float(fabs(eb[i])));
+  }
+
+  // depth plane
+  const float * v0 = v[0];
+  const float * v1 = v[fan-1];
+  const float * v2 = v[fan];
+  const float dzdx =
+    ((v1[2]-v0[2])*(v2[1]-v0[1]) - (v2[2]-v0[2])*(v1[1]-v0[1])) / fanarea;
+  const float dzdy =
+    ((v2[2]-v0[2])*(v1[0]-v0[0]) - (v1[2]-v0[2])*(v2[0]-v0[0])) / fanarea;
+  const float bias = 0.5f * (float(fabs(dzdx)) + float(fabs(dzdy)));
+
+  float * buf = &this->depth[0];
+  for (int y = y0; y <= y1; y++) {
+    const float cy = float(y) + 0.5f;
+    float * row = buf + y * w;
+    for (int x = x0; x <= x1; x++) {
+      const float cx = float(x) + 0.5f;
+      int i;
+      for (i = 0; i < num; i++) {
+        if (ea[i]*cx + eb[i]*cy + ec[i] < eofs[i]) break;
+      }
+      if (i < num) continue;
+      float z = v0[2] + dzdx * (cx - v0[0]) + dzdy * (cy - v0[1]) + bias;
+      if (z > zmax) z = zmax;
+      if (z < row[x]) row[x] = z;
+    }
+  }
+  this->mipsvalid = FALSE;
+}
+
+void
+SbOcclusionBuffer::PImpl::buildMips(void) const
+{
+  this->mips.truncate(0);
+  this->levelofs.truncate(0);
+  this->levelsize.truncate(0);
+
+  const float * src = this->depth.getArrayPtr();
+  SbVec2s srcsize = this->size;
+  while (srcsize[0] > 1 || srcsize[1] > 1) {
+    const SbVec2s dstsize((srcsize[0] + 1) / 2, (srcsize[1] + 1) / 2);
+    const int ofs = this->mips.getLength();
+    for (int i = dstsize[0] * dstsize[1]; i > 0; i--) this->mips.append(0.0f);
+    // the mips list might have been reallocated
+    if (this->levelofs.getLength()) {
+      src = this->mips.getArrayPtr() + this->levelofs[this->levelofs.getLength()-1];
+    }
+    float * dst = &this->mips[ofs];
+    for (int y = 0; y < dstsize[1]; y++) {
+      const int sy0 = y * 2;
+      const int sy1 = SbMin(sy0 + 1, srcsize[1] - 1);
+      for (int x = 0; x < dstsize[0]; x++) {
+        const int sx0 = x * 2;
+        const int sx1 = SbMin(sx0 + 1, srcsize[0] - 1);
+        dst[y * dstsize[0] + x] =
+          SbMax(SbMax(src[sy0 * srcsize[0] + sx0], src[sy0 * srcsize[0] + sx1]),
+                SbMax(src[sy1 * srcsize[0] + sx0], src[sy1 * srcsize[0] + sx1]));
+      }
+    }
+    this->levelofs.append(ofs);
+    this->levelsize.append(dstsize);
+    src = dst;
+    srcsize = dstsize;
+  }
+  this->mipsvalid = TRUE;
+}
+
+const float *
+SbOcclusionBuffer::PImpl::getLevel(const int level, SbVec2s & dim) const
+{
+  if (level == 0) {
+    dim = this->size;
+    return this->depth.getArrayPtr();
+  }
+  dim = this->levelsize[level-1];
+  return this->mips.getArrayPtr() + this->levelofs[level-1];
+}
+
+// *************************************************************************
+
+/*!
+  Constructor. The buffer is empty until a size is set with setSize().
+*/
+SbOcclusionBuffer::SbOcclusionBuffer(void)
+{
+}
+
+/*!
+  Destructor.
+*/
+SbOcclusionBuffer::~SbOcclusionBuffer()
+{
+}
+
+/*!
+  Sets the size of the buffer in pixels, and clears it. The buffer
+  covers the whole viewport, so its aspect ratio should normally match
+  the aspect ratio of the viewport.
+*/
+void
+SbOcclusionBuffer::setSize(const SbVec2s & size)
+{
+  PRIVATE(this)->size.setValue(SbMax(short(0), size[0]), SbMax(short(0), size[1]));
+  const int num = int(PRIVATE(this)->size[0]) * int(PRIVATE(this)->size[1]);
+  PRIVATE(this)->depth.truncate(0);
+  for (int i = 0; i < num; i++) PRIVATE(this)->depth.append(FLT_MAX);
+  this->clear();
+}
+
+/*!
+  Returns the size of the buffer.
+*/
+const SbVec2s &
+SbOcclusionBuffer::getSize(void) const
+{
+  return PRIVATE(this)->size;
+}
+
+/*!
+  Removes all occluders from the buffer, and resets the query
+  statistics.
+*/
+void
+SbOcclusionBuffer::clear(void)
+{
+  SbList <float> & depth = PRIVATE(this)->depth;
+  const int num = depth.getLength();
+  for (int i = 0; i < num; i++) depth[i] = FLT_MAX;
+  PRIVATE(this)->mipsvalid = FALSE;
+  PRIVATE(this)->numqueries = 0;
+  PRIVATE(this)->numoccluded = 0;
+}
+
+/*!
+  Rasterizes \a numtriangles triangles into the buffer. \a coords
+  should contain three vertices for each triangle, and \a objtoclip
+  is the matrix transforming the vertices into clip space.
+
+  Triangles are rasterized regardless of orientation. Only the pixels
+  completely covered by a triangle are marked, so the pixels along
+  edges shared by two triangles are not.
+*/
+void
+SbOcclusionBuffer::addTriangles(const SbVec3f * coords, const int numtriangles,
+                                const SbMatrix & objtoclip)
+{
+  if (PRIVATE(this)->depth.getLength() == 0) return;
+
+  float v[3][3];
+  float w[3];
+  const float * vptr[3] = { v[0], v[1], v[2] };
+  for (int i = 0; i < numtriangles; i++) {
+    PRIVATE(this)->toScreen(coords[i*3], objtoclip, v[0], w[0]);
+    PRIVATE(this)->toScreen(coords[i*3+1], objtoclip, v[1], w[1]);
+    PRIVATE(this)->toScreen(coords[i*3+2], objtoclip, v[2], w[2]);
+    if (w[0] <= OCCLUSION_EPS_W ||
+        w[1] <= OCCLUSION_EPS_W ||
+        w[2] <= OCCLUSION_EPS_W) continue;
+    PRIVATE(this)->rasterize(vptr, 3);
+  }
+}
+
+/*!
+  Rasterizes the faces of \a box into the buffer. The faces are
+  rasterized as quads, so there are no gaps along their diagonals.
+*/
+void
+SbOcclusionBuffer::addBox(const SbBox3f & box, const SbMatrix & objtoclip)
+{
+  if (box.isEmpty() || PRIVATE(this)->depth.getLength() == 0) return;
+
+  const SbVec3f & mn = box.getMin();
+  const SbVec3f & mx = box.getMax();
+  float c[8][3];
+  float w[8];
+  for (int i = 0; i < 8; i++) {
+    const SbVec3f p((i & 1) ? mx[0] : mn[0],
+                    (i & 2) ? mx[1] : mn[1],
+                    (i & 4) ? mx[2] : mn[2]);
+    PRIVATE(this)->toScreen(p, objtoclip, c[i], w[i]);
+  }
+  static const int faces[6][4] = {
+    { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, // -z, +z
+    { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, // -y, +y
+    { 0, 4, 6, 2 }, { 1, 3, 7, 5 }  // -x, +x
+  };
+  for (int f = 0; f < 6; f++) {
+    const float * quad[4];
+    int i;
+    for (i = 0; i < 4; i++) {
+      if (w[faces[f][i]] <= OCCLUSION_EPS_W) break;
+      quad[i] = c[faces[f][i]];
+    }
+    if (i == 4) PRIVATE(this)->rasterize(quad, 4);
+  }
+}
+
+/*!
+  Returns \c TRUE if \a box, transformed by \a objtoclip, is
+  completely hidden behind the occluders in the buffer.
+
+  The screen space footprint of the box is grown by one pixel before
+  testing, and boxes which are partly behind the eye point are never
+  reported as occluded.
+*/
+SbBool
+SbOcclusionBuffer::isOccluded(const SbBox3f & box, const SbMatrix & objtoclip) const
+{
+  const PImpl * p = &PRIVATE(this).get();
+  p->numqueries++;
+  if (box.isEmpty() || p->depth.getLength() == 0) return FALSE;
+
+  const SbVec3f & mn = box.getMin();
+  const SbVec3f & mx = box.getMax();
+  float minx = FLT_MAX, miny = FLT_MAX, minz = FLT_MAX;
+  float maxx = -FLT_MAX, maxy = -FLT_MAX;
+  for (int i = 0; i < 8; i++) {
+    const SbVec3f corner((i & 1) ? mx[0] : mn[0],
+                         (i & 2) ? mx[1] : mn[1],
+                         (i & 4) ? mx[2] : mn[2]);
+    float s[3], w;
+    p->toScreen(corner, objtoclip, s, w);
+    if (w <= OCCLUSION_EPS_W) return FALSE;
+    minx = SbMin(minx, s[0]); maxx = SbMax(maxx, s[0]);
+    miny = SbMin(miny, s[1]); maxy = SbMax(maxy, s[1]);
+    minz = SbMin(minz, s[2]);
+  }
+
+  const int w = p->size[0];
+  const int h = p->size[1];
+  // outside the buffer, let the frustum culling deal with it
+  if (maxx < 0.0f || maxy < 0.0f || minx >= float(w) || miny >= float(h)) return FALSE;
+
+  const int x0 = SbMax(0, int(floor(minx)) - 1);
+  const int x1 = SbMin(w - 1, int(floor(maxx)) + 1);
+  const int y0 = SbMax(0, int(floor(miny)) - 1);
+  const int y1 = SbMin(h - 1, int(floor(maxy)) + 1);
+
+  if (!p->mipsvalid) p->buildMips();
+
+  // start at the coarsest level where the footprint covers at most
+  // 2x2 texels, and refine while the footprint stays small
+  int level = 0;
+  while (level < p->levelofs.getLength() &&
+         ((x1 >> level) - (x0 >> level) > 1 ||
+          (y1 >> level) - (y0 >> level) > 1)) {
+    level++;
+  }
+
+  for (;;) {
+    SbVec2s dim;
+    const float * buf = p->getLevel(level, dim);
+    const int lx0 = x0 >> level, lx1 = SbMin(int(dim[0]) - 1, x1 >> level);
+    const int ly0 = y0 >> level, ly1 = SbMin(int(dim[1]) - 1, y1 >> level);
+    SbBool occluded = TRUE;
+    for (int y = ly0; y <= ly1 && occluded; y++) {
+      const float * row = buf + y * dim[0];
+      for (int x = lx0; x <= lx1; x++) {
+        if (row[x] >= minz) { occluded = FALSE; break; }
+      }
+    }
+    if (occluded) {
+      p->numoccluded++;
+      return TRUE;
+    }
+    if (level == 0) break;
+    level--;
+    // give up when the footprint gets too large to test at the finer level
+    if (((x1 >> level) - (x0 >> level) + 1) *
+        ((y1 >> level) - (y0 >> level) + 1) > 1024) break;
+  }
+  return FALSE;
+}
+
+/*!
+  Returns the depth value stored at \a pixel, in the range [0, 1], or
+  \c FLT_MAX if no occluder covers the pixel.
+
+  This is mostly useful for debugging.
+*/
+float
+SbOcclusionBuffer::getDepth(const SbVec2s & pixel) const
+{
+  const SbVec2s & size = PRIVATE(this)->size;
+  if (pixel[0] < 0 || pixel[1] < 0 || pixel[0] >= size[0] || pixel[1] >= size[1]) {
+    return FLT_MAX;
+  }
+  return PRIVATE(this)->depth[int(pixel[1]) * size[0] + pixel[0]];
+}
+
+/*!
+  Returns the number of isOccluded() queries done since the buffer was
+  last cleared.
+*/
+int
+SbOcclusionBuffer::getNumQueries(void) const
+{
+  return PRIVATE(this)->numqueries;
+}
+
+/*!
+  Returns the number of isOccluded() queries that found the box to be
+  occluded since the buffer was last cleared.
+*/
+int
+SbOcclusionBuffer::getNumOccluded(void) const
+{
+  return PRIVATE(this)->numoccluded;
+}
+
+#undef PRIVATE
+
+// *************************************************************************
+
+#ifdef COIN_TEST_SUITE
+#include <cfloat>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SbViewVolume.h>
+
+BOOST_AUTO_TEST_CASE(boxOcclusion)
+{
+  SbViewVolume vv;
+  vv.perspective(0.785398f, 1.0f, 1.0f, 100.0f);
+  SbMatrix affine, proj;
+  vv.getMatrices(affine, proj);
+  const SbMatrix objtoclip = affine * proj;
+
+  SbOcclusionBuffer buffer;
+  buffer.setSize(SbVec2s(64, 64));
+
+  // a wall covering the view at z = -10
+  buffer.addBox(SbBox3f(-20.0f, -20.0f, -11.0f, 20.0f, 20.0f, -10.0f), objtoclip);
+
+  const SbBox3f behind(-1.0f, -1.0f, -30.0f, 1.0f, 1.0f, -20.0f);
+  const SbBox3f infront(-1.0f, -1.0f, -8.0f, 1.0f, 1.0f, -6.0f);
+  const SbBox3f through(-1.0f, -1.0f, -15.0f, 1.0f, 1.0f, -5.0f);
+  const SbBox3f behindeye(-1.0f, -1.0f, -15.0f, 1.0f, 1.0f, 5.0f);
+
+  BOOST_CHECK_MESSAGE(buffer.isOccluded(behind, objtoclip), "box behind the wall not occluded");
+  BOOST_CHECK_MESSAGE(!buffer.isOccluded(infront, objtoclip), "box in front of the wall occluded");
+  BOOST_CHECK_MESSAGE(!buffer.isOccluded(through, objtoclip), "box through the wall occluded");
+  BOOST_CHECK_MESSAGE(!buffer.isOccluded(behindeye, objtoclip), "box crossing the eye point occluded");
+  BOOST_CHECK_EQUAL(buffer.getNumQueries(), 4);
+  BOOST_CHECK_EQUAL(buffer.getNumOccluded(), 1);
+
+  // a small occluder should only hide boxes within its footprint
+  buffer.clear();
+  buffer.addBox(SbBox3f(-1.0f, -1.0f, -11.0f, 1.0f, 1.0f, -10.0f), objtoclip);
+  BOOST_CHECK_MESSAGE(buffer.isOccluded(SbBox3f(-0.5f, -0.5f, -50.0f, 0.5f, 0.5f, -40.0f), objtoclip),
+                      "box behind small occluder not occluded");
+  BOOST_CHECK_MESSAGE(!buffer.isOccluded(SbBox3f(8.0f, -0.5f, -50.0f, 9.0f, 0.5f, -40.0f), objtoclip),
+                      "box beside small occluder occluded");
+  BOOST_CHECK_EQUAL(buffer.getDepth(SbVec2s(0, 0)), FLT_MAX);
+}
+
+BOOST_AUTO_TEST_CASE(innerCoverage)
+{
+  // with an identity matrix, x and y in [-1, 1] map to the pixels
+  SbOcclusionBuffer buffer;
+  buffer.setSize(SbVec2s(256, 256));
+  const float pixel = 2.0f / 256.0f;
+
+  // an occluder ending at 0.6 pixels into pixel 128, which covers
+  // that pixel's center but not the whole pixel
+  const float edge = 0.6f * pixel;
+  const SbVec3f tri[3] = {
+    SbVec3f(-1.0f, -1.0f, 0.0f), SbVec3f(edge, -1.0f, 0.0f), SbVec3f(edge, 1.0f, 0.0f)
+  };
+  buffer.addTriangles(tri, 1, SbMatrix::identity());
+  BOOST_CHECK_MESSAGE(buffer.getDepth(SbVec2s(127, 10)) < FLT_MAX,
+                      "fully covered pixel should be marked");
+  BOOST_CHECK_MESSAGE(buffer.getDepth(SbVec2s(128, 10)) == FLT_MAX,
+                      "partly covered pixel should not be marked");
+
+  // the faces of a box are rasterized without gaps along their
+  // diagonals
+  buffer.clear();
+  buffer.addBox(SbBox3f(-0.5f, -0.5f, 0.0f, 0.5f, 0.5f, 0.5f), SbMatrix::identity());
+  SbBool covered = TRUE;
+  for (int i = 65; i < 191; i++) {
+    if (buffer.getDepth(SbVec2s(i, i)) == FLT_MAX) covered = FALSE;
+  }
+  BOOST_CHECK_MESSAGE(covered, "box faces should cover their diagonals");
+}
+
+#endif // COIN_TEST_SUITE
@@ -294,6 +294,47 @@ SbViewVolume::projectToScreen(const SbVec3f& src, SbVec3f& dst) const
   dst = to_sbvec3f(dpdst);
 }
 
+/*!
+  \overload
+
+  Projects the \a num points in the \a src array to normalized
+  screen coordinates, and stores the results in the \a dst array.
+  This gives the same results as calling the single point version of
+  projectToScreen() for each point, but the projection matrix is
+  calculated only once for the whole array.
+
+  \a src and \a dst can point to the same array, but the arrays
+  must otherwise not overlap.
+
+  \since Coin 4.0
+*/
+void
+SbViewVolume::projectToScreen(const SbVec3f * src, SbVec3f * dst, const int num) const
+{
+  if (num <= 0) return;
+
+  const SbDPMatrix mat = this->dpvv.getMatrix();
+
+  // the single point version does the calculations in double
+  // precision, so we do that here as well to get identical results
+  const double m00 = mat[0][0], m01 = mat[0][1], m02 = mat[0][2], m03 = mat[0][3];
+  const double m10 = mat[1][0], m11 = mat[1][1], m12 = mat[1][2], m13 = mat[1][3];
+  const double m20 = mat[2][0], m21 = mat[2][1], m22 = mat[2][2], m23 = mat[2][3];
+  const double m30 = mat[3][0], m31 = mat[3][1], m32 = mat[3][2], m33 = mat[3][3];
+
+  const float * s = src[0].getValue();
+  float * d = &dst[0][0];
+
+  for (int i = 0; i < num; i++, s += 3, d += 3) {
+    const double x = s[0], y = s[1], z = s[2];
+    const double W = x*m03 + y*m13 + z*m23 + m33;
+    // coordinates are in range [-1, 1], normalize to [0,1]
+    d[0] = float((x*m00 + y*m10 + z*m20 + m30)/W * 0.5 + 0.5);
+    d[1] = float((x*m01 + y*m11 + z*m21 + m31)/W * 0.5 + 0.5);
+    d[2] = float((x*m02 + y*m12 + z*m22 + m32)/W * 0.5 + 0.5);
+  }
+}
+
 /*!
   Returns an SbPlane instance which has a normal vector in the opposite
   direction of which the camera is pointing. This means the
@@ -746,13 +787,52 @@ SbViewVolume::getViewUp(void) const
 */
 SbBool 
 SbViewVolume::intersect(const SbVec3f & p) const
+{
+  return this->intersect(&p, 1) == 1;
+}
+
+/*!
+  \overload
+
+  Classifies the \a num points in \a pts against the view volume.
+  If \a isinside is not \c NULL, it must point to an array of at
+  least \a num elements, and will be set to TRUE for points inside
+  the view volume and FALSE for points outside it.
+
+  Returns the number of points inside the view volume.
+
+  \since Coin 4.0
+*/
+int
+SbViewVolume::intersect(const SbVec3f * pts, const int num,
+                        SbBool * isinside) const
 {
   SbPlane planes[6];
   this->getViewVolumePlanes(planes);
-  for (int i = 0; i < 6; i++) {
-    if (!planes[i].isInHalfSpace(p)) return FALSE;
+
+  // unpack the planes so that the inner loop only works on plain
+  // numbers. The dot product is done in double precision to match
+  // SbPlane::isInHalfSpace().
+  double nx[6], ny[6], nz[6];
+  float dist[6];
+  for (int j = 0; j < 6; j++) {
+    const SbVec3f & n = planes[j].getNormal();
+    nx[j] = n[0]; ny[j] = n[1]; nz[j] = n[2];
+    dist[j] = planes[j].getDistanceFromOrigin();
   }
-  return TRUE;
+
+  int cnt = 0;
+  const float * p = pts[0].getValue();
+  for (int i = 0; i < num; i++, p += 3) {
+    const double x = p[0], y = p[1], z = p[2];
+    int inside = 1;
+    for (int j = 0; j < 6; j++) {
+      inside &= (float(x*nx[j] + y*ny[j] + z*nz[j]) - dist[j]) >= 0.0f;
+    }
+    if (isinside) isinside[i] = inside ? TRUE : FALSE;
+    cnt += inside;
+  }
+  return cnt;
 }
 
 /*!  
@@ -993,6 +1073,36 @@ SbViewVolume::getPlaneRectangle(const float distance, SbVec3f & lowerleft,
 #include <Inventor/SbBox3f.h>
 #include <cfloat>
 
+BOOST_AUTO_TEST_CASE(project_points)
+{
+  SbViewVolume vv;
+  vv.perspective(0.8f, 1.3f, 1.0f, 20.0f);
+  vv.translateCamera(SbVec3f(0.5f, -0.25f, 5.0f));
+
+  SbVec3f pts[5] = {
+    SbVec3f(0.0f, 0.0f, 0.0f), SbVec3f(1.0f, 1.0f, -2.0f),
+    SbVec3f(-2.0f, 0.5f, 3.0f), SbVec3f(0.0f, 0.0f, 10.0f),
+    SbVec3f(50.0f, 0.0f, 0.0f)
+  };
+  SbVec3f proj[5];
+  SbBool inside[5];
+  vv.projectToScreen(pts, proj, 5);
+  int cnt = vv.intersect(pts, 5, inside);
+
+  int expected = 0;
+  for (int i = 0; i < 5; i++) {
+    SbVec3f single;
+    vv.projectToScreen(pts[i], single);
+    BOOST_CHECK_MESSAGE(single.equals(proj[i], 1e-5f),
+                        "projectToScreen() array mismatch");
+    BOOST_CHECK_MESSAGE(vv.intersect(pts[i]) == inside[i],
+                        "intersect() array mismatch");
+    if (inside[i]) expected++;
+  }
+  BOOST_CHECK_EQUAL(cnt, expected);
+  BOOST_CHECK_EQUAL(cnt, 2);
+}
+
 BOOST_AUTO_TEST_CASE(intersect_ortho)
 {
   SbViewVolume vv;
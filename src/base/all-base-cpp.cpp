@@ -48,6 +48,7 @@
 #include "SbCylinder.cpp"
 #include "SbDict.cpp"
 #include "SbHeap.cpp"
+#include "SbIdBuffer.cpp"
 #include "SbImage.cpp"
 #include "SbLine.cpp"
 #include "SbDPLine.cpp"
@@ -55,6 +56,7 @@
 #include "SbDPMatrix.cpp"
 #include "SbName.cpp"
 #include "SbOctTree.cpp"
+#include "SbOcclusionBuffer.cpp"
 #include "SbPlane.cpp"
 #include "SbDPPlane.cpp"
 #include "SbRotation.cpp"
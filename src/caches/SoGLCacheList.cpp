@@ -35,6 +35,22 @@
   \brief The SoGLCacheList class is used to store and manage OpenGL caches.
 
   \ingroup coin_caches
+
+  Each cache list keeps statistics on how its caches are used: cache
+  hits and misses, caches built, invalidated and discarded, and the
+  measured time spent building a cache, traversing the subgraph
+  without a cache, and calling a cache. Use getStatistics() to read
+  them, for instance through SoSeparator::getGLCacheList(). While an
+  action is being profiled, the cache hits, misses and builds, and the
+  time spent building caches, are also added to the
+  SbProfilingData::GL_CACHE_HITS, SbProfilingData::GL_CACHE_MISSES,
+  SbProfilingData::GL_CACHE_BUILDS and
+  SbProfilingData::GL_CACHE_BUILD_TIME action statistics.
+
+  When a separator has its SoSeparator::renderCaching field set to \c
+  AUTO, the measurements decide if a cache should be built. By
+  default costBasedCachePolicy() is used, but an application can
+  install its own policy with setCachePolicyCallback().
 */
 
 #include <Inventor/caches/SoGLCacheList.h>
@@ -44,7 +60,11 @@
 #endif // HAVE_CONFIG_H
 
 #include <Inventor/C/tidbits.h>
+#include <Inventor/SbTime.h>
 #include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/annex/Profiler/SbProfilingData.h>
+#include <Inventor/annex/Profiler/SoProfiler.h>
+#include <Inventor/annex/Profiler/elements/SoProfilerElement.h>
 #include <Inventor/caches/SoGLRenderCache.h>
 #include <Inventor/elements/SoCacheElement.h>
 #include <Inventor/elements/SoGLCacheContextElement.h>
@@ -56,6 +76,7 @@
 #include <Inventor/system/gl.h>
 
 #include "tidbitsp.h"
+#include "coindefs.h"
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
 
@@ -71,7 +92,9 @@
 // multiple contexts though.
 
 static int COIN_AUTO_CACHING = -1;
-static int COIN_SMART_CACHING = -1;
+
+static SoGLCacheList::CachePolicyCB * cachepolicy_cb = SoGLCacheList::costBasedCachePolicy;
+static void * cachepolicy_closure = NULL;
 
 // *************************************************************************
 
@@ -82,12 +105,40 @@ public:
   SoGLRenderCache * opencache;
   SbBool savedinvalid;
   int autocachebits;
-  int numused;
-  int numdiscarded;
   SbBool needclose;
   SoElement * invalidelement;
   int numframesok;
   int numshapes;
+  // used to avoid rebuilding caches which are thrown away again soon
+  // after being built, see open()
+  int numused;
+  int numdiscarded;
+
+  // statistics. The times are running averages, in seconds
+  SoGLCacheList::Statistics stats;
+  SbTime opentime;
+  SbBool timetraversal;
+
+  static void addSample(double & average, const double sample) {
+    // the first sample initializes the average
+    if (average <= 0.0) average = sample;
+    else average += (sample - average) * 0.25;
+  }
+  // returns the profiling data to report to, or NULL if the action
+  // isn't being profiled
+  static SbProfilingData * getProfilingData(SoState * state) {
+    if (!SoProfiler::isEnabled()) return NULL;
+    SoProfilerElement * elt = SoProfilerElement::get(state);
+    return elt ? &elt->getProfilingData() : NULL;
+  }
+  // called whenever a run of frames with valid caches ends
+  void endValidRun(void) {
+    if (this->numframesok > 0) {
+      addSample(this->stats.framesbetweeninvalidations,
+                static_cast<double>(this->numframesok));
+    }
+    this->numframesok = 0;
+  }
 
   //
   // Callback from SoContextHandler
@@ -121,12 +172,14 @@ SoGLCacheList::SoGLCacheList(int numcaches)
   PRIVATE(this)->numcaches = numcaches;
   PRIVATE(this)->opencache = NULL;
   PRIVATE(this)->autocachebits = 0;
-  PRIVATE(this)->numused = 0;
-  PRIVATE(this)->numdiscarded = 0;
   PRIVATE(this)->needclose = FALSE;
   PRIVATE(this)->invalidelement = NULL;
   PRIVATE(this)->numframesok = 0;
   PRIVATE(this)->numshapes = 0;
+  PRIVATE(this)->numused = 0;
+  PRIVATE(this)->numdiscarded = 0;
+  PRIVATE(this)->timetraversal = FALSE;
+  this->resetStatistics();
 
   // auto caching must be enabled using an environment variable
   if (COIN_AUTO_CACHING < 0) {
@@ -134,11 +187,6 @@ SoGLCacheList::SoGLCacheList(int numcaches)
     if (env) COIN_AUTO_CACHING = atoi(env);
     else COIN_AUTO_CACHING = 1;
   }
-  if (COIN_SMART_CACHING < 0) {
-    const char * env = coin_getenv("COIN_SMART_CACHING");
-    if (env) COIN_SMART_CACHING = atoi(env);
-    else COIN_SMART_CACHING = 0;
-  }
 
   SoContextHandler::addContextDestructionCallback(SoGLCacheListP::contextCleanup, PRIVATE(this));
 
@@ -178,12 +226,20 @@ SoGLCacheList::~SoGLCacheList()
 SbBool
 SoGLCacheList::call(SoGLRenderAction * action)
 {
+  SoState * state = action->getState();
+  SbProfilingData * profilingdata = SoGLCacheListP::getProfilingData(state);
+
   // do a quick return if there are no caches in the list
   int n = PRIVATE(this)->itemlist.getLength();
-  if (n == 0) return FALSE;
+  if (n == 0) {
+    PRIVATE(this)->stats.nummisses++;
+    if (profilingdata) {
+      profilingdata->addActionStatistic(SbProfilingData::GL_CACHE_MISSES, 1.0);
+    }
+    return FALSE;
+  }
 
   int i;
-  SoState * state = action->getState();
   int context = SoGLCacheContextElement::get(state);
 
   for (i = 0; i < n; i++) {
@@ -191,6 +247,10 @@ SoGLCacheList::call(SoGLRenderAction * action)
     if (cache->getCacheContext() == context) {
       if (cache->isValid(state) &&
           SoGLLazyElement::preCacheCall(state, cache->getPreLazyState())) {
+        // only time the cache call when profiling, to keep the cache
+        // hit path cheap
+        const SbTime starttime =
+          profilingdata ? SbTime::getTimeOfDay() : SbTime::zero();
         cache->ref();
         // move cache to the end of the list. The MRU cache will be at
         // the end of the list, and the LRU will be the first
@@ -203,7 +263,13 @@ SoGLCacheList::call(SoGLRenderAction * action)
         cache->call(state);
         SoGLLazyElement::postCacheCall(state, cache->getPostLazyState());
         cache->unref(state);
+        PRIVATE(this)->stats.numhits++;
         PRIVATE(this)->numused++;
+        if (profilingdata) {
+          SoGLCacheListP::addSample(PRIVATE(this)->stats.cachedtime,
+                                    (SbTime::getTimeOfDay() - starttime).getValue());
+          profilingdata->addActionStatistic(SbProfilingData::GL_CACHE_HITS, 1.0);
+        }
 
 #if COIN_DEBUG
         // The GL error test is default disabled for this optimized
@@ -447,6 +513,10 @@ SoGLCacheList::call(SoGLRenderAction * action)
     }
   }
 #endif // debug
+  PRIVATE(this)->stats.nummisses++;
+  if (profilingdata) {
+    profilingdata->addActionStatistic(SbProfilingData::GL_CACHE_MISSES, 1.0);
+  }
   return FALSE;
 }
 
@@ -472,6 +542,8 @@ SoGLCacheList::open(SoGLRenderAction * action, SbBool autocache)
 
   // will be restored in close()
   PRIVATE(this)->savedinvalid = SoCacheElement::setInvalid(FALSE);
+  // traversals inside an open cache are not timed
+  PRIVATE(this)->timetraversal = FALSE;
 
   if (SoCacheElement::anyOpen(state)) return;
 
@@ -479,54 +551,37 @@ SoGLCacheList::open(SoGLRenderAction * action, SbBool autocache)
   if (!autocache) {
     if (PRIVATE(this)->numframesok >= 1) shouldcreate = TRUE;
   }
-  else {
-    if (PRIVATE(this)->numframesok >= 2 &&
-        (PRIVATE(this)->autocachebits == SoGLCacheContextElement::DO_AUTO_CACHE)) {
-
-      if (COIN_SMART_CACHING) {
-        if (PRIVATE(this)->numshapes < 2) {
-          if (PRIVATE(this)->numframesok >= 5) shouldcreate = TRUE;
-        }
-        else if (PRIVATE(this)->numshapes < 5) {
-          if (PRIVATE(this)->numframesok >= 4) shouldcreate = TRUE;
-        }
-        else if (PRIVATE(this)->numshapes < 10) {
-          if (PRIVATE(this)->numframesok >= 3) shouldcreate = TRUE;
-        }
-        else if (PRIVATE(this)->numshapes > 1000) {
-          if (PRIVATE(this)->numframesok >= 4) shouldcreate = TRUE;
-        }
-        else if (PRIVATE(this)->numshapes > 100) {
-          if (PRIVATE(this)->numframesok >= 3) shouldcreate = TRUE;
-        }
-        else {
-          shouldcreate = TRUE;
-        }
-      }
-      else {
-        shouldcreate = TRUE;
-      }
+  else if (PRIVATE(this)->numframesok >= 1 &&
+           (PRIVATE(this)->autocachebits == SoGLCacheContextElement::DO_AUTO_CACHE)) {
+    Statistics stats;
+    this->getStatistics(stats);
+    shouldcreate = cachepolicy_cb(cachepolicy_closure, this, stats);
+
+    if (shouldcreate) {
+      // don't create a new cache if caches have been thrown away
+      // often compared to how much they have been used. This avoids
+      // rebuilding caches for subgraphs which keep changing, no
+      // matter what the policy says.
+      const double docreate =
+        static_cast<double>(PRIVATE(this)->numframesok + PRIVATE(this)->numused);
+      double dontcreate = static_cast<double>(PRIVATE(this)->numdiscarded);
+      dontcreate *= dontcreate;
+      if (dontcreate >= docreate) shouldcreate = FALSE;
+    }
 #if COIN_DEBUG
-      if (coin_debug_caching_level() > 0 && PRIVATE(this)->numframesok >= 2) {
-        SoDebugError::postInfo("SoGLCacheList::open",
-                               "consider cache create: %p. numframesok: %d, numused: %d, numdiscarded: %d",
-                               this, PRIVATE(this)->numframesok, PRIVATE(this)->numused, PRIVATE(this)->numdiscarded);
-      }
-#endif // debug
-
+    if (coin_debug_caching_level() > 0) {
+      SoDebugError::postInfo("SoGLCacheList::open",
+                             "consider cache create: %p. numframesok: %d, "
+                             "numused: %d, numdiscarded: %d, "
+                             "traversal: %g, cached: %g, build: %g, "
+                             "frames between invalidations: %g -> %s",
+                             this, stats.numframesok, PRIVATE(this)->numused,
+                             PRIVATE(this)->numdiscarded, stats.traversaltime,
+                             stats.cachedtime, stats.buildtime,
+                             stats.framesbetweeninvalidations,
+                             shouldcreate ? "create" : "don't create");
     }
-  }
-
-  if (shouldcreate && autocache) {
-    // determine if we really should create a new cache, based on numused and numdiscarded
-    double docreate = static_cast<double>(PRIVATE(this)->numframesok + PRIVATE(this)->numused);
-    double dontcreate = (PRIVATE(this)->numdiscarded);
-    
-    dontcreate *= dontcreate;
-    // we used to be more conservative here, and use dontcreate^4 to avoid
-    // recreating caches too often. However, display lists are much faster with
-    // current drivers than they used to be so we're a bit more aggressive now.
-    if (dontcreate >= docreate) shouldcreate = FALSE;
+#endif // debug
   }
 
   if (shouldcreate) {
@@ -535,6 +590,7 @@ SoGLCacheList::open(SoGLRenderAction * action, SbBool autocache)
       SoGLRenderCache * cache = PRIVATE(this)->itemlist[0];
       cache->unref(state);
       PRIVATE(this)->itemlist.remove(0);
+      PRIVATE(this)->stats.numdiscarded++;
       PRIVATE(this)->numdiscarded++;
     }
     PRIVATE(this)->opencache = new SoGLRenderCache(state);
@@ -559,6 +615,8 @@ SoGLCacheList::open(SoGLRenderAction * action, SbBool autocache)
   }
   PRIVATE(this)->autocachebits = SoGLCacheContextElement::resetAutoCacheBits(state);
   PRIVATE(this)->numshapes = 0;
+  PRIVATE(this)->timetraversal = TRUE;
+  PRIVATE(this)->opentime = SbTime::getTimeOfDay();
 }
 
 /*!
@@ -571,6 +629,8 @@ SoGLCacheList::close(SoGLRenderAction * action)
   if (!PRIVATE(this)->needclose) return;
 
   SoState * state = action->getState();
+  const double traversaltime = PRIVATE(this)->timetraversal ?
+    (SbTime::getTimeOfDay() - PRIVATE(this)->opentime).getValue() : 0.0;
 
   // close open cache before accepting it or throwing it away
   if (PRIVATE(this)->opencache) {
@@ -580,12 +640,13 @@ SoGLCacheList::close(SoGLRenderAction * action)
   if (SoCacheElement::setInvalid(PRIVATE(this)->savedinvalid)) {
     // notify parent caches
     SoCacheElement::setInvalid(TRUE);
-    PRIVATE(this)->numframesok = 0;
+    PRIVATE(this)->endValidRun();
     // just throw away the open cache, it's invalid
     if (PRIVATE(this)->opencache) {
       PRIVATE(this)->opencache->unref();
       PRIVATE(this)->opencache = NULL;
-      PRIVATE(this)->numdiscarded += 1;
+      PRIVATE(this)->stats.numfailedbuilds++;
+      PRIVATE(this)->numdiscarded++;
 
 #if COIN_DEBUG
       if (coin_debug_caching_level() > 0) {
@@ -597,10 +658,23 @@ SoGLCacheList::close(SoGLRenderAction * action)
   }
   else {
     PRIVATE(this)->numframesok++;
+    if (PRIVATE(this)->timetraversal && !PRIVATE(this)->opencache) {
+      SoGLCacheListP::addSample(PRIVATE(this)->stats.traversaltime, traversaltime);
+    }
   }
 
   // open cache is ok, add it to the cache list
   if (PRIVATE(this)->opencache) {
+    PRIVATE(this)->stats.numbuilds++;
+    if (PRIVATE(this)->timetraversal) {
+      SoGLCacheListP::addSample(PRIVATE(this)->stats.buildtime, traversaltime);
+    }
+    SbProfilingData * profilingdata = SoGLCacheListP::getProfilingData(state);
+    if (profilingdata) {
+      profilingdata->addActionStatistic(SbProfilingData::GL_CACHE_BUILDS, 1.0);
+      profilingdata->addActionStatistic(SbProfilingData::GL_CACHE_BUILD_TIME,
+                                        traversaltime);
+    }
 #if COIN_DEBUG
     if (coin_debug_caching_level() > 0) {
       SoDebugError::postInfo("SoGLCacheList::close",
@@ -636,8 +710,160 @@ SoGLCacheList::invalidateAll(void)
     PRIVATE(this)->itemlist[i]->unref();
   }
   PRIVATE(this)->itemlist.truncate(0);
+  PRIVATE(this)->stats.numinvalidations++;
   PRIVATE(this)->numdiscarded += n;
-  PRIVATE(this)->numframesok = 0;
+  PRIVATE(this)->endValidRun();
+}
+
+/*!
+  \struct SoGLCacheList::Statistics SoGLCacheList.h Inventor/caches/SoGLCacheList.h
+  \brief The usage statistics for an SoGLCacheList.
+
+  \c numhits and \c nummisses count the calls to call() that did and
+  did not find a valid cache. \c numbuilds counts the caches which
+  were built and kept, \c numfailedbuilds the caches which were
+  thrown away while being built because something in the subgraph
+  could not be cached, and \c numdiscarded the caches removed to make
+  room for a newer one. \c numinvalidations counts the calls to
+  invalidateAll().
+
+  \c numcaches is the number of caches currently in the list, \c
+  numframesok the number of traversals since the subgraph last
+  changed, and \c numshapes the number of shapes rendered in the last
+  traversal.
+
+  \c buildtime, \c traversaltime and \c cachedtime are running
+  averages, in seconds, of the time spent rendering the subgraph while
+  building a cache, rendering it without a cache, and calling a
+  cache. \c framesbetweeninvalidations is the running average of how
+  many traversals the subgraph stays unchanged. The averages are 0.0
+  until the first measurement has been made. Calling a cache is only
+  timed while the action is being profiled, see SoProfiler, so \c
+  cachedtime stays 0.0 otherwise.
+
+  \c memory is an estimate of the memory used by the caches on the
+  client side. The size of the OpenGL display lists themselves can not
+  be queried, and is not included.
+
+  \since Coin 4.0
+*/
+
+/*!
+  Returns the usage statistics for this cache list in \a stats.
+
+  \since Coin 4.0
+*/
+void
+SoGLCacheList::getStatistics(Statistics & stats) const
+{
+  stats = PRIVATE(this)->stats;
+  stats.numcaches = PRIVATE(this)->itemlist.getLength();
+  stats.numframesok = PRIVATE(this)->numframesok;
+  stats.numshapes = PRIVATE(this)->numshapes;
+  stats.memory = sizeof(SoGLCacheList) + sizeof(SoGLCacheListP) +
+    stats.numcaches * (sizeof(SoGLRenderCache) + sizeof(SoGLRenderCache *));
+}
+
+/*!
+  Resets the counters and averages returned by getStatistics().
+
+  \since Coin 4.0
+*/
+void
+SoGLCacheList::resetStatistics(void)
+{
+  Statistics & stats = PRIVATE(this)->stats;
+  stats.numhits = 0;
+  stats.nummisses = 0;
+  stats.numbuilds = 0;
+  stats.numfailedbuilds = 0;
+  stats.numinvalidations = 0;
+  stats.numdiscarded = 0;
+  stats.numcaches = 0;
+  stats.numframesok = 0;
+  stats.numshapes = 0;
+  stats.buildtime = 0.0;
+  stats.traversaltime = 0.0;
+  stats.cachedtime = 0.0;
+  stats.framesbetweeninvalidations = 0.0;
+  stats.memory = 0;
+}
+
+/*!
+  \typedef SbBool SoGLCacheList::CachePolicyCB(void * closure, const SoGLCacheList * list, const Statistics & stats)
+
+  The type of the callback deciding if an automatic render cache
+  should be built. Return \c TRUE to build a cache during the
+  traversal which is about to start.
+
+  \since Coin 4.0
+*/
+
+/*!
+  Sets the policy used to decide if an automatic render cache should
+  be built for a separator with SoSeparator::renderCaching set to \c
+  AUTO. The policy is only consulted when the subgraph has been
+  unchanged for at least one traversal and contains nothing which
+  prevents caching. Pass \c NULL to restore the default policy,
+  costBasedCachePolicy().
+
+  Separators with SoSeparator::renderCaching set to \c ON always build
+  a cache, and do not consult the policy.
+
+  \since Coin 4.0
+*/
+void
+SoGLCacheList::setCachePolicyCallback(CachePolicyCB * func, void * closure)
+{
+  cachepolicy_cb = func ? func : SoGLCacheList::costBasedCachePolicy;
+  cachepolicy_closure = func ? closure : NULL;
+}
+
+/*!
+  The default cache policy. A cache is built if the time it is
+  expected to save before the subgraph changes again outweighs the
+  extra time spent building it.
+
+  The saving per traversal is the measured traversal time minus the
+  measured time for calling a cache. The extra cost of building is the
+  measured build time minus the traversal time. The number of
+  traversals a new cache is expected to live is the largest of the
+  average number of traversals between invalidations and the number
+  of traversals since the last change. Until a measurement has been
+  made, calling a cache is assumed to take half the traversal time,
+  and building one to take twice the traversal time. This builds a
+  cache after two unchanged traversals, unless the measurements show
+  that caching does not pay off.
+
+  Whatever the policy decides, no cache is built if caches for this
+  list have been thrown away often compared to how many times they
+  have been used, since the subgraph then changes too often for
+  caching to pay off.
+
+  \since Coin 4.0
+*/
+SbBool
+SoGLCacheList::costBasedCachePolicy(void * COIN_UNUSED_ARG(closure),
+                                    const SoGLCacheList * COIN_UNUSED_ARG(list),
+                                    const Statistics & stats)
+{
+  if (stats.numframesok < 2) return FALSE;
+
+  const double traversal = stats.traversaltime;
+  // no timing information, probably rendered inside another cache
+  if (traversal <= 0.0) return TRUE;
+
+  const double cached = stats.cachedtime > 0.0 ? stats.cachedtime : traversal * 0.5;
+  const double build = stats.buildtime > 0.0 ? stats.buildtime : traversal * 2.0;
+
+  const double saving = traversal - cached;
+  if (saving <= 0.0) return FALSE;
+
+  double lifetime = static_cast<double>(stats.numframesok);
+  if (stats.framesbetweeninvalidations > lifetime) {
+    lifetime = stats.framesbetweeninvalidations;
+  }
+  return (saving * lifetime) >= (build - traversal);
 }
 
 #undef PRIVATE
@@ -71,6 +71,7 @@
 #include <coindefs.h> // COIN_OBSOLETED
 
 #include "shaders/SoGLShaderProgram.h"
+#include "threads/threadsutilp.h"
 
 // *************************************************************************
 
@@ -172,6 +173,29 @@ create_matrix_bitmap(int intensity, unsigned char * bitmap,
   }
 }
 
+//
+// Creates the stipple patterns on first use, as screen door
+// transparency is rarely used.
+//
+static SbBool stipple_patterns_created = FALSE;
+
+static void
+create_stipple_patterns(void)
+{
+  CC_GLOBAL_LOCK;
+  if (!stipple_patterns_created) {
+    uint32_t matrix[32*32];
+    make_dither_matrix((uint32_t*)matrix, 32);
+    for (int i = 0; i <= 64; i++) {
+      int intensity = (32 * 32 * i) / 64 - 1;
+      create_matrix_bitmap((intensity >= 0) ? intensity : 0,
+                           stipple_patterns[i], (uint32_t*) matrix, 32);
+    }
+    stipple_patterns_created = TRUE;
+  }
+  CC_GLOBAL_UNLOCK;
+}
+
 
 SO_ELEMENT_SOURCE(SoGLLazyElement);
 
@@ -183,16 +207,6 @@ void
 SoGLLazyElement::initClass()
 {
   SO_ELEMENT_INIT_CLASS(SoGLLazyElement, inherited);
-
-  // create stipple patterns
-  int i;
-  uint32_t matrix[32*32];
-  make_dither_matrix((uint32_t*)matrix, 32);
-  for (i = 0; i <= 64; i++) {
-    int intensity = (32 * 32 * i) / 64 - 1;
-    create_matrix_bitmap((intensity >= 0) ? intensity : 0,
-                         stipple_patterns[i], (uint32_t*) matrix, 32);
-  }
 }
 
 /*!
@@ -331,6 +345,7 @@ SoGLLazyElement::sendTransparency(const int stipplenum) const
   }
   else {
     if (this->glstate.stipplenum <= 0) glEnable(GL_POLYGON_STIPPLE);
+    if (!stipple_patterns_created) create_stipple_patterns();
     glPolygonStipple(stipple_patterns[stipplenum]);
   }
   this->glstate.stipplenum = stipplenum;
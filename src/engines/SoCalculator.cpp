@@ -172,6 +172,15 @@
   have several statements in one expression. You just separate them
   with semicolons.
 
+  The expressions are compiled, and evaluated for a large number of
+  input values at a time, so an engine with long input fields is
+  cheap to update. Temporary variables keep their values from one
+  input value to the next, so an expression like "ta = ta + a; oa =
+  ta" makes a running sum. Such expressions, which read a temporary
+  variable before setting it, and expressions using rand(), are
+  evaluated one value at a time, which is slower. Both sides of the
+  \e ? operator are always evaluated.
+
   Here is a simple example of how an SoCalculator engine may be used
   in an .iv file:
 
@@ -325,15 +334,28 @@ public:
   float ta_th[8];
   SbVec3f tA_tH[8];
 
-  float a_h[8];
-  SbVec3f A_H[8];
-  float oa_od[4];
-  SbVec3f oA_oD[4];
   SbList <struct so_eval_node*> evaluatorList;
+
+  // all the expressions compiled into one program
+  so_eval_program * program;
+  // output values from the program, for all used outputs
+  SoMFFloat outvalues;
+
+  void clearExpressions(void);
 };
 
+void
+SoCalculatorP::clearExpressions(void)
+{
+  for (int i = 0; i < this->evaluatorList.getLength(); i++) {
+    so_eval_delete(this->evaluatorList[i]);
+  }
+  this->evaluatorList.truncate(0);
+  so_eval_program_delete(this->program);
+  this->program = NULL;
+}
+
 #define PRIVATE(thisp) (thisp->pimpl)
-#define THISP(POINTER) static_cast<SoCalculator *>(POINTER)
 
 SO_ENGINE_SOURCE(SoCalculator);
 
@@ -343,6 +365,8 @@ SO_ENGINE_SOURCE(SoCalculator);
 SoCalculator::SoCalculator(void)
 {
   PRIVATE(this) = new SoCalculatorP;
+  PRIVATE(this)->program = NULL;
+  PRIVATE(this)->outvalues.enableNotify(FALSE);
 
   SO_ENGINE_INTERNAL_CONSTRUCTOR(SoCalculator);
 
@@ -386,9 +410,7 @@ SoCalculator::SoCalculator(void)
 */
 SoCalculator::~SoCalculator(void)
 {
-  for (int i = 0; i < PRIVATE(this)->evaluatorList.getLength(); i++) {
-    so_eval_delete(PRIVATE(this)->evaluatorList[i]);
-  }
+  PRIVATE(this)->clearExpressions();
   delete PRIVATE(this);
 }
 
@@ -417,7 +439,7 @@ SoCalculator::evaluate(void)
         PRIVATE(this)->evaluatorList.append(so_eval_parse(s.getString()));
 #if COIN_DEBUG
         if (so_eval_error()) {
-          SoDebugError::postWarning("SoCalculator::evaluateExpression",
+          SoDebugError::postWarning("SoCalculator::evaluate",
                                     "%s", so_eval_error());
         }
 #endif // COIN_DEBUG
@@ -427,34 +449,82 @@ SoCalculator::evaluate(void)
   }
 
 
+  // The expressions are compiled into a register based program,
+  // which is evaluated for blocks of field values at a time. This is
+  // a lot faster than traversing the expression trees for every
+  // single value.
+  if (PRIVATE(this)->program == NULL) {
+    PRIVATE(this)->program =
+      so_eval_compile(PRIVATE(this)->evaluatorList.getArrayPtr(),
+                      PRIVATE(this)->evaluatorList.getLength());
+  }
+  so_eval_program * program = PRIVATE(this)->program;
+
   // find all fields used in all expressions
   int maxnum = 0;
   char inused[16]; /* a-h and A-H */
   char outused[8]; /* a-d and A-D */
-  for (i = 0; i < 16; i++) inused[i] = 0;
-  for (i = 0; i < 8; i++) outused[i] = 0;
+  so_eval_program_used(program, inused, outused);
 
-  for (i = 0; i < PRIVATE(this)->evaluatorList.getLength(); i++) {
-    this->findUsed(PRIVATE(this)->evaluatorList[i], inused, outused);
+  so_eval_io io;
+  for (i = 0; i < 16; i++) {
+    io.in[i] = NULL;
+    io.innum[i] = 0;
   }
 
   // find max number of values in used input fields
   char fieldname[2];
   fieldname[1] = 0;
-  for (i = 0; i < 16; i++) {
+  for (i = 0; i < 8; i++) {
     if (inused[i]) {
-      if (i < 8) {
-        fieldname[0] = 'a' + i;
-      }
-      else {
-        fieldname[0] = 'A' + (i-8);
-      }
-      SoMField * field = coin_assert_cast<SoMField*>(this->getField(fieldname));
-      maxnum = SbMax(maxnum, field->getNum());
+      fieldname[0] = 'a' + i;
+      SoMFFloat * field = coin_assert_cast<SoMFFloat *>(this->getField(fieldname));
+      io.in[i] = field->getValues(0);
+      io.innum[i] = field->getNum();
+    }
+    if (inused[i+8]) {
+      fieldname[0] = 'A' + i;
+      SoMFVec3f * field = coin_assert_cast<SoMFVec3f *>(this->getField(fieldname));
+      io.in[i+8] = field->getNum() ? field->getValues(0)->getValue() : NULL;
+      io.innum[i+8] = field->getNum();
     }
   }
+  for (i = 0; i < 16; i++) maxnum = SbMax(maxnum, io.innum[i]);
   if (maxnum == 0) maxnum = 1; // in case only temporary registers were used
 
+  SoMFFloat & outvalues = PRIVATE(this)->outvalues;
+  int outsize = 0;
+  for (i = 0; i < 8; i++) {
+    if (outused[i]) outsize += maxnum * (i < 4 ? 1 : 3);
+  }
+  outvalues.setNum(outsize);
+  float * outptr = outvalues.startEditing();
+
+  outsize = 0;
+  for (i = 0; i < 8; i++) {
+    io.out[i] = NULL;
+    if (outused[i]) {
+      io.out[i] = outptr + outsize;
+      outsize += maxnum * (i < 4 ? 1 : 3);
+    }
+  }
+
+  float tmp[32];
+  for (i = 0; i < 8; i++) {
+    tmp[i] = PRIVATE(this)->ta_th[i];
+    for (j = 0; j < 3; j++) tmp[8 + i*3 + j] = PRIVATE(this)->tA_tH[i][j];
+  }
+  io.tmp = tmp;
+
+  so_eval_program_run(program, &io, maxnum);
+  outvalues.finishEditing();
+
+  for (i = 0; i < 8; i++) {
+    PRIVATE(this)->ta_th[i] = tmp[i];
+    PRIVATE(this)->tA_tH[i].setValue(tmp + 8 + i*3);
+  }
+
+  // copy the values from the program to the engine outputs
   if (outused[0]) { SO_ENGINE_OUTPUT(oa, SoMFFloat, setNum(maxnum)); }
   if (outused[1]) { SO_ENGINE_OUTPUT(ob, SoMFFloat, setNum(maxnum)); }
   if (outused[2]) { SO_ENGINE_OUTPUT(oc, SoMFFloat, setNum(maxnum)); }
@@ -465,251 +535,149 @@ SoCalculator::evaluate(void)
   if (outused[6]) { SO_ENGINE_OUTPUT(oC, SoMFVec3f, setNum(maxnum)); }
   if (outused[7]) { SO_ENGINE_OUTPUT(oD, SoMFVec3f, setNum(maxnum)); }
 
-  // loop through all fieldindices and evaluate
-  for (i = 0; i < maxnum; i++) {
-    // just initialize output registers to default values
-    // (in case an expression reads from an output before setting its value)
-    PRIVATE(this)->oA_oD[0] = SbVec3f(0.0f, 0.0f, 0.0f);
-    PRIVATE(this)->oA_oD[1] = SbVec3f(0.0f, 0.0f, 0.0f);
-    PRIVATE(this)->oA_oD[2] = SbVec3f(0.0f, 0.0f, 0.0f);
-    PRIVATE(this)->oA_oD[3] = SbVec3f(0.0f, 0.0f, 0.0f);
-    PRIVATE(this)->oa_od[0] = 0.0f;
-    PRIVATE(this)->oa_od[1] = 0.0f;
-    PRIVATE(this)->oa_od[2] = 0.0f;
-    PRIVATE(this)->oa_od[3] = 0.0f;
-
-    // evaluate all expressions for this fieldidx
-    for (j = 0; j < PRIVATE(this)->evaluatorList.getLength(); j++) {
-      if (PRIVATE(this)->evaluatorList[j]) {
-        this->evaluateExpression(PRIVATE(this)->evaluatorList[j], i);
-      }
-    }
-  }
-}
+  if (outused[0]) { SO_ENGINE_OUTPUT(oa, SoMFFloat, setValues(0, maxnum, io.out[0])); }
+  if (outused[1]) { SO_ENGINE_OUTPUT(ob, SoMFFloat, setValues(0, maxnum, io.out[1])); }
+  if (outused[2]) { SO_ENGINE_OUTPUT(oc, SoMFFloat, setValues(0, maxnum, io.out[2])); }
+  if (outused[3]) { SO_ENGINE_OUTPUT(od, SoMFFloat, setValues(0, maxnum, io.out[3])); }
 
-// "extern C" wrapper and C-function typedefs are needed with the
-// OSF1/cxx compiler (probably a bug in the compiler, but it doesn't
-// seem to hurt to do this anyway).
-extern "C" {
-  typedef void(*C_func_read)(const char *, float *, void *);
-  typedef void(*C_func_write)(const char *, float *, int, void *);
+  if (outused[4]) { SO_ENGINE_OUTPUT(oA, SoMFVec3f, setValues(0, maxnum, reinterpret_cast<const SbVec3f *>(io.out[4]))); }
+  if (outused[5]) { SO_ENGINE_OUTPUT(oB, SoMFVec3f, setValues(0, maxnum, reinterpret_cast<const SbVec3f *>(io.out[5]))); }
+  if (outused[6]) { SO_ENGINE_OUTPUT(oC, SoMFVec3f, setValues(0, maxnum, reinterpret_cast<const SbVec3f *>(io.out[6]))); }
+  if (outused[7]) { SO_ENGINE_OUTPUT(oD, SoMFVec3f, setValues(0, maxnum, reinterpret_cast<const SbVec3f *>(io.out[7]))); }
 }
 
-// evaluates a single expression from/into fieldidx
+// Documented in superclass.
 void
-SoCalculator::evaluateExpression(struct so_eval_node *node, const int fieldidx)
+SoCalculator::inputChanged(SoField *which)
 {
-  int i;
-
-  char fieldname[2];
-  fieldname[1] = 0;
-  char inused[16]; /* a-h and A-H */
-  char outused[8]; /* oa-od and oA-oD */
-
-  so_eval_cbdata cbdata;
-  cbdata.readfieldcb = reinterpret_cast<C_func_read>(SoCalculator::readfieldcb);
-  cbdata.writefieldcb = reinterpret_cast<C_func_write>(SoCalculator::writefieldcb);
-  cbdata.userdata = this;
-
-  for (i = 0; i < 16; i++) inused[i] = 0;
-  for (i = 0; i < 8; i++) outused[i] = 0;
-
-  this->findUsed(node, inused, outused);
-
-  // copy values from fields to temporary "registers" while evaluating
-  for (i = 0; i < 8; i++) {
-    if (inused[i]) {
-      fieldname[0] = 'a' + i;
-      SoMFFloat * field = coin_assert_cast<SoMFFloat *>(this->getField(fieldname));
-      int num = field->getNum();
-      if (num) PRIVATE(this)->a_h[i] = field->getValues(0)[SbMin(fieldidx, num-1)];
-      else PRIVATE(this)->a_h[i] = 0.0f;
-    }
-  }
-  for (i = 0; i < 8; i++) {
-    if (inused[i+8]) {
-      fieldname[0] = 'A' + i;
-      SoMFVec3f * field = coin_assert_cast<SoMFVec3f *>(this->getField(fieldname));
-      int num = field->getNum();
-      if (num) PRIVATE(this)->A_H[i] = field->getValues(0)[SbMin(fieldidx, num-1)];
-      else PRIVATE(this)->A_H[i] = SbVec3f(0.0f, 0.0f, 0.0f);
-    }
+  // if expression changes we have to rebuild the eval tree structure
+  if (which == &this->expression) {
+    PRIVATE(this)->clearExpressions();
   }
-  so_eval_evaluate(node, &cbdata);
-
-  // copy the output values from "registers" to engine output
-  if (outused[0]) { SO_ENGINE_OUTPUT(oa, SoMFFloat, set1Value(fieldidx, PRIVATE(this)->oa_od[0])); }
-  if (outused[1]) { SO_ENGINE_OUTPUT(ob, SoMFFloat, set1Value(fieldidx, PRIVATE(this)->oa_od[1])); }
-  if (outused[2]) { SO_ENGINE_OUTPUT(oc, SoMFFloat, set1Value(fieldidx, PRIVATE(this)->oa_od[2])); }
-  if (outused[3]) { SO_ENGINE_OUTPUT(od, SoMFFloat, set1Value(fieldidx, PRIVATE(this)->oa_od[3])); }
-
-  if (outused[4]) { SO_ENGINE_OUTPUT(oA, SoMFVec3f, set1Value(fieldidx, PRIVATE(this)->oA_oD[0])); }
-  if (outused[5]) { SO_ENGINE_OUTPUT(oB, SoMFVec3f, set1Value(fieldidx, PRIVATE(this)->oA_oD[1])); }
-  if (outused[6]) { SO_ENGINE_OUTPUT(oC, SoMFVec3f, set1Value(fieldidx, PRIVATE(this)->oA_oD[2])); }
-  if (outused[7]) { SO_ENGINE_OUTPUT(oD, SoMFVec3f, set1Value(fieldidx, PRIVATE(this)->oA_oD[3])); }
 }
 
+#undef PRIVATE
 
+#ifdef COIN_TEST_SUITE
+#include <cfloat>
+#include <cmath>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFVec3f.h>
+
+// the values the expression tree interpreter gives for the
+// expressions in the test below, including its special cases for
+// division by zero, square roots of negative values and so on
+static float
+calculator_test_pow(float x, float y)
+{
+  if (x == 0.0f) return 0.0f;
+  if (x > 0.0f) return float(pow(x, y));
+  return float(pow(x, floor(y + 0.5)));
+}
 
-//
-// find all input and output fields that are used in the expression(s)
-// inused 0-7   => a-h
-// inused 8-15  => A-H
-// outused 0-3  => oa-od
-// outused 4-7  => oA-oD
-//
-// inused and outused must be cleared before calling this method
-//
-// FIXME: this becomes a bottleneck if there are many SoCalculator
-// engines in the scene graph which are updated all the time. See the
-// SoGuiExamples/coin-competitions/SIM-20010914/kaos.cpp.in for some
-// great test-code to use while profiling.  Could be solved by caching
-// the set of expressions found.  20010917 mortene.
-void
-SoCalculator::findUsed(struct so_eval_node *node, char *inused, char *outused)
+static float
+calculator_test_atan2(float y, float x)
 {
-  if (node == NULL) return;
-
-  if (node->id == ID_ASSIGN_FLT || node->id == ID_ASSIGN_VEC) {
-    this->findUsed(node->child2, inused, outused); // traverse rhs
-    // inspect lhs
-    node = node->child1;
-    if (node->regname[0] == 'o') { // only consider engine outputs
-      if ((node->regname[1] >= 'A') && (node->regname[1] <= 'D')) {
-        outused[node->regname[1]-'A'+4] = 1;
-      }
-      else {
-        assert((node->regname[1] >= 'a') && (node->regname[1] <= 'd'));
-        outused[node->regname[1]-'a'] = 1;
-      }
-    }
-  }
-  else {
-    if (node->child1) this->findUsed(node->child1, inused, outused);
-    if (node->child2) this->findUsed(node->child2, inused, outused);
-    if (node->child3) this->findUsed(node->child3, inused, outused);
-  }
-  if (node->id == ID_FLT_REG) {
-    if ((node->regname[0] >= 'a') && (node->regname[0] <= 'h')) {
-      inused[node->regname[0]-'a'] = 1;
-    }
-  }
-  else if (node->id == ID_VEC_REG || node->id == ID_VEC_REG_COMP) {
-    if ((node->regname[0] >= 'A') && (node->regname[0] <= 'H')) {
-      inused[node->regname[0]-'A'+8] = 1;
-    }
-  }
+  if (x == 0.0f) return float(y >= 0.0f ? M_PI * 0.5 : - M_PI * 0.5);
+  return float(atan2(y, x));
 }
 
-// Documented in superclass.
-void
-SoCalculator::inputChanged(SoField *which)
+static SbVec3f
+calculator_test_normalize(const SbVec3f & v)
 {
-  // if expression changes we have to rebuild the eval tree structure
-  if (which == &this->expression) {
-    for (int i = 0; i < PRIVATE(this)->evaluatorList.getLength(); i++) {
-      so_eval_delete(PRIVATE(this)->evaluatorList[i]);
-    }
-    PRIVATE(this)->evaluatorList.truncate(0);
-  }
+  const float len = float(sqrt(v.dot(v)));
+  if (len > 0.0f) return SbVec3f(v[0] / len, v[1] / len, v[2] / len);
+  return SbVec3f(0.0f, 0.0f, 0.0f);
 }
 
-// callback from evaluator. Reads values from temporary registers
-void
-SoCalculator::readfieldcb(const char *fieldname, float *data, void *userdata)
+static SbBool
+calculator_test_equal(float v0, float v1)
 {
-  SoCalculator * thisp = THISP(userdata);
-  if (fieldname[0] == 'o') {
-    //
-    // FIXME: I'm not quite sure if it should be legal to read from an
-    // output field. Investigate. pederb, 20000307
-    //
-
-    // this will work if output was set in an earlier expression
-    if ((fieldname[1] >= 'A') && (fieldname[1] <= 'D')) {
-      int idx = fieldname[1] - 'A';
-      data[0] = PRIVATE(thisp)->oA_oD[idx][0];
-      data[1] = PRIVATE(thisp)->oA_oD[idx][1];
-      data[2] = PRIVATE(thisp)->oA_oD[idx][2];
-    }
-    else {
-      assert((fieldname[1] >= 'a') && (fieldname[1] <= 'd'));
-      int idx = fieldname[1] - 'a';
-      data[0] = PRIVATE(thisp)->oa_od[idx];
-    }
-  }
-  else if (fieldname[0] == 't') {
-    if ((fieldname[1] >= 'A') && (fieldname[1] <= 'H')) {
-      int idx = fieldname[1] - 'A';
-      data[0] = PRIVATE(thisp)->tA_tH[idx][0];
-      data[1] = PRIVATE(thisp)->tA_tH[idx][1];
-      data[2] = PRIVATE(thisp)->tA_tH[idx][2];
-    }
-    else {
-      assert((fieldname[1] >= 'a') && (fieldname[1] <= 'h'));
-      int idx = fieldname[1] - 'a';
-      data[0] = PRIVATE(thisp)->ta_th[idx];
-    }
-  }
-  else if ((fieldname[0] >= 'A') && (fieldname[0] <= 'H')) {
-    int idx = fieldname[0] - 'A';
-    data[0] = PRIVATE(thisp)->A_H[idx][0];
-    data[1] = PRIVATE(thisp)->A_H[idx][1];
-    data[2] = PRIVATE(thisp)->A_H[idx][2];
-  }
-  else {
-    assert((fieldname[0] >= 'a') && (fieldname[0] <= 'h'));
-    int idx = fieldname[0] - 'a';
-    data[0] = PRIVATE(thisp)->a_h[idx];
-  }
+  return fabs(v0 - v1) <= 1e-4f * SbMax(1.0f, float(fabs(v1)));
 }
 
-// callback from evaluator. Writes values into temporary registers
-void
-SoCalculator::writefieldcb(const char *fieldname, float *data,
-                           int comp, void *userdata)
+BOOST_AUTO_TEST_CASE(compiledExpressions)
 {
-  SoCalculator * thisp = THISP(userdata);
-  if (fieldname[0] == 'o') {
-    if ((fieldname[1] >= 'A') && (fieldname[1] <= 'D')) {
-      int idx = fieldname[1] - 'A';
-      if (comp >= 0) {
-        PRIVATE(thisp)->oA_oD[idx][comp] = data[0];
-      }
-      else {
-        PRIVATE(thisp)->oA_oD[idx][0] = data[0];
-        PRIVATE(thisp)->oA_oD[idx][1] = data[1];
-        PRIVATE(thisp)->oA_oD[idx][2] = data[2];
-      }
-    }
-    else {
-      assert((fieldname[1] >= 'a') && (fieldname[1] <= 'd'));
-      int idx = fieldname[1] - 'a';
-      PRIVATE(thisp)->oa_od[idx] = data[0];
-    }
+  SoCalculator * calc = new SoCalculator;
+  calc->ref();
+
+  // ternaries, functions, vector operations and temporaries, with
+  // inputs of different lengths, over several evaluation blocks
+  calc->expression.set1Value(0, "ta = ta + a");
+  calc->expression.set1Value(1, "oa = ta");
+  calc->expression.set1Value(2, "ob = (a > b) ? sqrt(a) * 2 : pow(a, b) - fmod(a, b) + a / b");
+  calc->expression.set1Value(3, "oc = atan2(a, b) + floor(a) + cos(b) * sin(a) - log(b) + fabs(a)");
+  calc->expression.set1Value(4, "tA = cross(A, B) + A * b");
+  calc->expression.set1Value(5, "oA = normalize(tA)");
+  calc->expression.set1Value(6, "od = dot(A, B) + length(A) + A[1] - ((a <= b && !(b == 0)) ? 1 : 0)");
+  calc->expression.set1Value(7, "oB = (A[0] > 0) ? A : -B / b");
+  calc->expression.set1Value(8, "oC = vec3f(a, b, A[2]) * 0.5 + tA");
+
+  const int numa = 300, numb = 200, numA = 250;
+  int i;
+  for (i = 0; i < numa; i++) {
+    calc->a.set1Value(i, float((i * 37) % 23) - 11.0f + 0.25f);
   }
-  else if (fieldname[0] == 't') {
-    if ((fieldname[1] >= 'A') && (fieldname[1] <= 'H')) {
-      int idx = fieldname[1] - 'A';
-      if (comp >= 0) {
-        PRIVATE(thisp)->tA_tH[idx][comp] = data[0];
-      }
-      else {
-        PRIVATE(thisp)->tA_tH[idx][0] = data[0];
-        PRIVATE(thisp)->tA_tH[idx][1] = data[1];
-        PRIVATE(thisp)->tA_tH[idx][2] = data[2];
+  for (i = 0; i < numb; i++) {
+    calc->b.set1Value(i, float((i * 13) % 7) - 3.0f);
+  }
+  for (i = 0; i < numA; i++) {
+    calc->A.set1Value(i, SbVec3f(float(i % 5) - 2.0f, float(i % 3), 1.0f - float(i % 4)));
+  }
+  calc->B.setValue(SbVec3f(0.5f, -1.0f, 2.0f));
+
+  SoMFFloat oa, ob, oc, od;
+  SoMFVec3f oA, oB, oC;
+  oa.connectFrom(&calc->oa);
+  ob.connectFrom(&calc->ob);
+  oc.connectFrom(&calc->oc);
+  od.connectFrom(&calc->od);
+  oA.connectFrom(&calc->oA);
+  oB.connectFrom(&calc->oB);
+  oC.connectFrom(&calc->oC);
+
+  // the temporaries keep their values between evaluations
+  float ta = 0.0f;
+  for (int pass = 0; pass < 2; pass++) {
+    if (pass > 0) calc->a.set1Value(0, calc->a[0] + 1.0f);
+
+    BOOST_REQUIRE_EQUAL(oa.getNum(), numa);
+    BOOST_REQUIRE_EQUAL(oA.getNum(), numa);
+    int numerrors = 0;
+    for (i = 0; i < numa; i++) {
+      const float a = calc->a[i];
+      const float b = calc->b[SbMin(i, numb - 1)];
+      const SbVec3f A = calc->A[SbMin(i, numA - 1)];
+      const SbVec3f B = calc->B[0];
+      const float bdiv = (b == 0.0f) ? FLT_EPSILON : b;
+
+      ta += a;
+      const float refob = (a > b) ?
+        (a > 0.0f ? float(sqrt(a)) : 0.0f) * 2.0f :
+        calculator_test_pow(a, b) - (b != 0.0f ? float(fmod(a, b)) : 0.0f) + a / bdiv;
+      const float refoc = calculator_test_atan2(a, b) + float(floor(a)) +
+        float(cos(b)) * float(sin(a)) - (b <= 0.0f ? -128.0f : float(log(b))) + float(fabs(a));
+      const SbVec3f tA = A.cross(B) + A * b;
+      const float refod = A.dot(B) + float(sqrt(A.dot(A))) + A[1] -
+        ((a <= b && !(b == 0.0f)) ? 1.0f : 0.0f);
+      const SbVec3f refoB = (A[0] > 0.0f) ? A : -B / bdiv;
+      const SbVec3f refoC = SbVec3f(a, b, A[2]) * 0.5f + tA;
+
+      if (!calculator_test_equal(oa[i], ta) ||
+          !calculator_test_equal(ob[i], refob) ||
+          !calculator_test_equal(oc[i], refoc) ||
+          !calculator_test_equal(od[i], refod)) numerrors++;
+      for (int j = 0; j < 3; j++) {
+        if (!calculator_test_equal(oA[i][j], calculator_test_normalize(tA)[j]) ||
+            !calculator_test_equal(oB[i][j], refoB[j]) ||
+            !calculator_test_equal(oC[i][j], refoC[j])) numerrors++;
       }
     }
-    else {
-      assert((fieldname[1] >= 'a') && (fieldname[1] <= 'h'));
-      int idx = fieldname[1] - 'a';
-      PRIVATE(thisp)->ta_th[idx] = data[0];
-    }
-  }
-  else {
-    assert(0 && "should not happen");
+    BOOST_CHECK_MESSAGE(numerrors == 0,
+                        numerrors << " values differ from the expression tree results");
   }
+
+  calc->unref();
 }
 
-#undef THISP
-#undef PRIVATE
+#endif // COIN_TEST_SUITE
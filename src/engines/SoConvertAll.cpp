@@ -55,6 +55,8 @@
 #include "tidbitsp.h"
 #include "engines/SoSubEngineP.h"
 #include "misc/SbHash.h"
+#include "misc/SoDBP.h"
+#include "threads/threadsutilp.h"
 
 // *************************************************************************
 
@@ -67,6 +69,7 @@ typedef void convert_func(SoField * from, SoField * to);
 typedef SbHash<uint32_t, convert_func *> UInt32ToConverterFuncMap;
 
 static UInt32ToConverterFuncMap * convertfunc_dict = NULL;
+static SbBool convertfuncs_registered = FALSE;
 
 // *************************************************************************
 
@@ -661,7 +664,7 @@ static void to_and_from_sftrigger(SoField * COIN_UNUSED_ARG(from), SoField * to)
 static void
 register_convertfunc(convert_func * f, SoType from, SoType to)
 {
-  SoDB::addConverter(from, to, SoConvertAll::getClassTypeId());
+  SoDBP::addConverter(from, to, SoConvertAll::getClassTypeId());
   uint32_t val = (static_cast<uint32_t>(from.getKey()) << 16) + to.getKey();
   SbBool nonexist = convertfunc_dict->put(val, f);
   assert(nonexist);
@@ -673,6 +676,7 @@ static void convertall_cleanup_dict(void)
 {
   delete convertfunc_dict;
   convertfunc_dict = NULL;
+  convertfuncs_registered = FALSE;
 }
 
 } // extern "C"
@@ -689,7 +693,30 @@ SoConvertAll::initClass(void)
   // SoConvertAll doesn't have a createInstance() method (because it
   // doesn't have a default constructor), so use the ABSTRACT macros.
   SO_ENGINE_INTERNAL_INIT_ABSTRACT_CLASS(SoConvertAll);
+}
+
+/*!
+  Registers the conversions handled by this class with SoDB. This is
+  not done from initClass(), as it is a fairly large set of
+  conversions which most applications never use. Instead it is done on
+  the first call to SoDB::getConverter() or SoDB::addConverter().
+*/
+void
+SoConvertAll::initConverters(void)
+{
+  if (convertfuncs_registered) return;
 
+  CC_SYNC_BEGIN(SoConvertAll::initConverters);
+  if (!convertfuncs_registered) {
+    SoConvertAll::registerConverters();
+    convertfuncs_registered = TRUE;
+  }
+  CC_SYNC_END(SoConvertAll::initConverters);
+}
+
+void
+SoConvertAll::registerConverters(void)
+{
   struct Conversion {
     convert_func * func;
     const char * from;
@@ -51,6 +51,7 @@ class SoConvertAll : public SoFieldConverter {
 
 public:
   static void initClass(void);
+  static void initConverters(void);
   SoConvertAll(const SoType from, const SoType to);
 
 protected:
@@ -60,6 +61,8 @@ protected:
   virtual SoEngineOutput * getOutput(SoType type);
 
 private:
+  static void registerConverters(void);
+
   typedef void converter_func(SoField * from, SoField * to);
   converter_func * convertvalue;
 
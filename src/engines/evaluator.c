@@ -476,3 +476,669 @@ so_eval_delete(so_eval_node *node)
     free(node);
   }
 }
+
+/* ********************************************************************** */
+
+/*
+ * The compiled program. Registers 0-79 are fixed, and map to the
+ * SoCalculator inputs, temporaries and outputs (vector registers use
+ * three consecutive registers). Intermediate results and constants
+ * are put in registers above those. Every register is only written by
+ * one instruction, except the temporaries and outputs, which are only
+ * written by OP_MOV. Boolean values are stored as 0.0 or 1.0.
+ */
+
+#define REG_IN_FLT 0
+#define REG_IN_VEC 8
+#define REG_TMP_FLT 32
+#define REG_TMP_VEC 40
+#define REG_OUT_FLT 64
+#define REG_OUT_VEC 68
+#define REG_FIRST_FREE 80
+
+enum {
+  OP_MOV,
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_NDIV, /* a / b if b > 0, 0 otherwise (for normalize) */
+  OP_FMOD,
+  OP_NEG,
+  OP_AND,
+  OP_OR,
+  OP_NOT,
+  OP_TEST,
+  OP_LEQ,
+  OP_GEQ,
+  OP_LT,
+  OP_GT,
+  OP_EQ,
+  OP_NEQ,
+  OP_SEL,
+  OP_COS,
+  OP_SIN,
+  OP_TAN,
+  OP_ACOS,
+  OP_ASIN,
+  OP_ATAN,
+  OP_ATAN2,
+  OP_COSH,
+  OP_SINH,
+  OP_TANH,
+  OP_SQRT,
+  OP_EXP,
+  OP_LOG,
+  OP_LOG10,
+  OP_CEIL,
+  OP_FLOOR,
+  OP_FABS,
+  OP_POW,
+  OP_RAND
+};
+
+typedef struct {
+  short op;
+  short dst;
+  short src[3];
+} so_eval_instr;
+
+struct so_eval_program {
+  so_eval_instr *instr;
+  int numinstr, maxinstr;
+
+  int numregs;
+  short *constreg;
+  float *constval;
+  int numconst, maxconst;
+
+  char inused[16];
+  char outused[8];
+
+  /* set if a temporary register is read before it is written. The
+     values then depend on the previous value, and must be evaluated
+     one by one. */
+  int sequential;
+  /* set for programs using rand(), to get the random numbers in the
+     same order as when evaluating the trees */
+  int hasrand;
+
+  /* set while compiling: which fixed registers have been written */
+  char written[REG_FIRST_FREE];
+
+  float *regs; /* numregs * SO_EVAL_BLOCK_SIZE values */
+};
+
+/* the registers of a compiled (sub)expression */
+typedef struct {
+  int num; /* 1 for scalars and booleans, 3 for vectors */
+  short reg[3];
+} so_eval_result;
+
+static int
+compile_alloc_reg(so_eval_program *p)
+{
+  return p->numregs++;
+}
+
+static void
+compile_emit_to(so_eval_program *p, int op, int dst, int src0, int src1, int src2)
+{
+  so_eval_instr *ins;
+  if (p->numinstr == p->maxinstr) {
+    p->maxinstr = p->maxinstr ? p->maxinstr * 2 : 64;
+    p->instr = (so_eval_instr*) realloc(p->instr, p->maxinstr * sizeof(so_eval_instr));
+  }
+  ins = &p->instr[p->numinstr++];
+  ins->op = (short) op;
+  ins->dst = (short) dst;
+  ins->src[0] = (short) src0;
+  ins->src[1] = (short) src1;
+  ins->src[2] = (short) src2;
+}
+
+/* emits an instruction writing to a new register, which is returned */
+static int
+compile_emit(so_eval_program *p, int op, int src0, int src1, int src2)
+{
+  const int dst = compile_alloc_reg(p);
+  compile_emit_to(p, op, dst, src0, src1, src2);
+  return dst;
+}
+
+static int
+compile_const(so_eval_program *p, float val)
+{
+  int i;
+  for (i = 0; i < p->numconst; i++) {
+    if (p->constval[i] == val) return p->constreg[i];
+  }
+  if (p->numconst == p->maxconst) {
+    p->maxconst = p->maxconst ? p->maxconst * 2 : 16;
+    p->constreg = (short*) realloc(p->constreg, p->maxconst * sizeof(short));
+    p->constval = (float*) realloc(p->constval, p->maxconst * sizeof(float));
+  }
+  p->constval[p->numconst] = val;
+  p->constreg[p->numconst] = (short) compile_alloc_reg(p);
+  return p->constreg[p->numconst++];
+}
+
+/* returns the first fixed register for the register name */
+static int
+compile_fixed_reg(so_eval_program *p, const char *regname, int *isvec)
+{
+  char c;
+  if (regname[0] == 't' || regname[0] == 'o') {
+    c = regname[1];
+    *isvec = c >= 'A' && c <= 'H';
+    if (regname[0] == 't') {
+      return *isvec ? REG_TMP_VEC + (c - 'A') * 3 : REG_TMP_FLT + (c - 'a');
+    }
+    return *isvec ? REG_OUT_VEC + (c - 'A') * 3 : REG_OUT_FLT + (c - 'a');
+  }
+  c = regname[0];
+  *isvec = c >= 'A' && c <= 'H';
+  if (*isvec) {
+    p->inused[8 + c - 'A'] = 1;
+    return REG_IN_VEC + (c - 'A') * 3;
+  }
+  p->inused[c - 'a'] = 1;
+  return REG_IN_FLT + (c - 'a');
+}
+
+static void
+compile_read_fixed(so_eval_program *p, int reg)
+{
+  if (reg >= REG_TMP_FLT && reg < REG_OUT_FLT && !p->written[reg]) {
+    p->sequential = 1;
+  }
+}
+
+static void
+compile_write_fixed(so_eval_program *p, int reg, int src)
+{
+  /* MOV is the only instruction writing to a fixed register */
+  compile_emit_to(p, OP_MOV, reg, src, 0, 0);
+  p->written[reg] = 1;
+  if (reg >= REG_OUT_FLT) {
+    p->outused[reg < REG_OUT_VEC ? reg - REG_OUT_FLT : 4 + (reg - REG_OUT_VEC) / 3] = 1;
+  }
+}
+
+static int
+compile_unary_op(int id)
+{
+  switch (id) {
+  case ID_COS: return OP_COS;
+  case ID_SIN: return OP_SIN;
+  case ID_TAN: return OP_TAN;
+  case ID_ACOS: return OP_ACOS;
+  case ID_ASIN: return OP_ASIN;
+  case ID_ATAN: return OP_ATAN;
+  case ID_COSH: return OP_COSH;
+  case ID_SINH: return OP_SINH;
+  case ID_TANH: return OP_TANH;
+  case ID_SQRT: return OP_SQRT;
+  case ID_EXP: return OP_EXP;
+  case ID_LOG: return OP_LOG;
+  case ID_LOG10: return OP_LOG10;
+  case ID_CEIL: return OP_CEIL;
+  case ID_FLOOR: return OP_FLOOR;
+  case ID_FABS: return OP_FABS;
+  case ID_NEG: return OP_NEG;
+  case ID_NOT: return OP_NOT;
+  case ID_TEST_FLT: return OP_TEST;
+  case ID_RAND: return OP_RAND;
+  default: return -1;
+  }
+}
+
+static int
+compile_binary_op(int id)
+{
+  switch (id) {
+  case ID_ADD: return OP_ADD;
+  case ID_SUB: return OP_SUB;
+  case ID_MUL: return OP_MUL;
+  case ID_DIV: return OP_DIV;
+  case ID_FMOD: return OP_FMOD;
+  case ID_AND: return OP_AND;
+  case ID_OR: return OP_OR;
+  case ID_LEQ: return OP_LEQ;
+  case ID_GEQ: return OP_GEQ;
+  case ID_LT: return OP_LT;
+  case ID_GT: return OP_GT;
+  case ID_EQ: return OP_EQ;
+  case ID_NEQ: return OP_NEQ;
+  case ID_ATAN2: return OP_ATAN2;
+  case ID_POW: return OP_POW;
+  default: return -1;
+  }
+}
+
+static int
+compile_dot(so_eval_program *p, const so_eval_result *a, const so_eval_result *b)
+{
+  int x = compile_emit(p, OP_MUL, a->reg[0], b->reg[0], 0);
+  int y = compile_emit(p, OP_MUL, a->reg[1], b->reg[1], 0);
+  int z = compile_emit(p, OP_MUL, a->reg[2], b->reg[2], 0);
+  return compile_emit(p, OP_ADD, compile_emit(p, OP_ADD, x, y, 0), z, 0);
+}
+
+static void
+compile_node(so_eval_program *p, so_eval_node *node, so_eval_result *res)
+{
+  so_eval_result r1, r2, r3;
+  int i, op, reg, isvec;
+
+  res->num = 1;
+
+  switch (node->id) {
+  case ID_SEPARATOR:
+    if (node->child1) compile_node(p, node->child1, &r1);
+    if (node->child2) compile_node(p, node->child2, &r2);
+    return;
+  case ID_ASSIGN_FLT:
+    compile_node(p, node->child2, &r1);
+    reg = compile_fixed_reg(p, node->child1->regname, &isvec);
+    if (node->child1->regidx >= 0) reg += node->child1->regidx;
+    compile_write_fixed(p, reg, r1.reg[0]);
+    return;
+  case ID_ASSIGN_VEC:
+    compile_node(p, node->child2, &r1);
+    reg = compile_fixed_reg(p, node->child1->regname, &isvec);
+    /* copy the components first if the right hand side reads from
+       the register (like in "tA = vec3f(tA[1], tA[0], 0)") */
+    for (i = 0; i < 3; i++) {
+      if (r1.reg[i] >= reg && r1.reg[i] < reg + 3) break;
+    }
+    if (i < 3) {
+      for (i = 0; i < 3; i++) r1.reg[i] = (short) compile_emit(p, OP_MOV, r1.reg[i], 0, 0);
+    }
+    for (i = 0; i < 3; i++) compile_write_fixed(p, reg + i, r1.reg[i]);
+    return;
+  case ID_FLT_REG:
+  case ID_VEC_REG:
+  case ID_VEC_REG_COMP:
+    reg = compile_fixed_reg(p, node->regname, &isvec);
+    if (node->id == ID_VEC_REG_COMP) {
+      assert(node->regidx >= 0 && node->regidx <= 2);
+      reg += node->regidx;
+      isvec = 0;
+    }
+    res->num = isvec ? 3 : 1;
+    for (i = 0; i < res->num; i++) {
+      compile_read_fixed(p, reg + i);
+      res->reg[i] = (short) (reg + i);
+    }
+    return;
+  case ID_VALUE:
+    res->reg[0] = (short) compile_const(p, node->value);
+    return;
+  default:
+    break;
+  }
+
+  if (node->child1) compile_node(p, node->child1, &r1);
+  if (node->child2) compile_node(p, node->child2, &r2);
+  if (node->child3) compile_node(p, node->child3, &r3);
+
+  switch (node->id) {
+  case ID_ADD_VEC:
+  case ID_SUB_VEC:
+    res->num = 3;
+    for (i = 0; i < 3; i++) {
+      res->reg[i] = (short) compile_emit(p, node->id == ID_ADD_VEC ? OP_ADD : OP_SUB,
+                                         r1.reg[i], r2.reg[i], 0);
+    }
+    break;
+  case ID_NEG_VEC:
+    res->num = 3;
+    for (i = 0; i < 3; i++) {
+      res->reg[i] = (short) compile_emit(p, OP_NEG, r1.reg[i], 0, 0);
+    }
+    break;
+  case ID_MUL_VEC_FLT:
+  case ID_DIV_VEC_FLT:
+    /* OP_DIV handles division by zero the same way as for vectors */
+    res->num = 3;
+    for (i = 0; i < 3; i++) {
+      res->reg[i] = (short) compile_emit(p, node->id == ID_MUL_VEC_FLT ? OP_MUL : OP_DIV,
+                                         r1.reg[i], r2.reg[0], 0);
+    }
+    break;
+  case ID_CROSS:
+    res->num = 3;
+    for (i = 0; i < 3; i++) {
+      int j = (i + 1) % 3, k = (i + 2) % 3;
+      res->reg[i] = (short)
+        compile_emit(p, OP_SUB,
+                     compile_emit(p, OP_MUL, r1.reg[j], r2.reg[k], 0),
+                     compile_emit(p, OP_MUL, r1.reg[k], r2.reg[j], 0), 0);
+    }
+    break;
+  case ID_DOT:
+    res->reg[0] = (short) compile_dot(p, &r1, &r2);
+    break;
+  case ID_LEN:
+    res->reg[0] = (short) compile_emit(p, OP_SQRT, compile_dot(p, &r1, &r1), 0, 0);
+    break;
+  case ID_NORMALIZE:
+    reg = compile_emit(p, OP_SQRT, compile_dot(p, &r1, &r1), 0, 0);
+    res->num = 3;
+    for (i = 0; i < 3; i++) {
+      res->reg[i] = (short) compile_emit(p, OP_NDIV, r1.reg[i], reg, 0);
+    }
+    break;
+  case ID_TEST_VEC:
+    res->reg[0] = (short)
+      compile_emit(p, OP_OR,
+                   compile_emit(p, OP_OR,
+                                compile_emit(p, OP_TEST, r1.reg[0], 0, 0),
+                                compile_emit(p, OP_TEST, r1.reg[1], 0, 0), 0),
+                   compile_emit(p, OP_TEST, r1.reg[2], 0, 0), 0);
+    break;
+  case ID_VEC3F:
+    res->num = 3;
+    res->reg[0] = r1.reg[0];
+    res->reg[1] = r2.reg[0];
+    res->reg[2] = r3.reg[0];
+    break;
+  case ID_FLT_COND:
+  case ID_VEC_COND:
+    /* both branches are evaluated, and the result selected */
+    res->num = node->id == ID_VEC_COND ? 3 : 1;
+    for (i = 0; i < res->num; i++) {
+      res->reg[i] = (short) compile_emit(p, OP_SEL, r1.reg[0], r2.reg[i], r3.reg[i]);
+    }
+    break;
+  default:
+    op = compile_unary_op(node->id);
+    if (op >= 0) {
+      if (op == OP_RAND) p->hasrand = 1;
+      res->reg[0] = (short) compile_emit(p, op, r1.reg[0], 0, 0);
+      break;
+    }
+    op = compile_binary_op(node->id);
+    assert(op >= 0 && "Whoops. Unknown node id!\n");
+    /* comparing vectors only compares the x component, as for the
+       trees */
+    res->reg[0] = (short) compile_emit(p, op, r1.reg[0], r2.reg[0], 0);
+    break;
+  }
+}
+
+so_eval_program *
+so_eval_compile(so_eval_node *const *nodes, int numnodes)
+{
+  int i;
+  so_eval_result res;
+  so_eval_program *p = (so_eval_program*) malloc(sizeof(so_eval_program));
+
+  p->instr = NULL;
+  p->numinstr = p->maxinstr = 0;
+  p->numregs = REG_FIRST_FREE;
+  p->constreg = NULL;
+  p->constval = NULL;
+  p->numconst = p->maxconst = 0;
+  for (i = 0; i < 16; i++) p->inused[i] = 0;
+  for (i = 0; i < 8; i++) p->outused[i] = 0;
+  for (i = 0; i < REG_FIRST_FREE; i++) p->written[i] = 0;
+  p->sequential = 0;
+  p->hasrand = 0;
+
+  for (i = 0; i < numnodes; i++) {
+    if (nodes[i]) compile_node(p, nodes[i], &res);
+  }
+  if (p->hasrand) p->sequential = 1;
+
+  p->regs = (float*) malloc(sizeof(float) * p->numregs * SO_EVAL_BLOCK_SIZE);
+  return p;
+}
+
+void
+so_eval_program_delete(so_eval_program *p)
+{
+  if (p == NULL) return;
+  free(p->instr);
+  free(p->constreg);
+  free(p->constval);
+  free(p->regs);
+  free(p);
+}
+
+void
+so_eval_program_used(const so_eval_program *p, char *inused, char *outused)
+{
+  int i;
+  for (i = 0; i < 16; i++) inused[i] = p->inused[i];
+  for (i = 0; i < 8; i++) outused[i] = p->outused[i];
+}
+
+/*
+ * executes the program for n values.
+ */
+static void
+program_execute(const so_eval_program *p, float *regs, int n)
+{
+  int i, k;
+  for (i = 0; i < p->numinstr; i++) {
+    const so_eval_instr *ins = &p->instr[i];
+    float *d = regs + ins->dst * SO_EVAL_BLOCK_SIZE;
+    const float *a = regs + ins->src[0] * SO_EVAL_BLOCK_SIZE;
+    const float *b = regs + ins->src[1] * SO_EVAL_BLOCK_SIZE;
+    const float *c = regs + ins->src[2] * SO_EVAL_BLOCK_SIZE;
+
+    switch (ins->op) {
+    case OP_MOV:
+      for (k = 0; k < n; k++) d[k] = a[k];
+      break;
+    case OP_ADD:
+      for (k = 0; k < n; k++) d[k] = a[k] + b[k];
+      break;
+    case OP_SUB:
+      for (k = 0; k < n; k++) d[k] = a[k] - b[k];
+      break;
+    case OP_MUL:
+      for (k = 0; k < n; k++) d[k] = a[k] * b[k];
+      break;
+    case OP_DIV:
+      for (k = 0; k < n; k++) d[k] = a[k] / (b[k] == 0.0f ? FLT_EPSILON : b[k]);
+      break;
+    case OP_NDIV:
+      for (k = 0; k < n; k++) d[k] = b[k] > 0.0f ? a[k] / b[k] : 0.0f;
+      break;
+    case OP_FMOD:
+      for (k = 0; k < n; k++) d[k] = b[k] != 0.0f ? (float) fmod(a[k], b[k]) : 0.0f;
+      break;
+    case OP_NEG:
+      for (k = 0; k < n; k++) d[k] = -a[k];
+      break;
+    case OP_AND:
+      for (k = 0; k < n; k++) d[k] = (a[k] != 0.0f && b[k] != 0.0f) ? 1.0f : 0.0f;
+      break;
+    case OP_OR:
+      for (k = 0; k < n; k++) d[k] = (a[k] != 0.0f || b[k] != 0.0f) ? 1.0f : 0.0f;
+      break;
+    case OP_NOT:
+      for (k = 0; k < n; k++) d[k] = a[k] == 0.0f ? 1.0f : 0.0f;
+      break;
+    case OP_TEST:
+      for (k = 0; k < n; k++) d[k] = a[k] != 0.0f ? 1.0f : 0.0f;
+      break;
+    case OP_LEQ:
+      for (k = 0; k < n; k++) d[k] = a[k] <= b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_GEQ:
+      for (k = 0; k < n; k++) d[k] = a[k] >= b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_LT:
+      for (k = 0; k < n; k++) d[k] = a[k] < b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_GT:
+      for (k = 0; k < n; k++) d[k] = a[k] > b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_EQ:
+      for (k = 0; k < n; k++) d[k] = a[k] == b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_NEQ:
+      for (k = 0; k < n; k++) d[k] = a[k] != b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_SEL:
+      for (k = 0; k < n; k++) d[k] = a[k] != 0.0f ? b[k] : c[k];
+      break;
+    case OP_COS:
+      for (k = 0; k < n; k++) d[k] = (float) cos(a[k]);
+      break;
+    case OP_SIN:
+      for (k = 0; k < n; k++) d[k] = (float) sin(a[k]);
+      break;
+    case OP_TAN:
+      for (k = 0; k < n; k++) d[k] = (float) tan(a[k]);
+      break;
+    case OP_ACOS:
+      for (k = 0; k < n; k++) d[k] = (float) acos(clamp(a[k], -1.0f, 1.0f));
+      break;
+    case OP_ASIN:
+      for (k = 0; k < n; k++) d[k] = (float) asin(clamp(a[k], -1.0f, 1.0f));
+      break;
+    case OP_ATAN:
+      for (k = 0; k < n; k++) d[k] = (float) atan(a[k]);
+      break;
+    case OP_ATAN2:
+      for (k = 0; k < n; k++) {
+        if (b[k] == 0.0f) d[k] = (float) (a[k] >= 0.0f ? M_PI * 0.5 : - M_PI * 0.5);
+        else d[k] = (float) atan2(a[k], b[k]);
+      }
+      break;
+    case OP_COSH:
+      for (k = 0; k < n; k++) d[k] = (float) cosh(a[k]);
+      break;
+    case OP_SINH:
+      for (k = 0; k < n; k++) d[k] = (float) sinh(a[k]);
+      break;
+    case OP_TANH:
+      for (k = 0; k < n; k++) d[k] = (float) tanh(a[k]);
+      break;
+    case OP_SQRT:
+      for (k = 0; k < n; k++) d[k] = a[k] > 0.0f ? (float) sqrt(a[k]) : 0.0f;
+      break;
+    case OP_EXP:
+      for (k = 0; k < n; k++) d[k] = (float) exp(a[k]);
+      break;
+    case OP_LOG:
+      for (k = 0; k < n; k++) d[k] = a[k] <= 0.0f ? -128.0f : (float) log(a[k]);
+      break;
+    case OP_LOG10:
+      for (k = 0; k < n; k++) d[k] = a[k] <= 0.0f ? -38.0f : (float) log10(a[k]);
+      break;
+    case OP_CEIL:
+      for (k = 0; k < n; k++) d[k] = (float) ceil(a[k]);
+      break;
+    case OP_FLOOR:
+      for (k = 0; k < n; k++) d[k] = (float) floor(a[k]);
+      break;
+    case OP_FABS:
+      for (k = 0; k < n; k++) d[k] = (float) fabs(a[k]);
+      break;
+    case OP_POW:
+      for (k = 0; k < n; k++) {
+        if (a[k] == 0.0f) d[k] = 0.0f;
+        else if (a[k] > 0.0f) d[k] = (float) pow(a[k], b[k]);
+        else d[k] = (float) pow(a[k], floor(b[k] + 0.5));
+      }
+      break;
+    case OP_RAND:
+      for (k = 0; k < n; k++) d[k] = ((float)rand()) / ((float)RAND_MAX) * a[k];
+      break;
+    default:
+      assert(0 && "Whoops. Unknown opcode!\n");
+      break;
+    }
+  }
+}
+
+/*
+ * evaluates the program for count values, a block of values at a time
+ */
+void
+so_eval_program_run(so_eval_program *p, so_eval_io *io, int count)
+{
+  int i, j, k, start, n;
+  const int blocksize = p->sequential ? 1 : SO_EVAL_BLOCK_SIZE;
+  float *regs = p->regs;
+
+  /* constants and temporaries are set up for all values in the block */
+  for (i = 0; i < p->numconst; i++) {
+    float *d = regs + p->constreg[i] * SO_EVAL_BLOCK_SIZE;
+    for (k = 0; k < SO_EVAL_BLOCK_SIZE; k++) d[k] = p->constval[i];
+  }
+  for (i = 0; i < 32; i++) {
+    float *d = regs + (REG_TMP_FLT + i) * SO_EVAL_BLOCK_SIZE;
+    for (k = 0; k < blocksize; k++) d[k] = io->tmp[i];
+  }
+
+  for (start = 0; start < count; start += blocksize) {
+    n = count - start;
+    if (n > blocksize) n = blocksize;
+
+    /* read input values, repeating the last value of short inputs */
+    for (i = 0; i < 16; i++) {
+      const int num = io->innum[i];
+      const int comps = i < 8 ? 1 : 3;
+      const int reg = i < 8 ? REG_IN_FLT + i : REG_IN_VEC + (i - 8) * 3;
+      if (!p->inused[i]) continue;
+      for (j = 0; j < comps; j++) {
+        float *d = regs + (reg + j) * SO_EVAL_BLOCK_SIZE;
+        if (num == 0) {
+          for (k = 0; k < n; k++) d[k] = 0.0f;
+        }
+        else if (start + n <= num) {
+          const float *src = io->in[i] + start * comps + j;
+          for (k = 0; k < n; k++) d[k] = src[k * comps];
+        }
+        else {
+          for (k = 0; k < n; k++) {
+            const int idx = start + k < num ? start + k : num - 1;
+            d[k] = io->in[i][idx * comps + j];
+          }
+        }
+      }
+    }
+
+    /* outputs start out as zero for every value */
+    for (i = REG_OUT_FLT; i < REG_FIRST_FREE; i++) {
+      float *d = regs + i * SO_EVAL_BLOCK_SIZE;
+      for (k = 0; k < n; k++) d[k] = 0.0f;
+    }
+
+    program_execute(p, regs, n);
+
+    for (i = 0; i < 8; i++) {
+      const int comps = i < 4 ? 1 : 3;
+      const int reg = i < 4 ? REG_OUT_FLT + i : REG_OUT_VEC + (i - 4) * 3;
+      if (!p->outused[i] || !io->out[i]) continue;
+      for (j = 0; j < comps; j++) {
+        const float *s = regs + (reg + j) * SO_EVAL_BLOCK_SIZE;
+        float *dst = io->out[i] + start * comps + j;
+        for (k = 0; k < n; k++) dst[k * comps] = s[k];
+      }
+    }
+  }
+
+  /* keep the temporaries of the last value */
+  if (count > 0) {
+    n = (count - 1) % blocksize;
+    for (i = 0; i < 32; i++) {
+      io->tmp[i] = regs[(REG_TMP_FLT + i) * SO_EVAL_BLOCK_SIZE + n];
+    }
+  }
+}
+
+#undef REG_IN_FLT
+#undef REG_IN_VEC
+#undef REG_TMP_FLT
+#undef REG_TMP_VEC
+#undef REG_OUT_FLT
+#undef REG_OUT_VEC
+#undef REG_FIRST_FREE
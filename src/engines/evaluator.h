@@ -59,6 +59,14 @@
  * value to some function, it will be clamped or the result will
  * be set to some (hopefully) useful value.
  *                                              pederb, 20000307
+ *
+ * For evaluating the expressions over many field values, the trees
+ * can be compiled into a flat, register based program with
+ * so_eval_compile(). Every program register holds a block of
+ * SO_EVAL_BLOCK_SIZE values, and every instruction is a simple loop
+ * over such a block, so so_eval_program_run() processes whole input
+ * arrays at a time. Vector expressions are split into operations on
+ * the x, y and z components.
  */
 #ifdef __cplusplus
 extern "C" {
@@ -99,6 +107,40 @@ extern "C" {
      check this after calling so_eval_parse() */
   char * so_eval_error(void); /* defined in epsilon.y */
 
+  /* number of field values processed by each program instruction */
+#define SO_EVAL_BLOCK_SIZE 128
+
+  typedef struct so_eval_program so_eval_program;
+
+  /* input, output and temporary register storage for a program run */
+  typedef struct {
+    /* a-h (one float per value) and A-H (three floats per value) */
+    const float *in[16];
+    int innum[16];
+    /* oa-od and oA-oD, with room for count values. Only used outputs
+       are written. */
+    float *out[8];
+    /* ta-th followed by tA-tH (three floats each). Read before the
+       first value, and holds the registers after the last value when
+       done. */
+    float *tmp;
+  } so_eval_io;
+
+  /* compile the expression trees, evaluated in order for every value,
+     into one program. NULL entries are skipped. */
+  so_eval_program *so_eval_compile(so_eval_node *const *nodes, int numnodes);
+
+  /* free memory used by program */
+  void so_eval_program_delete(so_eval_program *program);
+
+  /* find input and output fields which are used. inused 0-7 is a-h,
+     8-15 is A-H, outused 0-3 is oa-od and 4-7 is oA-oD */
+  void so_eval_program_used(const so_eval_program *program,
+                            char *inused, char *outused);
+
+  /* evaluates the program for count field values */
+  void so_eval_program_run(so_eval_program *program, so_eval_io *io, int count);
+
   /* methods to create misc nodes */
   so_eval_node *so_eval_create_unary(int id, so_eval_node *topnode);
   so_eval_node *so_eval_create_binary(int id, so_eval_node *lhs, so_eval_node *rhs);
@@ -33,6 +33,25 @@
 /*
   Collects functionality for glyph-handling common for 2D and 3D
   glyphs.
+
+  The glyphs are kept in a cache, which is a hash table of singly
+  linked bucket chains. Readers walk the chains without taking any
+  locks, and take a reference on a matching glyph with a
+  compare-and-swap on its reference count. Inserting new glyphs,
+  growing the table and evicting unused glyphs is done by a single
+  writer at a time, holding the cache mutex.
+
+  Memory which readers might still be looking at (unlinked chain
+  nodes, old bucket tables and evicted glyph structs) is put on a
+  retired list, and only freed when no readers are inside the
+  cache. Readers announce themselves in one of a set of striped
+  counters, so that lookups of different glyphs don't fight over the
+  same cache line.
+
+  Glyphs which are no longer referenced are kept in the cache, so
+  that text which is regenerated often doesn't have to rasterize or
+  tessellate its glyphs again. When the number of unused glyphs grows
+  above COIN_GLYPH_CACHE_UNUSED (default 1024), they are evicted.
 */
 
 /* ********************************************************************** */
@@ -40,58 +59,534 @@
 #include "glyph.h"
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 
 #include <Inventor/C/base/list.h>
+#include <Inventor/C/base/string.h>
+#include <Inventor/C/tidbits.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
 
 #include "fontlib_wrapper.h"
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
 #include "coindefs.h"
 
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/wpool.h>
+#endif // HAVE_THREADS
+
 #ifndef COIN_WORKAROUND_NO_USING_STD_FUNCS
 using namespace std;
 #endif // !COIN_WORKAROUND_NO_USING_STD_FUNCS
 
 /* ********************************************************************** */
 
-void 
-cc_glyph_unref(cc_dict * dict, cc_glyph * glyph, cc_glyph_finalize * f)
-{
-  cc_list * glyphlist;
-  int ret;
-  void * tmp;
-  int i;
+#define GLYPH_CACHE_READER_STRIPES 16
+#define GLYPH_CACHE_INITIAL_SIZE 64
 
-  glyph->refcount--;
+struct cc_glyph_cache_node {
+  std::atomic<cc_glyph_cache_node *> next;
+  uint32_t hash;
+  cc_glyph * glyph;
+};
 
-  assert(glyph->refcount >= 0);
-  if (glyph->refcount > 0) { return; }
+struct cc_glyph_cache_table {
+  unsigned int size; /* always a power of two */
+  std::atomic<cc_glyph_cache_node *> * buckets;
+};
 
-  /* external finalizing: */
-  if (f) { (*f)(glyph); }
+/* padded to a cache line to avoid false sharing between stripes */
+struct cc_glyph_cache_readers {
+  std::atomic<int> count;
+  char pad[64 - sizeof(std::atomic<int>)];
+};
 
-  /* handling of common data: */
+struct cc_glyph_cache {
+  std::atomic<cc_glyph_cache_table *> table;
+  cc_glyph_cache_readers readers[GLYPH_CACHE_READER_STRIPES];
+  std::atomic<int> numunused;
+
+  void * mutex;
+  int numglyphs;
+  int maxunused;
+
+  cc_glyph_match * match;
+  cc_glyph_create * create;
+  cc_glyph_finalize * finalize;
+
+  /* memory waiting for the readers to leave the cache */
+  cc_list * retiredtables;
+  cc_list * retirednodes;
+  cc_list * retiredglyphs;
+};
+
+/* ********************************************************************** */
+
+static uint32_t
+glyph_cache_hash(uint32_t character, const cc_font_specification * spec,
+                 uint32_t variant)
+{
+  uint32_t h = cc_string_hash(&spec->name);
+  h = h * 31 + cc_string_hash(&spec->style);
+  h = h * 31 + variant;
+  h ^= character * 2654435761u;
+  h ^= h >> 15;
+  h *= 2246822519u;
+  h ^= h >> 13;
+  return h;
+}
 
-  ret = cc_dict_get(dict, (uintptr_t)glyph->character, &tmp);
-  assert(ret);
-  glyphlist = (cc_list *)tmp;
-    
-  for (i = 0; i < cc_list_get_length(glyphlist); i++) {
-    if (glyph == (cc_glyph *)cc_list_get(glyphlist, i)) break;
-  }    
-  assert(i < cc_list_get_length(glyphlist));
+static cc_glyph_cache_table *
+glyph_cache_table_construct(unsigned int size)
+{
+  unsigned int i;
+  cc_glyph_cache_table * t = new cc_glyph_cache_table;
+  t->size = size;
+  t->buckets = new std::atomic<cc_glyph_cache_node *>[size];
+  for (i = 0; i < size; i++) { t->buckets[i].store(NULL, std::memory_order_relaxed); }
+  return t;
+}
 
-  cc_list_remove_fast(glyphlist, i);
-  if (cc_list_get_length(glyphlist) == 0) {
-    (void)cc_dict_remove(dict, (uintptr_t)glyph->character);
-    cc_list_destruct(glyphlist);
+static void
+glyph_cache_table_destruct(cc_glyph_cache_table * t, SbBool freenodes)
+{
+  unsigned int i;
+  cc_glyph_cache_node * node, * next;
+  if (freenodes) {
+    for (i = 0; i < t->size; i++) {
+      node = t->buckets[i].load(std::memory_order_relaxed);
+      while (node) {
+        next = node->next.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+      }
+    }
   }
+  delete[] t->buckets;
+  delete t;
+}
 
+/* Frees the memory of a glyph struct. The font resources must already
+   have been released with glyph_cache_release(). */
+static void
+glyph_cache_free(cc_glyph * glyph)
+{
+  typedef std::atomic<int> atomic_int;
+  glyph->refcount.~atomic_int();
   cc_fontspec_clean(glyph->fontspec);
   free(glyph->fontspec);
+  free(glyph);
+}
 
+/* Releases the font resources held by a glyph. Must be done while
+   holding the cache mutex, before a glyph with the same key can be
+   created again, since the font abstraction layer doesn't reference
+   count its glyphs. */
+static void
+glyph_cache_release(cc_glyph_cache * cache, cc_glyph * glyph)
+{
+  if (cache->finalize) { (*cache->finalize)(glyph); }
   cc_flw_done_glyph(glyph->fontidx, glyph->glyphidx);
   cc_flw_unref_font(glyph->fontidx);
+}
 
-  free(glyph);
+/* Frees retired memory if no readers are inside the cache. Called
+   with the cache mutex held. */
+static void
+glyph_cache_reclaim(cc_glyph_cache * cache)
+{
+  int i, n;
+  if ((cc_list_get_length(cache->retiredtables) == 0) &&
+      (cc_list_get_length(cache->retirednodes) == 0) &&
+      (cc_list_get_length(cache->retiredglyphs) == 0)) return;
+
+  for (i = 0; i < GLYPH_CACHE_READER_STRIPES; i++) {
+    if (cache->readers[i].count.load() != 0) return;
+  }
+
+  n = cc_list_get_length(cache->retiredtables);
+  for (i = 0; i < n; i++) {
+    glyph_cache_table_destruct((cc_glyph_cache_table *)cc_list_get(cache->retiredtables, i), TRUE);
+  }
+  n = cc_list_get_length(cache->retirednodes);
+  for (i = 0; i < n; i++) {
+    delete (cc_glyph_cache_node *)cc_list_get(cache->retirednodes, i);
+  }
+  n = cc_list_get_length(cache->retiredglyphs);
+  for (i = 0; i < n; i++) {
+    glyph_cache_free((cc_glyph *)cc_list_get(cache->retiredglyphs, i));
+  }
+  cc_list_truncate(cache->retiredtables, 0);
+  cc_list_truncate(cache->retirednodes, 0);
+  cc_list_truncate(cache->retiredglyphs, 0);
+}
+
+/* Lock-free lookup. Returns the glyph with an extra reference, or
+   NULL if not found. */
+static cc_glyph *
+glyph_cache_find(cc_glyph_cache * cache, uint32_t hash, uint32_t character,
+                 const cc_font_specification * spec, float angle)
+{
+  cc_glyph_cache_table * t = cache->table.load();
+  cc_glyph_cache_node * node = t->buckets[hash & (t->size - 1)].load();
+
+  for (; node; node = node->next.load()) {
+    cc_glyph * glyph = node->glyph;
+    if ((node->hash != hash) || (glyph->character != character)) continue;
+    if (!(*cache->match)(glyph, spec, angle)) continue;
+
+    int refcount = glyph->refcount.load(std::memory_order_relaxed);
+    /* a negative refcount means the glyph is being evicted */
+    while (refcount >= 0) {
+      if (glyph->refcount.compare_exchange_weak(refcount, refcount + 1)) {
+        if (refcount == 0) { cache->numunused.fetch_sub(1); }
+        return glyph;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Moves all nodes into a table four times as large. Called with the
+   cache mutex held. */
+static void
+glyph_cache_grow(cc_glyph_cache * cache)
+{
+  unsigned int i;
+  cc_glyph_cache_table * old = cache->table.load();
+  cc_glyph_cache_table * t = glyph_cache_table_construct(old->size * 4);
+
+  /* The old nodes might be in use by readers, so the new table gets
+     its own copies. */
+  for (i = 0; i < old->size; i++) {
+    cc_glyph_cache_node * node = old->buckets[i].load();
+    for (; node; node = node->next.load()) {
+      cc_glyph_cache_node * copy = new cc_glyph_cache_node;
+      std::atomic<cc_glyph_cache_node *> & bucket = t->buckets[node->hash & (t->size - 1)];
+      copy->hash = node->hash;
+      copy->glyph = node->glyph;
+      copy->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      bucket.store(copy, std::memory_order_relaxed);
+    }
+  }
+  cache->table.store(t);
+  cc_list_append(cache->retiredtables, old);
+  glyph_cache_reclaim(cache);
+}
+
+/* Evicts all glyphs which are not referenced. Called with the cache
+   mutex held. */
+static void
+glyph_cache_evict(cc_glyph_cache * cache)
+{
+  unsigned int i;
+  cc_glyph_cache_table * t = cache->table.load();
+
+  for (i = 0; i < t->size; i++) {
+    std::atomic<cc_glyph_cache_node *> * link = &t->buckets[i];
+    cc_glyph_cache_node * node = link->load();
+    while (node) {
+      cc_glyph_cache_node * next = node->next.load();
+      int unused = 0;
+      /* mark as dead, so that readers which have already found the
+         node won't be able to resurrect it */
+      if (node->glyph->refcount.compare_exchange_strong(unused, -1)) {
+        link->store(next);
+        glyph_cache_release(cache, node->glyph);
+        cc_list_append(cache->retirednodes, node);
+        cc_list_append(cache->retiredglyphs, node->glyph);
+        cache->numglyphs--;
+        cache->numunused.fetch_sub(1);
+      }
+      else {
+        link = &node->next;
+      }
+      node = next;
+    }
+  }
+  glyph_cache_reclaim(cache);
+}
+
+/* ********************************************************************** */
+
+cc_glyph_cache *
+cc_glyph_cache_construct(cc_glyph_match * m, cc_glyph_create * c,
+                         cc_glyph_finalize * f)
+{
+  int i;
+  const char * env;
+  cc_glyph_cache * cache = new cc_glyph_cache;
+
+  cache->table.store(glyph_cache_table_construct(GLYPH_CACHE_INITIAL_SIZE));
+  for (i = 0; i < GLYPH_CACHE_READER_STRIPES; i++) {
+    cache->readers[i].count.store(0);
+  }
+  cache->numunused.store(0);
+  cache->mutex = NULL;
+  CC_MUTEX_CONSTRUCT(cache->mutex);
+  cache->numglyphs = 0;
+
+  env = coin_getenv("COIN_GLYPH_CACHE_UNUSED");
+  cache->maxunused = env ? atoi(env) : 1024;
+  if (cache->maxunused < 0) { cache->maxunused = 0; }
+
+  cache->match = m;
+  cache->create = c;
+  cache->finalize = f;
+
+  cache->retiredtables = cc_list_construct();
+  cache->retirednodes = cc_list_construct();
+  cache->retiredglyphs = cc_list_construct();
+  return cache;
+}
+
+void
+cc_glyph_cache_destruct(cc_glyph_cache * cache)
+{
+  unsigned int i;
+  cc_glyph_cache_table * t;
+
+  cc_glyph_prewarm_wait();
+
+  CC_MUTEX_LOCK(cache->mutex);
+  t = cache->table.load();
+  for (i = 0; i < t->size; i++) {
+    cc_glyph_cache_node * node = t->buckets[i].load();
+    for (; node; node = node->next.load()) {
+      cc_glyph * glyph = node->glyph;
+      /* Glyphs which are still referenced from the outside are left
+         alone, like they always have been. */
+      if (glyph->refcount.load() == (glyph->pinned ? 1 : 0)) {
+        glyph_cache_release(cache, glyph);
+        glyph_cache_free(glyph);
+      }
+    }
+  }
+  glyph_cache_table_destruct(t, TRUE);
+  glyph_cache_reclaim(cache);
+  CC_MUTEX_UNLOCK(cache->mutex);
+
+  cc_list_destruct(cache->retiredtables);
+  cc_list_destruct(cache->retirednodes);
+  cc_list_destruct(cache->retiredglyphs);
+  CC_MUTEX_DESTRUCT(cache->mutex);
+  delete cache;
+}
+
+cc_glyph *
+cc_glyph_cache_ref(cc_glyph_cache * cache, uint32_t character,
+                   const cc_font_specification * spec,
+                   float angle, uint32_t variant)
+{
+  cc_glyph * glyph;
+  const uint32_t hash = glyph_cache_hash(character, spec, variant);
+  std::atomic<int> & readers = cache->readers[hash % GLYPH_CACHE_READER_STRIPES].count;
+
+  readers.fetch_add(1);
+  glyph = glyph_cache_find(cache, hash, character, spec, angle);
+  readers.fetch_sub(1);
+  if (glyph) { return glyph; }
+
+  CC_MUTEX_LOCK(cache->mutex);
+
+  /* Evicted glyphs are unlinked while holding the mutex, so nothing
+     found here can be dead. */
+  glyph = glyph_cache_find(cache, hash, character, spec, angle);
+  if (glyph == NULL) {
+    cc_glyph_cache_table * t = cache->table.load();
+    cc_glyph_cache_node * node = new cc_glyph_cache_node;
+    std::atomic<cc_glyph_cache_node *> & bucket = t->buckets[hash & (t->size - 1)];
+
+    glyph = (*cache->create)(character, spec, angle);
+    new (&glyph->refcount) std::atomic<int>(1);
+    glyph->pinned = FALSE;
+
+    node->hash = hash;
+    node->glyph = glyph;
+    node->next.store(bucket.load(), std::memory_order_relaxed);
+    /* publishes the glyph to the readers */
+    bucket.store(node);
+
+    if (++cache->numglyphs > int(t->size * 2)) { glyph_cache_grow(cache); }
+  }
+
+  CC_MUTEX_UNLOCK(cache->mutex);
+  return glyph;
+}
+
+void 
+cc_glyph_unref(cc_glyph_cache * cache, cc_glyph * glyph)
+{
+  const int refcount = glyph->refcount.fetch_sub(1) - 1;
+  assert(refcount >= 0);
+  if (refcount > 0) { return; }
+
+  /* Unused glyphs stay in the cache until there are too many of
+     them. */
+  if (cache->numunused.fetch_add(1) + 1 > cache->maxunused) {
+    CC_MUTEX_LOCK(cache->mutex);
+    glyph_cache_evict(cache);
+    CC_MUTEX_UNLOCK(cache->mutex);
+  }
 }
 
 /* ********************************************************************** */
+
+struct cc_glyph_prewarm_request {
+  cc_glyph_cache * cache;
+  uint32_t * characters;
+  int num;
+  cc_font_specification spec;
+  float angle;
+  uint32_t variant;
+  std::atomic<int> numjobs;
+};
+
+struct cc_glyph_prewarm_job {
+  cc_glyph_prewarm_request * request;
+  int first;
+  int step;
+};
+
+static void
+glyph_prewarm_job(void * closure)
+{
+  int i;
+  cc_glyph_prewarm_job * job = (cc_glyph_prewarm_job *)closure;
+  cc_glyph_prewarm_request * req = job->request;
+
+  for (i = job->first; i < req->num; i += job->step) {
+    SbBool pinned;
+    cc_glyph * glyph = cc_glyph_cache_ref(req->cache, req->characters[i],
+                                          &req->spec, req->angle, req->variant);
+    /* keep the reference as the pin, unless already pinned */
+    CC_MUTEX_LOCK(req->cache->mutex);
+    pinned = glyph->pinned;
+    glyph->pinned = TRUE;
+    CC_MUTEX_UNLOCK(req->cache->mutex);
+    if (pinned) { cc_glyph_unref(req->cache, glyph); }
+  }
+
+  if (req->numjobs.fetch_sub(1) == 1) {
+    cc_fontspec_clean(&req->spec);
+    free(req->characters);
+    delete req;
+  }
+  delete job;
+}
+
+#ifdef HAVE_THREADS
+
+static cc_wpool * glyph_prewarmpool = NULL;
+
+static void
+glyph_prewarm_pool_cleanup(void)
+{
+  if (glyph_prewarmpool) cc_wpool_destruct(glyph_prewarmpool);
+  glyph_prewarmpool = NULL;
+}
+
+/* The number of threads used for pre-warming glyphs. Can be set with
+   the COIN_GLYPH_PREWARM_THREADS environment variable. 0 makes
+   pre-warming synchronous. */
+static int
+glyph_prewarm_num_threads(void)
+{
+  static int numthreads = -1;
+  if (numthreads < 0) {
+    const char * env = coin_getenv("COIN_GLYPH_PREWARM_THREADS");
+    numthreads = env ? atoi(env) : 2;
+    if (numthreads < 0) numthreads = 0;
+  }
+  return numthreads;
+}
+
+static cc_wpool *
+glyph_prewarm_pool(void)
+{
+  CC_GLOBAL_LOCK;
+  if (glyph_prewarmpool == NULL) {
+    glyph_prewarmpool = cc_wpool_construct(glyph_prewarm_num_threads());
+    coin_atexit((coin_atexit_f*) glyph_prewarm_pool_cleanup, CC_ATEXIT_NORMAL);
+  }
+  CC_GLOBAL_UNLOCK;
+  return glyph_prewarmpool;
+}
+
+#endif /* HAVE_THREADS */
+
+/*
+  Waits for all pending pre-warm requests to finish.
+*/
+void
+cc_glyph_prewarm_wait(void)
+{
+#ifdef HAVE_THREADS
+  if (glyph_prewarmpool) cc_wpool_wait_all(glyph_prewarmpool);
+#endif /* HAVE_THREADS */
+}
+
+/*
+  Generates the glyphs for the given characters, and pins them in the
+  cache, so that they are never evicted. The glyphs are generated in
+  worker threads, and the function returns before they are done. A
+  glyph which is looked up before it has been generated is simply
+  generated on demand.
+*/
+void
+cc_glyph_cache_prewarm(cc_glyph_cache * cache,
+                       const uint32_t * characters, int num,
+                       const cc_font_specification * spec,
+                       float angle, uint32_t variant)
+{
+  cc_glyph_prewarm_request * req;
+  cc_glyph_prewarm_job * job;
+
+  if (num <= 0) return;
+
+  req = new cc_glyph_prewarm_request;
+  req->cache = cache;
+  req->characters = (uint32_t *)malloc(sizeof(uint32_t) * num);
+  (void)memcpy(req->characters, characters, sizeof(uint32_t) * num);
+  req->num = num;
+  cc_fontspec_copy(spec, &req->spec);
+  req->angle = angle;
+  req->variant = variant;
+
+#ifdef HAVE_THREADS
+  int i, numjobs = glyph_prewarm_num_threads();
+  if (numjobs > num) numjobs = num;
+  if (numjobs > 0) {
+    cc_wpool * pool = glyph_prewarm_pool();
+    req->numjobs.store(numjobs);
+    cc_wpool_begin(pool, numjobs);
+    for (i = 0; i < numjobs; i++) {
+      job = new cc_glyph_prewarm_job;
+      job->request = req;
+      job->first = i;
+      job->step = numjobs;
+      cc_wpool_start_worker(pool, glyph_prewarm_job, job);
+    }
+    cc_wpool_end(pool);
+    return;
+  }
+#endif /* HAVE_THREADS */
+
+  /* no worker threads, do it right away */
+  req->numjobs.store(1);
+  job = new cc_glyph_prewarm_job;
+  job->request = req;
+  job->first = 0;
+  job->step = 1;
+  glyph_prewarm_job(job);
+}
+
+/* ********************************************************************** */
+
+#undef GLYPH_CACHE_READER_STRIPES
+#undef GLYPH_CACHE_INITIAL_SIZE
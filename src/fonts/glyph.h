@@ -46,7 +46,8 @@
 
 /* ********************************************************************** */
 
-#include "base/dict.h"
+#include <atomic>
+
 #include "fonts/fontspec.h"
 
 /* ********************************************************************** */
@@ -60,22 +61,62 @@ extern "C" {
 #endif
 
 struct cc_glyph {
-  int refcount;
+  /* Number of references. Modified without locking by the glyph
+     cache; -1 marks a glyph which has been evicted from the cache.
+     The glyph structs are malloc()'ed by the create functions, so
+     this is constructed and destructed by the cache itself. */
+  std::atomic<int> refcount;
 
   int glyphidx;
   uint32_t character;
 
   int fontidx;    
   cc_font_specification * fontspec;
+
+  /* Set when the glyph has been pinned by a pre-warm request. A
+     pinned glyph holds an extra reference until the cache dies. */
+  SbBool pinned;
 };
 
 typedef struct cc_glyph cc_glyph;
 
 /* ********************************************************************** */
 
-typedef void cc_glyph_finalize(cc_glyph *);
+/*
+  The glyph cache maps (character, font specification, angle) to
+  glyphs. Lookups of existing glyphs are lock-free. Only the creation
+  of new glyphs and the eviction of unused glyphs take the cache
+  mutex.
+*/
+
+typedef struct cc_glyph_cache cc_glyph_cache;
 
-void cc_glyph_unref(cc_dict * d, cc_glyph * g, cc_glyph_finalize * f);
+typedef void cc_glyph_finalize(cc_glyph *);
+typedef SbBool cc_glyph_match(const cc_glyph * g,
+                              const cc_font_specification * spec,
+                              float angle);
+typedef cc_glyph * cc_glyph_create(uint32_t character,
+                                   const cc_font_specification * spec,
+                                   float angle);
+
+cc_glyph_cache * cc_glyph_cache_construct(cc_glyph_match * m,
+                                          cc_glyph_create * c,
+                                          cc_glyph_finalize * f);
+void cc_glyph_cache_destruct(cc_glyph_cache * cache);
+
+/* "variant" is the part of the font specification, besides name and
+   style, that the match function compares (like a quantized size or
+   complexity). It is only used for hashing. */
+cc_glyph * cc_glyph_cache_ref(cc_glyph_cache * cache, uint32_t character,
+                              const cc_font_specification * spec,
+                              float angle, uint32_t variant);
+void cc_glyph_cache_prewarm(cc_glyph_cache * cache,
+                            const uint32_t * characters, int num,
+                            const cc_font_specification * spec,
+                            float angle, uint32_t variant);
+void cc_glyph_prewarm_wait(void);
+
+void cc_glyph_unref(cc_glyph_cache * cache, cc_glyph * g);
 
 /* ********************************************************************** */
 
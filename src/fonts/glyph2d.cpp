@@ -38,7 +38,6 @@
 
 #include <Inventor/C/base/string.h>
 
-#include "base/dict.h"
 #include "threads/threadsutilp.h"
 #include "tidbitsp.h"
 #include "fonts/glyph2d.h"
@@ -54,7 +53,7 @@ static SbBool glyph2d_specmatch(const cc_font_specification * spec1, const cc_fo
 struct cc_glyph2d {
   struct cc_glyph c; /* "c" for "common" glyph data (2d & 3d). */
 
-  float angle; /* FIXME: is this one really in use? 20060109 mortene. */
+  float angle; /* part of the cache key */
   unsigned short width; /* FIXME: is this one really in use? 20060109 mortene. */
 
   unsigned short height;
@@ -66,13 +65,13 @@ struct cc_glyph2d {
   SbBool mono;
 };
 
-static cc_dict * glyph2d_fonthash = NULL;
-static SbBool glyph2d_initialized = FALSE;
+static cc_glyph_cache * glyph2d_cache = NULL;
 
 /*
-  Mutex lock for the static ang global font hash
+  Mutex lock for setting up the glyph cache. The cache itself does
+  its own locking.
 */
-static void * glyph2d_fonthash_lock = NULL;
+static void * glyph2d_cache_lock = NULL;
 
 /* Set '#if 1' to enable debug output to stderr for tracking mutex locking. */
 #if 0
@@ -94,76 +93,27 @@ static void * glyph2d_fonthash_lock = NULL;
 static void
 cc_glyph2d_cleanup(void)
 {
-  CC_MUTEX_DESTRUCT(glyph2d_fonthash_lock);
-  cc_dict_destruct(glyph2d_fonthash);
-  glyph2d_fonthash = NULL;
-  glyph2d_initialized = FALSE;
+  cc_glyph_cache_destruct(glyph2d_cache);
+  glyph2d_cache = NULL;
+  CC_MUTEX_DESTRUCT(glyph2d_cache_lock);
 }
 
-static void
-cc_glyph2d_initialize()
+static SbBool
+glyph2d_match(const cc_glyph * g, const cc_font_specification * spec, float angle)
 {
-  CC_MUTEX_CONSTRUCT(glyph2d_fonthash_lock);
-  GLYPH2D_MUTEX_LOCK(glyph2d_fonthash_lock);
-  
-  if (glyph2d_initialized) {
-    GLYPH2D_MUTEX_UNLOCK(glyph2d_fonthash_lock);
-    return;
-  }
-  glyph2d_initialized = TRUE;
-  
-  glyph2d_fonthash = cc_dict_construct(15, 0.75);
-
-  /* +1, so it happens before the underlying font abstraction layer
-     cleans itself up: */
-  coin_atexit((coin_atexit_f*) cc_glyph2d_cleanup, CC_ATEXIT_FONT_SUBSYSTEM_HIGHPRIORITY);
-  
-  GLYPH2D_MUTEX_UNLOCK(glyph2d_fonthash_lock);
+  return glyph2d_specmatch(spec, g->fontspec) &&
+    (((const cc_glyph2d *)g)->angle == angle);
 }
 
-cc_glyph2d * 
-cc_glyph2d_ref(uint32_t character, const cc_font_specification * spec, float angle)
+static cc_glyph *
+glyph2d_create(uint32_t character, const cc_font_specification * spec, float angle)
 {
-  void * val;
   cc_glyph2d * glyph;
   int fontidx;
   int glyphidx;
-  int i;
   struct cc_font_bitmap * bm;
   cc_font_specification * newspec;
   cc_string * fonttoload;
-  cc_list * glyphlist;
-
-
-  /* because this function is the entry point for glyph2d, the mutex
-     is initialized here. */
-  if (glyph2d_fonthash_lock == NULL) 
-    cc_glyph2d_initialize();
-  
-  assert(spec);
-
-  GLYPH2D_MUTEX_LOCK(glyph2d_fonthash_lock);
-
-  /* Has the glyph been created before? */
-  if (cc_dict_get(glyph2d_fonthash, (uintptr_t)character, &val)) {
-    glyphlist = (cc_list *) val;
-    for (i = 0; i < cc_list_get_length(glyphlist); ++i) {
-      glyph = (cc_glyph2d *) cc_list_get(glyphlist, i);
-      if (glyph2d_specmatch(spec, glyph->c.fontspec)) {
-        GLYPH2D_MUTEX_UNLOCK(glyph2d_fonthash_lock);
-        glyph->c.refcount++;
-        return glyph;
-      }
-    }    
-  } 
-  else {
-    /* No glyphlist for this character is found. Create one and
-       add it to the hashtable. */
-    glyphlist = cc_list_construct();
-    cc_dict_put(glyph2d_fonthash, (uintptr_t)character, glyphlist);
-  }
-
-  assert(glyphlist);
 
   /* build a new glyph struct with bitmap */    
   glyph = (cc_glyph2d *) malloc(sizeof(cc_glyph2d));
@@ -228,19 +178,75 @@ cc_glyph2d_ref(uint32_t character, const cc_font_specification * spec, float ang
   glyph->bitmapoffsety = bm->bearingY;
   glyph->bitmap = bm->buffer;
   glyph->mono = bm->mono;
-  glyph->c.refcount = 1;
+
+  return &glyph->c;
+}
+
+static void
+cc_glyph2d_initialize()
+{
+  CC_MUTEX_CONSTRUCT(glyph2d_cache_lock);
+  GLYPH2D_MUTEX_LOCK(glyph2d_cache_lock);
+  
+  if (glyph2d_cache) {
+    GLYPH2D_MUTEX_UNLOCK(glyph2d_cache_lock);
+    return;
+  }
   
-  /* Store newly created glyph in the list for this character */
-  cc_list_append(glyphlist, glyph);
+  glyph2d_cache = cc_glyph_cache_construct(glyph2d_match, glyph2d_create, NULL);
+
+  /* +1, so it happens before the underlying font abstraction layer
+     cleans itself up: */
+  coin_atexit((coin_atexit_f*) cc_glyph2d_cleanup, CC_ATEXIT_FONT_SUBSYSTEM_HIGHPRIORITY);
   
-  GLYPH2D_MUTEX_UNLOCK(glyph2d_fonthash_lock);
-  return glyph;
+  GLYPH2D_MUTEX_UNLOCK(glyph2d_cache_lock);
+}
+
+/* The part of the key, besides font name and style, which is compared
+   by glyph2d_match(). */
+static uint32_t
+glyph2d_variant(const cc_font_specification * spec, float angle)
+{
+  uint32_t anglebits;
+  (void)memcpy(&anglebits, &angle, sizeof(uint32_t));
+  return uint32_t(int(spec->size)) ^ anglebits;
+}
+
+cc_glyph2d * 
+cc_glyph2d_ref(uint32_t character, const cc_font_specification * spec, float angle)
+{
+  /* because this function is the entry point for glyph2d, the cache
+     is initialized here. */
+  if (glyph2d_cache == NULL) 
+    cc_glyph2d_initialize();
+  
+  assert(spec);
+
+  return (cc_glyph2d *)cc_glyph_cache_ref(glyph2d_cache, character, spec, angle,
+                                          glyph2d_variant(spec, angle));
+}
+
+/*
+  Generates the glyphs for \a num characters ahead of time, in
+  worker threads, and keeps them cached.
+*/
+void
+cc_glyph2d_prewarm(const uint32_t * characters, int num,
+                   const cc_font_specification * spec, float angle)
+{
+  if (glyph2d_cache == NULL) 
+    cc_glyph2d_initialize();
+
+  assert(spec);
+
+  cc_glyph_cache_prewarm(glyph2d_cache, characters, num, spec, angle,
+                         glyph2d_variant(spec, angle));
 }
 
 void
 cc_glyph2d_unref(cc_glyph2d * glyph)
 {
-  cc_glyph_unref(glyph2d_fonthash, &(glyph->c), NULL);
+  cc_glyph_unref(glyph2d_cache, &(glyph->c));
 }
 
 static SbBool 
@@ -49,6 +49,8 @@ extern "C" {
 
   cc_glyph2d * cc_glyph2d_ref(uint32_t character, const cc_font_specification * spec, float angle);
   void cc_glyph2d_unref(cc_glyph2d * glyph);
+  void cc_glyph2d_prewarm(const uint32_t * characters, int num,
+                          const cc_font_specification * spec, float angle);
 
   void cc_glyph2d_getadvance(const cc_glyph2d * g, int * x, int * y);
   void cc_glyph2d_getkerning(const cc_glyph2d * left, const cc_glyph2d * right, int * x, int * y);
@@ -42,7 +42,6 @@
 #include <Inventor/C/base/string.h>
 
 #include "tidbitsp.h"
-#include "base/dict.h"
 #include "threads/threadsutilp.h"
 #include "fonts/fontlib_wrapper.h"
 #include "fonts/glyph.h"
@@ -70,13 +69,12 @@ struct cc_glyph3d {
 
 /* ********************************************************************** */
 
-static cc_dict * glyph3d_fonthash = NULL;
+static cc_glyph_cache * glyph3d_cache = NULL;
 static int glyph3d_spaceglyphindices[] = { -1, -1 };
 static float glyph3d_spaceglyphvertices[] = { 0, 0 };
-static SbBool glyph3d_initialized = FALSE;
-
-/* Mutex lock for the static ang global font hash */
-static void * glyph3d_fonthash_lock = NULL;
+/* Mutex lock for setting up the glyph cache. The cache itself does
+   its own locking. */
+static void * glyph3d_cache_lock = NULL;
 
 /* Because the 3D glyphs are normalized when generated, a standard
    fontsize is used for all glyphs. This also prevent Windows from
@@ -107,80 +105,32 @@ static unsigned int glyph3d_standardfontsize = 50;
 static void
 cc_glyph3d_cleanup(void)
 {
-  CC_MUTEX_DESTRUCT(glyph3d_fonthash_lock);
-  cc_dict_destruct(glyph3d_fonthash);
-  glyph3d_fonthash = NULL;
-  glyph3d_initialized = FALSE;
+  cc_glyph_cache_destruct(glyph3d_cache);
+  glyph3d_cache = NULL;
+  CC_MUTEX_DESTRUCT(glyph3d_cache_lock);
 }
 
-static void
-cc_glyph3d_initialize()
+static SbBool
+glyph3d_match(const cc_glyph * g, const cc_font_specification * spec,
+              float COIN_UNUSED_ARG(angle))
 {
-  CC_MUTEX_CONSTRUCT(glyph3d_fonthash_lock);
-  GLYPH3D_MUTEX_LOCK(glyph3d_fonthash_lock);
-  
-  if (glyph3d_initialized) {
-    GLYPH3D_MUTEX_UNLOCK(glyph3d_fonthash_lock);
-    return;
-  }
-  glyph3d_initialized = TRUE;
-  
-  glyph3d_fonthash = cc_dict_construct(15, 0.75);
-
-  /* +1, so it happens before the underlying font abstraction layer
-     cleans itself up: */
-  coin_atexit((coin_atexit_f*) cc_glyph3d_cleanup, CC_ATEXIT_FONT_SUBSYSTEM_HIGHPRIORITY);
-
-  GLYPH3D_MUTEX_UNLOCK(glyph3d_fonthash_lock);  
+  return glyph3d_specmatch(spec, g->fontspec);
 }
 
-cc_glyph3d *
-cc_glyph3d_ref(uint32_t character, const cc_font_specification * spec)
+static cc_glyph *
+glyph3d_create(uint32_t character, const cc_font_specification * spec,
+               float COIN_UNUSED_ARG(angle))
 {
   cc_glyph3d * glyph;
   int glyphidx;
   int fontidx;
-  void * val;
   cc_font_specification * newspec;
   cc_string * fonttoload;
-  cc_list * glyphlist = NULL;
-
-  /* because this function is the entry point for glyph3d, the mutex
-     is initialized here. */
-  if (glyph3d_fonthash_lock == NULL) 
-    cc_glyph3d_initialize();
-  
-  assert(spec);
-
-  GLYPH3D_MUTEX_LOCK(glyph3d_fonthash_lock);
-
-  /* Has the glyph been created before? */
-  if (cc_dict_get(glyph3d_fonthash, (uintptr_t)character, &val)) {
-    int i;
-    glyphlist = (cc_list *) val;
-    for (i=0;i<cc_list_get_length(glyphlist);++i) {
-      glyph = (cc_glyph3d *) cc_list_get(glyphlist, i);
-      if (glyph3d_specmatch(spec, glyph->c.fontspec)) {
-        GLYPH3D_MUTEX_UNLOCK(glyph3d_fonthash_lock);
-        glyph->c.refcount++;
-        return glyph;
-      }
-    }    
-  } else {
-    /* No glyphlist for this character is found. Create one and
-       add it to the hashtable. */
-    glyphlist = cc_list_construct();
-    cc_dict_put(glyph3d_fonthash, (uintptr_t)character, glyphlist);
-  }
-
-  assert(glyphlist);
 
   /* build a new glyph struct */
   glyph = (cc_glyph3d *) malloc(sizeof(cc_glyph3d));
 
   glyph->c.character = character;
-  glyph->c.refcount = 1;
-
 
   newspec = (cc_font_specification *) malloc(sizeof(cc_font_specification));
   assert(newspec);
@@ -246,11 +196,7 @@ cc_glyph3d_ref(uint32_t character, const cc_font_specification * spec)
   glyph3d_calcboundingbox(glyph);
   glyph->width = glyph->bbox[2] - glyph->bbox[0];
 
-  /* Store newly created glyph in the list for this character */
-  cc_list_append(glyphlist, glyph);
-
-  GLYPH3D_MUTEX_UNLOCK(glyph3d_fonthash_lock);
-  return glyph;
+  return &glyph->c;
 }
 
 static void
@@ -260,10 +206,73 @@ finalize_glyph3d(cc_glyph * g)
   if (g3d->didallocvectorglyph) { free(g3d->vectorglyph); }
 }
 
+static void
+cc_glyph3d_initialize()
+{
+  CC_MUTEX_CONSTRUCT(glyph3d_cache_lock);
+  GLYPH3D_MUTEX_LOCK(glyph3d_cache_lock);
+  
+  if (glyph3d_cache) {
+    GLYPH3D_MUTEX_UNLOCK(glyph3d_cache_lock);
+    return;
+  }
+  
+  glyph3d_cache = cc_glyph_cache_construct(glyph3d_match, glyph3d_create,
+                                           finalize_glyph3d);
+
+  /* +1, so it happens before the underlying font abstraction layer
+     cleans itself up: */
+  coin_atexit((coin_atexit_f*) cc_glyph3d_cleanup, CC_ATEXIT_FONT_SUBSYSTEM_HIGHPRIORITY);
+
+  GLYPH3D_MUTEX_UNLOCK(glyph3d_cache_lock);  
+}
+
+/* The part of the key, besides font name and style, which is compared
+   by glyph3d_specmatch(): the complexity at the same reduced precision. */
+static uint32_t
+glyph3d_variant(const cc_font_specification * spec)
+{
+  float c = spec->complexity;
+  if (c > 1.0f) c = 1.0f;
+  if (c < 0.0f) c = 0.0f;
+  return uint32_t(int(c * 10.0f));
+}
+
+cc_glyph3d *
+cc_glyph3d_ref(uint32_t character, const cc_font_specification * spec)
+{
+  /* because this function is the entry point for glyph3d, the cache
+     is initialized here. */
+  if (glyph3d_cache == NULL) 
+    cc_glyph3d_initialize();
+  
+  assert(spec);
+
+  return (cc_glyph3d *)cc_glyph_cache_ref(glyph3d_cache, character, spec, 0.0f,
+                                          glyph3d_variant(spec));
+}
+
+/*
+  Tessellates the glyphs for \a num characters ahead of time, in
+  worker threads, and keeps them cached.
+*/
+void
+cc_glyph3d_prewarm(const uint32_t * characters, int num,
+                   const cc_font_specification * spec)
+{
+  if (glyph3d_cache == NULL) 
+    cc_glyph3d_initialize();
+
+  assert(spec);
+
+  cc_glyph_cache_prewarm(glyph3d_cache, characters, num, spec, 0.0f,
+                         glyph3d_variant(spec));
+}
+
 void 
 cc_glyph3d_unref(cc_glyph3d * glyph)
 {
-  cc_glyph_unref(glyph3d_fonthash, &(glyph->c), finalize_glyph3d);
+  cc_glyph_unref(glyph3d_cache, &(glyph->c));
 }
 
 const float *
@@ -50,6 +50,8 @@ extern "C" {
   cc_glyph3d * cc_glyph3d_ref(uint32_t character,
                               const cc_font_specification * spec);
   void cc_glyph3d_unref(cc_glyph3d * glyph);
+  void cc_glyph3d_prewarm(const uint32_t * characters, int num,
+                          const cc_font_specification * spec);
 
   const float * cc_glyph3d_getcoords(const cc_glyph3d * g);
   const int * cc_glyph3d_getfaceindices(const cc_glyph3d * g);
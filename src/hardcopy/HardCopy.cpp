@@ -44,7 +44,16 @@
   camera).
 
   SoVectorizePSAction inherits SoVectorizeAction, and will output a
-  PostScript file.
+  PostScript file. SoVectorizeSVGAction and SoVectorizePDFAction
+  will output SVG and PDF files. The PDF backend supports Gouraud
+  shading natively, while the SVG backend draws Gouraud shaded
+  triangles using their average color.
+
+  Large drawings do not have to fit in memory. When the number of
+  sorted items exceeds a limit (262144 by default, set the
+  COIN_VECTORIZE_MAX_ITEMS environment variable to change it), the
+  items are sorted and written to a temporary file, and the sorted
+  runs are merged when the page is written.
 
   Texture-mapped polygons are not supported, since this is not
   supported by the vector file formats, at least it is not supported in
@@ -127,6 +136,8 @@
 #include <Inventor/annex/HardCopy/SoHardCopy.h>
 
 #include <Inventor/annex/HardCopy/SoVectorizePSAction.h>
+#include <Inventor/annex/HardCopy/SoVectorizeSVGAction.h>
+#include <Inventor/annex/HardCopy/SoVectorizePDFAction.h>
 
 #include "tidbitsp.h"
 
@@ -151,6 +162,8 @@ SoHardCopy::init(void)
 
   SoVectorizeAction::initClass();
   SoVectorizePSAction::initClass();
+  SoVectorizeSVGAction::initClass();
+  SoVectorizePDFAction::initClass();
 
   hardcopy_isinitialized = TRUE;
   coin_atexit((coin_atexit_f*)hardcopy_cleanup, CC_ATEXIT_NORMAL);
@@ -344,7 +344,7 @@ SoVectorizeAction::beginViewport(const SbVec2f & start, const SbVec2f & size,
 void
 SoVectorizeAction::endViewport(void)
 {
-  if (PRIVATE(this)->itemlist.getLength()) {
+  if (PRIVATE(this)->hasPendingItems()) {
     PRIVATE(this)->outputItems();
     PRIVATE(this)->reset();
   }
@@ -711,20 +711,41 @@ SoVectorizeAction::getLineJoinsStyle(void) const
 }
 
 /*!
-  Not implemented yet. Provided for TGS OIV compatibility.
+  Sets the hidden line/hidden surface removal mode. The default mode
+  is HLHSR_PAINTER.
+
+  NO_HLHSR outputs items in traversal order. HLHSR_SIMPLE_PAINTER and
+  HLHSR_PAINTER sort the items back to front (painter's
+  algorithm). HLHSR_PAINTER_SURFACE_REMOVAL also removes the triangles
+  that are completely hidden by other triangles before sorting, which
+  can make the output considerably smaller for dense scenes.
+  HIDDEN_LINES_REMOVAL in addition clips lines to their visible parts
+  and removes hidden points. Faces drawn with the LINES draw style
+  still hide the lines behind them in this mode, which gives classic
+  hidden line drawings.
+
+  Visibility is found by rasterizing the triangles into an SbIdBuffer
+  with 1024 pixels along the longest viewport side. The resolution
+  can be changed with the COIN_VECTORIZE_HLHSR_RESOLUTION environment
+  variable.
+
+  \sa SbIdBuffer
 */
 void
-SoVectorizeAction::setHLHSRMode(HLHSRMode COIN_UNUSED_ARG(mode))
+SoVectorizeAction::setHLHSRMode(HLHSRMode mode)
 {
+  PRIVATE(this)->hlhsrmode = mode;
 }
 
 /*!
-  Not implemented yet. Provided for TGS OIV compatibility.
+  Returns the hidden line/hidden surface removal mode.
+
+  \sa setHLHSRMode()
 */
 SoVectorizeAction::HLHSRMode
 SoVectorizeAction::getHLHSRMode(void) const
 {
-  return HLHSR_PAINTER;
+  return PRIVATE(this)->hlhsrmode;
 }
 
 /*!
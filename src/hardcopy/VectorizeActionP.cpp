@@ -64,8 +64,17 @@
 #include <Inventor/caches/SoBoundingBoxCache.h>
 #include <Inventor/elements/SoClipPlaneElement.h>
 #include <Inventor/SbClip.h>
+#include <Inventor/SbIdBuffer.h>
+#include <Inventor/C/tidbits.h> // coin_getenv()
 
+#include <Inventor/errors/SoDebugError.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 
 #define PUBLIC(obj) ((obj)->publ)
 
@@ -127,7 +136,14 @@ SoVectorizeActionP::SoVectorizeActionP(SoVectorizeAction * p)
   this->nominalwidth = 0.35f;
   this->pixelimagesize = 0.35f;
   this->pointstyle = SoVectorizeAction::CIRCLE;
+  this->hlhsrmode = SoVectorizeAction::HLHSR_PAINTER;
   this->annotationidx = 0;
+
+  this->hlhsrbuffer = NULL;
+  this->hlhsrnumids = 0;
+  this->spillfile = NULL;
+  this->didspill = FALSE;
+  this->nextspill = SoVectorizeActionP::getMaxItems();
 }
 
 //
@@ -161,7 +177,25 @@ SoVectorizeActionP::reset(void)
     delete this->annotationlist[i];
   }
   this->annotationlist.truncate(0);
+
+  for (i = 0; i < this->occluderlist.getLength(); i++) {
+    delete this->occluderlist[i];
+  }
+  this->occluderlist.truncate(0);
   this->bsp.clear();
+
+  delete this->hlhsrbuffer;
+  this->hlhsrbuffer = NULL;
+  this->hlhsrvisible.truncate(0);
+  this->hlhsrnumids = 0;
+
+  if (this->spillfile) {
+    fclose(this->spillfile); // removed automatically
+    this->spillfile = NULL;
+  }
+  this->spillruns.truncate(0);
+  this->didspill = FALSE;
+  this->nextspill = SoVectorizeActionP::getMaxItems();
 }
 
 //
@@ -189,10 +223,11 @@ SoVectorizeActionP::add_point(vertexdata * vd, SoState * state)
   
   SbVec3f v;
   this->shapeprojmatrix.multVecMatrix(vd->point, v);
-  v[2] = 0.0f;
 
   SbVec3f wv;
   SoVectorizePoint * point = new SoVectorizePoint;
+  point->z = v[2];
+  v[2] = 0.0f;
 
   SbColor4f c;
   c.setPackedValue(vd->diffuse);
@@ -239,20 +274,21 @@ SoVectorizeActionP::add_line(vertexdata * vd0, vertexdata * vd1, SoState * state
     }
   }
 
-  for (i = 0; i < 2; i++) {
-    this->shapeprojmatrix.multVecMatrix(vd[i]->point, v[i]);
-    v[i][2] = 0.0f;
-  }
-
+  SbVec3f pts[2] = { vd[0]->point, vd[1]->point };
   SbVec3f wv[2];
+  this->shapeprojmatrix.multVecMatrix(pts, v, 2);
+  this->shapetoworldmatrix.multVecMatrix(pts, wv, 2);
+
   SoVectorizeLine * line = new SoVectorizeLine;
+  line->z[0] = v[0][2];
+  line->z[1] = v[1][2];
+  v[0][2] = v[1][2] = 0.0f;
 
   float accdist = 0.0f;
   SbColor4f c;
 
   for (i = 0; i < 2; i++) {
     c.setPackedValue(vd[i]->diffuse);
-    this->shapetoworldmatrix.multVecMatrix(vd[i]->point, wv[i]);
     line->vidx[i] = this->bsp.addPoint(v[i]);
     if (dophong) {
       line->col[i] = this->shade_vertex(state, vd[i]->point,
@@ -329,6 +365,7 @@ SoVectorizeActionP::triangle_cb(void * userdata,
   // need to do some extra work when in line mode, since we don't want
   // to tessellate a polygon into triangles, but draw the polygon as
   // one line loop.
+  SbBool occluderonly = FALSE;
   if (thisp->drawstyle == SoDrawStyleElement::LINES) {
     const SoDetail * detail = v1->getDetail();
     // it's not required to have a detail instance per vertex, so
@@ -359,7 +396,12 @@ SoVectorizeActionP::triangle_cb(void * userdata,
       line_segment_cb(userdata, action, v3, v1);
       thisp->prevfaceindex = -1;
     }
-    return;
+    // when removing hidden lines, the faces must still hide the lines
+    // behind them even if they are not drawn themselves
+    if (thisp->hlhsrmode != SoVectorizeAction::HIDDEN_LINES_REMOVAL ||
+        thisp->annotationidx) return;
+    thisp->curr_vertexdata_index = 0;
+    occluderonly = TRUE;
   }
   if (thisp->drawstyle == SoDrawStyleElement::POINTS) {
     point_cb(userdata, action, v1);
@@ -399,13 +441,19 @@ SoVectorizeActionP::triangle_cb(void * userdata,
     }
   }
 
+  SbVec3f pts[9+8];
+  for (i = 0; i < n; i++) pts[i] = vd[i]->point;
+  thisp->shapetoworldmatrix.multVecMatrix(pts, wv, n);
+  thisp->shapeprojmatrix.multVecMatrix(pts, v, n);
+
   SbColor4f c;
+  float z[9+8];
   for (i = 0; i < n; i++) {
     c.setPackedValue(vd[i]->diffuse);
-    thisp->shapetoworldmatrix.multVecMatrix(vd[i]->point, wv[i]);
-    thisp->shapeprojmatrix.multVecMatrix(vd[i]->point, v[i]);
+    z[i] = v[i][2];
     v[i][2] = 0.0f;
 
+    if (occluderonly) continue;
     if (thisp->phong) {
       vd[i]->diffuse = thisp->shade_vertex(state, vd[i]->point,
                                            c,
@@ -431,16 +479,19 @@ SoVectorizeActionP::triangle_cb(void * userdata,
     SoVectorizeTriangle * tri = new SoVectorizeTriangle;
     float accdist = 0.0f;
     tri->vidx[0] = thisp->bsp.addPoint(v[0]);
+    tri->z[0] = z[0];
     tri->col[0] = vd[0]->diffuse;
     accdist += thisp->cameraplane.getDistance(wv[0]);
     
     for (int j = 1; j < 3; j++) {
       tri->vidx[j] = thisp->bsp.addPoint(v[i+j]);
+      tri->z[j] = z[i+j];
       tri->col[j] = vd[i+j]->diffuse;
       accdist += thisp->cameraplane.getDistance(wv[i+j]);
     }
     tri->depth = accdist / 3.0f;
-    thisp->addTriangle(tri);
+    if (occluderonly) thisp->occluderlist.append(tri);
+    else thisp->addTriangle(tri);
   }
 }
 
@@ -781,25 +832,40 @@ qsort_compare(const void * q0, const void * q1)
   return 1;
 }
 
-//
-// Will sort and output items (painter's algorithm). FIXME: implement
-// a better algorithm for hidden surface handling.
-//
+// id used for triangles that only hide lines, and are never output
+#define OCCLUDER_ID 0xffffffff
+
+// number of records read at a time from each spilled run
+#define RUN_BUFFER_SIZE 512
 
 extern "C" {
 typedef int qsort_cmp(const void *, const void *);
 }
 
+//
+// Will sort and output items (painter's algorithm). Hidden items are
+// removed first for the HLHSR_PAINTER_SURFACE_REMOVAL and
+// HIDDEN_LINES_REMOVAL modes. If items have been spilled to disk, the
+// sorted runs are merged while printing.
+//
 void
 SoVectorizeActionP::outputItems(void)
 {
-  int i, n = this->itemlist.getLength();
-  if (n) {
-    SoVectorizeItem ** ptr = (SoVectorizeItem**) this->itemlist.getArrayPtr();
-    qsort(ptr, n, sizeof(void*), (qsort_cmp *) qsort_compare);
-    
-    for (i = 0; i < n; i++) {
-      PUBLIC(this)->printItem(ptr[i]);
+  int i, n;
+  if (this->didspill && this->hlhsrmode != SoVectorizeAction::NO_HLHSR) {
+    this->mergeRuns();
+  }
+  else {
+    if (this->removeHidden()) this->removeHiddenItems();
+    n = this->itemlist.getLength();
+    if (n) {
+      SoVectorizeItem ** ptr = (SoVectorizeItem**) this->itemlist.getArrayPtr();
+      if (this->hlhsrmode != SoVectorizeAction::NO_HLHSR) {
+        qsort(ptr, n, sizeof(void*), (qsort_cmp *) qsort_compare);
+      }
+      for (i = 0; i < n; i++) {
+        PUBLIC(this)->printItem(ptr[i]);
+      }
     }
   }
   n = this->annotationlist.getLength();
@@ -811,6 +877,721 @@ SoVectorizeActionP::outputItems(void)
   }
 }
 
+//
+// Returns TRUE if there are items that have not been output yet.
+//
+SbBool
+SoVectorizeActionP::hasPendingItems(void) const
+{
+  return this->itemlist.getLength() || this->didspill;
+}
+
+//
+// Returns the maximum number of items kept in memory before they are
+// spilled to disk. The default is 262144, and can be changed with the
+// COIN_VECTORIZE_MAX_ITEMS environment variable.
+//
+int
+SoVectorizeActionP::getMaxItems(void)
+{
+  static int maxitems = -1;
+  if (maxitems < 0) {
+    const char * env = coin_getenv("COIN_VECTORIZE_MAX_ITEMS");
+    maxitems = env ? atoi(env) : 0;
+    if (maxitems <= 0) maxitems = 262144;
+    if (maxitems < 16) maxitems = 16;
+  }
+  return maxitems;
+}
+
+//
+// Spills items to disk if there are too many items in memory.
+//
+void
+SoVectorizeActionP::checkSpill(void)
+{
+  if (this->itemlist.getLength() >= this->nextspill) this->spillItems();
+}
+
+//
+// Moves all triangles, lines and points in itemlist out of
+// memory. With NO_HLHSR they are simply output in traversal order,
+// otherwise they are sorted on depth and written to a temporary file
+// as one run. Texts and images are few and are kept in memory.
+//
+void
+SoVectorizeActionP::spillItems(void)
+{
+  int i, j;
+  const int n = this->itemlist.getLength();
+  this->didspill = TRUE;
+
+  if (this->hlhsrmode == SoVectorizeAction::NO_HLHSR) {
+    for (i = 0; i < n; i++) {
+      PUBLIC(this)->printItem(this->itemlist[i]);
+      delete this->itemlist[i];
+    }
+    this->itemlist.truncate(0);
+    this->compactBSP();
+    this->nextspill = SoVectorizeActionP::getMaxItems();
+    return;
+  }
+
+  if (this->spillfile == NULL) {
+    this->spillfile = tmpfile();
+    if (this->spillfile == NULL) {
+      SoDebugError::postWarning("SoVectorizeActionP::spillItems",
+                                "Unable to create temporary file. All "
+                                "items will be kept in memory.");
+      this->didspill = this->spillruns.getLength() > 0;
+      this->nextspill = INT_MAX;
+      return;
+    }
+  }
+  const SbBool removehidden = this->removeHidden();
+  if (removehidden && this->hlhsrbuffer == NULL) this->hlhsrBegin();
+
+  SoVectorizeItem ** ptr = (SoVectorizeItem**) this->itemlist.getArrayPtr();
+  qsort(ptr, n, sizeof(void*), (qsort_cmp *) qsort_compare);
+
+  SpillRun run;
+  (void) sovectorize_fseek(this->spillfile, 0, SEEK_END);
+  run.offset = sovectorize_ftell(this->spillfile);
+  run.num = 0;
+
+  const SbVec3f * pts = this->bsp.getPointsArrayPtr();
+  SbList <SoVectorizeItem*> keep;
+  for (i = 0; i < n; i++) {
+    SoVectorizeItem * item = ptr[i];
+    SpillRecord rec;
+    memset(&rec, 0, sizeof(SpillRecord));
+    rec.type = item->type;
+    rec.depth = item->depth;
+    switch (item->type) {
+    case SoVectorizeItem::TRIANGLE:
+      {
+        SoVectorizeTriangle * tri = (SoVectorizeTriangle*) item;
+        for (j = 0; j < 3; j++) {
+          rec.x[j] = pts[tri->vidx[j]][0];
+          rec.y[j] = pts[tri->vidx[j]][1];
+          rec.z[j] = tri->z[j];
+          rec.col[j] = tri->col[j];
+        }
+        if (removehidden) {
+          rec.id = ++this->hlhsrnumids;
+          this->hlhsrAddTriangle(tri, rec.id);
+        }
+      }
+      break;
+    case SoVectorizeItem::LINE:
+      {
+        SoVectorizeLine * line = (SoVectorizeLine*) item;
+        for (j = 0; j < 2; j++) {
+          rec.x[j] = pts[line->vidx[j]][0];
+          rec.y[j] = pts[line->vidx[j]][1];
+          rec.z[j] = line->z[j];
+          rec.col[j] = line->col[j];
+        }
+        rec.size = line->width;
+        rec.pattern = line->pattern;
+      }
+      break;
+    case SoVectorizeItem::POINT:
+      {
+        SoVectorizePoint * point = (SoVectorizePoint*) item;
+        rec.x[0] = pts[point->vidx][0];
+        rec.y[0] = pts[point->vidx][1];
+        rec.z[0] = point->z;
+        rec.col[0] = point->col;
+        rec.size = point->size;
+      }
+      break;
+    default:
+      keep.append(item);
+      continue;
+    }
+    (void) fwrite(&rec, sizeof(SpillRecord), 1, this->spillfile);
+    delete item;
+    run.num++;
+  }
+  if (removehidden) this->hlhsrAddOccluders();
+  if (run.num) this->spillruns.append(run);
+
+  this->itemlist = keep;
+  this->compactBSP();
+  this->nextspill = this->itemlist.getLength() + SoVectorizeActionP::getMaxItems();
+}
+
+//
+// Rebuilds the BSP tree so that it only contains the points used by
+// the annotation items. All other items using the tree must have been
+// output or spilled.
+//
+void
+SoVectorizeActionP::compactBSP(void)
+{
+  int i, j;
+  const int n = this->annotationlist.getLength();
+  SbList <SbVec3f> pts;
+  for (i = 0; i < n; i++) {
+    SoVectorizeItem * item = this->annotationlist[i];
+    switch (item->type) {
+    case SoVectorizeItem::TRIANGLE:
+      for (j = 0; j < 3; j++) pts.append(this->bsp.getPoint(((SoVectorizeTriangle*)item)->vidx[j]));
+      break;
+    case SoVectorizeItem::LINE:
+      for (j = 0; j < 2; j++) pts.append(this->bsp.getPoint(((SoVectorizeLine*)item)->vidx[j]));
+      break;
+    case SoVectorizeItem::POINT:
+      pts.append(this->bsp.getPoint(((SoVectorizePoint*)item)->vidx));
+      break;
+    default:
+      break;
+    }
+  }
+  this->bsp.clear();
+
+  int idx = 0;
+  for (i = 0; i < n; i++) {
+    SoVectorizeItem * item = this->annotationlist[i];
+    switch (item->type) {
+    case SoVectorizeItem::TRIANGLE:
+      for (j = 0; j < 3; j++) ((SoVectorizeTriangle*)item)->vidx[j] = this->bsp.addPoint(pts[idx++]);
+      break;
+    case SoVectorizeItem::LINE:
+      for (j = 0; j < 2; j++) ((SoVectorizeLine*)item)->vidx[j] = this->bsp.addPoint(pts[idx++]);
+      break;
+    case SoVectorizeItem::POINT:
+      ((SoVectorizePoint*)item)->vidx = this->bsp.addPoint(pts[idx++]);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+//
+// Creates an item from a spilled record. The coordinates are added
+// to the BSP tree.
+//
+SoVectorizeItem *
+SoVectorizeActionP::createItem(const SpillRecord & rec)
+{
+  int i;
+  SoVectorizeItem * item = NULL;
+  switch (rec.type) {
+  case SoVectorizeItem::TRIANGLE:
+    {
+      SoVectorizeTriangle * tri = new SoVectorizeTriangle;
+      for (i = 0; i < 3; i++) {
+        tri->vidx[i] = this->bsp.addPoint(SbVec3f(rec.x[i], rec.y[i], 0.0f));
+        tri->z[i] = rec.z[i];
+        tri->col[i] = rec.col[i];
+      }
+      item = tri;
+    }
+    break;
+  case SoVectorizeItem::LINE:
+    {
+      SoVectorizeLine * line = new SoVectorizeLine;
+      for (i = 0; i < 2; i++) {
+        line->vidx[i] = this->bsp.addPoint(SbVec3f(rec.x[i], rec.y[i], 0.0f));
+        line->z[i] = rec.z[i];
+        line->col[i] = rec.col[i];
+      }
+      line->width = rec.size;
+      line->pattern = rec.pattern;
+      item = line;
+    }
+    break;
+  case SoVectorizeItem::POINT:
+    {
+      SoVectorizePoint * point = new SoVectorizePoint;
+      point->vidx = this->bsp.addPoint(SbVec3f(rec.x[0], rec.y[0], 0.0f));
+      point->z = rec.z[0];
+      point->col = rec.col[0];
+      point->size = rec.size;
+      item = point;
+    }
+    break;
+  default:
+    assert(0 && "unexpected item type");
+    return NULL;
+  }
+  item->depth = rec.depth;
+  return item;
+}
+
+namespace {
+
+  // the current item of one sorted source when merging
+  struct MergeHead {
+    float depth;
+    int source;
+  };
+
+  // makes std::push_heap() and std::pop_heap() build a min-heap
+  struct MergeHeadCompare {
+    bool operator()(const MergeHead & h0, const MergeHead & h1) const {
+      return h0.depth > h1.depth;
+    }
+  };
+
+} // namespace
+
+//
+// Merges the sorted runs on disk with the sorted texts and images in
+// memory, and prints the items in depth order. Only a few records
+// from each run are kept in memory at a time.
+//
+void
+SoVectorizeActionP::mergeRuns(void)
+{
+  int i;
+  this->spillItems(); // the last, partial run
+  const SbBool removehidden = this->removeHidden();
+  if (removehidden && this->hlhsrbuffer) this->hlhsrEnd();
+
+  const int nummem = this->itemlist.getLength();
+  SoVectorizeItem ** memitems = (SoVectorizeItem**) this->itemlist.getArrayPtr();
+  qsort(memitems, nummem, sizeof(void*), (qsort_cmp *) qsort_compare);
+
+  const int numruns = this->spillruns.getLength();
+  SpillRecord * buffers = new SpillRecord[numruns * RUN_BUFFER_SIZE + 1];
+  int * consumed = new int[numruns + 1]; // records read from each run
+  int * bufpos = new int[numruns + 1];
+  int * bufnum = new int[numruns + 1];
+
+  // heap with one entry per non-empty source. Source numruns is the
+  // list of texts and images in memory.
+  MergeHead * heap = new MergeHead[numruns + 1];
+  int heapsize = 0;
+
+  for (i = 0; i <= numruns; i++) {
+    consumed[i] = bufpos[i] = bufnum[i] = 0;
+    if (i < numruns) {
+      if (!this->fillRunBuffer(i, buffers + i * RUN_BUFFER_SIZE, consumed[i], bufnum[i])) continue;
+      heap[heapsize].depth = buffers[i * RUN_BUFFER_SIZE].depth;
+    }
+    else {
+      if (nummem == 0) continue;
+      heap[heapsize].depth = memitems[0]->depth;
+    }
+    heap[heapsize].source = i;
+    std::push_heap(heap, heap + ++heapsize, MergeHeadCompare());
+  }
+
+  const int maxbsp = SoVectorizeActionP::getMaxItems() * 3;
+  SbList <SoVectorizeItem*> visible;
+  while (heapsize > 0) {
+    std::pop_heap(heap, heap + heapsize--, MergeHeadCompare());
+    const int src = heap[heapsize].source;
+
+    if (src == numruns) {
+      PUBLIC(this)->printItem(memitems[bufpos[src]]);
+      if (++bufpos[src] < nummem) {
+        heap[heapsize].depth = memitems[bufpos[src]]->depth;
+        std::push_heap(heap, heap + ++heapsize, MergeHeadCompare());
+      }
+      continue;
+    }
+
+    SpillRecord * buf = buffers + src * RUN_BUFFER_SIZE;
+    const SpillRecord & rec = buf[bufpos[src]];
+    if (this->bsp.numPoints() > maxbsp) this->compactBSP();
+    SoVectorizeItem * item = this->createItem(rec);
+    if (removehidden) {
+      visible.truncate(0);
+      this->hlhsrFilter(item, rec.id, visible);
+      for (i = 0; i < visible.getLength(); i++) {
+        PUBLIC(this)->printItem(visible[i]);
+        delete visible[i];
+      }
+    }
+    else {
+      PUBLIC(this)->printItem(item);
+      delete item;
+    }
+
+    if (++bufpos[src] == bufnum[src]) {
+      bufpos[src] = 0;
+      if (!this->fillRunBuffer(src, buf, consumed[src], bufnum[src])) continue;
+    }
+    heap[heapsize].depth = buf[bufpos[src]].depth;
+    std::push_heap(heap, heap + ++heapsize, MergeHeadCompare());
+  }
+
+  delete[] heap;
+  delete[] bufnum;
+  delete[] bufpos;
+  delete[] consumed;
+  delete[] buffers;
+}
+
+//
+// Reads the next records of spilled run \a run into \a buffer. Returns
+// FALSE if the run is exhausted.
+//
+SbBool
+SoVectorizeActionP::fillRunBuffer(const int run, SpillRecord * buffer,
+                                  int & consumed, int & num)
+{
+  const SpillRun & r = this->spillruns[run];
+  num = SbMin(r.num - consumed, (int) RUN_BUFFER_SIZE);
+  if (num <= 0) return FALSE;
+  (void) sovectorize_fseek(this->spillfile,
+                           r.offset + SoVectorizeFileOffset(consumed) * SoVectorizeFileOffset(sizeof(SpillRecord)),
+                           SEEK_SET);
+  num = (int) fread(buffer, sizeof(SpillRecord), num, this->spillfile);
+  consumed += num;
+  return num > 0;
+}
+
+//
+// Returns the size of the id buffer used for hidden surface
+// removal. The longest side is 1024 pixels by default, and can be
+// changed with the COIN_VECTORIZE_HLHSR_RESOLUTION environment
+// variable.
+//
+static SbVec2s
+hlhsr_buffer_size(const SbVec2f & viewportsize)
+{
+  static int resolution = -1;
+  if (resolution < 0) {
+    const char * env = coin_getenv("COIN_VECTORIZE_HLHSR_RESOLUTION");
+    resolution = env ? atoi(env) : 0;
+    if (resolution <= 0) resolution = 1024;
+    if (resolution > 8192) resolution = 8192;
+  }
+  float w = SbMax(viewportsize[0], 1.0f);
+  float h = SbMax(viewportsize[1], 1.0f);
+  const float scale = float(resolution) / SbMax(w, h);
+  return SbVec2s(short(SbMax(int(w * scale), 16)),
+                 short(SbMax(int(h * scale), 16)));
+}
+
+//
+// Returns TRUE if depth z at pixel (x, y) is not behind the closest
+// surface in the id buffer. The farthest depth in the 3x3
+// neighbourhood is used so that edges lying on a surface (or on its
+// silhouette) are not hidden by the surface itself.
+//
+static SbBool
+hlhsr_is_visible(const SbIdBuffer & idbuffer, const int x, const int y, const float z)
+{
+  const SbVec2s & size = idbuffer.getSize();
+  const float * depth = idbuffer.getDepthBuffer();
+  float maxdepth = 0.0f;
+  for (int j = SbMax(y-1, 0); j <= SbMin(y+1, size[1]-1); j++) {
+    for (int i = SbMax(x-1, 0); i <= SbMin(x+1, size[0]-1); i++) {
+      maxdepth = SbMax(maxdepth, depth[j * size[0] + i]);
+    }
+  }
+  return z <= maxdepth + 1.0e-5f;
+}
+
+//
+// Returns TRUE if the triangle p, in id buffer pixel coordinates and
+// with depths z, passes the depth test at the center of any pixel it
+// strictly contains.
+//
+static SbBool
+hlhsr_surface_visible(const SbIdBuffer & idbuffer, const SbVec2f * p, const float * z)
+{
+  const SbVec2s & size = idbuffer.getSize();
+  const SbVec2f e1 = p[1] - p[0];
+  const SbVec2f e2 = p[2] - p[0];
+  const float area = e1[0] * e2[1] - e1[1] * e2[0];
+  if (area == 0.0f) return FALSE;
+  const float zmin = SbMin(z[0], SbMin(z[1], z[2]));
+  const float zmax = SbMax(z[0], SbMax(z[1], z[2]));
+
+  const float ymin = SbMin(p[0][1], SbMin(p[1][1], p[2][1]));
+  const float ymax = SbMax(p[0][1], SbMax(p[1][1], p[2][1]));
+  const int y0 = SbMax(int(floor(ymin - 0.5f)) + 1, 0);
+  const int y1 = SbMin(int(ceil(ymax - 0.5f)) - 1, int(size[1]) - 1);
+  for (int y = y0; y <= y1; y++) {
+    // the span of the triangle along the row through the pixel centers
+    const float yc = float(y) + 0.5f;
+    float xl = FLT_MAX, xr = -FLT_MAX;
+    for (int i = 0; i < 3; i++) {
+      const SbVec2f & a = p[i];
+      const SbVec2f & b = p[(i+1) % 3];
+      if ((a[1] < yc && b[1] > yc) || (a[1] > yc && b[1] < yc)) {
+        const float x = a[0] + (yc - a[1]) * (b[0] - a[0]) / (b[1] - a[1]);
+        xl = SbMin(xl, x);
+        xr = SbMax(xr, x);
+      }
+    }
+    if (!(xl < xr)) continue;
+    const int x0 = SbMax(int(floor(xl - 0.5f)) + 1, 0);
+    const int x1 = SbMin(int(ceil(xr - 0.5f)) - 1, int(size[0]) - 1);
+    for (int x = x0; x <= x1; x++) {
+      // the depth of the triangle plane at the pixel center
+      const SbVec2f c = SbVec2f(float(x) + 0.5f, yc) - p[0];
+      const float u = (c[0] * e2[1] - c[1] * e2[0]) / area;
+      const float v = (e1[0] * c[1] - e1[1] * c[0]) / area;
+      const float zc = SbClamp(z[0] + u * (z[1] - z[0]) + v * (z[2] - z[0]), zmin, zmax);
+      if (hlhsr_is_visible(idbuffer, x, y, zc)) return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+//
+// Returns TRUE if some part of the edges of the triangle p, in id
+// buffer pixel coordinates, is visible. Catches the triangles that
+// are only visible between the pixel centers.
+//
+static SbBool
+hlhsr_edges_visible(const SbIdBuffer & idbuffer, const SbVec2f * p, const float * z)
+{
+  for (int i = 0; i < 3; i++) {
+    const int j = (i+1) % 3;
+    const SbVec2f d = p[j] - p[i];
+    const int numsteps = SbMax(int(ceil(d.length())), 1);
+    for (int k = 0; k <= numsteps; k++) {
+      const float t = float(k) / float(numsteps);
+      const SbVec2f s = p[i] + d * t;
+      if (hlhsr_is_visible(idbuffer, int(floor(s[0])), int(floor(s[1])),
+                           z[i] + (z[j] - z[i]) * t)) return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+//
+// Returns TRUE if hidden items should be removed.
+//
+SbBool
+SoVectorizeActionP::removeHidden(void) const
+{
+  return
+    this->hlhsrmode == SoVectorizeAction::HLHSR_PAINTER_SURFACE_REMOVAL ||
+    this->hlhsrmode == SoVectorizeAction::HIDDEN_LINES_REMOVAL;
+}
+
+//
+// Creates an empty id buffer for hidden surface removal.
+//
+void
+SoVectorizeActionP::hlhsrBegin(void)
+{
+  delete this->hlhsrbuffer;
+  this->hlhsrbuffer = new SbIdBuffer;
+  this->hlhsrbuffer->setSize(hlhsr_buffer_size(this->viewport.size));
+  this->hlhsrvisible.truncate(0);
+  this->hlhsrnumids = 0;
+}
+
+//
+// Rasterizes a triangle into the id buffer.
+//
+void
+SoVectorizeActionP::hlhsrAddTriangle(const SoVectorizeTriangle * tri, const uint32_t id)
+{
+  // item coordinates are in [0, 1], the id buffer needs clip coordinates
+  static const SbMatrix toclip(2.0f, 0.0f, 0.0f, 0.0f,
+                               0.0f, 2.0f, 0.0f, 0.0f,
+                               0.0f, 0.0f, 2.0f, 0.0f,
+                               -1.0f, -1.0f, -1.0f, 1.0f);
+  SbVec3f v[3];
+  for (int i = 0; i < 3; i++) {
+    v[i] = this->bsp.getPoint(tri->vidx[i]);
+    v[i][2] = tri->z[i];
+  }
+  this->hlhsrbuffer->addTriangle(v[0], v[1], v[2], toclip, id);
+}
+
+//
+// Rasterizes and deletes the triangles that only hide lines.
+//
+void
+SoVectorizeActionP::hlhsrAddOccluders(void)
+{
+  for (int i = 0; i < this->occluderlist.getLength(); i++) {
+    this->hlhsrAddTriangle(this->occluderlist[i], OCCLUDER_ID);
+    delete this->occluderlist[i];
+  }
+  this->occluderlist.truncate(0);
+  // rasterize now, so that the pending primitives are freed
+  (void) this->hlhsrbuffer->getIdBuffer();
+}
+
+//
+// Finds the ids of all triangles that are visible in at least one
+// pixel.
+//
+void
+SoVectorizeActionP::hlhsrEnd(void)
+{
+  int i;
+  const int numwords = int(this->hlhsrnumids / 32) + 1;
+  this->hlhsrvisible.truncate(0);
+  for (i = 0; i < numwords; i++) this->hlhsrvisible.append(0);
+
+  const SbVec2s & size = this->hlhsrbuffer->getSize();
+  const uint32_t * ids = this->hlhsrbuffer->getIdBuffer();
+  const int numpixels = int(size[0]) * int(size[1]);
+  for (i = 0; i < numpixels; i++) {
+    const uint32_t id = ids[i];
+    if (id && id <= this->hlhsrnumids) this->hlhsrvisible[int(id >> 5)] |= 1 << (id & 31);
+  }
+}
+
+//
+// Appends the visible parts of \a item to \a result, and deletes
+// \a item if it's not appended. \a id is the id the item was
+// rasterized with, if it's a triangle.
+//
+void
+SoVectorizeActionP::hlhsrFilter(SoVectorizeItem * item, const uint32_t id,
+                                SbList <SoVectorizeItem*> & result)
+{
+  int j;
+  const SbIdBuffer & idbuffer = *this->hlhsrbuffer;
+  const SbVec2s & size = idbuffer.getSize();
+  const SbBool removelines =
+    this->hlhsrmode == SoVectorizeAction::HIDDEN_LINES_REMOVAL;
+
+  SbBool visible = TRUE;
+  switch (item->type) {
+  case SoVectorizeItem::TRIANGLE:
+    visible = (this->hlhsrvisible[int(id >> 5)] & (1 << (id & 31))) != 0;
+    if (!visible) {
+      // a triangle can be missing from the id buffer and still be
+      // visible. Thin triangles might not cover any pixel center, and
+      // a surface drawn later at the same depth wins the pixel centers
+      // a triangle shares with it. Keep the triangle if it passes the
+      // depth test at any pixel center it covers, or along its edges.
+      SoVectorizeTriangle * tri = (SoVectorizeTriangle*) item;
+      SbVec2f p[3];
+      for (j = 0; j < 3; j++) {
+        const SbVec3f pt = this->bsp.getPoint(tri->vidx[j]);
+        p[j].setValue(pt[0] * size[0], pt[1] * size[1]);
+      }
+      visible =
+        hlhsr_surface_visible(idbuffer, p, tri->z) ||
+        hlhsr_edges_visible(idbuffer, p, tri->z);
+    }
+    break;
+  case SoVectorizeItem::LINE:
+    if (removelines) {
+      this->splitVisibleLine((SoVectorizeLine*) item, idbuffer, result);
+      return;
+    }
+    break;
+  case SoVectorizeItem::POINT:
+    if (removelines) {
+      SoVectorizePoint * point = (SoVectorizePoint*) item;
+      const SbVec3f pt = this->bsp.getPoint(point->vidx);
+      visible = hlhsr_is_visible(idbuffer, int(pt[0] * size[0]), int(pt[1] * size[1]), point->z);
+    }
+    break;
+  default:
+    break;
+  }
+  if (visible) result.append(item);
+  else delete item;
+}
+
+//
+// Rasterizes all triangles into an id buffer and removes the
+// triangles that are not visible in any pixel. In
+// HIDDEN_LINES_REMOVAL mode, lines are split into their visible
+// segments and hidden points are removed as well.
+//
+void
+SoVectorizeActionP::removeHiddenItems(void)
+{
+  int i;
+  const int n = this->itemlist.getLength();
+  if (n == 0) return;
+
+  this->hlhsrBegin();
+  SbBool hastriangles = this->occluderlist.getLength() > 0;
+  for (i = 0; i < n; i++) {
+    SoVectorizeItem * item = this->itemlist[i];
+    if (item->type != SoVectorizeItem::TRIANGLE) continue;
+    this->hlhsrAddTriangle((SoVectorizeTriangle*) item, uint32_t(i+1));
+    hastriangles = TRUE;
+  }
+  this->hlhsrAddOccluders();
+  if (hastriangles) {
+    this->hlhsrnumids = uint32_t(n);
+    this->hlhsrEnd();
+
+    SbList <SoVectorizeItem*> result(n);
+    for (i = 0; i < n; i++) {
+      this->hlhsrFilter(this->itemlist[i], uint32_t(i+1), result);
+    }
+    this->itemlist = result;
+  }
+  delete this->hlhsrbuffer;
+  this->hlhsrbuffer = NULL;
+}
+
+//
+// Samples the line once per pixel, and replaces it by its visible
+// segments in \a result. The line is kept unchanged if it's visible
+// everywhere.
+//
+void
+SoVectorizeActionP::splitVisibleLine(SoVectorizeLine * line,
+                                     const SbIdBuffer & idbuffer,
+                                     SbList <SoVectorizeItem*> & result)
+{
+  const SbVec2s & size = idbuffer.getSize();
+  const SbVec3f p0 = this->bsp.getPoint(line->vidx[0]);
+  const SbVec3f p1 = this->bsp.getPoint(line->vidx[1]);
+  const SbVec2f s0(p0[0] * size[0], p0[1] * size[1]);
+  const SbVec2f s1(p1[0] * size[0], p1[1] * size[1]);
+  const int numsteps = SbMax(int(ceil((s1 - s0).length())), 1);
+
+  // the visible segments, as [start, end] sample index pairs
+  SbList <int> segments;
+  int start = -1;
+  for (int i = 0; i <= numsteps; i++) {
+    const float t = float(i) / float(numsteps);
+    const SbVec2f s = s0 + (s1 - s0) * t;
+    const float z = line->z[0] + (line->z[1] - line->z[0]) * t;
+    if (hlhsr_is_visible(idbuffer, int(s[0]), int(s[1]), z)) {
+      if (start < 0) start = i;
+    }
+    else if (start >= 0) {
+      segments.append(start);
+      segments.append(i-1);
+      start = -1;
+    }
+  }
+  if (start == 0) { // completely visible
+    result.append(line);
+    return;
+  }
+  if (start > 0) {
+    segments.append(start);
+    segments.append(numsteps);
+  }
+
+  SbColor4f c0, c1;
+  c0.setPackedValue(line->col[0]);
+  c1.setPackedValue(line->col[1]);
+  for (int i = 0; i < segments.getLength(); i += 2) {
+    if (segments[i] == segments[i+1]) continue; // a single sample
+    SoVectorizeLine * part = new SoVectorizeLine(*line);
+    for (int j = 0; j < 2; j++) {
+      const float t = float(segments[i+j]) / float(numsteps);
+      SbVec3f p = p0 + (p1 - p0) * t;
+      p[2] = 0.0f;
+      part->vidx[j] = this->bsp.addPoint(p);
+      part->z[j] = line->z[0] + (line->z[1] - line->z[0]) * t;
+      part->col[j] = (c0 + (c1 - c0) * t).getPackedValue();
+    }
+    result.append(part);
+  }
+  delete line;
+}
+
 //
 // The OpenGL shading model
 //
@@ -951,6 +1732,7 @@ SoVectorizeActionP::addTriangle(SoVectorizeTriangle * tri)
   }
   else {
     this->itemlist.append(tri);
+    this->checkSpill();
   }
 }
 
@@ -960,14 +1742,15 @@ SoVectorizeActionP::addTriangle(SoVectorizeTriangle * tri)
 void 
 SoVectorizeActionP::addLine(SoVectorizeLine * line)
 {
+  line->width = this->linewidth;
+  line->pattern = this->linepattern;
   if (this->annotationidx) {
     this->annotationlist.append(line);
   }
   else {
     this->itemlist.append(line);
+    this->checkSpill();
   }
-  line->width = this->linewidth;
-  line->pattern = this->linepattern;
 }
 
 //
@@ -976,13 +1759,14 @@ SoVectorizeActionP::addLine(SoVectorizeLine * line)
 void 
 SoVectorizeActionP::addPoint(SoVectorizePoint * point)
 {
+  point->size = this->pointsize;
   if (this->annotationidx) {
     this->annotationlist.append(point);
   }
   else {
     this->itemlist.append(point);
+    this->checkSpill();
   }
-  point->size = this->pointsize;
 }
 
 //
@@ -47,7 +47,37 @@
 #include <Inventor/SbImage.h>
 #include "VectorizeItems.h"
 
+#include <cstdio>
+#ifndef _WIN32
+#include <sys/types.h> // off_t
+#endif // !_WIN32
+
+// 64 bit file offsets, since vectorized output and the item spill
+// file can get larger than 2 GB, and long is 32 bits on Windows.
+typedef int64_t SoVectorizeFileOffset;
+
+static inline SoVectorizeFileOffset
+sovectorize_ftell(FILE * fp)
+{
+#ifdef _WIN32
+  return SoVectorizeFileOffset(_ftelli64(fp));
+#else // !_WIN32
+  return SoVectorizeFileOffset(ftello(fp));
+#endif // !_WIN32
+}
+
+static inline int
+sovectorize_fseek(FILE * fp, const SoVectorizeFileOffset offset, const int whence)
+{
+#ifdef _WIN32
+  return _fseeki64(fp, __int64(offset), whence);
+#else // !_WIN32
+  return fseeko(fp, off_t(offset), whence);
+#endif // !_WIN32
+}
+
 class SbClip;
+class SbIdBuffer;
 class SoPointDetail;
 
 class SoVectorizeActionP {
@@ -84,6 +114,7 @@ public:
   float nominalwidth;
   float pixelimagesize;
   SoVectorizeAction::PointStyle pointstyle;
+  SoVectorizeAction::HLHSRMode hlhsrmode;
 
   SbBool testInside(SoState * state,
                     const SbVec3f & p0, 
@@ -98,6 +129,7 @@ public:
   void addImage(SoVectorizeImage * image);
   
   void outputItems(void);
+  SbBool hasPendingItems(void) const;
   void reset(void);
 
 private:
@@ -109,6 +141,9 @@ private:
   } vertexdata;
 
   SbList <vertexdata*> vertexdatalist;
+  // triangles that are not output, but that hide lines in
+  // HIDDEN_LINES_REMOVAL mode (faces drawn as lines)
+  SbList <SoVectorizeTriangle*> occluderlist;
   int curr_vertexdata_index;
   vertexdata * alloc_vertexdata(void);
   vertexdata * create_vertexdata(const SoPrimitiveVertex * pv, SoState * state);
@@ -118,6 +153,50 @@ private:
   
   SbBool clip_line(vertexdata * v0, vertexdata * v1, const SbPlane & plane);
 
+  // hidden surface removal
+  SbIdBuffer * hlhsrbuffer;
+  SbList <uint32_t> hlhsrvisible; // one bit per triangle id
+  uint32_t hlhsrnumids;
+
+  SbBool removeHidden(void) const;
+  void hlhsrBegin(void);
+  void hlhsrAddTriangle(const SoVectorizeTriangle * tri, const uint32_t id);
+  void hlhsrAddOccluders(void);
+  void hlhsrEnd(void);
+  void hlhsrFilter(SoVectorizeItem * item, const uint32_t id,
+                   SbList <SoVectorizeItem*> & result);
+  void removeHiddenItems(void);
+  void splitVisibleLine(SoVectorizeLine * line, const SbIdBuffer & idbuffer,
+                        SbList <SoVectorizeItem*> & result);
+
+  // to keep memory usage bounded, items are sorted and spilled to a
+  // temporary file in runs, which are merged when output
+  struct SpillRecord {
+    float depth;
+    uint32_t id;       // hidden surface removal id for triangles
+    int type;
+    uint32_t col[3];
+    float x[3], y[3], z[3];
+    float size;        // line width or point size
+    uint16_t pattern;  // line pattern
+  };
+  struct SpillRun {
+    SoVectorizeFileOffset offset; // file offset of the first record
+    int num;           // number of records
+  };
+  FILE * spillfile;
+  SbList <SpillRun> spillruns;
+  SbBool didspill;
+  int nextspill;
+
+  static int getMaxItems(void);
+  void checkSpill(void);
+  void spillItems(void);
+  void compactBSP(void);
+  SoVectorizeItem * createItem(const SpillRecord & rec);
+  void mergeRuns(void);
+  SbBool fillRunBuffer(const int run, SpillRecord * buffer, int & consumed, int & num);
+
   struct ShapeMaterial {
     SbColor ambient_light_model;
     SbColor ambient;
@@ -67,6 +67,7 @@ public:
     this->size = 1.0f;
   }
   int vidx;       // index to BSPtree coordinate
+  float z;        // normalized depth, for hidden surface removal
   float size;     // Coin size (pixels)
   uint32_t col;
 };
@@ -77,6 +78,7 @@ public:
     this->type = TRIANGLE;
   }
   int vidx[3];      // indices to BSPtree coordinates
+  float z[3];       // normalized depths, for hidden surface removal
   uint32_t col[3];
 };
 
@@ -88,6 +90,7 @@ public:
     this->width = 1.0f;
   }
   int vidx[2];       // indices to BSPtree coordinates
+  float z[2];        // normalized depths, for hidden surface removal
   uint32_t col[2];
   uint16_t pattern;  // Coin line pattern
   float width;       // Coin line width (pixels)
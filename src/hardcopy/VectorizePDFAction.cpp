@@ -0,0 +1,1075 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoVectorizePDFAction SoVectorizePDFAction.h Inventor/annex/HardCopy/SoVectorizePDFAction.h
+  \brief The SoVectorizePDFAction class is used for rendering to a PDF file.
+
+  \ingroup coin_hardcopy
+
+  Each page is written as a single page PDF document. The page
+  contents are written in chunks of a few hundred kilobytes as the
+  items are printed, so the memory used by the output backend does
+  not depend on the size of the drawing. The content streams are
+  compressed if zlib is available.
+
+  Consecutive triangles with the same color are filled as one path,
+  and the fill and stroke colors are only set when they change.
+  Gouraud shaded triangles are written as free-form triangle mesh
+  shadings, where consecutive Gouraud shaded triangles share one
+  shading resource.
+
+  The standard 14 PDF fonts are used for text, which means that text
+  will be drawn using a substitute font if the font name is not one
+  of them. The width of centered and right justified text is
+  approximated using the Courier metrics.
+
+  \since Coin 4.0
+*/
+
+#include <Inventor/annex/HardCopy/SoVectorizePDFAction.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbBSPTree.h>
+#include <Inventor/SbColor.h>
+
+#include "hardcopy/VectorizeActionP.h"
+#include "glue/zlib.h"
+#include "actions/SoSubActionP.h"
+
+// *************************************************************************
+
+/* stuff copied from the zlib.h header file (we want to avoid
+   including it here so that zlib is not required to compile Coin) */
+struct internal_state;
+typedef void * (*alloc_func)(void * opaque, unsigned int items, unsigned int size);
+typedef void   (*free_func)(void * opaque, void * address);
+
+#define Z_DEFAULT_COMPRESSION  (-1)
+#define Z_DEFAULT_STRATEGY 0
+#define Z_OK 0
+#define Z_STREAM_END    1
+#define Z_FINISH        4
+#define Z_DEFLATED   8
+#define MAX_WBITS   15 /* 32K LZ77 window */
+
+/* This zlib struct should never change */
+typedef struct {
+  unsigned char * next_in;  /* next input byte */
+  unsigned int avail_in;  /* number of bytes available at next_in */
+  unsigned long total_in;  /* total nb of input bytes read so far */
+
+  unsigned char * next_out; /* next output byte should be put there */
+  unsigned int avail_out; /* remaining free space at next_out */
+  unsigned long total_out; /* total nb of bytes output so far */
+
+  char * msg;      /* last error message, NULL if no error */
+  struct internal_state * state; /* not visible by applications */
+
+  alloc_func zalloc;  /* used to allocate the internal state */
+  free_func  zfree;   /* used to free the internal state */
+  void * opaque;  /* private data object passed to zalloc and zfree */
+
+  int data_type;  /* best guess about the data type: ascii or binary */
+  unsigned long adler;      /* adler32 value of the uncompressed data */
+  unsigned long reserved;   /* reserved for future use */
+} z_stream;
+
+// *************************************************************************
+
+namespace {
+
+  // a simple growable byte buffer
+  class PDFBuffer {
+  public:
+    PDFBuffer(void) {
+      this->data = NULL;
+      this->len = 0;
+      this->cap = 0;
+    }
+    ~PDFBuffer() {
+      free(this->data);
+    }
+    void reserve(const size_t size) {
+      if (size <= this->cap) return;
+      this->cap = SbMax(size, this->cap * 2);
+      this->data = (unsigned char *) realloc(this->data, this->cap);
+    }
+    void append(const void * src, const size_t n) {
+      this->reserve(this->len + n);
+      memcpy(this->data + this->len, src, n);
+      this->len += n;
+    }
+    void append(const unsigned char c) {
+      if (this->len == this->cap) this->reserve(this->len + 1);
+      this->data[this->len++] = c;
+    }
+    void printf(const char * fmt, ...) {
+      char buf[512];
+      va_list args;
+      va_start(args, fmt);
+      int n = coin_vsnprintf(buf, sizeof(buf), fmt, args);
+      va_end(args);
+      if (n < 0 || n >= int(sizeof(buf))) n = int(strlen(buf));
+      this->append(buf, size_t(n));
+    }
+
+    unsigned char * data;
+    size_t len;
+    size_t cap;
+  };
+
+} // namespace
+
+class SoVectorizePDFActionP {
+public:
+  SoVectorizePDFActionP(SoVectorizePDFAction * p) {
+    this->publ = p;
+    this->default2dfont = "Courier";
+    this->gouraudeps = 0.01;
+    this->compressed = TRUE;
+    this->zlibchecked = FALSE;
+    this->landscape = FALSE;
+    this->viewportopen = FALSE;
+    this->numshadingtris = 0;
+    this->resetState();
+  }
+
+  enum {
+    // content is written to the file in chunks of this size
+    CONTENT_CHUNK_SIZE = 256 * 1024,
+    // max number of triangles in one shading
+    SHADING_MAX_TRIANGLES = 16384
+  };
+
+  enum PathType {
+    NO_PATH,
+    FILL_PATH,
+    STROKE_PATH
+  };
+
+  FILE * getFile(void) const;
+  SbVec2f convertToPDF(const SbVec2f & mm) const;
+  float convertToPDF(const float mm) const;
+  SbVec2f toPage(const SbVec3f & v) const;
+
+  int newObject(void);
+  void beginObject(const int num);
+  void writeStream(const int num, const SbString & dict,
+                   const unsigned char * data, const size_t len);
+  SbBool useCompression(void);
+
+  void flushContent(void);
+  void checkContent(void);
+  void resetState(void);
+  void setFillColor(const uint32_t col);
+  void setStrokeColor(const uint32_t col);
+  void beginPath(const PathType type, const uint32_t color,
+                 const float width = 0.0f, const uint16_t pattern = 0xffff);
+  void endPath(void);
+  void flushShading(void);
+
+  int getFont(const SbString & fontname);
+
+  void printTriangle(const SoVectorizeTriangle * item);
+  void printLine(const SoVectorizeLine * item);
+  void printPoint(const SoVectorizePoint * item);
+  void printText(const SoVectorizeText * item);
+  void printImage(const SoVectorizeImage * item);
+
+  SbString default2dfont;
+  double gouraudeps;
+  SbBool compressed;
+  SbBool zlibchecked;
+  SbBool zlibavailable;
+
+  SbList <SoVectorizeFileOffset> objoffsets; // file offset of each object
+  SbList <int> contentobjs;
+  SbList <int> shadingobjs;
+  SbList <int> imageobjs;
+  SbList <int> fontobjs;
+  SbList <SbString> fontnames;
+
+  PDFBuffer content;
+  PDFBuffer shading;
+  int numshadingtris;
+  float shadingrange;
+
+  // graphics state
+  PathType pathtype;
+  SbBool hasfillcolor;
+  uint32_t fillcolor;
+  SbBool hasstrokecolor;
+  uint32_t strokecolor;
+  float linewidth;
+  uint16_t linepattern;
+
+  SbVec2f paper;
+  SbBool landscape;
+  SbBool viewportopen;
+
+private:
+  SoVectorizePDFAction * publ;
+};
+
+#define PRIVATE(p) (p->pimpl)
+#define PUBLIC(p) (p->publ)
+
+// catalog, page tree and page objects, written at the end of the page
+#define PDF_CATALOG_OBJ 1
+#define PDF_PAGES_OBJ 2
+#define PDF_PAGE_OBJ 3
+
+// *************************************************************************
+
+SO_ACTION_SOURCE(SoVectorizePDFAction);
+
+// *************************************************************************
+
+/*!
+  \copydetails SoAction::initClass(void)
+*/
+void
+SoVectorizePDFAction::initClass(void)
+{
+  SO_ACTION_INTERNAL_INIT_CLASS(SoVectorizePDFAction, SoVectorizeAction);
+}
+
+/*!
+  Default constructor.
+*/
+SoVectorizePDFAction::SoVectorizePDFAction(void)
+{
+  PRIVATE(this) = new SoVectorizePDFActionP(this);
+  SO_ACTION_CONSTRUCTOR(SoVectorizePDFAction);
+
+  this->setOutput(new SoVectorOutput);
+}
+
+/*!
+  Default destructor.
+*/
+SoVectorizePDFAction::~SoVectorizePDFAction()
+{
+  delete PRIVATE(this);
+}
+
+// *************************************************************************
+
+/*!
+  Sets the default font name. This font will be used for rendering
+  Text2-nodes which have no Font-nodes preceding them. The default
+  value is "Courier".
+*/
+void
+SoVectorizePDFAction::setDefault2DFont(const SbString & fontname)
+{
+  PRIVATE(this)->default2dfont = fontname;
+}
+
+/*!
+  Returns the default font name.
+
+  \sa setDefault2DFont()
+*/
+const SbString &
+SoVectorizePDFAction::getDefault2DFont(void) const
+{
+  return PRIVATE(this)->default2dfont;
+}
+
+/*!
+  Sets the Gouraud shading threshold. Triangles with vertex colors
+  that differ more than \a eps in any color component are Gouraud
+  shaded, the others are drawn using their average color. A threshold
+  of 0.0 will disable Gouraud shading. Default is 0.01.
+*/
+void
+SoVectorizePDFAction::setGouraudThreshold(const double eps)
+{
+  PRIVATE(this)->gouraudeps = eps;
+}
+
+/*!
+  Sets whether the content streams should be compressed. Compression
+  requires zlib, and is ignored if zlib is not available. Default is
+  \c TRUE.
+*/
+void
+SoVectorizePDFAction::setCompressed(const SbBool onoff)
+{
+  PRIVATE(this)->compressed = onoff;
+}
+
+/*!
+  Returns whether the content streams are compressed.
+
+  \sa setCompressed()
+*/
+SbBool
+SoVectorizePDFAction::isCompressed(void) const
+{
+  return PRIVATE(this)->compressed;
+}
+
+// *************************************************************************
+
+// doc in parent
+void
+SoVectorizePDFAction::printHeader(void) const
+{
+  FILE * file = PRIVATE(this)->getFile();
+
+  PRIVATE(this)->objoffsets.truncate(0);
+  PRIVATE(this)->contentobjs.truncate(0);
+  PRIVATE(this)->shadingobjs.truncate(0);
+  PRIVATE(this)->imageobjs.truncate(0);
+  PRIVATE(this)->fontobjs.truncate(0);
+  PRIVATE(this)->fontnames.truncate(0);
+  PRIVATE(this)->content.len = 0;
+  PRIVATE(this)->shading.len = 0;
+  PRIVATE(this)->numshadingtris = 0;
+  PRIVATE(this)->viewportopen = FALSE;
+  PRIVATE(this)->resetState();
+
+  // reserve the objects written in printFooter()
+  (void) PRIVATE(this)->newObject();
+  (void) PRIVATE(this)->newObject();
+  (void) PRIVATE(this)->newObject();
+
+  fputs("%PDF-1.4\n", file);
+  fputs("%\xe2\xe3\xcf\xd3\n", file); // mark the file as binary
+
+  const SbVec2f start = PRIVATE(this)->convertToPDF(this->getPageStartpos());
+  const SbVec2f size = PRIVATE(this)->convertToPDF(this->getPageSize());
+  PRIVATE(this)->paper = size + start * 2.0f;
+  PRIVATE(this)->shadingrange = SbMax(PRIVATE(this)->paper[0], PRIVATE(this)->paper[1]) * 2.0f;
+
+  PDFBuffer & out = PRIVATE(this)->content;
+  out.printf("q\n");
+  PRIVATE(this)->landscape = this->getOrientation() == LANDSCAPE;
+  if (PRIVATE(this)->landscape) {
+    const SbVec2f halfsize = size * 0.5f;
+    out.printf("1 0 0 1 %g %g cm\n", start[0] + halfsize[0], start[1] + halfsize[1]);
+    out.printf("0 1 -1 0 0 0 cm\n");
+    out.printf("1 0 0 1 %g %g cm\n", -(halfsize[1] + start[1]), -(halfsize[0] + start[0]));
+  }
+}
+
+// doc in parent
+void
+SoVectorizePDFAction::printFooter(void) const
+{
+  int i;
+  FILE * file = PRIVATE(this)->getFile();
+
+  PRIVATE(this)->endPath();
+  PRIVATE(this)->flushShading();
+  if (PRIVATE(this)->viewportopen) PRIVATE(this)->content.printf("Q\n");
+  PRIVATE(this)->content.printf("Q\n");
+  PRIVATE(this)->viewportopen = FALSE;
+  PRIVATE(this)->flushContent();
+
+  PRIVATE(this)->beginObject(PDF_PAGE_OBJ);
+  fprintf(file, "<< /Type /Page /Parent %d 0 R /MediaBox [0 0 %g %g]\n",
+          PDF_PAGES_OBJ, PRIVATE(this)->paper[0], PRIVATE(this)->paper[1]);
+  fputs("/Contents [", file);
+  for (i = 0; i < PRIVATE(this)->contentobjs.getLength(); i++) {
+    fprintf(file, "%s%d 0 R", (i % 8) ? " " : "\n", PRIVATE(this)->contentobjs[i]);
+  }
+  fputs("]\n/Resources << /ProcSet [/PDF /Text /ImageB /ImageC]\n", file);
+  if (PRIVATE(this)->fontobjs.getLength()) {
+    fputs("/Font <<", file);
+    for (i = 0; i < PRIVATE(this)->fontobjs.getLength(); i++) {
+      fprintf(file, " /F%d %d 0 R", i, PRIVATE(this)->fontobjs[i]);
+    }
+    fputs(" >>\n", file);
+  }
+  if (PRIVATE(this)->imageobjs.getLength()) {
+    fputs("/XObject <<", file);
+    for (i = 0; i < PRIVATE(this)->imageobjs.getLength(); i++) {
+      fprintf(file, " /Im%d %d 0 R", i, PRIVATE(this)->imageobjs[i]);
+    }
+    fputs(" >>\n", file);
+  }
+  if (PRIVATE(this)->shadingobjs.getLength()) {
+    fputs("/Shading <<", file);
+    for (i = 0; i < PRIVATE(this)->shadingobjs.getLength(); i++) {
+      fprintf(file, "%s/Sh%d %d 0 R", (i % 8) ? " " : "\n", i, PRIVATE(this)->shadingobjs[i]);
+    }
+    fputs(" >>\n", file);
+  }
+  fputs(">>\n>>\nendobj\n", file);
+
+  PRIVATE(this)->beginObject(PDF_PAGES_OBJ);
+  fprintf(file, "<< /Type /Pages /Kids [%d 0 R] /Count 1 >>\nendobj\n", PDF_PAGE_OBJ);
+
+  PRIVATE(this)->beginObject(PDF_CATALOG_OBJ);
+  fprintf(file, "<< /Type /Catalog /Pages %d 0 R >>\nendobj\n", PDF_PAGES_OBJ);
+
+  const SoVectorizeFileOffset xref = sovectorize_ftell(file);
+  const int numobjs = PRIVATE(this)->objoffsets.getLength();
+  fprintf(file, "xref\n0 %d\n", numobjs + 1);
+  fputs("0000000000 65535 f \n", file);
+  for (i = 0; i < numobjs; i++) {
+    fprintf(file, "%010lld 00000 n \n", (long long) PRIVATE(this)->objoffsets[i]);
+  }
+  fprintf(file, "trailer\n<< /Size %d /Root %d 0 R >>\n", numobjs + 1, PDF_CATALOG_OBJ);
+  fprintf(file, "startxref\n%lld\n%%%%EOF\n", (long long) xref);
+}
+
+// doc in parent
+void
+SoVectorizePDFAction::printViewport(void) const
+{
+  PRIVATE(this)->endPath();
+  PRIVATE(this)->flushShading();
+
+  const SbVec2f start = PRIVATE(this)->convertToPDF(this->getRotatedViewportStartpos());
+  const SbVec2f size = PRIVATE(this)->convertToPDF(this->getRotatedViewportSize());
+
+  PDFBuffer & out = PRIVATE(this)->content;
+  if (PRIVATE(this)->viewportopen) out.printf("Q\n");
+  out.printf("q\n%g %g %g %g re W n\n", start[0], start[1], size[0], size[1]);
+  PRIVATE(this)->viewportopen = TRUE;
+  PRIVATE(this)->resetState();
+}
+
+// doc in parent
+void
+SoVectorizePDFAction::printBackground(void) const
+{
+  SbColor bgcol;
+  (void) this->getBackgroundColor(bgcol);
+  const SbVec2f start = PRIVATE(this)->convertToPDF(this->getRotatedViewportStartpos());
+  const SbVec2f size = PRIVATE(this)->convertToPDF(this->getRotatedViewportSize());
+
+  PRIVATE(this)->endPath();
+  PRIVATE(this)->flushShading();
+  PRIVATE(this)->setFillColor(bgcol.getPackedValue());
+  PRIVATE(this)->content.printf("%g %g %g %g re f\n", start[0], start[1], size[0], size[1]);
+}
+
+// doc in parent
+void
+SoVectorizePDFAction::printItem(const SoVectorizeItem * item) const
+{
+  if (item->type != SoVectorizeItem::TRIANGLE) PRIVATE(this)->flushShading();
+
+  switch (item->type) {
+  case SoVectorizeItem::TRIANGLE:
+    PRIVATE(this)->printTriangle((SoVectorizeTriangle*)item);
+    break;
+  case SoVectorizeItem::LINE:
+    PRIVATE(this)->printLine((SoVectorizeLine*)item);
+    break;
+  case SoVectorizeItem::POINT:
+    PRIVATE(this)->printPoint((SoVectorizePoint*)item);
+    break;
+  case SoVectorizeItem::TEXT:
+    PRIVATE(this)->printText((SoVectorizeText*)item);
+    break;
+  case SoVectorizeItem::IMAGE:
+    PRIVATE(this)->printImage((SoVectorizeImage*)item);
+    break;
+  default:
+    assert(0 && "unsupported item");
+    break;
+  }
+  PRIVATE(this)->checkContent();
+}
+
+// *************************************************************************
+
+FILE *
+SoVectorizePDFActionP::getFile(void) const
+{
+  return PUBLIC(this)->getOutput()->getFilePointer();
+}
+
+// a PDF unit is 1/72 inch
+SbVec2f
+SoVectorizePDFActionP::convertToPDF(const SbVec2f & mm) const
+{
+  return from_mm(mm, SoVectorizeAction::INCH) * 72.0f;
+}
+
+// a PDF unit is 1/72 inch
+float
+SoVectorizePDFActionP::convertToPDF(const float mm) const
+{
+  return from_mm(mm, SoVectorizeAction::INCH) * 72.0f;
+}
+
+//
+// converts from normalized viewport coordinates to page coordinates
+//
+SbVec2f
+SoVectorizePDFActionP::toPage(const SbVec3f & v) const
+{
+  const SbVec2f size = this->convertToPDF(PUBLIC(this)->getRotatedViewportSize());
+  const SbVec2f start = this->convertToPDF(PUBLIC(this)->getRotatedViewportStartpos());
+  return SbVec2f(v[0] * size[0] + start[0], v[1] * size[1] + start[1]);
+}
+
+//
+// Allocates a new object number.
+//
+int
+SoVectorizePDFActionP::newObject(void)
+{
+  this->objoffsets.append(0);
+  return this->objoffsets.getLength();
+}
+
+//
+// Starts writing object \a num.
+//
+void
+SoVectorizePDFActionP::beginObject(const int num)
+{
+  FILE * file = this->getFile();
+  this->objoffsets[num-1] = sovectorize_ftell(file);
+  fprintf(file, "%d 0 obj\n", num);
+}
+
+//
+// Returns TRUE if streams should be compressed.
+//
+SbBool
+SoVectorizePDFActionP::useCompression(void)
+{
+  if (!this->compressed) return FALSE;
+  if (!this->zlibchecked) {
+    this->zlibavailable = cc_zlibglue_available();
+    this->zlibchecked = TRUE;
+  }
+  return this->zlibavailable;
+}
+
+//
+// Writes object \a num as a stream object, with the extra dictionary
+// entries in \a dict.
+//
+void
+SoVectorizePDFActionP::writeStream(const int num, const SbString & dict,
+                                   const unsigned char * data, const size_t len)
+{
+  FILE * file = this->getFile();
+  PDFBuffer deflated;
+  SbBool deflate = len > 0 && this->useCompression();
+  if (deflate) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    deflate = cc_zlibglue_deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                                       MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    if (deflate) {
+      stream.next_in = (unsigned char *) data;
+      stream.avail_in = (unsigned int) len;
+      int ret;
+      do {
+        deflated.reserve(deflated.len + len / 2 + 1024);
+        stream.next_out = deflated.data + deflated.len;
+        stream.avail_out = (unsigned int) (deflated.cap - deflated.len);
+        ret = cc_zlibglue_deflate(&stream, Z_FINISH);
+        deflated.len = deflated.cap - stream.avail_out;
+      } while (ret == Z_OK);
+      (void) cc_zlibglue_deflateEnd(&stream);
+      deflate = ret == Z_STREAM_END;
+    }
+  }
+
+  this->beginObject(num);
+  fprintf(file, "<< %s%s/Length %lu %s>>\nstream\n",
+          dict.getString(), dict.getLength() ? " " : "",
+          (unsigned long) (deflate ? deflated.len : len),
+          deflate ? "/Filter /FlateDecode " : "");
+  if (deflate) fwrite(deflated.data, 1, deflated.len, file);
+  else if (len) fwrite(data, 1, len, file);
+  fputs("\nendstream\nendobj\n", file);
+}
+
+//
+// Writes the buffered page content as a content stream object.
+//
+void
+SoVectorizePDFActionP::flushContent(void)
+{
+  if (this->content.len == 0) return;
+  const int num = this->newObject();
+  this->writeStream(num, SbString(""), this->content.data, this->content.len);
+  this->contentobjs.append(num);
+  this->content.len = 0;
+}
+
+//
+// Writes the content buffer to file if it's full. Content streams
+// are concatenated by the viewer, so the page can be split anywhere
+// between two operators.
+//
+void
+SoVectorizePDFActionP::checkContent(void)
+{
+  if (this->content.len >= CONTENT_CHUNK_SIZE) this->flushContent();
+}
+
+//
+// Forgets the graphics state, for instance after a Q operator.
+//
+void
+SoVectorizePDFActionP::resetState(void)
+{
+  this->pathtype = NO_PATH;
+  this->hasfillcolor = FALSE;
+  this->fillcolor = 0;
+  this->hasstrokecolor = FALSE;
+  this->strokecolor = 0;
+  this->linewidth = 1.0f;
+  this->linepattern = 0xffff;
+}
+
+static void
+print_rgb(PDFBuffer & out, const uint32_t col, const char * op)
+{
+  out.printf("%.3g %.3g %.3g %s\n",
+             ((col >> 24) & 0xff) / 255.0f,
+             ((col >> 16) & 0xff) / 255.0f,
+             ((col >> 8) & 0xff) / 255.0f, op);
+}
+
+void
+SoVectorizePDFActionP::setFillColor(const uint32_t col)
+{
+  const uint32_t rgb = col & 0xffffff00;
+  if (this->hasfillcolor && rgb == this->fillcolor) return;
+  print_rgb(this->content, rgb, "rg");
+  this->fillcolor = rgb;
+  this->hasfillcolor = TRUE;
+}
+
+void
+SoVectorizePDFActionP::setStrokeColor(const uint32_t col)
+{
+  const uint32_t rgb = col & 0xffffff00;
+  if (this->hasstrokecolor && rgb == this->strokecolor) return;
+  print_rgb(this->content, rgb, "RG");
+  this->strokecolor = rgb;
+  this->hasstrokecolor = TRUE;
+}
+
+//
+// Starts a new path, unless the current one has the same attributes.
+//
+void
+SoVectorizePDFActionP::beginPath(const PathType type, const uint32_t color,
+                                 const float width, const uint16_t pattern)
+{
+  const uint32_t rgb = color & 0xffffff00;
+  if (type == this->pathtype) {
+    if (type == FILL_PATH && rgb == this->fillcolor) return;
+    if (type == STROKE_PATH && rgb == this->strokecolor &&
+        width == this->linewidth && pattern == this->linepattern) return;
+  }
+  this->endPath();
+  this->flushShading();
+
+  if (type == FILL_PATH) {
+    this->setFillColor(rgb);
+  }
+  else {
+    this->setStrokeColor(rgb);
+    if (width != this->linewidth) {
+      this->content.printf("%g w\n", this->convertToPDF(width * PUBLIC(this)->getNominalWidth()));
+      this->linewidth = width;
+    }
+    if (pattern != this->linepattern) {
+      // runs of on and off bits, starting with the most significant bit
+      const float unit = this->convertToPDF(PUBLIC(this)->getNominalWidth());
+      this->content.printf("[");
+      if (pattern != 0xffff) {
+        int bit = 15, numruns = 0;
+        SbBool on = TRUE;
+        while (bit >= 0) {
+          int len = 0;
+          while (bit >= 0 && (((pattern >> bit) & 1) != 0) == on) { len++; bit--; }
+          this->content.printf("%s%g", numruns ? " " : "", len * unit);
+          numruns++;
+          on = !on;
+        }
+        if (numruns & 1) this->content.printf(" 0"); // need pairs of values
+      }
+      this->content.printf("] 0 d\n");
+      this->linepattern = pattern;
+    }
+  }
+  this->pathtype = type;
+}
+
+//
+// Paints the current path.
+//
+void
+SoVectorizePDFActionP::endPath(void)
+{
+  switch (this->pathtype) {
+  case FILL_PATH: this->content.printf("f\n"); break;
+  case STROKE_PATH: this->content.printf("S\n"); break;
+  default: break;
+  }
+  this->pathtype = NO_PATH;
+}
+
+//
+// Writes the pending Gouraud shaded triangles as a free-form triangle
+// mesh shading, and paints it.
+//
+void
+SoVectorizePDFActionP::flushShading(void)
+{
+  if (this->numshadingtris == 0) return;
+
+  const int num = this->newObject();
+  SbString dict;
+  dict.sprintf("/ShadingType 4 /ColorSpace /DeviceRGB /BitsPerCoordinate 32 "
+               "/BitsPerComponent 8 /BitsPerFlag 8 /Decode [%g %g %g %g 0 1 0 1 0 1]",
+               -this->shadingrange, this->shadingrange,
+               -this->shadingrange, this->shadingrange);
+  this->writeStream(num, dict, this->shading.data, this->shading.len);
+  this->content.printf("/Sh%d sh\n", this->shadingobjs.getLength());
+  this->shadingobjs.append(num);
+
+  this->shading.len = 0;
+  this->numshadingtris = 0;
+}
+
+//
+// Returns the index of the font resource for \a fontname.
+//
+int
+SoVectorizePDFActionP::getFont(const SbString & fontname)
+{
+  int i;
+  for (i = 0; i < this->fontnames.getLength(); i++) {
+    if (this->fontnames[i] == fontname) return i;
+  }
+  // font names can't contain white space or delimiters
+  SbString name;
+  const char * str = fontname.getString();
+  for (i = 0; str[i]; i++) {
+    const unsigned char c = (unsigned char) str[i];
+    if (c <= 32 || c >= 127 || strchr("#()<>[]{}/%", c)) {
+      SbString hex;
+      hex.sprintf("#%02x", c);
+      name += hex;
+    }
+    else {
+      name += char(c);
+    }
+  }
+  FILE * file = this->getFile();
+  const int num = this->newObject();
+  this->beginObject(num);
+  fprintf(file, "<< /Type /Font /Subtype /Type1 /BaseFont /%s /Encoding /WinAnsiEncoding >>\nendobj\n",
+          name.getString());
+  this->fontnames.append(fontname);
+  this->fontobjs.append(num);
+  return this->fontobjs.getLength() - 1;
+}
+
+void
+SoVectorizePDFActionP::printTriangle(const SoVectorizeTriangle * item)
+{
+  int i;
+  const SbBSPTree & bsp = PUBLIC(this)->getBSPTree();
+  SbVec2f v[3];
+  for (i = 0; i < 3; i++) v[i] = this->toPage(bsp.getPoint(item->vidx[i]));
+  if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2]) return;
+
+  SbColor c[3];
+  float t;
+  for (i = 0; i < 3; i++) c[i].setPackedValue(item->col[i], t);
+
+  SbBool flatshade = this->gouraudeps == 0.0;
+  if (!flatshade) {
+    float maxdiff = 0.0f;
+    for (i = 0; i < 3; i++) {
+      maxdiff = SbMax(maxdiff, float(fabs(c[0][i] - c[1][i])));
+      maxdiff = SbMax(maxdiff, float(fabs(c[0][i] - c[2][i])));
+      maxdiff = SbMax(maxdiff, float(fabs(c[1][i] - c[2][i])));
+    }
+    flatshade = maxdiff <= this->gouraudeps;
+  }
+
+  if (flatshade) {
+    const SbColor avg = (c[0] + c[1] + c[2]) / 3.0f;
+    this->beginPath(FILL_PATH, avg.getPackedValue());
+    this->content.printf("%g %g m %g %g l %g %g l h\n",
+                         v[0][0], v[0][1], v[1][0], v[1][1], v[2][0], v[2][1]);
+    return;
+  }
+
+  this->endPath();
+  const double scale = 4294967295.0 / (2.0 * this->shadingrange);
+  for (i = 0; i < 3; i++) {
+    this->shading.append(0); // edge flag, a new triangle
+    for (int j = 0; j < 2; j++) {
+      double d = (double(v[i][j]) + this->shadingrange) * scale;
+      d = SbClamp(d, 0.0, 4294967295.0);
+      const uint32_t val = uint32_t(d);
+      for (int k = 3; k >= 0; k--) this->shading.append((unsigned char) ((val >> (k * 8)) & 0xff));
+    }
+    for (int j = 0; j < 3; j++) {
+      this->shading.append((unsigned char) (SbClamp(c[i][j], 0.0f, 1.0f) * 255.0f + 0.5f));
+    }
+  }
+  if (++this->numshadingtris >= SHADING_MAX_TRIANGLES) this->flushShading();
+}
+
+void
+SoVectorizePDFActionP::printLine(const SoVectorizeLine * item)
+{
+  const SbBSPTree & bsp = PUBLIC(this)->getBSPTree();
+  const SbVec2f v0 = this->toPage(bsp.getPoint(item->vidx[0]));
+  const SbVec2f v1 = this->toPage(bsp.getPoint(item->vidx[1]));
+
+  this->beginPath(STROKE_PATH, item->col[0], item->width, item->pattern);
+  this->content.printf("%g %g m %g %g l\n", v0[0], v0[1], v1[0], v1[1]);
+}
+
+void
+SoVectorizePDFActionP::printPoint(const SoVectorizePoint * item)
+{
+  const SbVec2f v = this->toPage(PUBLIC(this)->getBSPTree().getPoint(item->vidx));
+  const float size = this->convertToPDF(item->size * PUBLIC(this)->getNominalWidth());
+  const float r = size * 0.5f;
+
+  this->beginPath(FILL_PATH, item->col);
+  switch (PUBLIC(this)->getPointStyle()) {
+  default:
+    assert(0 && "unknown point style");
+  case SoVectorizeAction::CIRCLE:
+    {
+      // four Bezier curves
+      const float k = r * 0.5523f;
+      const float x = v[0], y = v[1];
+      this->content.printf("%g %g m %g %g %g %g %g %g c %g %g %g %g %g %g c "
+                           "%g %g %g %g %g %g c %g %g %g %g %g %g c h\n",
+                           x + r, y,
+                           x + r, y + k, x + k, y + r, x, y + r,
+                           x - k, y + r, x - r, y + k, x - r, y,
+                           x - r, y - k, x - k, y - r, x, y - r,
+                           x + k, y - r, x + r, y - k, x + r, y);
+    }
+    break;
+  case SoVectorizeAction::SQUARE:
+    this->content.printf("%g %g %g %g re\n", v[0] - r, v[1] - r, size, size);
+    break;
+  }
+}
+
+void
+SoVectorizePDFActionP::printText(const SoVectorizeText * item)
+{
+  const SbVec2f size = this->convertToPDF(PUBLIC(this)->getRotatedViewportSize());
+  SbVec2f pos = this->toPage(SbVec3f(item->pos[0], item->pos[1], 0.0f));
+  const float fontsize = item->fontsize * size[1];
+
+  SbString fontname = item->fontname.getString();
+  if (fontname == "defaultFont") fontname = this->default2dfont;
+
+  // approximate the string width using the Courier metrics
+  const float width = 0.6f * fontsize * item->string.getLength();
+  switch (item->justification) {
+  default:
+  case SoVectorizeText::LEFT: break;
+  case SoVectorizeText::CENTER: pos[0] -= width * 0.5f; break;
+  case SoVectorizeText::RIGHT: pos[0] -= width; break;
+  }
+
+  this->endPath();
+  const int font = this->getFont(fontname);
+  this->setFillColor(item->col);
+  PDFBuffer & out = this->content;
+  out.printf("BT /F%d %g Tf %g %g Td (", font, fontsize, pos[0], pos[1]);
+  for (const char * str = item->string.getString(); *str; str++) {
+    if (*str == '(' || *str == ')' || *str == '\\') out.append((unsigned char) '\\');
+    out.append((unsigned char) *str);
+  }
+  out.printf(") Tj ET\n");
+}
+
+void
+SoVectorizePDFActionP::printImage(const SoVectorizeImage * item)
+{
+  const SbVec2f vpsize = this->convertToPDF(PUBLIC(this)->getRotatedViewportSize());
+  const SbVec2f pos = this->toPage(SbVec3f(item->pos[0], item->pos[1], 0.0f));
+
+  const int w = item->image.size[0];
+  const int h = item->image.size[1];
+  const int nc = item->image.nc;
+  const int outnc = nc >= 3 ? 3 : 1;
+
+  // PDF images are stored from the top row
+  PDFBuffer data;
+  data.reserve(size_t(w) * size_t(h) * outnc);
+  for (int y = h - 1; y >= 0; y--) {
+    const unsigned char * row = item->image.data + size_t(y) * w * nc;
+    for (int x = 0; x < w; x++) {
+      data.append(row + x * nc, outnc);
+    }
+  }
+
+  const int num = this->newObject();
+  SbString dict;
+  dict.sprintf("/Type /XObject /Subtype /Image /Width %d /Height %d "
+               "/ColorSpace /%s /BitsPerComponent 8",
+               w, h, outnc == 3 ? "DeviceRGB" : "DeviceGray");
+  this->writeStream(num, dict, data.data, data.len);
+
+  this->endPath();
+  this->content.printf("q %g 0 0 %g %g %g cm /Im%d Do Q\n",
+                       item->size[0] * vpsize[0], item->size[1] * vpsize[1],
+                       pos[0], pos[1], this->imageobjs.getLength());
+  this->imageobjs.append(num);
+}
+
+#undef PRIVATE
+#undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/annex/HardCopy/SoHardCopy.h>
+#include <Inventor/annex/HardCopy/SoVectorOutput.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoLineSet.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+static SbList <char>
+read_pdf_file(const char * filename)
+{
+  SbList <char> data;
+  FILE * fp = fopen(filename, "rb");
+  if (fp == NULL) return data;
+  char buf[1024];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    for (size_t i = 0; i < n; i++) data.append(buf[i]);
+  }
+  fclose(fp);
+  data.append('\0');
+  return data;
+}
+
+BOOST_AUTO_TEST_CASE(crossReferenceTable)
+{
+  SoHardCopy::init();
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position = SbVec3f(0.0f, 0.0f, 5.0f);
+  camera->height = 2.0f;
+  root->addChild(camera);
+  SoBaseColor * col = new SoBaseColor;
+  col->rgb = SbColor(1.0f, 0.0f, 0.0f);
+  root->addChild(col);
+  const SbVec3f v[] = {
+    SbVec3f(-0.5f, -0.5f, 0.0f), SbVec3f(0.5f, -0.5f, 0.0f),
+    SbVec3f(0.5f, 0.5f, 0.0f), SbVec3f(-0.5f, 0.5f, 0.0f)
+  };
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setValues(0, 4, v);
+  root->addChild(coords);
+  root->addChild(new SoFaceSet);
+  root->addChild(new SoLineSet);
+
+  const char * filename = "coin_test_xref.pdf";
+  SoVectorizePDFAction * action = new SoVectorizePDFAction;
+  BOOST_REQUIRE(action->getOutput()->openFile(filename));
+  action->beginStandardPage(SoVectorizeAction::A4, 10.0f);
+  action->beginViewport();
+  action->calibrate(SbViewportRegion(400, 400));
+  action->apply(root);
+  action->endViewport();
+  action->endPage();
+  action->getOutput()->closeFile();
+  delete action;
+
+  const SbList <char> data = read_pdf_file(filename);
+  BOOST_REQUIRE(data.getLength() > 0);
+  const int size = data.getLength() - 1;
+  const char * pdf = data.getArrayPtr();
+  BOOST_CHECK(strncmp(pdf, "%PDF-", 5) == 0);
+
+  // startxref must point at the xref table at the end of the file
+  const char * startxref = NULL;
+  for (const char * s = pdf; (s = strstr(s, "startxref\n")) != NULL; s++) startxref = s;
+  BOOST_REQUIRE(startxref != NULL);
+  const long long xref = atoll(startxref + 10);
+  BOOST_REQUIRE(xref > 0 && xref < size);
+  BOOST_CHECK(strncmp(pdf + xref, "xref\n0 ", 7) == 0);
+  BOOST_CHECK(strcmp(strchr(startxref + 10, '\n'), "\n%%EOF\n") == 0);
+
+  // every entry in the table must point at the start of its object
+  const char * table = pdf + xref + 7;
+  const int numentries = atoi(table);
+  BOOST_REQUIRE(numentries > 1);
+  table = strchr(table, '\n') + 1;
+  BOOST_CHECK(strncmp(table, "0000000000 65535 f \n", 20) == 0);
+  for (int i = 1; i < numentries; i++) {
+    const char * entry = table + i * 20;
+    BOOST_REQUIRE(strncmp(entry + 10, " 00000 n \n", 10) == 0);
+    const long long offset = atoll(entry);
+    BOOST_REQUIRE(offset > 0 && offset < xref);
+    SbString obj;
+    obj.sprintf("%d 0 obj\n", i);
+    BOOST_CHECK_MESSAGE(strncmp(pdf + offset, obj.getString(), obj.getLength()) == 0,
+                        "xref entry " << i << " does not point at its object");
+  }
+
+  SbString trailer;
+  trailer.sprintf("trailer\n<< /Size %d /Root ", numentries);
+  BOOST_CHECK(strncmp(table + numentries * 20, trailer.getString(), trailer.getLength()) == 0);
+
+  (void) remove(filename);
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
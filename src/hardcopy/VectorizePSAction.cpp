@@ -809,3 +809,124 @@ SoVectorizePSActionP::convertToPS(const float mm) const
 
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+#include <cstring>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/annex/HardCopy/SoHardCopy.h>
+#include <Inventor/annex/HardCopy/SoVectorOutput.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoLightModel.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+static void
+add_polygon(SoSeparator * root, const SbVec3f * v, const int num, const SbColor & color)
+{
+  SoBaseColor * col = new SoBaseColor;
+  col->rgb = color;
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setValues(0, num, v);
+  SoFaceSet * fs = new SoFaceSet;
+  fs->numVertices = num;
+  root->addChild(col);
+  root->addChild(coords);
+  root->addChild(fs);
+}
+
+static int
+count_ps_triangles(const char * filename)
+{
+  int num = 0;
+  FILE * fp = fopen(filename, "r");
+  if (fp == NULL) return -1;
+  char line[1024];
+  while (fgets(line, sizeof(line), fp)) {
+    // skip the procedure definitions and comments in the prolog
+    if (line[0] == '/' || line[0] == '%') continue;
+    if (strstr(line, " flatshadetriangle\n") || strstr(line, " gouraudtriangle\n")) num++;
+  }
+  fclose(fp);
+  return num;
+}
+
+BOOST_AUTO_TEST_CASE(hiddenSurfaceRemoval)
+{
+  SoHardCopy::init();
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position = SbVec3f(0.0f, 0.0f, 5.0f);
+  camera->height = 2.0f;
+  root->addChild(camera);
+  SoLightModel * lm = new SoLightModel;
+  lm->model = SoLightModel::BASE_COLOR;
+  root->addChild(lm);
+
+  // a front quad, hiding a smaller quad and a thin triangle behind it
+  const SbVec3f front[] = {
+    SbVec3f(-0.5f, -0.5f, 1.0f), SbVec3f(0.5f, -0.5f, 1.0f),
+    SbVec3f(0.5f, 0.5f, 1.0f), SbVec3f(-0.5f, 0.5f, 1.0f)
+  };
+  const SbVec3f back[] = {
+    SbVec3f(-0.4f, -0.4f, -1.0f), SbVec3f(0.4f, -0.4f, -1.0f),
+    SbVec3f(0.4f, 0.4f, -1.0f), SbVec3f(-0.4f, 0.4f, -1.0f)
+  };
+  const SbVec3f hiddensliver[] = {
+    SbVec3f(-0.3f, 0.1f, -1.0f), SbVec3f(0.3f, 0.1f, -1.0f),
+    SbVec3f(0.3f, 0.10001f, -1.0f)
+  };
+  // a long triangle, much thinner than a pixel, outside the front quad
+  const SbVec3f sliver[] = {
+    SbVec3f(-0.9f, 0.8f, 0.0f), SbVec3f(0.9f, 0.8f, 0.0f),
+    SbVec3f(0.9f, 0.80001f, 0.0f)
+  };
+  // a quad outside the front quad, with thin triangles lying on it
+  // drawn before and after it. Each covers part of a row of pixel
+  // centers in the id buffer, but the surface drawn last at the same
+  // depth takes those pixels.
+  const SbVec3f side[] = {
+    SbVec3f(-0.95f, 0.65f, 0.5f), SbVec3f(-0.55f, 0.65f, 0.5f),
+    SbVec3f(-0.55f, 0.75f, 0.5f), SbVec3f(-0.95f, 0.75f, 0.5f)
+  };
+  const SbVec3f onside0[] = {
+    SbVec3f(-0.9f, 0.7015f, 0.5f), SbVec3f(-0.6f, 0.7015f, 0.5f),
+    SbVec3f(-0.6f, 0.7023f, 0.5f)
+  };
+  const SbVec3f onside1[] = {
+    SbVec3f(-0.9f, 0.6816f, 0.5f), SbVec3f(-0.6f, 0.6816f, 0.5f),
+    SbVec3f(-0.6f, 0.6824f, 0.5f)
+  };
+  add_polygon(root, front, 4, SbColor(1.0f, 0.0f, 0.0f));
+  add_polygon(root, back, 4, SbColor(0.0f, 0.0f, 1.0f));
+  add_polygon(root, hiddensliver, 3, SbColor(0.0f, 1.0f, 0.0f));
+  add_polygon(root, sliver, 3, SbColor(0.0f, 1.0f, 1.0f));
+  add_polygon(root, onside0, 3, SbColor(1.0f, 1.0f, 0.0f));
+  add_polygon(root, side, 4, SbColor(1.0f, 0.0f, 1.0f));
+  add_polygon(root, onside1, 3, SbColor(1.0f, 1.0f, 0.0f));
+
+  const char * filename = "coin_test_hlhsr.ps";
+  SoVectorizePSAction * action = new SoVectorizePSAction;
+  action->setHLHSRMode(SoVectorizeAction::HLHSR_PAINTER_SURFACE_REMOVAL);
+  BOOST_REQUIRE(action->getOutput()->openFile(filename));
+  action->beginStandardPage(SoVectorizeAction::A4, 10.0f);
+  action->beginViewport();
+  action->calibrate(SbViewportRegion(400, 400));
+  action->apply(root);
+  action->endViewport();
+  action->endPage();
+  action->getOutput()->closeFile();
+  delete action;
+
+  // the front quad, the visible sliver, the side quad and the
+  // triangles on it
+  BOOST_CHECK_EQUAL(count_ps_triangles(filename), 7);
+
+  (void) remove(filename);
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
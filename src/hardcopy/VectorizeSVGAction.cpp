@@ -0,0 +1,754 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoVectorizeSVGAction SoVectorizeSVGAction.h Inventor/annex/HardCopy/SoVectorizeSVGAction.h
+  \brief The SoVectorizeSVGAction class is used for rendering to an SVG file.
+
+  \ingroup coin_hardcopy
+
+  Items are written to the file as they are printed, so no part of
+  the drawing is kept in memory by the output backend. Consecutive
+  triangles with the same color, and consecutive lines with the same
+  color, width and pattern, are written as one path element, which
+  keeps the file size down for large drawings. All coordinates are in
+  millimeters.
+
+  SVG 1.1 has no support for Gouraud shaded triangles, so triangles
+  are drawn using the average of their vertex colors. Images are
+  embedded as uncompressed PNG data.
+
+  \since Coin 4.0
+*/
+
+#include <Inventor/annex/HardCopy/SoVectorizeSVGAction.h>
+
+#include <cstdio>
+
+#include <Inventor/SbBSPTree.h>
+#include <Inventor/SbColor.h>
+
+#include "hardcopy/VectorizeActionP.h"
+#include "actions/SoSubActionP.h"
+
+// *************************************************************************
+
+class SoVectorizeSVGActionP {
+public:
+  SoVectorizeSVGActionP(SoVectorizeSVGAction * p) {
+    this->publ = p;
+    this->default2dfont = "Courier";
+    this->pathtype = NO_PATH;
+    this->pathcolor = 0;
+    this->pathwidth = 0.0f;
+    this->pathpattern = 0xffff;
+    this->viewportopen = FALSE;
+    this->landscape = FALSE;
+    this->numviewports = 0;
+  }
+
+  enum PathType {
+    NO_PATH,
+    FILL_PATH,
+    STROKE_PATH
+  };
+
+  FILE * getFile(void) const;
+  SbVec2f toPage(const SbVec3f & v) const;
+
+  void beginPath(const PathType type, const uint32_t color,
+                 const float width = 0.0f, const uint16_t pattern = 0xffff);
+  void endPath(void);
+
+  void printTriangle(const SoVectorizeTriangle * item);
+  void printLine(const SoVectorizeLine * item);
+  void printPoint(const SoVectorizePoint * item);
+  void printText(const SoVectorizeText * item);
+  void printImage(const SoVectorizeImage * item);
+
+  SbString default2dfont;
+
+  // the path element currently being written
+  PathType pathtype;
+  uint32_t pathcolor;
+  float pathwidth;
+  uint16_t pathpattern;
+
+  SbBool viewportopen;
+  SbBool landscape;
+  int numviewports;
+
+private:
+  SoVectorizeSVGAction * publ;
+};
+
+#define PRIVATE(p) (p->pimpl)
+#define PUBLIC(p) (p->publ)
+
+// *************************************************************************
+
+SO_ACTION_SOURCE(SoVectorizeSVGAction);
+
+// *************************************************************************
+
+/*!
+  \copydetails SoAction::initClass(void)
+*/
+void
+SoVectorizeSVGAction::initClass(void)
+{
+  SO_ACTION_INTERNAL_INIT_CLASS(SoVectorizeSVGAction, SoVectorizeAction);
+}
+
+/*!
+  Default constructor.
+*/
+SoVectorizeSVGAction::SoVectorizeSVGAction(void)
+{
+  PRIVATE(this) = new SoVectorizeSVGActionP(this);
+  SO_ACTION_CONSTRUCTOR(SoVectorizeSVGAction);
+
+  this->setOutput(new SoVectorOutput);
+}
+
+/*!
+  Default destructor.
+*/
+SoVectorizeSVGAction::~SoVectorizeSVGAction()
+{
+  delete PRIVATE(this);
+}
+
+// *************************************************************************
+
+/*!
+  Sets the default font name. This font will be used for rendering
+  Text2-nodes which have no Font-nodes preceding them. The default
+  value is "Courier".
+*/
+void
+SoVectorizeSVGAction::setDefault2DFont(const SbString & fontname)
+{
+  PRIVATE(this)->default2dfont = fontname;
+}
+
+/*!
+  Returns the default font name.
+
+  \sa setDefault2DFont()
+*/
+const SbString &
+SoVectorizeSVGAction::getDefault2DFont(void) const
+{
+  return PRIVATE(this)->default2dfont;
+}
+
+// *************************************************************************
+
+static void
+print_color(FILE * fp, const char * attr, const uint32_t col)
+{
+  fprintf(fp, " %s=\"#%02x%02x%02x\"", attr,
+          (col >> 24) & 0xff, (col >> 16) & 0xff, (col >> 8) & 0xff);
+}
+
+static void
+print_escaped(FILE * fp, const char * str)
+{
+  for (; *str; str++) {
+    switch (*str) {
+    case '&': fputs("&amp;", fp); break;
+    case '<': fputs("&lt;", fp); break;
+    case '>': fputs("&gt;", fp); break;
+    case '"': fputs("&quot;", fp); break;
+    default: fputc(*str, fp); break;
+    }
+  }
+}
+
+//
+// Prints the runs of on and off bits in the line pattern, starting
+// with the most significant bit.
+//
+static void
+print_dasharray(FILE * fp, const uint16_t pattern, const float unit)
+{
+  fputs(" stroke-dasharray=\"", fp);
+  int bit = 15;
+  int numruns = 0;
+  SbBool on = TRUE;
+  while (bit >= 0) {
+    int len = 0;
+    while (bit >= 0 && (((pattern >> bit) & 1) != 0) == on) { len++; bit--; }
+    fprintf(fp, "%s%g", numruns ? " " : "", len * unit);
+    numruns++;
+    on = !on;
+  }
+  if (numruns & 1) fputs(" 0", fp); // need pairs of values
+  fputs("\"", fp);
+}
+
+namespace {
+
+  // writes bytes base64 encoded
+  class Base64Writer {
+  public:
+    Base64Writer(FILE * fp) {
+      this->fp = fp;
+      this->num = 0;
+    }
+    void put(const unsigned char c) {
+      this->buf[this->num++] = c;
+      if (this->num == 3) this->flush();
+    }
+    void flush(void) {
+      static const char table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      if (this->num == 0) return;
+      unsigned char b[3] = { 0, 0, 0 };
+      for (int i = 0; i < this->num; i++) b[i] = this->buf[i];
+      char out[4];
+      out[0] = table[b[0] >> 2];
+      out[1] = table[((b[0] & 0x03) << 4) | (b[1] >> 4)];
+      out[2] = this->num > 1 ? table[((b[1] & 0x0f) << 2) | (b[2] >> 6)] : '=';
+      out[3] = this->num > 2 ? table[b[2] & 0x3f] : '=';
+      fwrite(out, 1, 4, this->fp);
+      this->num = 0;
+    }
+  private:
+    FILE * fp;
+    unsigned char buf[3];
+    int num;
+  };
+
+  // writes a PNG image using stored (uncompressed) deflate blocks
+  class PNGWriter {
+  public:
+    PNGWriter(Base64Writer & out) : out(out) {
+      this->crc = 0;
+    }
+
+    void write(const unsigned char * data, const int width, const int height, const int nc) {
+      static const unsigned char signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+      int i;
+      for (i = 0; i < 8; i++) this->out.put(signature[i]);
+
+      const int outnc = nc >= 3 ? 3 : 1;
+      this->beginChunk("IHDR", 13);
+      this->putUInt32(uint32_t(width));
+      this->putUInt32(uint32_t(height));
+      this->putByte(8); // bit depth
+      this->putByte(outnc == 3 ? 2 : 0); // RGB or grayscale
+      this->putByte(0);
+      this->putByte(0);
+      this->putByte(0);
+      this->endChunk();
+
+      const uint32_t rowlen = uint32_t(width * outnc + 1);
+      const uint32_t rawlen = rowlen * uint32_t(height);
+      const uint32_t numblocks = SbMax((rawlen + 65534) / 65535, uint32_t(1));
+      this->beginChunk("IDAT", 2 + rawlen + numblocks * 5 + 4);
+      this->putByte(0x78); // zlib header, no compression
+      this->putByte(0x01);
+      uint32_t adlera = 1, adlerb = 0;
+      uint32_t blockleft = 0;
+      uint32_t left = rawlen;
+      if (rawlen == 0) this->beginBlock(0, TRUE);
+      // PNG rows are stored from the top, image rows from the bottom
+      for (int y = height - 1; y >= 0; y--) {
+        const unsigned char * row = data + y * width * nc;
+        for (int x = -1; x < width * outnc; x++) {
+          if (blockleft == 0) {
+            blockleft = SbMin(left, uint32_t(65535));
+            this->beginBlock(blockleft, blockleft == left);
+          }
+          unsigned char c = 0; // row filter type
+          if (x >= 0) c = row[(x / outnc) * nc + (x % outnc)];
+          this->putByte(c);
+          adlera = (adlera + c) % 65521;
+          adlerb = (adlerb + adlera) % 65521;
+          blockleft--;
+          left--;
+        }
+      }
+      this->putUInt32((adlerb << 16) | adlera);
+      this->endChunk();
+
+      this->beginChunk("IEND", 0);
+      this->endChunk();
+      this->out.flush();
+    }
+
+  private:
+    void beginBlock(const uint32_t len, const SbBool last) {
+      this->putByte(last ? 1 : 0);
+      this->putByte(len & 0xff);
+      this->putByte((len >> 8) & 0xff);
+      this->putByte(~len & 0xff);
+      this->putByte((~len >> 8) & 0xff);
+    }
+    void beginChunk(const char * type, const uint32_t len) {
+      for (int i = 3; i >= 0; i--) this->out.put((len >> (i * 8)) & 0xff);
+      this->crc = 0xffffffff;
+      for (int i = 0; i < 4; i++) this->putByte(type[i]);
+    }
+    void endChunk(void) {
+      const uint32_t c = this->crc ^ 0xffffffff;
+      for (int i = 3; i >= 0; i--) this->out.put((c >> (i * 8)) & 0xff);
+    }
+    void putUInt32(const uint32_t val) {
+      for (int i = 3; i >= 0; i--) this->putByte((val >> (i * 8)) & 0xff);
+    }
+    void putByte(const unsigned char c) {
+      static uint32_t table[256];
+      static SbBool initialized = FALSE;
+      if (!initialized) {
+        for (uint32_t n = 0; n < 256; n++) {
+          uint32_t v = n;
+          for (int k = 0; k < 8; k++) v = (v & 1) ? 0xedb88320 ^ (v >> 1) : v >> 1;
+          table[n] = v;
+        }
+        initialized = TRUE;
+      }
+      this->crc = table[(this->crc ^ c) & 0xff] ^ (this->crc >> 8);
+      this->out.put(c);
+    }
+
+    Base64Writer & out;
+    uint32_t crc;
+  };
+
+} // namespace
+
+// *************************************************************************
+
+// doc in parent
+void
+SoVectorizeSVGAction::printHeader(void) const
+{
+  FILE * file = PRIVATE(this)->getFile();
+
+  const SbVec2f & start = this->getPageStartpos();
+  const SbVec2f & size = this->getPageSize();
+  const SbVec2f paper = size + start * 2.0f;
+
+  fputs("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n", file);
+  fputs("<!-- Creator: Coin -->\n", file);
+  fprintf(file,
+          "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+          "xmlns:xlink=\"http://www.w3.org/1999/xlink\" version=\"1.1\"\n"
+          "     width=\"%gmm\" height=\"%gmm\" viewBox=\"0 0 %g %g\">\n",
+          paper[0], paper[1], paper[0], paper[1]);
+
+  // use a y axis pointing up, like in PostScript
+  fprintf(file, "<g transform=\"matrix(1 0 0 -1 0 %g)\" stroke-linecap=\"round\">\n", paper[1]);
+
+  PRIVATE(this)->landscape = this->getOrientation() == LANDSCAPE;
+  if (PRIVATE(this)->landscape) {
+    const SbVec2f halfsize = size * 0.5f;
+    fprintf(file, "<g transform=\"translate(%g %g) rotate(90) translate(%g %g)\">\n",
+            start[0] + halfsize[0], start[1] + halfsize[1],
+            -(halfsize[1] + start[1]), -(halfsize[0] + start[0]));
+  }
+  PRIVATE(this)->pathtype = SoVectorizeSVGActionP::NO_PATH;
+  PRIVATE(this)->viewportopen = FALSE;
+  PRIVATE(this)->numviewports = 0;
+}
+
+// doc in parent
+void
+SoVectorizeSVGAction::printFooter(void) const
+{
+  FILE * file = PRIVATE(this)->getFile();
+
+  PRIVATE(this)->endPath();
+  if (PRIVATE(this)->viewportopen) fputs("</g>\n", file);
+  if (PRIVATE(this)->landscape) fputs("</g>\n", file);
+  fputs("</g>\n</svg>\n", file);
+  PRIVATE(this)->viewportopen = FALSE;
+}
+
+// doc in parent
+void
+SoVectorizeSVGAction::printViewport(void) const
+{
+  FILE * file = PRIVATE(this)->getFile();
+
+  PRIVATE(this)->endPath();
+  if (PRIVATE(this)->viewportopen) fputs("</g>\n", file);
+
+  const SbVec2f start = this->getRotatedViewportStartpos();
+  const SbVec2f size = this->getRotatedViewportSize();
+  const int id = PRIVATE(this)->numviewports++;
+  fprintf(file, "<clipPath id=\"viewport%d\"><rect x=\"%g\" y=\"%g\" width=\"%g\" height=\"%g\"/></clipPath>\n",
+          id, start[0], start[1], size[0], size[1]);
+  fprintf(file, "<g clip-path=\"url(#viewport%d)\">\n", id);
+  PRIVATE(this)->viewportopen = TRUE;
+}
+
+// doc in parent
+void
+SoVectorizeSVGAction::printBackground(void) const
+{
+  FILE * file = PRIVATE(this)->getFile();
+
+  SbColor bgcol;
+  (void) this->getBackgroundColor(bgcol);
+  const SbVec2f start = this->getRotatedViewportStartpos();
+  const SbVec2f size = this->getRotatedViewportSize();
+
+  PRIVATE(this)->endPath();
+  fprintf(file, "<rect x=\"%g\" y=\"%g\" width=\"%g\" height=\"%g\"",
+          start[0], start[1], size[0], size[1]);
+  print_color(file, "fill", bgcol.getPackedValue());
+  fputs("/>\n", file);
+}
+
+// doc in parent
+void
+SoVectorizeSVGAction::printItem(const SoVectorizeItem * item) const
+{
+  switch (item->type) {
+  case SoVectorizeItem::TRIANGLE:
+    PRIVATE(this)->printTriangle((SoVectorizeTriangle*)item);
+    break;
+  case SoVectorizeItem::LINE:
+    PRIVATE(this)->printLine((SoVectorizeLine*)item);
+    break;
+  case SoVectorizeItem::POINT:
+    PRIVATE(this)->printPoint((SoVectorizePoint*)item);
+    break;
+  case SoVectorizeItem::TEXT:
+    PRIVATE(this)->printText((SoVectorizeText*)item);
+    break;
+  case SoVectorizeItem::IMAGE:
+    PRIVATE(this)->printImage((SoVectorizeImage*)item);
+    break;
+  default:
+    assert(0 && "unsupported item");
+    break;
+  }
+}
+
+// *************************************************************************
+
+FILE *
+SoVectorizeSVGActionP::getFile(void) const
+{
+  return PUBLIC(this)->getOutput()->getFilePointer();
+}
+
+//
+// converts from normalized viewport coordinates to page coordinates (mm)
+//
+SbVec2f
+SoVectorizeSVGActionP::toPage(const SbVec3f & v) const
+{
+  const SbVec2f size = PUBLIC(this)->getRotatedViewportSize();
+  const SbVec2f start = PUBLIC(this)->getRotatedViewportStartpos();
+  return SbVec2f(v[0] * size[0] + start[0], v[1] * size[1] + start[1]);
+}
+
+//
+// Starts a new path element, unless the current one has the same
+// attributes.
+//
+void
+SoVectorizeSVGActionP::beginPath(const PathType type, const uint32_t color,
+                                 const float width, const uint16_t pattern)
+{
+  const uint32_t rgb = color & 0xffffff00;
+  if (type == this->pathtype && rgb == this->pathcolor &&
+      (type == FILL_PATH || (width == this->pathwidth && pattern == this->pathpattern))) {
+    return;
+  }
+  this->endPath();
+
+  FILE * file = this->getFile();
+  fputs("<path", file);
+  if (type == FILL_PATH) {
+    print_color(file, "fill", rgb);
+  }
+  else {
+    fputs(" fill=\"none\"", file);
+    print_color(file, "stroke", rgb);
+    fprintf(file, " stroke-width=\"%g\"", width * PUBLIC(this)->getNominalWidth());
+    if (pattern != 0xffff) print_dasharray(file, pattern, PUBLIC(this)->getNominalWidth());
+  }
+  fputs(" d=\"", file);
+
+  this->pathtype = type;
+  this->pathcolor = rgb;
+  this->pathwidth = width;
+  this->pathpattern = pattern;
+}
+
+//
+// Ends the current path element.
+//
+void
+SoVectorizeSVGActionP::endPath(void)
+{
+  if (this->pathtype != NO_PATH) {
+    fputs("\"/>\n", this->getFile());
+    this->pathtype = NO_PATH;
+  }
+}
+
+void
+SoVectorizeSVGActionP::printTriangle(const SoVectorizeTriangle * item)
+{
+  const SbBSPTree & bsp = PUBLIC(this)->getBSPTree();
+  SbVec2f v[3];
+  SbColor4f c(0.0f, 0.0f, 0.0f, 0.0f);
+  for (int i = 0; i < 3; i++) {
+    v[i] = this->toPage(bsp.getPoint(item->vidx[i]));
+    SbColor4f vc;
+    vc.setPackedValue(item->col[i]);
+    c += vc;
+  }
+  if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2]) return;
+
+  this->beginPath(FILL_PATH, (c * (1.0f / 3.0f)).getPackedValue());
+  fprintf(this->getFile(), "M%g %gL%g %gL%g %gZ",
+          v[0][0], v[0][1], v[1][0], v[1][1], v[2][0], v[2][1]);
+}
+
+void
+SoVectorizeSVGActionP::printLine(const SoVectorizeLine * item)
+{
+  const SbBSPTree & bsp = PUBLIC(this)->getBSPTree();
+  const SbVec2f v0 = this->toPage(bsp.getPoint(item->vidx[0]));
+  const SbVec2f v1 = this->toPage(bsp.getPoint(item->vidx[1]));
+
+  this->beginPath(STROKE_PATH, item->col[0], item->width, item->pattern);
+  fprintf(this->getFile(), "M%g %gL%g %g", v0[0], v0[1], v1[0], v1[1]);
+}
+
+void
+SoVectorizeSVGActionP::printPoint(const SoVectorizePoint * item)
+{
+  FILE * file = this->getFile();
+  const SbVec2f v = this->toPage(PUBLIC(this)->getBSPTree().getPoint(item->vidx));
+  const float size = item->size * PUBLIC(this)->getNominalWidth();
+
+  this->endPath();
+  switch (PUBLIC(this)->getPointStyle()) {
+  default:
+    assert(0 && "unknown point style");
+  case SoVectorizeAction::CIRCLE:
+    fprintf(file, "<circle cx=\"%g\" cy=\"%g\" r=\"%g\"", v[0], v[1], size * 0.5f);
+    break;
+  case SoVectorizeAction::SQUARE:
+    fprintf(file, "<rect x=\"%g\" y=\"%g\" width=\"%g\" height=\"%g\"",
+            v[0] - size * 0.5f, v[1] - size * 0.5f, size, size);
+    break;
+  }
+  print_color(file, "fill", item->col);
+  fputs("/>\n", file);
+}
+
+void
+SoVectorizeSVGActionP::printText(const SoVectorizeText * item)
+{
+  FILE * file = this->getFile();
+  const SbVec2f size = PUBLIC(this)->getRotatedViewportSize();
+  const SbVec2f pos = this->toPage(SbVec3f(item->pos[0], item->pos[1], 0.0f));
+
+  SbString fontname = item->fontname.getString();
+  if (fontname == "defaultFont") fontname = this->default2dfont;
+
+  const char * anchor = "start";
+  switch (item->justification) {
+  default:
+  case SoVectorizeText::LEFT: break;
+  case SoVectorizeText::CENTER: anchor = "middle"; break;
+  case SoVectorizeText::RIGHT: anchor = "end"; break;
+  }
+
+  this->endPath();
+  // flip the text back, since the y axis points up
+  fprintf(file, "<text transform=\"translate(%g %g) scale(1 -1)\" font-family=\"",
+          pos[0], pos[1]);
+  print_escaped(file, fontname.getString());
+  fprintf(file, "\" font-size=\"%g\" text-anchor=\"%s\"", item->fontsize * size[1], anchor);
+  print_color(file, "fill", item->col);
+  fputs(">", file);
+  print_escaped(file, item->string.getString());
+  fputs("</text>\n", file);
+}
+
+void
+SoVectorizeSVGActionP::printImage(const SoVectorizeImage * item)
+{
+  FILE * file = this->getFile();
+  const SbVec2f vpsize = PUBLIC(this)->getRotatedViewportSize();
+  const SbVec2f pos = this->toPage(SbVec3f(item->pos[0], item->pos[1], 0.0f));
+  const SbVec2f size(item->size[0] * vpsize[0], item->size[1] * vpsize[1]);
+
+  this->endPath();
+  fprintf(file, "<image transform=\"translate(%g %g) scale(1 -1)\" x=\"0\" y=\"%g\" "
+          "width=\"%g\" height=\"%g\" preserveAspectRatio=\"none\"\n"
+          "       xlink:href=\"data:image/png;base64,",
+          pos[0], pos[1], -size[1], size[0], size[1]);
+  Base64Writer base64(file);
+  PNGWriter png(base64);
+  png.write(item->image.data, item->image.size[0], item->image.size[1], item->image.nc);
+  fputs("\"/>\n", file);
+}
+
+#undef PRIVATE
+#undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+#include <cstring>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/annex/HardCopy/SoHardCopy.h>
+#include <Inventor/annex/HardCopy/SoVectorOutput.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoDrawStyle.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoLightModel.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoPointSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+static SbString
+read_svg_file(const char * filename)
+{
+  SbString s;
+  FILE * fp = fopen(filename, "rb");
+  if (fp == NULL) return s;
+  char buf[1024];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf) - 1, fp)) > 0) {
+    buf[n] = '\0';
+    s += buf;
+  }
+  fclose(fp);
+  return s;
+}
+
+static int
+count_svg_substrings(const char * s, const char * sub)
+{
+  int num = 0;
+  const size_t len = strlen(sub);
+  while ((s = strstr(s, sub)) != NULL) { num++; s += len; }
+  return num;
+}
+
+BOOST_AUTO_TEST_CASE(elements)
+{
+  SoHardCopy::init();
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position = SbVec3f(0.0f, 0.0f, 5.0f);
+  camera->height = 2.0f;
+  root->addChild(camera);
+  SoLightModel * lm = new SoLightModel;
+  lm->model = SoLightModel::BASE_COLOR;
+  root->addChild(lm);
+
+  // a red quad, a blue triangle and three green points
+  const SbVec3f quad[] = {
+    SbVec3f(-0.5f, -0.5f, 0.0f), SbVec3f(0.0f, -0.5f, 0.0f),
+    SbVec3f(0.0f, 0.0f, 0.0f), SbVec3f(-0.5f, 0.0f, 0.0f)
+  };
+  const SbVec3f triangle[] = {
+    SbVec3f(0.2f, 0.2f, 0.0f), SbVec3f(0.8f, 0.2f, 0.0f), SbVec3f(0.5f, 0.8f, 0.0f)
+  };
+  const SbVec3f points[] = {
+    SbVec3f(-0.8f, 0.8f, 0.0f), SbVec3f(-0.6f, 0.8f, 0.0f), SbVec3f(-0.4f, 0.8f, 0.0f)
+  };
+  SoBaseColor * col = new SoBaseColor;
+  col->rgb.set1Value(0, SbColor(1.0f, 0.0f, 0.0f));
+  col->rgb.set1Value(1, SbColor(0.0f, 0.0f, 1.0f));
+  root->addChild(col);
+  SoMaterialBinding * mb = new SoMaterialBinding;
+  mb->value = SoMaterialBinding::PER_FACE;
+  root->addChild(mb);
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setValues(0, 4, quad);
+  coords->point.setValues(4, 3, triangle);
+  root->addChild(coords);
+  SoFaceSet * fs = new SoFaceSet;
+  fs->numVertices.set1Value(0, 4);
+  fs->numVertices.set1Value(1, 3);
+  root->addChild(fs);
+  SoBaseColor * green = new SoBaseColor;
+  green->rgb = SbColor(0.0f, 1.0f, 0.0f);
+  root->addChild(green);
+  SoMaterialBinding * overall = new SoMaterialBinding;
+  overall->value = SoMaterialBinding::OVERALL;
+  root->addChild(overall);
+  SoCoordinate3 * pcoords = new SoCoordinate3;
+  pcoords->point.setValues(0, 3, points);
+  root->addChild(pcoords);
+  SoDrawStyle * ds = new SoDrawStyle;
+  ds->pointSize = 4.0f;
+  root->addChild(ds);
+  root->addChild(new SoPointSet);
+
+  const char * filename = "coin_test_elements.svg";
+  SoVectorizeSVGAction * action = new SoVectorizeSVGAction;
+  BOOST_REQUIRE(action->getOutput()->openFile(filename));
+  action->beginStandardPage(SoVectorizeAction::A4, 10.0f);
+  action->beginViewport();
+  action->calibrate(SbViewportRegion(400, 400));
+  action->apply(root);
+  action->endViewport();
+  action->endPage();
+  action->getOutput()->closeFile();
+  delete action;
+
+  const SbString svg = read_svg_file(filename);
+  const char * s = svg.getString();
+  BOOST_CHECK(strncmp(s, "<?xml", 5) == 0);
+  BOOST_CHECK(strstr(s, "</svg>\n") != NULL);
+  // beginStandardPage() opens a page sized viewport before ours
+  BOOST_CHECK_EQUAL(count_svg_substrings(s, "<clipPath"), 2);
+  BOOST_CHECK_EQUAL(count_svg_substrings(s, "<g"), count_svg_substrings(s, "</g>"));
+  // one filled path per color, one closed subpath per triangle
+  BOOST_CHECK_EQUAL(count_svg_substrings(s, "<path"), 2);
+  BOOST_CHECK_EQUAL(count_svg_substrings(s, "Z"), 3);
+  BOOST_CHECK_EQUAL(count_svg_substrings(s, "<circle"), 3);
+
+  (void) remove(filename);
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
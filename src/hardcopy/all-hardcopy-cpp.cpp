@@ -35,4 +35,6 @@
 #include "VectorOutput.cpp"
 #include "VectorizeAction.cpp"
 #include "VectorizeActionP.cpp"
+#include "VectorizePDFAction.cpp"
 #include "VectorizePSAction.cpp"
+#include "VectorizeSVGAction.cpp"
@@ -113,6 +113,12 @@ inline unsigned int SbHashFunc(unsigned long key) { return toUint<unsigned long>
 class SbString;
 unsigned int SbHashFunc(const SbString & key);
 
+// C string keys are compared by pointer value, not by content (they
+// are typically SbName strings, which are unique). Hash the pointer
+// value too, instead of implicitly converting to SbString and hashing
+// the characters.
+inline unsigned int SbHashFunc(const char * key) { return SbHashFunc(reinterpret_cast<size_t>(key)); }
+
 /*
   Some implementations of pointers, all functions are per writing only reinterpret_casts to size_t
 */
@@ -0,0 +1,665 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoBoundingBoxTracker SoBoundingBoxTracker.h Inventor/misc/SoBoundingBoxTracker.h
+  \brief The SoBoundingBoxTracker class keeps the bounding box of a scene graph up to date.
+
+  \ingroup general
+
+  Applying an SoGetBoundingBoxAction to a scene graph traverses the
+  whole graph every time, except below SoSeparator nodes with a valid
+  bounding box cache. For applications that need the bounding box of
+  the scene very often, for instance to fit the near and far
+  clipping planes every frame, this class can be used instead.
+
+  The tracker builds a tree mirroring the SoGroup, SoSeparator and
+  SoSwitch nodes in the scene graph, and stores the world space
+  bounding box for each node in the tree. A single sensor on the root
+  node follows the notification path of each change down to the
+  changed node, and marks the changed parts of the tree.
+  getBoundingBox() then only recomputes the bounding boxes for the
+  nodes that changed, and for the nodes that might be affected by
+  them through the traversal state (i.e. the later siblings of
+  changed transformation nodes, up to the closest SoSeparator).
+
+  The bounding box is the union of the world space bounding boxes of
+  the shapes in the scene, and might be slightly tighter than the
+  bounding box calculated by SoGetBoundingBoxAction, which
+  accumulates boxes in the local coordinate system of the first
+  shape. The bounding box center is not tracked.
+
+  All nodes in the tracked scene graph are referenced by the tracker,
+  so nodes removed from the scene graph are not destructed until the
+  next call to getBoundingBox().
+
+  Scene graph notification only reaches the root once for each
+  change, through one of the parents of the changed node. A node used
+  both inside a node the tracker doesn't look into (like a nodekit or
+  an SoGroup subclass) and somewhere else might therefore not have
+  all its uses updated. Call invalidate() after changing such nodes.
+
+  \code
+  SoBoundingBoxTracker tracker(viewer->getViewportRegion());
+  tracker.setSceneGraph(root);
+
+  // later, every frame
+  const SbBox3f & box = tracker.getBoundingBox();
+  \endcode
+
+  \sa SoGetBoundingBoxAction
+  \since Coin 4.0
+*/
+
+#include <Inventor/misc/SoBoundingBoxTracker.h>
+
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/elements/SoSwitchElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/misc/SoNotification.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+
+#include "misc/SbHash.h"
+
+// *************************************************************************
+
+namespace {
+
+enum EntryKind { LEAF, GROUP, SEPARATOR, SWITCH };
+
+// one entry for each node instance (i.e. for each path) in the tracked graph
+struct Entry {
+  Entry(SoNode * n, Entry * p, int idx)
+    : node(n), parent(p), childindex(idx), kind(LEAF),
+      dirty(TRUE), rebuild(TRUE) { }
+
+  SoNode * node;
+  Entry * parent;
+  int childindex;
+  EntryKind kind;
+  SbList <Entry *> children;
+  SbBox3f box;
+  // leaf: the bounding box must be recalculated. group: something
+  // below has changed
+  SbBool dirty;
+  // group: the list of children must be rebuilt
+  SbBool rebuild;
+};
+
+class SoBoundingBoxTrackerAction;
+class SoBoundingBoxTrackerSensor;
+
+} // namespace
+
+class SoBoundingBoxTrackerP {
+public:
+  SoBoundingBoxTrackerP(void) : root(NULL), rootentry(NULL), numupdated(0) { }
+
+  // per node data. A node used several places in the graph has
+  // several entries.
+  struct NodeRecord {
+    SbList <Entry *> entries;
+  };
+
+  SoNode * root;
+  Entry * rootentry;
+  SbHash<SoNode *, NodeRecord *> records;
+  SoBoundingBoxTrackerAction * action;
+  SoBoundingBoxTrackerSensor * sensor;
+  SbBox3f box;
+  int numupdated;
+
+  static EntryKind getKind(SoNode * node);
+  Entry * createEntry(SoNode * node, Entry * parent, int childindex);
+  void deleteEntry(Entry * entry);
+  void rebuildChildren(Entry * entry);
+
+  static void markDirty(Entry * entry);
+  static void markSubgraphDirty(Entry * entry);
+  static void markStateDirty(Entry * entry);
+
+  void nodeChanged(NodeRecord * record, SoNode * trigger);
+  void notified(SoNotList * list);
+
+  void traverse(SoBoundingBoxTrackerAction * action, Entry * entry, SbBool needstate);
+};
+
+namespace {
+
+// Runs the incremental traversal inside an ordinary bounding box
+// action traversal, so that all the nodes see a normal
+// SoGetBoundingBoxAction.
+class SoBoundingBoxTrackerAction : public SoGetBoundingBoxAction {
+  typedef SoGetBoundingBoxAction inherited;
+public:
+  SoBoundingBoxTrackerAction(const SbViewportRegion & vp, SoBoundingBoxTrackerP * master)
+    : inherited(vp), master(master) { }
+
+protected:
+  virtual void beginTraversal(SoNode * COIN_UNUSED_ARG(node)) {
+    this->resetCenter();
+    this->getXfBoundingBox().makeEmpty();
+    SoViewportRegionElement::set(this->getState(), this->getViewportRegion());
+    this->master->traverse(this, this->master->rootentry, FALSE);
+  }
+
+private:
+  SoBoundingBoxTrackerP * master;
+};
+
+// Gets all the notifications from the scene graph, and passes them
+// on immediately instead of scheduling a callback, since the
+// notification records are needed to find the changed node.
+class SoBoundingBoxTrackerSensor : public SoNodeSensor {
+  typedef SoNodeSensor inherited;
+public:
+  SoBoundingBoxTrackerSensor(SoBoundingBoxTrackerP * master) : master(master) { }
+
+  virtual void notify(SoNotList * list) {
+    this->master->notified(list);
+  }
+
+private:
+  SoBoundingBoxTrackerP * master;
+};
+
+} // namespace
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// *************************************************************************
+
+// Only the exact group types are handled by the tracker. Subclasses
+// might traverse their children differently, and are treated as
+// leaf nodes.
+EntryKind
+SoBoundingBoxTrackerP::getKind(SoNode * node)
+{
+  const SoType type = node->getTypeId();
+  if (type == SoGroup::getClassTypeId()) return GROUP;
+  if (type == SoSeparator::getClassTypeId()) return SEPARATOR;
+  if (type == SoSwitch::getClassTypeId()) {
+    const SoSwitch * sw = static_cast<const SoSwitch *>(node);
+    if (sw->whichChild.isIgnored() ||
+        sw->whichChild.getValue() != SO_SWITCH_INHERIT) return SWITCH;
+  }
+  return LEAF;
+}
+
+Entry *
+SoBoundingBoxTrackerP::createEntry(SoNode * node, Entry * parent, int childindex)
+{
+  Entry * entry = new Entry(node, parent, childindex);
+  entry->kind = SoBoundingBoxTrackerP::getKind(node);
+  node->ref();
+
+  NodeRecord * record;
+  if (!this->records.get(node, record)) {
+    record = new NodeRecord;
+    this->records.put(node, record);
+  }
+  record->entries.append(entry);
+  return entry;
+}
+
+void
+SoBoundingBoxTrackerP::deleteEntry(Entry * entry)
+{
+  for (int i = 0; i < entry->children.getLength(); i++) {
+    this->deleteEntry(entry->children[i]);
+  }
+
+  NodeRecord * record;
+  if (this->records.get(entry->node, record)) {
+    const int idx = record->entries.find(entry);
+    assert(idx >= 0);
+    record->entries.removeFast(idx);
+    if (record->entries.getLength() == 0) {
+      delete record;
+      this->records.erase(entry->node);
+    }
+  }
+  entry->node->unref();
+  delete entry;
+}
+
+void
+SoBoundingBoxTrackerP::rebuildChildren(Entry * entry)
+{
+  for (int i = 0; i < entry->children.getLength(); i++) {
+    this->deleteEntry(entry->children[i]);
+  }
+  entry->children.truncate(0);
+  entry->rebuild = FALSE;
+
+  const SoChildList * children = entry->node->getChildren();
+  const int num = children->getLength();
+  int first = 0, last = num - 1;
+  if (entry->kind == SWITCH) {
+    const SoSwitch * sw = static_cast<const SoSwitch *>(entry->node);
+    const int which = sw->whichChild.isIgnored() ?
+      SO_SWITCH_NONE : sw->whichChild.getValue();
+    if (which != SO_SWITCH_ALL) {
+      const SbBool inrange = which >= 0 && which < num;
+      first = inrange ? which : 0;
+      last = inrange ? which : -1;
+    }
+  }
+  for (int i = first; i <= last; i++) {
+    entry->children.append(this->createEntry((*children)[i], entry, i));
+  }
+}
+
+// *************************************************************************
+
+void
+SoBoundingBoxTrackerP::markDirty(Entry * entry)
+{
+  entry->dirty = TRUE;
+  for (Entry * p = entry->parent; p && !p->dirty; p = p->parent) {
+    p->dirty = TRUE;
+  }
+}
+
+void
+SoBoundingBoxTrackerP::markSubgraphDirty(Entry * entry)
+{
+  entry->dirty = TRUE;
+  for (int i = 0; i < entry->children.getLength(); i++) {
+    SoBoundingBoxTrackerP::markSubgraphDirty(entry->children[i]);
+  }
+}
+
+// The traversal state after entry has changed. Mark everything that
+// sees this state, i.e. all later siblings up to the closest
+// separator.
+void
+SoBoundingBoxTrackerP::markStateDirty(Entry * entry)
+{
+  for (Entry * p = entry->parent; p; entry = p, p = p->parent) {
+    const int n = p->children.getLength();
+    for (int i = p->children.find(entry) + 1; i < n; i++) {
+      SoBoundingBoxTrackerP::markSubgraphDirty(p->children[i]);
+    }
+    SoBoundingBoxTrackerP::markDirty(p);
+    if (p->kind == SEPARATOR) break;
+  }
+}
+
+void
+SoBoundingBoxTrackerP::nodeChanged(NodeRecord * record, SoNode * trigger)
+{
+  for (int i = 0; i < record->entries.getLength(); i++) {
+    Entry * entry = record->entries[i];
+    if (entry->kind == LEAF) {
+      SoBoundingBoxTrackerP::markDirty(entry);
+      if (entry->node->affectsState()) {
+        SoBoundingBoxTrackerP::markStateDirty(entry);
+      }
+    }
+    // changes below a group are handled by the child entries, but
+    // changes to the group itself (fields or children) means that
+    // the children must be found again
+    else if (trigger == entry->node) {
+      entry->rebuild = TRUE;
+      SoBoundingBoxTrackerP::markDirty(entry);
+      if (entry->kind != SEPARATOR) {
+        SoBoundingBoxTrackerP::markStateDirty(entry);
+      }
+    }
+  }
+}
+
+// The notification records lead from the root back to the changed
+// node. All the tracked nodes on the way get to check the change,
+// just as if each of them had a sensor of its own.
+void
+SoBoundingBoxTrackerP::notified(SoNotList * list)
+{
+  const SoNotRec * first = list->getFirstRecAtNode();
+  SoNode * trigger = first ? static_cast<SoNode *>(first->getBase()) : this->root;
+
+  const SoType nodetype = SoNode::getClassTypeId();
+  for (const SoNotRec * rec = list->getLastRec(); rec; rec = rec->getPrevious()) {
+    SoBase * base = rec->getBase();
+    NodeRecord * record;
+    if (base && base->isOfType(nodetype) &&
+        this->records.get(static_cast<SoNode *>(base), record)) {
+      this->nodeChanged(record, trigger);
+    }
+    if (rec == first) break;
+  }
+}
+
+// *************************************************************************
+
+// Traverses entry, recalculating the bounding boxes of all dirty
+// entries. If needstate is TRUE, the traversal state after entry
+// must be correct even if nothing below entry is dirty.
+void
+SoBoundingBoxTrackerP::traverse(SoBoundingBoxTrackerAction * action, Entry * entry,
+                                SbBool needstate)
+{
+  if (!entry->dirty && (!needstate || entry->kind == SEPARATOR)) return;
+
+  // the type of entry might change, typically for an SoSwitch
+  // switching to or from SO_SWITCH_INHERIT
+  if (entry->dirty) {
+    const EntryKind kind = SoBoundingBoxTrackerP::getKind(entry->node);
+    if (kind != entry->kind) {
+      for (int i = 0; i < entry->children.getLength(); i++) {
+        this->deleteEntry(entry->children[i]);
+      }
+      entry->children.truncate(0);
+      entry->kind = kind;
+      entry->rebuild = TRUE;
+    }
+  }
+
+  if (entry->kind == LEAF) {
+    if (entry->dirty) {
+      action->getXfBoundingBox().makeEmpty();
+      action->resetCenter();
+      action->traverse(entry->node);
+      entry->box = action->getBoundingBox();
+      entry->dirty = FALSE;
+      this->numupdated++;
+    }
+    else if (entry->node->affectsState()) {
+      action->traverse(entry->node);
+    }
+    return;
+  }
+
+  if (entry->rebuild) this->rebuildChildren(entry);
+
+  SoState * state = action->getState();
+  if (entry->kind == SEPARATOR) state->push();
+  if (entry->kind == SWITCH) {
+    const SoSwitch * sw = static_cast<const SoSwitch *>(entry->node);
+    SoSwitchElement::set(state, sw->whichChild.isIgnored() ?
+                         SO_SWITCH_NONE : sw->whichChild.getValue());
+  }
+
+  const int n = entry->children.getLength();
+  int lastdirty = -1;
+  for (int i = 0; i < n; i++) {
+    if (entry->children[i]->dirty) lastdirty = i;
+  }
+  const SbBool passstate = needstate && entry->kind != SEPARATOR;
+  const int last = passstate ? n - 1 : lastdirty;
+  for (int i = 0; i <= last; i++) {
+    Entry * child = entry->children[i];
+    action->pushCurPath(child->childindex, child->node);
+    this->traverse(action, child, passstate || i < lastdirty);
+    action->popCurPath();
+  }
+
+  if (entry->kind == SEPARATOR) state->pop();
+
+  if (entry->dirty) {
+    entry->box.makeEmpty();
+    for (int i = 0; i < n; i++) {
+      entry->box.extendBy(entry->children[i]->box);
+    }
+    entry->dirty = FALSE;
+  }
+}
+
+// *************************************************************************
+
+/*!
+  Constructor. The \a vp viewport region is used for the
+  SoGetBoundingBoxAction traversals.
+*/
+SoBoundingBoxTracker::SoBoundingBoxTracker(const SbViewportRegion & vp)
+{
+  PRIVATE(this)->action = new SoBoundingBoxTrackerAction(vp, &PRIVATE(this).get());
+  PRIVATE(this)->sensor = new SoBoundingBoxTrackerSensor(&PRIVATE(this).get());
+}
+
+/*!
+  Destructor.
+*/
+SoBoundingBoxTracker::~SoBoundingBoxTracker()
+{
+  this->setSceneGraph(NULL);
+  delete PRIVATE(this)->sensor;
+  delete PRIVATE(this)->action;
+}
+
+/*!
+  Sets the scene graph to track. Pass \c NULL to stop tracking the
+  current scene graph.
+*/
+void
+SoBoundingBoxTracker::setSceneGraph(SoNode * root)
+{
+  if (root) root->ref();
+  PRIVATE(this)->sensor->detach();
+  if (PRIVATE(this)->rootentry) {
+    PRIVATE(this)->deleteEntry(PRIVATE(this)->rootentry);
+    PRIVATE(this)->rootentry = NULL;
+  }
+  if (PRIVATE(this)->root) PRIVATE(this)->root->unref();
+  PRIVATE(this)->root = root;
+  if (root) {
+    PRIVATE(this)->rootentry = PRIVATE(this)->createEntry(root, NULL, -1);
+    PRIVATE(this)->sensor->attach(root);
+  }
+  PRIVATE(this)->box.makeEmpty();
+}
+
+/*!
+  Returns the tracked scene graph.
+*/
+SoNode *
+SoBoundingBoxTracker::getSceneGraph(void) const
+{
+  return PRIVATE(this)->root;
+}
+
+/*!
+  Sets the viewport region used when calculating bounding boxes. This
+  invalidates all the tracked bounding boxes.
+*/
+void
+SoBoundingBoxTracker::setViewportRegion(const SbViewportRegion & vp)
+{
+  PRIVATE(this)->action->setViewportRegion(vp);
+  this->invalidate();
+}
+
+/*!
+  Returns the viewport region used when calculating bounding boxes.
+*/
+const SbViewportRegion &
+SoBoundingBoxTracker::getViewportRegion(void) const
+{
+  return PRIVATE(this)->action->getViewportRegion();
+}
+
+/*!
+  Returns the world space bounding box of the scene graph, updating
+  the parts of the graph that changed since the last call.
+*/
+const SbBox3f &
+SoBoundingBoxTracker::getBoundingBox(void)
+{
+  PRIVATE(this)->numupdated = 0;
+  Entry * rootentry = PRIVATE(this)->rootentry;
+  if (rootentry && rootentry->dirty) {
+    PRIVATE(this)->action->apply(PRIVATE(this)->root);
+    PRIVATE(this)->box = rootentry->box;
+  }
+  return PRIVATE(this)->box;
+}
+
+/*!
+  Returns \c FALSE if the scene graph has changed since the bounding
+  box was last calculated.
+*/
+SbBool
+SoBoundingBoxTracker::isValid(void) const
+{
+  return PRIVATE(this)->rootentry == NULL || !PRIVATE(this)->rootentry->dirty;
+}
+
+/*!
+  Forces a full recalculation of the bounding box the next time
+  getBoundingBox() is called. This is normally not needed, as changes
+  in the scene graph are detected automatically, but might be useful
+  if the scene contains nodes with bounding boxes depending on
+  something else than the scene graph and the viewport region.
+*/
+void
+SoBoundingBoxTracker::invalidate(void)
+{
+  if (PRIVATE(this)->rootentry) {
+    SoBoundingBoxTrackerP::markSubgraphDirty(PRIVATE(this)->rootentry);
+  }
+}
+
+/*!
+  Returns the number of leaf nodes (shapes and other nodes that are
+  not SoGroup, SoSeparator or SoSwitch nodes) that had their bounding
+  box recalculated in the last call to getBoundingBox().
+*/
+int
+SoBoundingBoxTracker::getNumUpdatedNodes(void) const
+{
+  return PRIVATE(this)->numupdated;
+}
+
+#undef PRIVATE
+
+// *************************************************************************
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+BOOST_AUTO_TEST_CASE(incrementalUpdate)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoGroup * group = new SoGroup;
+  root->addChild(group);
+  SoTranslation * trans = new SoTranslation;
+  group->addChild(trans);
+  for (int i = 0; i < 10; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * t = new SoTranslation;
+    t->translation.setValue(float(i) * 3.0f, 0.0f, 0.0f);
+    sep->addChild(t);
+    sep->addChild(new SoCube);
+    group->addChild(sep);
+  }
+  SoSwitch * sw = new SoSwitch;
+  sw->addChild(new SoSphere);
+  root->addChild(sw);
+
+  SbViewportRegion vp(100, 100);
+  SoBoundingBoxTracker tracker(vp);
+  tracker.setSceneGraph(root);
+  SoGetBoundingBoxAction bba(vp);
+
+  bba.apply(root);
+  BOOST_CHECK(tracker.getBoundingBox() == bba.getBoundingBox());
+  BOOST_CHECK_EQUAL(tracker.getNumUpdatedNodes(), 21);
+
+  // nothing changed
+  tracker.getBoundingBox();
+  BOOST_CHECK_EQUAL(tracker.getNumUpdatedNodes(), 0);
+
+  // a single shape
+  SoSeparator * last = static_cast<SoSeparator *>(group->getChild(10));
+  static_cast<SoCube *>(last->getChild(1))->width = 10.0f;
+  bba.apply(root);
+  BOOST_CHECK(tracker.getBoundingBox() == bba.getBoundingBox());
+  BOOST_CHECK_EQUAL(tracker.getNumUpdatedNodes(), 1);
+
+  // the translation affects all the separators and the switch
+  trans->translation.setValue(0.0f, 5.0f, 0.0f);
+  bba.apply(root);
+  BOOST_CHECK(tracker.getBoundingBox() == bba.getBoundingBox());
+  BOOST_CHECK_EQUAL(tracker.getNumUpdatedNodes(), 21);
+
+  // the switch child is only traversed when switched on
+  sw->whichChild = 0;
+  sw->addChild(new SoCube);
+  bba.apply(root);
+  BOOST_CHECK(tracker.getBoundingBox() == bba.getBoundingBox());
+  BOOST_CHECK_EQUAL(tracker.getNumUpdatedNodes(), 1);
+
+  // removing a child
+  group->removeChild(10);
+  bba.apply(root);
+  BOOST_CHECK(tracker.getBoundingBox() == bba.getBoundingBox());
+
+  // a node used twice in the graph updates both instances
+  SoCube * shared = new SoCube;
+  SoSeparator * first = new SoSeparator;
+  first->addChild(shared);
+  SoSeparator * second = new SoSeparator;
+  SoTranslation * offset = new SoTranslation;
+  offset->translation.setValue(0.0f, 0.0f, -20.0f);
+  second->addChild(offset);
+  second->addChild(shared);
+  root->addChild(first);
+  root->addChild(second);
+  bba.apply(root);
+  BOOST_CHECK(tracker.getBoundingBox() == bba.getBoundingBox());
+  shared->depth = 30.0f;
+  bba.apply(root);
+  BOOST_CHECK(tracker.getBoundingBox() == bba.getBoundingBox());
+  BOOST_CHECK_EQUAL(tracker.getNumUpdatedNodes(), 2);
+
+  tracker.setSceneGraph(NULL);
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -115,6 +115,7 @@
 #include "misc/CoinStaticObjectInDLL.h"
 #include "misc/systemsanity.icc"
 #include "misc/SoDBP.h"
+#include "engines/SoConvertAll.h"
 #include "misc/SbHash.h"
 #include "misc/SoConfigSettings.h"
 #include "rendering/SoVBO.h"
@@ -1088,6 +1089,18 @@ SoDB::doSelect(int COIN_UNUSED_ARG(nfds), void * COIN_UNUSED_ARG(readfds), void
  */
 void
 SoDB::addConverter(SoType from, SoType to, SoType converter)
+{
+  // The built-in conversions are registered on demand. Make sure
+  // they are in place before adding to them, so they can still be
+  // overridden.
+  SoConvertAll::initConverters();
+  SoDBP::addConverter(from, to, converter);
+}
+
+// Registers a converter without triggering registration of the
+// built-in conversions.
+void
+SoDBP::addConverter(SoType from, SoType to, SoType converter)
 {
   const uint32_t linkid = (((uint32_t)from.getKey()) << 16) + to.getKey();
   SbBool nonexist = SoDBP::converters->put(linkid, converter.getKey());
@@ -1116,6 +1129,8 @@ SoDB::addConverter(SoType from, SoType to, SoType converter)
 SoType
 SoDB::getConverter(SoType from, SoType to)
 {
+  SoConvertAll::initConverters();
+
   uint32_t val = (((uint32_t)from.getKey()) << 16) + to.getKey();
   int16_t key;
   if (!SoDBP::converters->get(val, key)) { return SoType::badType(); }
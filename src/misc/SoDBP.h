@@ -83,6 +83,7 @@ public:
   static void removeRealTimeFieldCB(void);
   static void updateRealTimeFieldCB(void * data, SoSensor * sensor);
   static void listWin32ProcessModules(void);
+  static void addConverter(SoType from, SoType to, SoType converter);
 
 #ifdef COIN_THREADSAFE
   static SbRWMutex * globalmutex;
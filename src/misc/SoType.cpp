@@ -167,7 +167,8 @@ struct SoTypeData {
              const SoType theParent = SoType::badType(),
              const SoType::instantiationMethod createMethod = NULL)
     : name(theName), type(type), isPublic(ispublic), data(theData),
-      parent(theParent), method(createMethod) { };
+      parent(theParent), method(createMethod), depth(0), ancestors(NULL) { };
+  ~SoTypeData() { delete[] this->ancestors; }
 
   SbName name;
   SoType type;
@@ -175,6 +176,13 @@ struct SoTypeData {
   uint16_t data;
   SoType parent;
   SoType::instantiationMethod method;
+
+  // The number of parents above this type, and the keys of all the
+  // types from the root of the type hierarchy down to and including
+  // this type. Used to make SoType::isDerivedFrom() a constant time
+  // test: type A is derived from B if A's ancestor at B's depth is B.
+  int depth;
+  int16_t * ancestors;
 };
 
 // OBSOLETED: this code was only active for GCC 2.7.x, and I don't
@@ -299,6 +307,18 @@ SoType::createType(const SoType parent, const SbName name,
   SoType newType;
   newType.index = SoType::typedatalist->getLength();
   SoTypeData * typeData = new SoTypeData(name, newType, TRUE, data, parent, method);
+  const SoTypeData * parentdata =
+    parent.isBad() ? NULL : (*SoType::typedatalist)[(int)parent.getKey()];
+  if (parentdata) {
+    typeData->depth = parentdata->depth + 1;
+    typeData->ancestors = new int16_t[typeData->depth + 1];
+    (void)memcpy(typeData->ancestors, parentdata->ancestors,
+                 typeData->depth * sizeof(int16_t));
+  }
+  else {
+    typeData->ancestors = new int16_t[1];
+  }
+  typeData->ancestors[typeData->depth] = newType.getKey();
   SoType::typedatalist->append(typeData);
 
   // add to dictionary for fast lookup
@@ -518,16 +538,22 @@ SoType::fromName(const SbName name)
 
   assert((type_dict != NULL) && "SoType static class data not yet initialized");
 
+  // The common case is that the name is registered as is, so try that
+  // before doing anything else.
+  int16_t index = 0;
+  if (type_dict->get(name.getString(), index)) {
+    assert(index >= 0 && index < SoType::typedatalist->getLength());
+    return (*SoType::typedatalist)[index]->type;
+  }
+
   // It should be possible to specify a type name with the "So" prefix
   // and get the correct type id, even though the types in some type
   // hierarchies are named internally without the prefix.
-  SbString tmp(name.getString());
-  if ( tmp.compareSubString("So") == 0 ) tmp = tmp.getSubString(2);
-  SbName noprefixname(tmp);
+  const char * namestr = name.getString();
+  const SbName noprefixname((namestr[0] == 'S' && namestr[1] == 'o') ?
+                            namestr + 2 : namestr);
 
-  int16_t index = 0;
-  if (!type_dict->get(name.getString(), index) &&
-      !type_dict->get(noprefixname.getString(), index)) {
+  if (!type_dict->get(noprefixname.getString(), index)) {
     if ( !SoDB::isInitialized() ) {
       return SoType::badType();
     }
@@ -747,19 +773,13 @@ SoType::isDerivedFrom(const SoType parent) const
     return FALSE;
   }
 
-  SoType type = *this;
-  do {
-#if COIN_DEBUG && 0 // debug
-    SoDebugError::postInfo("SoType::isDerivedFrom",
-                           "this: '%s' parent: '%s'",
-                           type.getName().getString(),
-                           parent.getName().getString());
-#endif // debug
-    if (type == parent) return TRUE;
-    type = (*SoType::typedatalist)[(int)type.getKey()]->parent;
-  } while (!type.isBad());
+  const SoTypeData * typedata = (*SoType::typedatalist)[(int)this->getKey()];
+  const SoTypeData * parentdata = (*SoType::typedatalist)[(int)parent.getKey()];
+  if (parentdata == NULL) return FALSE; // removed type
 
-  return FALSE;
+  return
+    (parentdata->depth <= typedata->depth) &&
+    (typedata->ancestors[parentdata->depth] == parent.getKey());
 }
 
 /*!
@@ -987,4 +1007,28 @@ BOOST_AUTO_TEST_CASE(testRemoveType)
                       "Type didn't deregister correctly");
 }
 
+BOOST_AUTO_TEST_CASE(testIsDerivedFrom)
+{
+  SoType base = SoType::createType(SoNode::getClassTypeId(), SbName("MyBase"));
+  SoType derived = SoType::createType(base, SbName("MyDerived"), createInstance, 0);
+  SoType other = SoType::createType(SoNode::getClassTypeId(), SbName("MyOther"));
+
+  BOOST_CHECK_MESSAGE(derived.isDerivedFrom(derived), "type not derived from itself");
+  BOOST_CHECK_MESSAGE(derived.isDerivedFrom(base), "type not derived from parent");
+  BOOST_CHECK_MESSAGE(derived.isDerivedFrom(SoNode::getClassTypeId()),
+                      "type not derived from grandparent");
+  BOOST_CHECK_MESSAGE(derived.isDerivedFrom(SoBase::getClassTypeId()),
+                      "type not derived from root");
+  BOOST_CHECK_MESSAGE(!base.isDerivedFrom(derived), "parent derived from child");
+  BOOST_CHECK_MESSAGE(!derived.isDerivedFrom(other), "type derived from sibling of parent");
+  BOOST_CHECK_MESSAGE(!other.isDerivedFrom(base), "type derived from sibling");
+
+  BOOST_CHECK_MESSAGE(SoType::fromName(SbName("SoMyDerived")) == derived,
+                      "lookup with \"So\" prefix failed");
+
+  SoType::removeType(SbName("MyDerived"));
+  SoType::removeType(SbName("MyOther"));
+  SoType::removeType(SbName("MyBase"));
+}
+
 #endif // COIN_TEST_SUITE
@@ -52,6 +52,7 @@
 #include "CoinStaticObjectInDLL.cpp"
 #include "SoAudioDevice.cpp"
 #include "SoBaseP.cpp"
+#include "SoBoundingBoxTracker.cpp"
 #include "SoChildList.cpp"
 #include "SoCompactPathList.cpp"
 #include "SoConfigSettings.cpp"
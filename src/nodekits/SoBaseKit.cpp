@@ -551,10 +551,13 @@
 #include <Inventor/errors/SoReadError.h>
 #include <Inventor/C/tidbits.h> // coin_isspace()
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/threads/SbStorage.h>
 
 #include "coindefs.h" // COIN_OBSOLETED()
 #include "io/SoWriterefCounter.h"
 #include "nodekits/SoSubKitP.h"
+#include "misc/SbHash.h"
+#include "tidbitsp.h" // coin_atexit()
 
 class SoBaseKitP {
 public:
@@ -579,8 +582,72 @@ public:
   void setParts(SbList <SoNode*> partlist, const SbBool leafparts);
 
   SbBool readUnknownFields(SoInput *in, SoFieldData *&unknownFieldData );
+
+  // A part name like "childList[2].appearance.material" parsed into
+  // its period-separated components.
+  class PartToken {
+  public:
+    SbName name;
+    int listidx;
+    SbBool islist;
+    SbBool badindex;
+  };
+  typedef SbList<PartToken> PartPath;
+
+  static void parsePartPath(const char * partname, PartPath & tokens);
+  static const PartPath * getPartPath(const SbName & partname);
+  static SbBool findPart(const PartToken * tokens, const int numtokens,
+                         SoBaseKit *& kit, int & partnum,
+                         SbBool & islist, int & listidx,
+                         const SbBool makeifneeded, SoPath * path,
+                         const SbBool recsearch);
+
+  // Parsed part names are cached, keyed on the SbName string, since
+  // applications tend to access the same few parts over and over. The
+  // cache is kept per thread, so that looking up a part name doesn't
+  // need a lock.
+  typedef SbHash<const char *, PartPath *> PartPathCache;
+  static SbStorage * partpathstorage;
+  static void partpathcacheConstruct(void * closure);
+  static void partpathcacheDestruct(void * closure);
+  static void atexit_cleanup(void);
 };
 
+SbStorage * SoBaseKitP::partpathstorage = NULL;
+
+// Upper bound on the number of cached part names. List element
+// indices are part of the name, so the set of names is not
+// necessarily bounded.
+static const unsigned int SOBASEKIT_MAX_CACHED_PARTPATHS = 1024;
+
+void
+SoBaseKitP::partpathcacheConstruct(void * closure)
+{
+  PartPathCache ** cache = static_cast<PartPathCache **>(closure);
+  *cache = new PartPathCache;
+}
+
+void
+SoBaseKitP::partpathcacheDestruct(void * closure)
+{
+  PartPathCache * cache = *static_cast<PartPathCache **>(closure);
+  SbList<const char *> keys;
+  cache->makeKeyList(keys);
+  for (int i = 0; i < keys.getLength(); i++) {
+    PartPath * tokens = NULL;
+    (void) cache->get(keys[i], tokens);
+    delete tokens;
+  }
+  delete cache;
+}
+
+void
+SoBaseKitP::atexit_cleanup(void)
+{
+  delete SoBaseKitP::partpathstorage;
+  SoBaseKitP::partpathstorage = NULL;
+}
+
 #define PRIVATE(p) ((p)->pimpl)
 #define PUBLIC(p) ((p)->kit)
 
@@ -640,16 +707,17 @@ SoBaseKit::SoBaseKit(void)
   //
   // SO_KIT_ADD_CATALOG_ENTRY(this, SoBaseKit, TRUE, "", "", FALSE);
 
-  SoBaseKit::classcatalog->addEntry("this",
-                                    SoBaseKit::getClassTypeId(),
-                                    SoBaseKit::getClassTypeId(),
-                                    TRUE,
-                                    "",
-                                    "",
-                                    FALSE,
-                                    SoType::badType(),
-                                    SoType::badType(),
-                                    FALSE);
+  if (!PRIVATE_KIT_CATALOG_IS_SET_UP())
+    SoBaseKit::classcatalog->addEntry("this",
+                                      SoBaseKit::getClassTypeId(),
+                                      SoBaseKit::getClassTypeId(),
+                                      TRUE,
+                                      "",
+                                      "",
+                                      FALSE,
+                                      SoType::badType(),
+                                      SoType::badType(),
+                                      FALSE);
 
   SO_KIT_ADD_CATALOG_LIST_ENTRY(callbackList, SoSeparator, TRUE, this, "", SoCallback, TRUE);
   SO_KIT_ADD_LIST_ITEM_TYPE(callbackList, SoEventCallback);
@@ -684,6 +752,12 @@ SoBaseKit::initClass(void)
   SoAudioRenderAction::addMethod(type,
                                  SoAudioRenderAction::callDoAction);
   SoBaseKit::searchchildren = FALSE;
+
+  SoBaseKitP::partpathstorage =
+    new SbStorage(sizeof(SoBaseKitP::PartPathCache *),
+                  SoBaseKitP::partpathcacheConstruct,
+                  SoBaseKitP::partpathcacheDestruct);
+  coin_atexit((coin_atexit_f*) SoBaseKitP::atexit_cleanup, CC_ATEXIT_NORMAL);
 }
 
 /*!
@@ -1644,7 +1718,7 @@ SoBaseKit::getContainerNode(const SbName & listname, SbBool makeifneeded)
   int partNum;
   SbBool isList;
   int listIdx;
-  if (SoBaseKit::findPart(SbString(listname.getString()), kit, partNum,
+  if (SoBaseKit::findPart(listname, kit, partNum,
                           isList, listIdx, makeifneeded, NULL, TRUE)) {
     SoNode * node = PRIVATE(kit)->instancelist[partNum]->getValue();
     if (node == NULL) return NULL;
@@ -1702,9 +1776,7 @@ SoBaseKit::getAnyPart(const SbName & partname, SbBool makeifneeded,
   SbBool isList;
   int listIdx;
 
-  SbString partstring(partname.getString());
-
-  if (SoBaseKit::findPart(partstring, kit, partNum, isList, listIdx,
+  if (SoBaseKit::findPart(partname, kit, partNum, isList, listIdx,
                           makeifneeded, NULL, TRUE)) {
 
     if (publiccheck && !kit->getNodekitCatalog()->isPublic(partNum)) {
@@ -1818,7 +1890,7 @@ SoBaseKit::createPathToAnyPart(const SbName & partname, SbBool makeifneeded,
   SbBool isList;
   int listIdx;
 
-  if (SoBaseKit::findPart(SbString(partname.getString()), kit, partNum,
+  if (SoBaseKit::findPart(partname, kit, partNum,
                           isList, listIdx, makeifneeded, path)) {
     const SoNodekitCatalog * catalog = kit->getNodekitCatalog();
     if ((leafcheck && ! catalog->isLeaf(partNum)) ||
@@ -1881,13 +1953,11 @@ SoBaseKit::setAnyPart(const SbName & partname, SoNode * from, SbBool anypart)
   SbBool isList;
   int listIdx;
 
-  SbString partstring(partname.getString());
-
   // FIXME: findPart() really needs another parameter, since we need
   // to create intermediate parts, but not the leaf part. For now we
   // just supply makeifneeded = TRUE, and then immediately overwrite
   // the part here. pederb, 2004-06-07
-  if (SoBaseKit::findPart(partstring, kit, partNum, isList, listIdx, TRUE, NULL, TRUE)) {
+  if (SoBaseKit::findPart(partname, kit, partNum, isList, listIdx, TRUE, NULL, TRUE)) {
     if (anypart || kit->getNodekitCatalog()->isPublic(partNum)) {
       if (isList) {
         SoNode * partnode = PRIVATE(kit)->instancelist[partNum]->getValue();
@@ -1969,12 +2039,27 @@ SoBaseKit::createFieldList(void)
   const SoNodekitCatalog * catalog = this->getNodekitCatalog();
   // only do this if the catalog has been created
   if (catalog) {
-    PRIVATE(this)->instancelist.truncate(0);
-    PRIVATE(this)->instancelist.append(NULL); // first catalog entry is "this"
-    for (int i = 1; i < catalog->getNumEntries(); i++) {
-      PRIVATE(this)->instancelist.append((SoSFNode *)this->getField(catalog->getName(i)));
-      assert(PRIVATE(this)->instancelist[i] != NULL);
+    SbList<SoSFNode*> & instancelist = PRIVATE(this)->instancelist;
+    const int numentries = catalog->getNumEntries();
+    instancelist.truncate(0);
+    // first catalog entry is "this", and has no field
+    for (int i = 0; i < numentries; i++) instancelist.append(NULL);
+
+    // Match fields to parts in a single pass over the fields, instead
+    // of searching the fields for each part name.
+    const SoFieldData * fielddata = this->getFieldData();
+    const int numfields = fielddata->getNumFields();
+    for (int i = 0; i < numfields; i++) {
+      const int part = catalog->getPartNumber(fielddata->getFieldName(i));
+      if (part > 0) {
+        instancelist[part] = (SoSFNode *)fielddata->getField(this, i);
+      }
+    }
+#if COIN_DEBUG
+    for (int i = 1; i < numentries; i++) {
+      assert(instancelist[i] != NULL);
     }
+#endif // COIN_DEBUG
   }
 }
 
@@ -2158,6 +2243,25 @@ SbBool
 SoBaseKit::findPart(const SbString & partname, SoBaseKit *& kit, int & partnum,
                     SbBool & islist, int & listidx, const SbBool makeifneeded,
                     SoPath * path, const SbBool recsearch)
+{
+  // Part names with list indices are parsed without being made into
+  // an SbName, since SbName strings are never freed and the indices
+  // make the set of such names unbounded.
+  if (strchr(partname.getString(), '[') == NULL) {
+    return SoBaseKit::findPart(SbName(partname.getString()), kit, partnum,
+                               islist, listidx, makeifneeded, path, recsearch);
+  }
+  SoBaseKitP::PartPath tokens;
+  SoBaseKitP::parsePartPath(partname.getString(), tokens);
+  return SoBaseKitP::findPart(tokens.getArrayPtr(), tokens.getLength(),
+                              kit, partnum, islist, listidx,
+                              makeifneeded, path, recsearch);
+}
+
+SbBool
+SoBaseKit::findPart(const SbName & partname, SoBaseKit *& kit, int & partnum,
+                    SbBool & islist, int & listidx, const SbBool makeifneeded,
+                    SoPath * path, const SbBool recsearch)
 {
   // BNF:
   //
@@ -2170,142 +2274,17 @@ SoBaseKit::findPart(const SbString & partname, SoBaseKit *& kit, int & partnum,
   // singlelistname is name of a part which is a list
   // idx is an integer value
 
-  if (partname == "this") {
-    islist = FALSE;
-    partnum = 0;
-    return TRUE;
-  }
-
-  const char * stringptr = partname.getString();
-  const char * periodptr = strchr(stringptr, '.'); // find first period
-  const char * startbracket = strchr(stringptr, '[');
-
-  if (periodptr && (startbracket > periodptr))
-    startbracket = NULL; // will handle later
-
-  islist = FALSE; // set to FALSE first
-  SbString firstpartname;
-  if (startbracket) { // get index
-    long int listindex = strtol(startbracket+1, NULL, 10);
-    if (listindex == LONG_MIN || listindex == LONG_MAX) {
-#if COIN_DEBUG
-      SoDebugError::postWarning("SoBaseKit::findPart",
-                                "list index not properly specified");
-#endif // COIN_DEBUG
-      return FALSE;
-    }
-    const ptrdiff_t endidx = startbracket - stringptr - 1;
-    firstpartname = partname.getSubString(0, (int)endidx);
-    listidx = (int) listindex;
-    islist = TRUE;
-  }
-  else if (periodptr) {
-    const ptrdiff_t endidx = periodptr - stringptr - 1;
-    firstpartname = partname.getSubString(0, (int)endidx);
-  }
-  else firstpartname = partname;
-
-  partnum = kit->getNodekitCatalog()->getPartNumber(firstpartname);
-  if (partnum == SO_CATALOG_NAME_NOT_FOUND) {
-    if (recsearch) { // search leaf nodekits for this part?
-      SoBaseKit * orgkit = kit;
-      assert(path == NULL); // should not do recsearch when creating path
-      const SoNodekitCatalog * catalog = orgkit->getNodekitCatalog();
-      for (int i = 1; i < PRIVATE(orgkit)->instancelist.getLength(); i++) {
-        if (catalog->isLeaf(i) &&
-            catalog->getType(i).isDerivedFrom(SoBaseKit::getClassTypeId())) {
-          kit = (SoBaseKit *)PRIVATE(orgkit)->instancelist[i]->getValue();
-          SbBool didexist = kit != NULL;
-          if (!didexist) {
-            if (!makeifneeded) continue;
-            orgkit->makePart(i);
-            kit = (SoBaseKit *)PRIVATE(orgkit)->instancelist[i]->getValue();
-          }
-          if (SoBaseKit::findPart(partname, kit, partnum, islist, listidx,
-                                  makeifneeded, path, recsearch)) {
-            return TRUE;
-          }
-          else if (!didexist) {
-            // we created this part, remove it
-            orgkit->setPart(i, NULL);
-          }
-        }
-      }
-      kit = orgkit; // return with an error in this kit
-    }
-    // nope, not found
-    return FALSE;
-  }
-
-  assert(partnum < PRIVATE(kit)->instancelist.getLength());
-  SoSFNode * nodefield = PRIVATE(kit)->instancelist[partnum];
-  assert(nodefield);
-
-  if (makeifneeded && nodefield->getValue() == NULL) {
-    kit->makePart(partnum);
-  }
-
-  if (path) {
-    const SoNodekitCatalog * catalog = kit->getNodekitCatalog();
-    SbList <SoNode*> nodestopart;
-    int parent = catalog->getParentPartNumber(partnum);
-    while (parent > 0) {
-      SoNode * node = PRIVATE(kit)->instancelist[parent]->getValue();
-      if (node == NULL) {
-        assert(makeifneeded == FALSE);
-        break;
-      }
-      nodestopart.push(node);
-      parent = catalog->getParentPartNumber(parent);
-    }
-    assert(parent == 0 || !makeifneeded);
-    while (nodestopart.getLength()) {
-      SoNode * node = nodestopart.pop();
-      path->append(node);
-    }
-  }
-
-  if (periodptr == NULL) {
-    // singlename or singlelistname found, do not recurse any more
-    return TRUE; // all info has been found, just return TRUE
-  }
-  else { // recurse
-    SoNode * node = nodefield->getValue();
-    if (node == NULL) return FALSE;
-    const ptrdiff_t startidx = periodptr - stringptr + 1;
-    SbString newpartname = partname.getSubString((int)startidx);
-    if (islist) {
-      SoNodeKitListPart * list = (SoNodeKitListPart *) node;
-      int numlistchildren = list->getNumChildren();
-      if (listidx < 0 || listidx > numlistchildren || (!makeifneeded && listidx == numlistchildren)) {
-#if COIN_DEBUG
-        SoDebugError::postWarning("SoBaseKit::findPart",
-                                  "index %d out of bounds for part \"%s\"",
-                                  listidx,
-                                  firstpartname.getString());
-#endif // COIN_DEBUG
-        return FALSE;
-      }
-      else if (listidx == numlistchildren) {
-        (void) list->createAndAddDefaultChild();
-      }
-      SoNode * partnode = list->getChild(listidx);
-      assert(partnode && partnode->isOfType(SoBaseKit::getClassTypeId()));
-      kit = (SoBaseKit *)partnode;
-
-      if (path) {
-        path->append(list);
-        path->append(list->getContainerNode());
-      }
-    }
-    else {
-      assert(node->isOfType(SoBaseKit::getClassTypeId()));
-      kit = (SoBaseKit *)node;
-    }
-    if (path) path->append(kit);
-    return SoBaseKit::findPart(newpartname, kit, partnum, islist,
-                               listidx, makeifneeded, path, recsearch);
-  }
+  const SoBaseKitP::PartPath * tokens = SoBaseKitP::getPartPath(partname);
+  if (tokens) {
+    return SoBaseKitP::findPart(tokens->getArrayPtr(), tokens->getLength(),
+                                kit, partnum, islist, listidx,
+                                makeifneeded, path, recsearch);
+  }
+  SoBaseKitP::PartPath tmp;
+  SoBaseKitP::parsePartPath(partname.getString(), tmp);
+  return SoBaseKitP::findPart(tmp.getArrayPtr(), tmp.getLength(),
+                              kit, partnum, islist, listidx,
+                              makeifneeded, path, recsearch);
 }
 
 //
@@ -2484,6 +2463,188 @@ SoBaseKit::findNodeInThisKit(SoNode * node, const int parentnum) const
 // the correct write order: non-part fields first, then leaf parts,
 // then non-leaf parts.
 //
+// Splits a part name into its period-separated components. The list
+// index of a list element, as in "childList[2]", is parsed up front.
+void
+SoBaseKitP::parsePartPath(const char * partname, PartPath & tokens)
+{
+  const char * start = partname;
+  for (;;) {
+    const char * period = strchr(start, '.');
+    const char * end = period ? period : start + strlen(start);
+    const char * bracket = static_cast<const char *>(memchr(start, '[', end - start));
+
+    PartToken token;
+    token.islist = bracket != NULL;
+    token.badindex = FALSE;
+    token.listidx = 0;
+    const char * nameend = bracket ? bracket : end;
+    if (nameend > start) {
+      token.name = SbName(SbString(start, 0, (int)(nameend - start) - 1).getString());
+    }
+    else {
+      token.name = SbName::empty();
+    }
+    if (bracket) {
+      long int listindex = strtol(bracket+1, NULL, 10);
+      if (listindex == LONG_MIN || listindex == LONG_MAX) {
+        token.badindex = TRUE;
+      }
+      token.listidx = (int) listindex;
+    }
+    tokens.append(token);
+
+    if (period == NULL) break;
+    start = period + 1;
+  }
+}
+
+// Returns the parsed components of partname from this thread's
+// cache, or NULL if partname is not cached and the cache is full.
+const SoBaseKitP::PartPath *
+SoBaseKitP::getPartPath(const SbName & partname)
+{
+  PartPathCache * cache =
+    *static_cast<PartPathCache **>(SoBaseKitP::partpathstorage->get());
+  PartPath * tokens = NULL;
+  if (!cache->get(partname.getString(), tokens) &&
+      cache->getNumElements() < SOBASEKIT_MAX_CACHED_PARTPATHS) {
+    tokens = new PartPath;
+    SoBaseKitP::parsePartPath(partname.getString(), *tokens);
+    (void) cache->put(partname.getString(), tokens);
+  }
+  return tokens;
+}
+
+// Searches for the part given by the parsed part name tokens. See
+// SoBaseKit::findPart().
+SbBool
+SoBaseKitP::findPart(const PartToken * tokens, const int numtokens,
+                     SoBaseKit *& kit, int & partnum,
+                     SbBool & islist, int & listidx,
+                     const SbBool makeifneeded, SoPath * path,
+                     const SbBool recsearch)
+{
+  const PartToken & token = tokens[0];
+  if (numtokens == 1 && !token.islist && token.name == "this") {
+    islist = FALSE;
+    partnum = 0;
+    return TRUE;
+  }
+
+  islist = token.islist;
+  if (token.islist) {
+    if (token.badindex) {
+#if COIN_DEBUG
+      SoDebugError::postWarning("SoBaseKit::findPart",
+                                "list index not properly specified");
+#endif // COIN_DEBUG
+      return FALSE;
+    }
+    listidx = token.listidx;
+  }
+
+  partnum = kit->getNodekitCatalog()->getPartNumber(token.name);
+  if (partnum == SO_CATALOG_NAME_NOT_FOUND) {
+    if (recsearch) { // search leaf nodekits for this part?
+      SoBaseKit * orgkit = kit;
+      assert(path == NULL); // should not do recsearch when creating path
+      const SoNodekitCatalog * catalog = orgkit->getNodekitCatalog();
+      for (int i = 1; i < PRIVATE(orgkit)->instancelist.getLength(); i++) {
+        if (catalog->isLeaf(i) &&
+            catalog->getType(i).isDerivedFrom(SoBaseKit::getClassTypeId())) {
+          kit = (SoBaseKit *)PRIVATE(orgkit)->instancelist[i]->getValue();
+          SbBool didexist = kit != NULL;
+          if (!didexist) {
+            if (!makeifneeded) continue;
+            orgkit->makePart(i);
+            kit = (SoBaseKit *)PRIVATE(orgkit)->instancelist[i]->getValue();
+          }
+          if (SoBaseKitP::findPart(tokens, numtokens, kit, partnum, islist,
+                                   listidx, makeifneeded, path, recsearch)) {
+            return TRUE;
+          }
+          else if (!didexist) {
+            // we created this part, remove it
+            orgkit->setPart(i, NULL);
+          }
+        }
+      }
+      kit = orgkit; // return with an error in this kit
+    }
+    // nope, not found
+    return FALSE;
+  }
+
+  assert(partnum < PRIVATE(kit)->instancelist.getLength());
+  SoSFNode * nodefield = PRIVATE(kit)->instancelist[partnum];
+  assert(nodefield);
+
+  if (makeifneeded && nodefield->getValue() == NULL) {
+    kit->makePart(partnum);
+  }
+
+  if (path) {
+    const SoNodekitCatalog * catalog = kit->getNodekitCatalog();
+    SbList <SoNode*> nodestopart;
+    int parent = catalog->getParentPartNumber(partnum);
+    while (parent > 0) {
+      SoNode * node = PRIVATE(kit)->instancelist[parent]->getValue();
+      if (node == NULL) {
+        assert(makeifneeded == FALSE);
+        break;
+      }
+      nodestopart.push(node);
+      parent = catalog->getParentPartNumber(parent);
+    }
+    assert(parent == 0 || !makeifneeded);
+    while (nodestopart.getLength()) {
+      SoNode * node = nodestopart.pop();
+      path->append(node);
+    }
+  }
+
+  if (numtokens == 1) {
+    // singlename or singlelistname found, do not recurse any more
+    return TRUE; // all info has been found, just return TRUE
+  }
+  else { // recurse
+    SoNode * node = nodefield->getValue();
+    if (node == NULL) return FALSE;
+    if (islist) {
+      SoNodeKitListPart * list = (SoNodeKitListPart *) node;
+      int numlistchildren = list->getNumChildren();
+      if (listidx < 0 || listidx > numlistchildren || (!makeifneeded && listidx == numlistchildren)) {
+#if COIN_DEBUG
+        SoDebugError::postWarning("SoBaseKit::findPart",
+                                  "index %d out of bounds for part \"%s\"",
+                                  listidx,
+                                  token.name.getString());
+#endif // COIN_DEBUG
+        return FALSE;
+      }
+      else if (listidx == numlistchildren) {
+        (void) list->createAndAddDefaultChild();
+      }
+      SoNode * partnode = list->getChild(listidx);
+      assert(partnode && partnode->isOfType(SoBaseKit::getClassTypeId()));
+      kit = (SoBaseKit *)partnode;
+
+      if (path) {
+        path->append(list);
+        path->append(list->getContainerNode());
+      }
+    }
+    else {
+      assert(node->isOfType(SoBaseKit::getClassTypeId()));
+      kit = (SoBaseKit *)node;
+    }
+    if (path) path->append(kit);
+    return SoBaseKitP::findPart(tokens + 1, numtokens - 1, kit, partnum,
+                                islist, listidx, makeifneeded, path, recsearch);
+  }
+}
+
 void
 SoBaseKitP::createWriteData(void)
 {
@@ -2736,4 +2897,92 @@ SoBaseKitP::readUnknownFields(SoInput *in, SoFieldData *&unknownfielddata)
 #undef PRIVATE
 #undef PUBLIC
 
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodekits/SoNodeKitListPart.h>
+#include <Inventor/nodekits/SoSeparatorKit.h>
+#include <Inventor/nodekits/SoShapeKit.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/threads/SbThread.h>
+
+namespace {
+
+const int BASEKIT_TEST_THREADS = 4;
+
+struct BaseKitTestLookups {
+  SoBaseKit * kit;
+  SbList <SbName> names;
+  SbList <SoNode *> parts;
+  int numwrong;
+};
+
+void *
+basekit_test_thread(void * closure)
+{
+  BaseKitTestLookups * lookups = static_cast<BaseKitTestLookups *>(closure);
+  for (int i = 0; i < 200; i++) {
+    for (int j = 0; j < lookups->names.getLength(); j++) {
+      if (lookups->kit->getPart(lookups->names[j], FALSE) != lookups->parts[j]) {
+        lookups->numwrong++;
+      }
+    }
+  }
+  return NULL;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(partNames)
+{
+  SoSeparatorKit * kit = new SoSeparatorKit;
+  kit->ref();
+  SoNodeKitListPart * list =
+    static_cast<SoNodeKitListPart *>(kit->getPart("childList", TRUE));
+  BOOST_REQUIRE(list != NULL);
+  for (int i = 0; i < 3; i++) list->addChild(new SoShapeKit);
+
+  // list indices in part name strings
+  BOOST_CHECK(kit->set("childList[2].transform", "translation 1 2 3"));
+  SoTransform * transform = static_cast<SoTransform *>
+    (static_cast<SoShapeKit *>(list->getChild(2))->getPart("transform", FALSE));
+  BOOST_REQUIRE(transform != NULL);
+  BOOST_CHECK(transform->translation.getValue() == SbVec3f(1.0f, 2.0f, 3.0f));
+  BOOST_CHECK(kit->getPart("childList[2].transform", FALSE) == transform);
+  BOOST_CHECK(kit->getPart("childList[1].transform", FALSE) == NULL);
+  BOOST_CHECK(kit->getPart("childList[0].material", TRUE) != NULL);
+
+  // part names are looked up from several threads at once
+  SbList <SbName> names;
+  names.append(SbName("childList"));
+  names.append(SbName("childList[2].transform"));
+  names.append(SbName("childList[0].appearance.material"));
+  names.append(SbName("childList[1].transform"));
+  names.append(SbName("transform"));
+
+  BaseKitTestLookups lookups[BASEKIT_TEST_THREADS];
+  SbThread * threads[BASEKIT_TEST_THREADS];
+  int i, j;
+  for (i = 0; i < BASEKIT_TEST_THREADS; i++) {
+    lookups[i].kit = kit;
+    lookups[i].names = names;
+    for (j = 0; j < names.getLength(); j++) {
+      lookups[i].parts.append(kit->getPart(names[j], FALSE));
+    }
+    lookups[i].numwrong = 0;
+  }
+  BOOST_CHECK(lookups[0].parts[2] != NULL);
+  for (i = 0; i < BASEKIT_TEST_THREADS; i++) {
+    threads[i] = SbThread::create(basekit_test_thread, &lookups[i]);
+  }
+  for (i = 0; i < BASEKIT_TEST_THREADS; i++) {
+    threads[i]->join();
+    SbThread::destroy(threads[i]);
+    BOOST_CHECK_EQUAL(lookups[i].numwrong, 0);
+  }
+
+  kit->unref();
+}
+
+#endif // COIN_TEST_SUITE
+
 #endif // HAVE_NODEKITS
@@ -531,7 +531,7 @@ SoInteractionKit::setAnyPartAsDefault(const SbName & partname,
   int partNum;
   SbBool isList;
   int listIdx;
-  if (SoBaseKit::findPart(SbString(partname.getString()), kit, partNum,
+  if (SoBaseKit::findPart(partname, kit, partNum,
                           isList, listIdx, TRUE)) {
     SoSFNode * field = kit->getCatalogInstances()[partNum];
     // FIXME: default check not working properly. pederb, 2000-01-21
@@ -616,7 +616,7 @@ SoInteractionKit::setAnySurrogatePath(const SbName & partname,
   int partNum;
   SbBool isList;
   int listIdx;
-  if (SoBaseKit::findPart(SbString(partname.getString()), kit, partNum,
+  if (SoBaseKit::findPart(partname, kit, partNum,
                           isList, listIdx, TRUE)) {
     assert(kit->isOfType(SoInteractionKit::getClassTypeId()));
     const SoNodekitCatalog * catalog = kit->getNodekitCatalog();
@@ -895,4 +895,49 @@ SoInteractionKitP::sensorCB(void * data, SoSensor *)
 }
 
 #endif // DOXYGEN_SKIP_THIS
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/draggers/SoTranslate1Dragger.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+BOOST_AUTO_TEST_CASE(defaultPartsByName)
+{
+  // the first instance reads the default parts
+  SoTranslate1Dragger * first = new SoTranslate1Dragger;
+  first->ref();
+  SoNode * defaultpart = first->getPart("translator", FALSE);
+  BOOST_REQUIRE(defaultpart != NULL);
+
+  // the default parts are shared by all instances
+  SoTranslate1Dragger * dragger = new SoTranslate1Dragger;
+  dragger->ref();
+  BOOST_CHECK(dragger->getPart("translator", FALSE) == defaultpart);
+  dragger->unref();
+
+  // a node the application gives the name of a default part replaces
+  // it in draggers constructed afterwards
+  SoSeparator * part = new SoSeparator;
+  part->ref();
+  part->addChild(new SoCube);
+  part->setName("translate1Translator");
+  dragger = new SoTranslate1Dragger;
+  dragger->ref();
+  BOOST_CHECK(dragger->getPart("translator", FALSE) == part);
+  BOOST_CHECK(first->getPart("translator", FALSE) == defaultpart);
+  dragger->unref();
+
+  part->setName("");
+  dragger = new SoTranslate1Dragger;
+  dragger->ref();
+  BOOST_CHECK(dragger->getPart("translator", FALSE) == defaultpart);
+  dragger->unref();
+
+  part->unref();
+  first->unref();
+}
+
+#endif // COIN_TEST_SUITE
+
 #endif // HAVE_NODEKITS
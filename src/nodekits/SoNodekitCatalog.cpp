@@ -50,6 +50,7 @@
 
 #include <Inventor/nodekits/SoBaseKit.h>
 
+#include <atomic>
 #include <cassert>
 #include <cstdio> // fprintf()
 
@@ -72,6 +73,105 @@ public:
   SoTypeList itemtypeslist;
 };
 
+// *************************************************************************
+
+// Lookup tables for a complete catalog. Part names are SbName
+// instances, so the string pointer uniquely identifies a name. We use
+// this to build a collision-free (perfect) hash table from name to
+// part number, found by trying multiplicative hash seeds until one
+// spreads all the names to separate slots. The parent and right
+// sibling part numbers are also resolved up front, as they are looked
+// up for every part when a nodekit instance is set up, and so is the
+// leaf flag, which is checked repeatedly when searching for parts.
+
+class SoNodekitCatalogP {
+public:
+  SoNodekitCatalogP(void) : complete(FALSE), seed(0), shift(0) { }
+
+  void clear(void) {
+    this->complete.store(FALSE, std::memory_order_relaxed);
+    this->table.truncate(0);
+    this->parents.truncate(0);
+    this->siblings.truncate(0);
+    this->leaves.truncate(0);
+  }
+
+  int slot(const char * key) const {
+    const uintptr_t k = reinterpret_cast<uintptr_t>(key);
+    return static_cast<int>((k * this->seed) >> this->shift);
+  }
+
+  SbBool build(const SbList<CatalogItem *> & items);
+
+  int find(const SbName & name) const {
+    const int idx = this->table[this->slot(name.getString())];
+    if (idx >= 0 && this->names[idx] == name.getString()) return idx;
+    return SO_CATALOG_NAME_NOT_FOUND;
+  }
+
+  // The tables are built under the global lock, but read without
+  // it. Setting the flag with release semantics, and checking it with
+  // acquire semantics, makes sure a thread which sees the flag also
+  // sees the tables.
+  SbBool isComplete(void) const {
+    return this->complete.load(std::memory_order_acquire);
+  }
+
+  std::atomic<SbBool> complete;
+  uintptr_t seed;
+  int shift;
+  SbList<int> table;
+  SbList<const char *> names;
+  SbList<int> parents;
+  SbList<int> siblings;
+  SbList<SbBool> leaves;
+};
+
+SbBool
+SoNodekitCatalogP::build(const SbList<CatalogItem *> & items)
+{
+  const int n = items.getLength();
+  const int bits = sizeof(uintptr_t) * 8;
+
+  this->names.truncate(0);
+  for (int i = 0; i < n; i++) {
+    this->names.append(items[i]->name.getString());
+  }
+
+  // Start out with a load factor of at most 1/2, and double the table
+  // size if no collision-free seed is found.
+  int tablebits = 1;
+  while ((1 << tablebits) < 2 * n) tablebits++;
+
+  uintptr_t candidate = static_cast<uintptr_t>(0x9e3779b97f4a7c15ULL);
+  for (; tablebits <= 16; tablebits++) {
+    const int size = 1 << tablebits;
+    this->shift = bits - tablebits;
+    for (int attempt = 0; attempt < 64; attempt++) {
+      this->seed = candidate | 1;
+      // simple LCG step to get the next candidate seed
+      candidate = candidate * static_cast<uintptr_t>(6364136223846793005ULL) +
+        static_cast<uintptr_t>(1442695040888963407ULL);
+
+      this->table.truncate(0);
+      for (int i = 0; i < size; i++) this->table.append(-1);
+      int i;
+      for (i = 0; i < n; i++) {
+        const int s = this->slot(this->names[i]);
+        if (this->table[s] != -1) break;
+        this->table[s] = i;
+      }
+      if (i == n) return TRUE;
+    }
+  }
+  this->table.truncate(0);
+  return FALSE;
+}
+
+// *************************************************************************
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
 /*!
   Initialization of static variables.
 */
@@ -85,6 +185,7 @@ SoNodekitCatalog::initClass(void)
 */
 SoNodekitCatalog::SoNodekitCatalog(void)
 {
+  PRIVATE(this) = new SoNodekitCatalogP;
 }
 
 /*!
@@ -97,6 +198,7 @@ SoNodekitCatalog::~SoNodekitCatalog()
     delete this->items[i];
   for (i=0; i < this->delayeditems.getLength(); i++)
     delete this->delayeditems[i];
+  delete PRIVATE(this);
 }
 
 /*!
@@ -117,6 +219,7 @@ int
 SoNodekitCatalog::getPartNumber(const SbName & name) const
 {
   assert(this->delayeditems.getLength() == 0);
+  if (PRIVATE(this)->isComplete()) return PRIVATE(this)->find(name);
   return this->getPartNumber(this->items, name);
 }
 
@@ -219,6 +322,7 @@ SoNodekitCatalog::isLeaf(int part) const
   assert( part >= 0 && part < this->getNumEntries() &&
           "invalid part" );
 
+  if (PRIVATE(this)->isComplete()) return PRIVATE(this)->leaves[part];
   for (int i=0; i < this->items.getLength(); i++) {
     if ((i != part) && (this->items[part]->name == this->items[i]->parentname))
       return FALSE;
@@ -272,6 +376,7 @@ SoNodekitCatalog::getParentPartNumber(int part) const
   assert( part >= 0 && part < this->getNumEntries() &&
           "invalid part" );
 
+  if (PRIVATE(this)->isComplete()) return PRIVATE(this)->parents[part];
   return this->getPartNumber(this->items[part]->parentname);
 }
 
@@ -323,6 +428,7 @@ SoNodekitCatalog::getRightSiblingPartNumber(int part) const
   assert( part >= 0 && part < this->getNumEntries() && 
           "invalid part" );
 
+  if (PRIVATE(this)->isComplete()) return PRIVATE(this)->siblings[part];
   return this->getPartNumber(this->items[part]->siblingname);
 }
 
@@ -517,6 +623,8 @@ SoNodekitCatalog::addEntry(const SbName & name, SoType type,
 
   CC_GLOBAL_LOCK;
   if (!this->hasEntry(name)) {
+    // the part layout changes, so the lookup tables must be rebuilt
+    PRIVATE(this)->clear();
     assert((name != "") && "Empty name not allowed");
     assert((this->getPartNumber( this->items, name ) == SO_CATALOG_NAME_NOT_FOUND ) && "partname already in use" );
     assert(this->getPartNumber( this->delayeditems, name ) == SO_CATALOG_NAME_NOT_FOUND && "partname already in use" );
@@ -784,6 +892,62 @@ SoNodekitCatalog::printCheck(void) const
   }
 }
 
+/*!
+  Returns \c TRUE if setComplete() has been called and no entries have
+  been added to the catalog since.
+
+  \since Coin 4.0
+  \sa setComplete()
+*/
+SbBool
+SoNodekitCatalog::isComplete(void) const
+{
+  return PRIVATE(this)->isComplete();
+}
+
+/*!
+  Marks the catalog as complete, i.e. all entries for the nodekit
+  class have been added. This is done by the SO_KIT_INIT_INSTANCE()
+  macro at the end of the nodekit constructor.
+
+  A complete catalog looks up part numbers by name in constant time,
+  and the nodekit catalog macros will not try to add entries to it
+  again for subsequent instances of the nodekit class.
+
+  Adding a new entry to the catalog will clear the complete flag.
+
+  \since Coin 4.0
+  \sa isComplete()
+*/
+void
+SoNodekitCatalog::setComplete(void)
+{
+  if (PRIVATE(this)->isComplete()) return;
+
+  CC_GLOBAL_LOCK;
+  if (!PRIVATE(this)->isComplete() && this->delayeditems.getLength() == 0) {
+    SoNodekitCatalogP * p = PRIVATE(this);
+    if (p->build(this->items)) {
+      const int n = this->items.getLength();
+      p->parents.truncate(0);
+      p->siblings.truncate(0);
+      p->leaves.truncate(0);
+      int i;
+      for (i = 0; i < n; i++) {
+        p->parents.append(this->getPartNumber(this->items, this->items[i]->parentname));
+        p->siblings.append(this->getPartNumber(this->items, this->items[i]->siblingname));
+        p->leaves.append(TRUE);
+      }
+      for (i = 0; i < n; i++) {
+        const int parent = p->parents[i];
+        if (parent >= 0 && parent != i) p->leaves[parent] = FALSE;
+      }
+      p->complete.store(TRUE, std::memory_order_release);
+    }
+  }
+  CC_GLOBAL_UNLOCK;
+}
+
 // Overloaded to work with both delayed and "real" list of entries.
 int
 SoNodekitCatalog::getPartNumber(const SbList<class CatalogItem *> & l,
@@ -860,4 +1024,84 @@ SoNodekitCatalog::hasListItemType(const SbName & name, SoType type) const
   return l[part]->itemtypeslist.find( type ) != -1;
 }
 
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/draggers/SoTransformerDragger.h>
+#include <Inventor/nodekits/SoAppearanceKit.h>
+#include <Inventor/nodekits/SoCameraKit.h>
+#include <Inventor/nodekits/SoLightKit.h>
+#include <Inventor/nodekits/SoSceneKit.h>
+#include <Inventor/nodekits/SoShapeKit.h>
+#include <Inventor/nodekits/SoWrapperKit.h>
+
+BOOST_AUTO_TEST_CASE(partLookup)
+{
+  SoBaseKit * kits[] = {
+    new SoAppearanceKit, new SoCameraKit, new SoLightKit, new SoSceneKit,
+    new SoShapeKit, new SoWrapperKit, new SoTransformerDragger
+  };
+  const int numkits = sizeof(kits) / sizeof(kits[0]);
+  int i, j, k;
+
+  // the part names of all the catalogs, to check for misses with
+  // names used in other catalogs
+  SbList <SbName> allnames;
+  for (i = 0; i < numkits; i++) {
+    kits[i]->ref();
+    const SoNodekitCatalog * catalog = kits[i]->getNodekitCatalog();
+    for (j = 0; j < catalog->getNumEntries(); j++) {
+      allnames.append(catalog->getName(j));
+    }
+  }
+  allnames.append(SbName("noSuchPart"));
+  allnames.append(SbName("childList[0]"));
+  allnames.append(SbName::empty());
+
+  for (i = 0; i < numkits; i++) {
+    const SoNodekitCatalog * catalog = kits[i]->getNodekitCatalog();
+    const char * kitname = kits[i]->getTypeId().getName().getString();
+    const int n = catalog->getNumEntries();
+    // the catalog is complete once an instance has been constructed
+    BOOST_CHECK_MESSAGE(catalog->isComplete(), kitname);
+
+    for (j = 0; j < n; j++) {
+      const SbName & name = catalog->getName(j);
+      BOOST_CHECK_MESSAGE(catalog->getPartNumber(name) == j,
+                          kitname << " part " << name.getString());
+      // check the precomputed parent, sibling and leaf against the
+      // names in the catalog
+      int parent = SO_CATALOG_NAME_NOT_FOUND;
+      int sibling = SO_CATALOG_NAME_NOT_FOUND;
+      SbBool leaf = TRUE;
+      for (k = 0; k < n; k++) {
+        if (catalog->getName(k) == catalog->getParentName(j)) parent = k;
+        if (catalog->getName(k) == catalog->getRightSiblingName(j)) sibling = k;
+        if (k != j && catalog->getParentName(k) == name) leaf = FALSE;
+      }
+      BOOST_CHECK_MESSAGE(catalog->getParentPartNumber(j) == parent,
+                          kitname << " parent of " << name.getString());
+      BOOST_CHECK_MESSAGE(catalog->getRightSiblingPartNumber(j) == sibling,
+                          kitname << " sibling of " << name.getString());
+      BOOST_CHECK_MESSAGE(catalog->isLeaf(j) == leaf,
+                          kitname << " leaf " << name.getString());
+    }
+
+    for (j = 0; j < allnames.getLength(); j++) {
+      SbBool found = FALSE;
+      for (k = 0; k < n; k++) {
+        if (catalog->getName(k) == allnames[j]) found = TRUE;
+      }
+      if (found) continue;
+      BOOST_CHECK_MESSAGE(catalog->getPartNumber(allnames[j]) == SO_CATALOG_NAME_NOT_FOUND,
+                          kitname << " found " << allnames[j].getString());
+    }
+  }
+
+  for (i = 0; i < numkits; i++) kits[i]->unref();
+}
+
+#endif // COIN_TEST_SUITE
+
 #endif // HAVE_NODEKITS
@@ -81,6 +81,7 @@
 #include <cmath>
 #include <climits>
 #include <cstring> // memset()
+#include <atomic>
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
@@ -90,9 +91,12 @@
 #include <Inventor/C/tidbits.h> // coin_getenv()
 #include <Inventor/SbBox2s.h>
 #include <Inventor/SbBox3f.h>
+#include <Inventor/SbIdBuffer.h>
 #include <Inventor/SbMatrix.h>
 #include <Inventor/SbTesselator.h>
+#include <Inventor/SbLine.h>
 #include <Inventor/SbTime.h>
+#include <Inventor/SbVec2f.h>
 #include <Inventor/SbVec2s.h>
 #include <Inventor/SbVec3f.h>
 #include <Inventor/SbViewVolume.h>
@@ -126,8 +130,14 @@
 #include <Inventor/sensors/SoTimerSensor.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
 
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/wpool.h>
+#endif // HAVE_THREADS
+
 #include "nodes/SoSubNodeP.h"
 #include "coindefs.h" // COIN_OBSOLETED()
+#include "tidbitsp.h" // coin_atexit()
+#include "threads/threadsutilp.h"
 
 // *************************************************************************
 
@@ -214,6 +224,12 @@
 
   Set this field to VISIBLE_SHAPES to make only the primitives visible
   from the current viewpoint be selected.
+
+  Visibility is decided by rasterizing the scene into an SbIdBuffer,
+  which does not need an OpenGL context. Set the environment variable
+  COIN_EXTSELECTION_OFFSCREEN_RENDERER to 1 to use the old method of
+  rendering the primitives with unique colors through an
+  SoOffscreenRenderer instead.
 */
 
 // *************************************************************************
@@ -295,6 +311,10 @@ public:
                                  SbBool renderAsBlack);
 
   int scanOffscreenBuffer(SoNode * root);
+
+  void selectVisibleIdBuffer(SoNode * root);
+  SbBool scanIdBuffer(const unsigned int numids);
+  const SbMatrix & getIdBufferMatrix(SoState * state);
   void addVisitedPath(const SoPath *path);
 
   SbBool checkOffscreenRendererCapabilities();
@@ -331,6 +351,19 @@ public:
                                             const SbBox2s & lassorect,
                                             const SbBool full);
 
+  SbBool projectBBox(SoCallbackAction * action,
+                     const SbMatrix & projmatrix,
+                     const SoShape * shape,
+                     SbVec2s * projpts);
+
+  enum ShapeClass { SHAPE_OUTSIDE, SHAPE_INSIDE, SHAPE_BOUNDARY };
+  ShapeClass classifyShape(SoCallbackAction * action,
+                           const SbMatrix & projmatrix,
+                           const SoShape * shape,
+                           const SbBox2s & lassorect);
+
+  void testDeferredTriangles(void);
+
   static void offscreenLassoTesselatorCallback(void * v0, void * v1, void * v2, void * userdata);
 
   static void triangleCB(void * userData,
@@ -349,7 +382,7 @@ public:
                       const SoPrimitiveVertex * v);
 
   void selectAndReset(SoHandleEventAction * action);
-  void performSelection(SoHandleEventAction * action);
+  void performSelection(SoNode * root, const SbViewportRegion & vp);
 
   void validateViewportBBox(SbBox2s & bbox, 
                             const SbVec2s & vpsize);
@@ -410,9 +443,19 @@ public:
     SbBool onlyrect;
     SbBool allshapes;
     SbBool hasgeometry;
+    SbBool deferred;
   } primcbdata_t;
   primcbdata_t primcbdata;
 
+  // triangles (three object space points each) of the current shape
+  // that have not been tested against the lasso yet
+  SbList<SbVec3f> deferredtriangles;
+
+  // the lasso of the last selection, and the view volume it was done in
+  SbList<SbVec2s> lassocoordsdc;
+  SbList<SbVec3f> lassocoordswc;
+  SbBool hasviewvolume;
+
   void doSelect(const SoPath * path);
   void selectPaths(void);
   SoLassoSelectionFilterCB * filterCB;
@@ -428,8 +471,15 @@ public:
   SbBool callfiltercbonlyifselectable;
   SbBool wasshiftdown;
 
-  SoHandleEventAction *offscreenaction;
   SbViewVolume offscreenviewvolume;
+
+  // software rasterizer for VISIBLE_SHAPES, used instead of the
+  // offscreen renderers while useidbuffer is TRUE
+  SbIdBuffer * idbuffer;
+  SbBool useidbuffer;
+  SbBool idbuffermatrixvalid;
+  SbMatrix idbuffermodelmatrix;
+  SbMatrix idbuffermatrix;
   int offscreencolorcounter;
   int offscreencolorcounterpasses;
   unsigned int offscreenskipcounter;
@@ -803,6 +853,12 @@ SoExtSelection::SoExtSelection(void)
   PRIVATE(this)->renderer = NULL;
   PRIVATE(this)->lassorenderer = NULL;
 
+  PRIVATE(this)->primcbdata.deferred = FALSE;
+  PRIVATE(this)->hasviewvolume = FALSE;
+
+  PRIVATE(this)->idbuffer = NULL;
+  PRIVATE(this)->useidbuffer = FALSE;
+  PRIVATE(this)->idbuffermatrixvalid = FALSE;
 }
 
 /*!
@@ -812,6 +868,7 @@ SoExtSelection::~SoExtSelection()
 {
   delete PRIVATE(this)->renderer;
   delete PRIVATE(this)->lassorenderer;
+  delete PRIVATE(this)->idbuffer;
   delete PRIVATE(this)->cbaction;
   delete PRIVATE(this)->visitedshapepaths;
   delete PRIVATE(this);
@@ -1247,56 +1304,143 @@ SoExtSelection::GLRenderBelowPath(SoGLRenderAction * action)
   state->pop();
 }
 
+namespace {
+
+SoCallbackAction::Response
+find_viewvolume_cb(void * closure, SoCallbackAction * action, const SoNode *)
+{
+  *static_cast<SbViewVolume *>(closure) = SoViewVolumeElement::get(action->getState());
+  return SoCallbackAction::ABORT;
+}
+
+} // namespace
+
 /*!
   Simulate lasso selection programmatically.
 
-  This function is currently just stubbed.
-*/
+  The \a lasso polygon is given in world coordinates, and is projected
+  to the screen using the first camera in the scene graph \a root.
 
+  \sa select(SoNode *, int, SbVec2f *, const SbViewportRegion &, SbBool)
+*/
 void
-SoExtSelection::select(SoNode * COIN_UNUSED_ARG(root), int COIN_UNUSED_ARG(numcoords), SbVec3f * COIN_UNUSED_ARG(lasso), const SbViewportRegion & COIN_UNUSED_ARG(vp), SbBool COIN_UNUSED_ARG(shiftpolicy))
+SoExtSelection::select(SoNode * root, int numcoords, SbVec3f * lasso, const SbViewportRegion & vp, SbBool shiftpolicy)
 {
-  // FIXME: Implement this for TGS compatibility...
-  COIN_STUB_ONCE();
+  if (root == NULL || numcoords < 1) return;
+
+  SbViewVolume vv;
+  SoCallbackAction cba(vp);
+  cba.addPostCallback(SoCamera::getClassTypeId(), find_viewvolume_cb, &vv);
+  cba.apply(root);
+  if (!cba.hasTerminated()) {
+    SoDebugError::postWarning("SoExtSelection::select",
+                              "no camera found in the scene graph");
+    return;
+  }
+
+  SbList <SbVec2f> normcoords(numcoords);
+  for (int i = 0; i < numcoords; i++) {
+    SbVec3f screenpt;
+    vv.projectToScreen(lasso[i], screenpt);
+    normcoords.append(SbVec2f(screenpt[0], screenpt[1]));
+  }
+  this->select(root, numcoords, &normcoords[0], vp, shiftpolicy);
 }
 
 /*!
   Simulate lasso selection programmatically.
 
-  This function is currently just stubbed.
+  The \a lasso polygon is given in normalized viewport coordinates,
+  from (0, 0) in the lower left corner to (1, 1) in the upper right
+  corner of \a vp. The shapes in \a root are selected according to the
+  lassoPolicy and lassoMode fields, just as for an interactive lasso
+  selection, and \a shiftpolicy decides whether the shift key should
+  be considered pressed for the SoSelection::SHIFT policy.
+
+  Shapes with a bounding box that projects completely inside or
+  outside the lasso are decided without testing their primitives
+  when lassoMode is ALL_SHAPES. The triangles of shapes on the lasso
+  boundary are tested in parallel when Coin is built with thread
+  support. The number of threads used can be set with the
+  COIN_EXTSELECTION_THREADS environment variable, and defaults to 4.
+
+  \since Coin 4.0
 */
-
 void
-SoExtSelection::select(SoNode * COIN_UNUSED_ARG(root), int COIN_UNUSED_ARG(numcoords), SbVec2f * COIN_UNUSED_ARG(lasso), const SbViewportRegion & COIN_UNUSED_ARG(vp), SbBool COIN_UNUSED_ARG(shiftpolicy))
+SoExtSelection::select(SoNode * root, int numcoords, SbVec2f * lasso, const SbViewportRegion & vp, SbBool shiftpolicy)
 {
-  // FIXME: Implement this for TGS compatibility...
-  COIN_STUB_ONCE();
+  if (root == NULL || numcoords < 1) return;
+  if (PRIVATE(this)->runningselection.mode != SoExtSelectionP::SelectionState::NONE) {
+    SoDebugError::postWarning("SoExtSelection::select",
+                              "an interactive selection is already in progress");
+    return;
+  }
+
+  const SbVec2s vpo = vp.getViewportOriginPixels();
+  const SbVec2s vps = vp.getViewportSizePixels();
+  for (int i = 0; i < numcoords; i++) {
+    const float x = float(vpo[0]) + lasso[i][0] * float(vps[0]);
+    const float y = float(vpo[1]) + lasso[i][1] * float(vps[1]);
+    PRIVATE(this)->runningselection.coords.append(SbVec2s((short) SbClamp(x, -32768.0f, 32767.0f),
+                                                          (short) SbClamp(y, -32768.0f, 32767.0f)));
+  }
+  PRIVATE(this)->runningselection.mode = SoExtSelectionP::SelectionState::LASSO;
+  PRIVATE(this)->wasshiftdown = shiftpolicy;
+
+  PRIVATE(this)->performSelection(root, vp);
+  PRIVATE(this)->runningselection.reset();
 }
 
 /*!
   Returns lasso coordinates in device coordinates.
 
-  This function is currently just stubbed.
+  While an interactive selection is in progress, the current lasso
+  is returned. Otherwise the lasso of the last selection is
+  returned. A rectangle is returned as a four point polygon.
+
+  \since Coin 4.0
 */
 const SbVec2s *
-SoExtSelection::getLassoCoordsDC (int &COIN_UNUSED_ARG(numCoords))
+SoExtSelection::getLassoCoordsDC(int & numCoords)
 {
-  // FIXME: Implement this for TGS compatibility...
-  COIN_STUB_ONCE();
-  return NULL;
+  const SbList <SbVec2s> & coords =
+    (PRIVATE(this)->runningselection.mode != SoExtSelectionP::SelectionState::NONE) ?
+    PRIVATE(this)->runningselection.coords : PRIVATE(this)->lassocoordsdc;
+  numCoords = coords.getLength();
+  return numCoords ? coords.getArrayPtr() : NULL;
 }
 
 /*!
   Returns lasso coordinates in world coordinates.
 
-  This function is currently just stubbed.
+  The coordinates returned by getLassoCoordsDC() are projected onto
+  the near plane of the camera used for the last selection. If no
+  selection has been done yet, \a numCoords is set to 0 and \c NULL
+  is returned.
+
+  \since Coin 4.0
 */
 const SbVec3f *
-SoExtSelection::getLassoCoordsWC (int &COIN_UNUSED_ARG(numCoords))
-{
-  // FIXME: Implement this for TGS compatibility...
-  COIN_STUB_ONCE();
-  return NULL;
+SoExtSelection::getLassoCoordsWC(int & numCoords)
+{
+  int num;
+  const SbVec2s * dc = this->getLassoCoordsDC(num);
+
+  SbList <SbVec3f> & wc = PRIVATE(this)->lassocoordswc;
+  wc.truncate(0);
+  if (PRIVATE(this)->hasviewvolume) {
+    const SbViewVolume & vv = PRIVATE(this)->offscreenviewvolume;
+    const SbVec2s vpo = PRIVATE(this)->curvp.getViewportOriginPixels();
+    const SbVec2s vps = PRIVATE(this)->curvp.getViewportSizePixels();
+    for (int i = 0; i < num; i++) {
+      SbLine line;
+      vv.projectPointToLine(SbVec2f(float(dc[i][0] - vpo[0]) / float(vps[0]),
+                                    float(dc[i][1] - vpo[1]) / float(vps[1])), line);
+      wc.append(line.getPosition());
+    }
+  }
+  numCoords = wc.getLength();
+  return numCoords ? wc.getArrayPtr() : NULL;
 }
 
 /*!
@@ -1443,6 +1587,11 @@ SoExtSelectionP::postShapeCallback(void * data, SoCallbackAction * action, const
 {
   SoExtSelection * ext = (SoExtSelection*)data;
 
+  if (PRIVATE(ext)->primcbdata.deferred) {
+    PRIVATE(ext)->testDeferredTriangles();
+    PRIVATE(ext)->primcbdata.deferred = FALSE;
+  }
+
   SbBool hit = FALSE;
   switch (ext->lassoPolicy.getValue()) {
   case SoExtSelection::FULL:
@@ -1491,6 +1640,8 @@ SoExtSelectionP::cameraCB(void * data,
 
   // Save viewvolume for later use.
   thisp->pimpl->offscreenviewvolume = vv;
+  thisp->pimpl->hasviewvolume = TRUE;
+  thisp->pimpl->idbuffermatrixvalid = FALSE;
 
   SbBox2s rectbbox;
   for (int i = 0; i < PRIVATE(thisp)->runningselection.coords.getLength(); i++) {
@@ -1569,6 +1720,25 @@ project_pt(const SbMatrix & projmatrix, const SbVec3f & v,
                  (short) SbClamp(normpt[1], -32768.0f, 32767.0f));
 }
 
+// project an array of points to screen
+static void
+project_pts(const SbMatrix & projmatrix, const SbVec3f * v, SbVec2s * dst,
+            const int num, const SbVec2s & vporg, const SbVec2s & vpsize)
+{
+  SbVec3f normpts[8];
+  for (int i = 0; i < num; i += 8) {
+    const int cnt = SbMin(num - i, 8);
+    projmatrix.multVecMatrix(v + i, normpts, cnt);
+    for (int j = 0; j < cnt; j++) {
+      SbVec3f & normpt = normpts[j];
+      normpt[0] = ((normpt[0] + 1.0f) * 0.5f) * (float) vpsize[0] + (float) vporg[0];
+      normpt[1] = ((normpt[1] + 1.0f) * 0.5f) * (float) vpsize[1] + (float) vporg[1];
+      dst[i+j].setValue((short) SbClamp(normpt[0], -32768.0f, 32767.0f),
+                        (short) SbClamp(normpt[1], -32768.0f, 32767.0f));
+    }
+  }
+}
+
 // test for intersection between bounding box and lasso/rectangle
 SoCallbackAction::Response
 SoExtSelectionP::testBBox(SoCallbackAction * action,
@@ -1577,36 +1747,12 @@ SoExtSelectionP::testBBox(SoCallbackAction * action,
                           const SbBox2s & lassorect,
                           const SbBool full)
 {
-  SbBox3f bbox;
-  SbVec3f center;
-  const SoBoundingBoxCache * bboxcache = shape->getBoundingBoxCache();
-  if (bboxcache && bboxcache->isValid(action->getState())) {
-    bbox = bboxcache->getProjectedBox();
-    if (bboxcache->isCenterSet()) center = bboxcache->getCenter();
-    else center = bbox.getCenter();
-  }
-  else {
-    ((SoShape *)shape)->computeBBox(action, bbox, center);
-  }
-  SbVec3f mincorner = bbox.getMin();
-  SbVec3f maxcorner = bbox.getMax();
-
   SbBox2s shapebbox;
-
-  SbVec2s vppt;
-  SbVec3f normpt;
-  SbVec2s vpo = this->curvp.getViewportOriginPixels();
-  SbVec2s vps = this->curvp.getViewportSizePixels();
-
   SbVec2s projpts[8];
 
+  (void) this->projectBBox(action, projmatrix, shape, projpts);
   for (int i = 0; i < 8; i++) {
-    SbVec3f corner(i & 1 ? maxcorner[0] : mincorner[0],
-                   i & 2 ? maxcorner[1] : mincorner[1],
-                   i & 4 ? maxcorner[2] : mincorner[2]);
-    vppt = project_pt(projmatrix, corner, vpo, vps);
-    projpts[i] = vppt;
-    shapebbox.extendBy(vppt);
+    shapebbox.extendBy(projpts[i]);
   }
   if (lassorect.intersect(shapebbox)) { // quick reject
     int i;
@@ -1648,24 +1794,97 @@ SoExtSelectionP::testBBox(SoCallbackAction * action,
 
 }
 
+// Projects the corners of the shape's bounding box to the
+// screen. Returns FALSE if the bounding box is empty, or if some corner
+// is behind the eye, in which case the projected points can not be
+// trusted.
+SbBool
+SoExtSelectionP::projectBBox(SoCallbackAction * action,
+                             const SbMatrix & projmatrix,
+                             const SoShape * shape,
+                             SbVec2s * projpts)
+{
+  SbBox3f bbox;
+  SbVec3f center;
+  const SoBoundingBoxCache * bboxcache = shape->getBoundingBoxCache();
+  if (bboxcache && bboxcache->isValid(action->getState())) {
+    bbox = bboxcache->getProjectedBox();
+    if (bboxcache->isCenterSet()) center = bboxcache->getCenter();
+    else center = bbox.getCenter();
+  }
+  else {
+    ((SoShape *)shape)->computeBBox(action, bbox, center);
+  }
+  SbVec3f mincorner = bbox.getMin();
+  SbVec3f maxcorner = bbox.getMax();
+
+  SbVec2s vpo = this->curvp.getViewportOriginPixels();
+  SbVec2s vps = this->curvp.getViewportSizePixels();
+
+  SbVec3f corners[8];
+  SbBool infront = !bbox.isEmpty();
+  for (int i = 0; i < 8; i++) {
+    corners[i].setValue(i & 1 ? maxcorner[0] : mincorner[0],
+                        i & 2 ? maxcorner[1] : mincorner[1],
+                        i & 4 ? maxcorner[2] : mincorner[2]);
+    const float w =
+      corners[i][0] * projmatrix[0][3] + corners[i][1] * projmatrix[1][3] +
+      corners[i][2] * projmatrix[2][3] + projmatrix[3][3];
+    if (w <= 0.0f) infront = FALSE;
+  }
+  project_pts(projmatrix, corners, projpts, 8, vpo, vps);
+  return infront;
+}
+
+// Decides from the projected bounding box whether the shape is
+// completely outside or inside the lasso. Only shapes on the lasso
+// boundary need to have their primitives tested.
+SoExtSelectionP::ShapeClass
+SoExtSelectionP::classifyShape(SoCallbackAction * action,
+                               const SbMatrix & projmatrix,
+                               const SoShape * shape,
+                               const SbBox2s & lassorect)
+{
+  SbVec2s projpts[8];
+  if (!this->projectBBox(action, projmatrix, shape, projpts)) return SHAPE_BOUNDARY;
+
+  SbBox2s shapebbox;
+  for (int i = 0; i < 8; i++) {
+    shapebbox.extendBy(projpts[i]);
+  }
+  if (!lassorect.intersect(shapebbox)) return SHAPE_OUTSIDE;
+
+  // the screen space rectangle around the box contains all the
+  // projected primitives
+  const SbVec2s & bmin = shapebbox.getMin();
+  const SbVec2s & bmax = shapebbox.getMax();
+  SbList <SbVec2s> rect;
+  rect.append(bmin);
+  rect.append(SbVec2s(bmax[0], bmin[1]));
+  rect.append(bmax);
+  rect.append(SbVec2s(bmin[0], bmax[1]));
+
+  const SbList <SbVec2s> & coords = this->runningselection.coords;
+  if (!poly_poly_intersect(coords, rect)) return SHAPE_OUTSIDE;
+
+  int i;
+  for (i = 0; i < 4; i++) {
+    if (!point_in_poly(coords, rect[i])) return SHAPE_BOUNDARY;
+  }
+  for (i = 0; i < 4; i++) {
+    if (poly_line_intersect(coords, rect[i], rect[(i+1) % 4], FALSE)) return SHAPE_BOUNDARY;
+  }
+  return SHAPE_INSIDE;
+}
+
 // initialize some variables needed before receiving primitive callbacks.
 SoCallbackAction::Response
 SoExtSelectionP::testPrimitives(SoCallbackAction * action,
                                 const SbMatrix & projmatrix,
-                                const SoShape * /* shape */,
+                                const SoShape * shape,
                                 const SbBox2s & lassorect,
                                 const SbBool full)
 {
-  // FIXME: consider quick reject based on bounding box for now we
-  // just initialize some variables, and trust that the user has a
-  // sensible scene graph so that shapes are culled in the separators.
-  // ????-??-?? pederb.
-  //
-  // FIXME: I believe what pederb mention above would be a _very_
-  // important optimization -- especially when using VISIBLE_SHAPES
-  // with a small rectangle/polygon selection in a huge scene.
-  // 20050309 mortene.
-
   this->primcbdata.fulltest = full;
   this->primcbdata.projmatrix = projmatrix;
   this->primcbdata.lassorect = lassorect;
@@ -1676,11 +1895,202 @@ SoExtSelectionP::testPrimitives(SoCallbackAction * action,
   this->primcbdata.abort = FALSE;
   this->primcbdata.onlyrect = (this->runningselection.mode == SelectionState::LASSO);
   this->primcbdata.hasgeometry = FALSE;
+  this->primcbdata.deferred = FALSE;
+
+  // For VISIBLE_SHAPES, all triangles must be rendered to the
+  // offscreen buffer, so shapes can only be decided from their
+  // bounding boxes when testing all shapes.
+  if (this->primcbdata.allshapes) {
+    switch (this->classifyShape(action, projmatrix, shape, lassorect)) {
+    case SHAPE_OUTSIDE:
+      this->primcbdata.allhit = FALSE;
+      return SoCallbackAction::PRUNE;
+    case SHAPE_INSIDE:
+      // the filter callbacks must see the primitives
+      if (!this->triangleFilterCB && !this->lineFilterCB && !this->pointFilterCB) {
+        this->primcbdata.hit = TRUE;
+        this->primcbdata.hasgeometry = TRUE;
+        return SoCallbackAction::PRUNE;
+      }
+      break;
+    default:
+      break;
+    }
+    // boundary shapes have their triangles tested in batches
+    this->primcbdata.deferred = (this->triangleFilterCB == NULL);
+  }
+
   // signal to callback action that we want to generate primitives for
   // this shape
   return SoCallbackAction::CONTINUE;
 }
 
+// the number of triangles tested in one batch, and the minimum number
+// of triangles per thread when testing in parallel
+#define DEFERRED_BATCH_SIZE 65536
+#define DEFERRED_MIN_THREAD_SIZE 512
+
+// Test if a projected triangle is inside the lasso (full) or
+// intersects it (!full).
+static SbBool
+triangle_in_lasso(const SbList <SbVec2s> & coords, const SbBool full,
+                  const SbVec2s & p0, const SbVec2s & p1, const SbVec2s & p2)
+{
+  if (full) {
+    if (poly_line_intersect(coords, p0, p1, FALSE) || !point_in_poly(coords, p0)) return FALSE;
+    if (poly_line_intersect(coords, p1, p2, FALSE) || !point_in_poly(coords, p1)) return FALSE;
+    if (poly_line_intersect(coords, p2, p0, FALSE) || !point_in_poly(coords, p2)) return FALSE;
+    return TRUE;
+  }
+  return poly_tri_intersect(coords, p0, p1, p2);
+}
+
+namespace {
+
+// a range of deferred triangles to be tested by one thread
+struct TriangleTestJob {
+  const SbVec3f * points;
+  int numtriangles;
+  const SbMatrix * projmatrix;
+  SbVec2s vporg;
+  SbVec2s vpsize;
+  const SbList <SbVec2s> * coords;
+  SbBool full;
+  // set when some thread has decided the result for the shape
+  std::atomic<SbBool> * decided;
+  // full: all triangles are inside, !full: some triangle intersects
+  SbBool result;
+};
+
+void
+test_triangle_job(void * closure)
+{
+  TriangleTestJob * job = static_cast<TriangleTestJob *>(closure);
+  job->result = job->full;
+  for (int i = 0; i < job->numtriangles && !job->decided->load(std::memory_order_relaxed); i++) {
+    SbVec2s projvtx[3];
+    project_pts(*job->projmatrix, job->points + i * 3, projvtx, 3, job->vporg, job->vpsize);
+    if (triangle_in_lasso(*job->coords, job->full, projvtx[0], projvtx[1], projvtx[2]) != job->full) {
+      job->result = !job->full;
+      job->decided->store(TRUE, std::memory_order_relaxed);
+    }
+  }
+}
+
+#ifdef HAVE_THREADS
+
+cc_wpool * triangletestpool = NULL;
+int triangletestthreads = -1;
+
+void
+triangle_test_pool_cleanup(void)
+{
+  if (triangletestpool) cc_wpool_destruct(triangletestpool);
+  triangletestpool = NULL;
+  triangletestthreads = -1;
+}
+
+// The number of threads used for testing boundary shapes. Can be set
+// with the COIN_EXTSELECTION_THREADS environment variable.
+int
+triangle_test_num_threads(void)
+{
+  CC_GLOBAL_LOCK;
+  if (triangletestthreads < 0) {
+    const char * env = coin_getenv("COIN_EXTSELECTION_THREADS");
+    triangletestthreads = env ? atoi(env) : 4;
+    if (triangletestthreads < 1) triangletestthreads = 1;
+  }
+  const int numthreads = triangletestthreads;
+  CC_GLOBAL_UNLOCK;
+  return numthreads;
+}
+
+cc_wpool *
+triangle_test_pool(const int numthreads)
+{
+  CC_GLOBAL_LOCK;
+  if (triangletestpool == NULL) {
+    triangletestpool = cc_wpool_construct(numthreads - 1);
+    coin_atexit((coin_atexit_f*) triangle_test_pool_cleanup, CC_ATEXIT_NORMAL);
+  }
+  CC_GLOBAL_UNLOCK;
+  return triangletestpool;
+}
+
+#endif // HAVE_THREADS
+
+} // namespace
+
+// Tests the deferred triangles against the lasso, using several
+// threads for large batches, and updates the hit state of the shape.
+void
+SoExtSelectionP::testDeferredTriangles(void)
+{
+  const int numtriangles = this->deferredtriangles.getLength() / 3;
+  if (numtriangles == 0) return;
+
+  int numjobs = 1;
+#ifdef HAVE_THREADS
+  const int numthreads = triangle_test_num_threads();
+  numjobs = SbMin(numthreads, numtriangles / DEFERRED_MIN_THREAD_SIZE);
+  if (numjobs < 1) numjobs = 1;
+#endif // HAVE_THREADS
+
+  std::atomic<SbBool> decided(FALSE);
+  SbList <TriangleTestJob> jobs(numjobs);
+  const int chunk = (numtriangles + numjobs - 1) / numjobs;
+  for (int i = 0; i < numjobs; i++) {
+    TriangleTestJob job;
+    job.points = this->deferredtriangles.getArrayPtr() + i * chunk * 3;
+    job.numtriangles = SbMin(chunk, numtriangles - i * chunk);
+    job.projmatrix = &this->primcbdata.projmatrix;
+    job.vporg = this->primcbdata.vporg;
+    job.vpsize = this->primcbdata.vpsize;
+    job.coords = &this->runningselection.coords;
+    job.full = this->primcbdata.fulltest;
+    job.decided = &decided;
+    job.result = job.full;
+    jobs.append(job);
+  }
+
+#ifdef HAVE_THREADS
+  cc_wpool * pool = NULL;
+  if (numjobs > 1) {
+    pool = triangle_test_pool(numthreads);
+    cc_wpool_begin(pool, numjobs - 1);
+    for (int i = 1; i < numjobs; i++) {
+      cc_wpool_start_worker(pool, test_triangle_job, &jobs[i]);
+    }
+    cc_wpool_end(pool);
+  }
+#endif // HAVE_THREADS
+  test_triangle_job(&jobs[0]);
+#ifdef HAVE_THREADS
+  if (pool) cc_wpool_wait_all(pool);
+#endif // HAVE_THREADS
+
+  SbBool result = this->primcbdata.fulltest;
+  for (int i = 0; i < numjobs; i++) {
+    if (jobs[i].result != this->primcbdata.fulltest) result = !this->primcbdata.fulltest;
+  }
+  if (this->primcbdata.fulltest) {
+    if (result) this->primcbdata.hit = TRUE;
+    else {
+      this->primcbdata.allhit = FALSE;
+      this->primcbdata.abort = TRUE;
+    }
+  }
+  else {
+    if (result) {
+      this->primcbdata.hit = TRUE;
+      this->primcbdata.abort = TRUE;
+    }
+    else this->primcbdata.allhit = FALSE;
+  }
+  this->deferredtriangles.truncate(0);
+}
+
 
 
 // triangle callback from SoCallbackAction
@@ -1757,13 +2167,23 @@ SoExtSelectionP::triangleCB(void * userData,
     return;
   }
 
+  if (thisp->primcbdata.deferred) {
+    thisp->deferredtriangles.append(v1->getPoint());
+    thisp->deferredtriangles.append(v2->getPoint());
+    thisp->deferredtriangles.append(v3->getPoint());
+    if (thisp->deferredtriangles.getLength() >= 3 * DEFERRED_BATCH_SIZE) {
+      thisp->testDeferredTriangles();
+    }
+    return;
+  }
 
-  SbVec2s p0 = project_pt(thisp->primcbdata.projmatrix, v1->getPoint(),
-                          thisp->primcbdata.vporg, thisp->primcbdata.vpsize);
-  SbVec2s p1 = project_pt(thisp->primcbdata.projmatrix, v2->getPoint(),
-                          thisp->primcbdata.vporg, thisp->primcbdata.vpsize);
-  SbVec2s p2 = project_pt(thisp->primcbdata.projmatrix, v3->getPoint(),
-                          thisp->primcbdata.vporg, thisp->primcbdata.vpsize);
+  const SbVec3f trivtx[3] = { v1->getPoint(), v2->getPoint(), v3->getPoint() };
+  SbVec2s projvtx[3];
+  project_pts(thisp->primcbdata.projmatrix, trivtx, projvtx, 3,
+              thisp->primcbdata.vporg, thisp->primcbdata.vpsize);
+  const SbVec2s & p0 = projvtx[0];
+  const SbVec2s & p1 = projvtx[1];
+  const SbVec2s & p2 = projvtx[2];
 
 
   if(thisp->primcbdata.fulltest) { // entire triangle must be inside lasso
@@ -1783,22 +2203,13 @@ SoExtSelectionP::triangleCB(void * userData,
       }
     }
 
-    if(poly_line_intersect(thisp->runningselection.coords, p0, p1, FALSE) || !point_in_poly(thisp->runningselection.coords, p0)) {
-      thisp->primcbdata.allhit = FALSE;
-      return;
-    }
-    if(poly_line_intersect(thisp->runningselection.coords, p1, p2, FALSE) || !point_in_poly(thisp->runningselection.coords, p1)) {
+    if (!triangle_in_lasso(thisp->runningselection.coords, TRUE, p0, p1, p2)) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
-    if(poly_line_intersect(thisp->runningselection.coords, p2, p0, FALSE) || !point_in_poly(thisp->runningselection.coords, p2)) {
-      thisp->primcbdata.allhit = FALSE;
-      return;
-    }
-
 
   } else { // some part of the triangle must be inside lasso
-    if (!poly_tri_intersect(thisp->runningselection.coords, p0, p1, p2)) {
+    if (!triangle_in_lasso(thisp->runningselection.coords, FALSE, p0, p1, p2)) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
@@ -1873,6 +2284,30 @@ SoExtSelectionP::addTriangleToOffscreenBuffer(SoCallbackAction * action,
     return;
 
   SoState * state = action->getState();
+
+  // Check vertex ordrering
+  SoShapeHintsElement::VertexOrdering vertexorder;
+  SoShapeHintsElement::ShapeType shapetype;
+  SoShapeHintsElement::FaceType facetype; //Unused.
+  SoShapeHintsElement::get(state, vertexorder, shapetype, facetype);
+
+  if (this->useidbuffer) {
+    SbIdBuffer::Culling culling = SbIdBuffer::CULL_NONE;
+    if (shapetype == SoShapeHintsElement::SOLID) {
+      if (vertexorder == SoShapeHintsElement::CLOCKWISE) {
+        culling = SbIdBuffer::CULL_COUNTERCLOCKWISE;
+      }
+      else if (vertexorder == SoShapeHintsElement::COUNTERCLOCKWISE) {
+        culling = SbIdBuffer::CULL_CLOCKWISE;
+      }
+    }
+    this->idbuffer->addTriangle(v1->getPoint(), v2->getPoint(), v3->getPoint(),
+                                this->getIdBufferMatrix(state),
+                                renderAsBlack ? 0 : this->offscreencolorcounter++,
+                                culling);
+    return;
+  }
+
   SbMatrix proj, affine;
   const SbMatrix & mm = SoModelMatrixElement::get(state);
   offscreenviewvolume.getMatrices(affine, proj);
@@ -1885,12 +2320,6 @@ SoExtSelectionP::addTriangleToOffscreenBuffer(SoCallbackAction * action,
 
   glDepthFunc(GL_LEQUAL);
 
-  // Check vertex ordrering
-  SoShapeHintsElement::VertexOrdering vertexorder;
-  SoShapeHintsElement::ShapeType shapetype;
-  SoShapeHintsElement::FaceType facetype; //Unused.
-  SoShapeHintsElement::get(state, vertexorder, shapetype, facetype);
-
 
   if(shapetype == SoShapeHintsElement::SOLID){
     if(vertexorder == SoShapeHintsElement::CLOCKWISE){
@@ -2060,6 +2489,13 @@ SoExtSelectionP::addLineToOffscreenBuffer(SoCallbackAction * action,
     return;
 
   SoState * state = action->getState();
+  if (this->useidbuffer) {
+    this->idbuffer->addLine(v1->getPoint(), v2->getPoint(),
+                            this->getIdBufferMatrix(state),
+                            renderAsBlack ? 0 : this->offscreencolorcounter++);
+    return;
+  }
+
   SbMatrix proj, affine;
   const SbMatrix & mm = SoModelMatrixElement::get(state);
   offscreenviewvolume.getMatrices(affine, proj);
@@ -2210,6 +2646,12 @@ SoExtSelectionP::addPointToOffscreenBuffer(SoCallbackAction * action,
     return;
 
   SoState * state = action->getState();
+  if (this->useidbuffer) {
+    this->idbuffer->addPoint(v1->getPoint(), this->getIdBufferMatrix(state),
+                             renderAsBlack ? 0 : this->offscreencolorcounter++);
+    return;
+  }
+
   SbMatrix proj, affine;
   const SbMatrix & mm = SoModelMatrixElement::get(state);
   offscreenviewvolume.getMatrices(affine, proj);
@@ -2321,8 +2763,7 @@ SoExtSelectionP::offscreenRenderLassoCallback(void * userdata, SoAction * action
   SoExtSelectionP * pimpl = (SoExtSelectionP *) userdata;
 
   // Setup optimal screen-aspect according to lasso-size
-  SoHandleEventAction * eventAction = pimpl->offscreenaction;
-  const SbViewportRegion & vp = SoViewportRegionElement::get(eventAction->getState());
+  const SbViewportRegion & vp = pimpl->curvp;
 
   SbVec2s vpo = vp.getViewportOriginPixels();
   SbVec2s vps = vp.getViewportSizePixels();
@@ -2543,16 +2984,155 @@ SoExtSelectionP::scanOffscreenBuffer(SoNode * COIN_UNUSED_ARG(sceneRoot))
   return(hitflag);
 }
 
+// Returns the matrix from object space to clip space for the current
+// shape when rasterizing into the id buffer.
+const SbMatrix &
+SoExtSelectionP::getIdBufferMatrix(SoState * state)
+{
+  const SbMatrix & mm = SoModelMatrixElement::get(state);
+  if (!this->idbuffermatrixvalid || mm != this->idbuffermodelmatrix) {
+    SbMatrix affine, proj;
+    this->offscreenviewvolume.getMatrices(affine, proj);
+    this->idbuffermatrix = mm * affine * proj;
+    this->idbuffermodelmatrix = mm;
+    this->idbuffermatrixvalid = TRUE;
+  }
+  return this->idbuffermatrix;
+}
+
+// VISIBLE_SHAPES selection using the software id buffer. The first
+// traversal rasterizes all primitives, with a unique id for each
+// primitive touching the lasso. The ids visible inside the lasso are
+// then marked in visibletrianglesbitarray, and the second traversal
+// hands the visible primitives to the filter callbacks, just like
+// for the offscreen renderer. There is no limit on the number of
+// primitives, so a single pass is always enough.
+void
+SoExtSelectionP::selectVisibleIdBuffer(SoNode * root)
+{
+  if (this->idbuffer == NULL) this->idbuffer = new SbIdBuffer;
+  const SbVec2s vpsize = this->curvp.getViewportSizePixels();
+  if (this->idbuffer->getSize() != vpsize) this->idbuffer->setSize(vpsize);
+  else this->idbuffer->clear();
+
+  this->useidbuffer = TRUE;
+  this->idbuffermatrixvalid = FALSE;
+  this->maximumcolorcounter = UINT_MAX;
+  this->offscreencolorcounterpasses = 0;
+  this->offscreencolorcounter = 1;
+  this->offscreenskipcounter = 0;
+  this->applyonlyonselectedtriangles = FALSE;
+  this->offscreencolorcounteroverflow = FALSE;
+  this->drawcallbackcounter = 0;
+  this->drawcounter = 0;
+
+  this->cbaction->apply(root);
+
+  const unsigned int numids = this->offscreencolorcounter;
+  this->visibletrianglesbitarray = new unsigned char[(numids + 7) / 8];
+  if (this->scanIdBuffer(numids)) {
+    this->offscreencolorcounter = 1;
+    this->offscreenskipcounter = 0;
+    this->drawcallbackcounter = 0;
+    this->drawcounter = 0;
+    this->applyonlyonselectedtriangles = TRUE;
+    this->cbaction->apply(root);
+  }
+  delete [] this->visibletrianglesbitarray;
+  this->visibletrianglesbitarray = NULL;
+  this->useidbuffer = FALSE;
+}
+
+// Marks the ids visible inside the lasso in
+// visibletrianglesbitarray. The lasso is filled one row at a time,
+// using the same inside rule as point_in_poly(). Returns TRUE if some
+// id was found.
+SbBool
+SoExtSelectionP::scanIdBuffer(const unsigned int numids)
+{
+  (void)memset(this->visibletrianglesbitarray, 0, (numids + 7) / 8);
+
+  const SbVec2s size = this->idbuffer->getSize();
+  const SbVec2s org = this->curvp.getViewportOriginPixels();
+  const uint32_t * ids = this->idbuffer->getIdBuffer();
+  const SbList <SbVec2s> & coords = this->runningselection.coords;
+  const int n = coords.getLength();
+
+  SbBox2s rectbbox;
+  int i;
+  for (i = 0; i < n; i++) {
+    rectbbox.extendBy(coords[i]);
+  }
+  const int ymin = SbMax(0, rectbbox.getMin()[1] - org[1]);
+  const int ymax = SbMin(size[1] - 1, rectbbox.getMax()[1] - org[1]);
+
+  SbBool hitflag = FALSE;
+  SbBool hasarea = FALSE;
+  SbList <float> crossings;
+  for (int y = ymin; y <= ymax; y++) {
+    const float py = float(y + org[1]);
+    crossings.truncate(0);
+    for (i = 0; i < n; i++) {
+      const SbVec2s & pi = coords[i];
+      const SbVec2s & pj = coords[i > 0 ? i - 1 : n - 1];
+      if (((pi[1] <= py) && (py < pj[1])) || ((pj[1] <= py) && (py < pi[1]))) {
+        const float xc = float(pj[0] - pi[0]) * (py - pi[1]) / float(pj[1] - pi[1]) + pi[0];
+        // insertion sort, there are usually only a few crossings
+        int j = crossings.getLength();
+        crossings.append(xc);
+        while (j > 0 && crossings[j-1] > xc) {
+          crossings[j] = crossings[j-1];
+          j--;
+        }
+        crossings[j] = xc;
+      }
+    }
+    for (i = 0; i + 1 < crossings.getLength(); i += 2) {
+      hasarea = TRUE;
+      const int x0 = SbMax(0, int(ceil(crossings[i])) - org[0]);
+      const int x1 = SbMin(size[0] - 1, int(ceil(crossings[i+1])) - 1 - org[0]);
+      for (int x = x0; x <= x1; x++) {
+        const uint32_t id = ids[y * size[0] + x];
+        if (id != 0 && id < numids) {
+          this->visibletrianglesbitarray[id >> 3] |= 0x1 << (id & 0x07);
+          hitflag = TRUE;
+        }
+      }
+    }
+  }
+
+  // a single click or a line, scan the pixels around it like for the
+  // offscreen renderer
+  if (!hasarea) {
+    this->validateViewportBBox(rectbbox, this->curvp.getViewportSizePixels());
+    const int x0 = SbMax(0, rectbbox.getMin()[0] - org[0]);
+    const int x1 = SbMin(int(size[0]), rectbbox.getMax()[0] - org[0]);
+    const int y0 = SbMax(0, rectbbox.getMin()[1] - org[1]);
+    const int y1 = SbMin(int(size[1]), rectbbox.getMax()[1] - org[1]);
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++) {
+        const uint32_t id = ids[y * size[0] + x];
+        if (id != 0 && id < numids) {
+          this->visibletrianglesbitarray[id >> 3] |= 0x1 << (id & 0x07);
+          hitflag = TRUE;
+        }
+      }
+    }
+  }
+  return hitflag;
+}
+
 void
 SoExtSelectionP::selectAndReset(SoHandleEventAction * action)
 {
-  this->performSelection(action);
+  this->performSelection(action->getCurPath()->getHead(),
+                         SoViewportRegionElement::get(action->getState()));
   this->runningselection.reset();
 }
 
 // start a selecting for the current lasso/rectangle
 void
-SoExtSelectionP::performSelection(SoHandleEventAction * action)
+SoExtSelectionP::performSelection(SoNode * root, const SbViewportRegion & vp)
 {
   assert(this->runningselection.mode != SelectionState::NONE);
 
@@ -2574,11 +3154,13 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
     this->runningselection.coords.append(p1);
     this->runningselection.coords.append(SbVec2s(p0[0], p1[1]));
   }
+  this->lassocoordsdc = this->runningselection.coords;
+  this->hasviewvolume = FALSE;
 
   //Send signal to client that tris are coming up,
   PUBLIC(this)->startCBList->invokeCallbacks(PUBLIC(this));
 
-  this->curvp = SoViewportRegionElement::get(action->getState());
+  this->curvp = vp;
   this->cbaction->setViewportRegion(this->curvp);
 
   switch (PUBLIC(this)->policy.getValue()) {
@@ -2602,7 +3184,7 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
 
     // Execute 'search' for triangles
     primcbdata.allshapes = TRUE;
-    this->cbaction->apply(action->getCurPath()->getHead());
+    this->cbaction->apply(root);
 
   }
   else {
@@ -2612,9 +3194,20 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
     //
     primcbdata.allshapes = FALSE;
 
+    static int useoffscreenrenderer = -1;
+    if (useoffscreenrenderer < 0) {
+      const char * env = coin_getenv("COIN_EXTSELECTION_OFFSCREEN_RENDERER");
+      useoffscreenrenderer = env && (atoi(env) > 0);
+    }
+    if (!useoffscreenrenderer) {
+      this->selectVisibleIdBuffer(root);
+      this->selectPaths();
+      PUBLIC(this)->finishCBList->invokeCallbacks(PUBLIC(this));
+      PUBLIC(this)->touch();
+      return;
+    }
 
-    this->offscreenaction = action;
-    this->offscreenheadnode = action->getCurPath()->getHead();
+    this->offscreenheadnode = root;
 
     // Check OpenGL capabilities
     SbBool setupok = this->checkOffscreenRendererCapabilities();
@@ -2651,9 +3244,9 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
     unsigned int maxsize[2];
     cc_glglue_context_max_dimensions(&maxsize[0], &maxsize[1]);
 
-    this->requestedsize = action->getViewportRegion().getViewportSizePixels();
+    this->requestedsize = vp.getViewportSizePixels();
 
-    SbViewportRegion vp = action->getViewportRegion();
+    SbViewportRegion offscreenvp = vp;
     if((unsigned int) requestedsize[0] > maxsize[0] || (unsigned int) requestedsize[1] > maxsize[1]){
 
       double maxv = (float) SbMax(requestedsize[0],requestedsize[1]);
@@ -2664,16 +3257,16 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
       newsize[0] = (int) (requestedsize[0] * scale);
       newsize[1] = (int) (requestedsize[1] * scale);
 
-      vp = SbViewportRegion(newsize[0],newsize[1]);
+      offscreenvp = SbViewportRegion(newsize[0],newsize[1]);
     }
     // only (re)allocate the renderers if the viewport has changed
-    if (this->renderer == NULL || this->renderer->getViewportRegion() != vp) {
+    if (this->renderer == NULL || this->renderer->getViewportRegion() != offscreenvp) {
       delete this->renderer;
-      this->renderer = new SoOffscreenRenderer(vp);
+      this->renderer = new SoOffscreenRenderer(offscreenvp);
     }
-    if (this->lassorenderer == NULL || this->lassorenderer->getViewportRegion() != vp) {
+    if (this->lassorenderer == NULL || this->lassorenderer->getViewportRegion() != offscreenvp) {
       delete this->lassorenderer;
-      this->lassorenderer = new SoOffscreenRenderer(vp);
+      this->lassorenderer = new SoOffscreenRenderer(offscreenvp);
     }
 
     SoCallback * cbnode = new SoCallback;
@@ -2716,7 +3309,7 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
 
       // Scan buffer marking visible colors in the
       // 'visibletrianglesbitarray' array.
-      if (this->scanOffscreenBuffer(action->getCurPath()->getHead()) != 0) {
+      if (this->scanOffscreenBuffer(root) != 0) {
 
         // Render once more, but only selected triangles which are forwarded
         // to client code through 'triangleFilterCB'.
@@ -2728,7 +3321,7 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
         this->drawcounter = 0;
 
         this->applyonlyonselectedtriangles = TRUE;
-        this->cbaction->apply(action->getCurPath()->getHead());
+        this->cbaction->apply(root);
         PUBLIC(this)->touch();
 
       } else {
@@ -2775,5 +3368,175 @@ SoExtSelectionP::validateViewportBBox(SbBox2s & bbox,
   }
 }
 
+#undef DEFERRED_BATCH_SIZE
+#undef DEFERRED_MIN_THREAD_SIZE
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoPath.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static SoExtSelection *
+make_lasso_scene(void)
+{
+  SoExtSelection * root = new SoExtSelection;
+  root->lassoType = SoExtSelection::LASSO;
+  root->lassoMode = SoExtSelection::ALL_SHAPES;
+  root->policy = SoSelection::SHIFT;
+
+  // the camera views [-10, 10] x [-10, 10]
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position.setValue(0.0f, 0.0f, 10.0f);
+  camera->height = 20.0f;
+  root->addChild(camera);
+
+  // unit cubes at x = -6, -2, 2 and 6
+  for (int i = 0; i < 4; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * t = new SoTranslation;
+    t->translation.setValue(-6.0f + 4.0f * i, 0.0f, 0.0f);
+    sep->addChild(t);
+    sep->addChild(new SoCube);
+    root->addChild(sep);
+  }
+
+  // a finely tessellated sphere at y = 6, radius 2
+  SoSeparator * sep = new SoSeparator;
+  SoTranslation * t = new SoTranslation;
+  t->translation.setValue(0.0f, 6.0f, 0.0f);
+  sep->addChild(t);
+  SoComplexity * complexity = new SoComplexity;
+  complexity->value = 1.0f;
+  sep->addChild(complexity);
+  SoSphere * sphere = new SoSphere;
+  sphere->radius = 2.0f;
+  sep->addChild(sphere);
+  root->addChild(sep);
+  return root;
+}
+
+BOOST_AUTO_TEST_CASE(programmaticLasso)
+{
+  SoExtSelection * root = make_lasso_scene();
+  root->ref();
+  SbViewportRegion vp(200, 200);
+
+  // a lasso around the two cubes on the right, cutting the sphere in
+  // half, in normalized coordinates
+  SbVec2f lasso[4] = {
+    SbVec2f(0.5f, 0.4f), SbVec2f(0.9f, 0.4f),
+    SbVec2f(0.9f, 0.9f), SbVec2f(0.5f, 0.9f)
+  };
+
+  root->lassoPolicy = SoExtSelection::PART;
+  root->select(root, 4, lasso, vp, FALSE);
+  BOOST_CHECK_EQUAL(root->getNumSelected(), 3);
+
+  root->lassoPolicy = SoExtSelection::FULL;
+  root->select(root, 4, lasso, vp, FALSE);
+  BOOST_CHECK_EQUAL(root->getNumSelected(), 2);
+
+  root->lassoPolicy = SoExtSelection::FULL_BBOX;
+  root->select(root, 4, lasso, vp, FALSE);
+  BOOST_CHECK_EQUAL(root->getNumSelected(), 2);
+
+  int num = 0;
+  const SbVec2s * dc = root->getLassoCoordsDC(num);
+  BOOST_CHECK_EQUAL(num, 4);
+  if (dc) {
+    BOOST_CHECK(dc[2] == SbVec2s(180, 180));
+  }
+  const SbVec3f * wc = root->getLassoCoordsWC(num);
+  BOOST_CHECK_EQUAL(num, 4);
+  if (wc) {
+    BOOST_CHECK(fabs(wc[2][0] - 8.0f) < 0.2f && fabs(wc[2][1] - 8.0f) < 0.2f);
+  }
+
+  // the same lasso in world coordinates selects the same shapes
+  SbVec3f wclasso[4] = {
+    SbVec3f(0.0f, -2.0f, 0.0f), SbVec3f(8.0f, -2.0f, 0.0f),
+    SbVec3f(8.0f, 8.0f, 0.0f), SbVec3f(0.0f, 8.0f, 0.0f)
+  };
+  root->lassoPolicy = SoExtSelection::PART;
+  root->select(root, 4, wclasso, vp, FALSE);
+  BOOST_CHECK_EQUAL(root->getNumSelected(), 3);
+
+  // a lasso inside the sphere only hits it through its triangles
+  SbVec2f small[3] = {
+    SbVec2f(0.49f, 0.79f), SbVec2f(0.51f, 0.79f), SbVec2f(0.5f, 0.81f)
+  };
+  root->select(root, 3, small, vp, FALSE);
+  BOOST_CHECK_EQUAL(root->getNumSelected(), 1);
+  root->lassoPolicy = SoExtSelection::FULL;
+  root->select(root, 3, small, vp, FALSE);
+  BOOST_CHECK_EQUAL(root->getNumSelected(), 0);
+
+  root->unref();
+}
+
+static SbBool
+accept_triangle(void *, SoCallbackAction *, const SoPrimitiveVertex *,
+                const SoPrimitiveVertex *, const SoPrimitiveVertex *)
+{
+  return TRUE;
+}
+
+BOOST_AUTO_TEST_CASE(visibleShapes)
+{
+  SoExtSelection * root = new SoExtSelection;
+  root->ref();
+  root->lassoType = SoExtSelection::LASSO;
+  root->lassoPolicy = SoExtSelection::PART;
+  root->setTriangleFilterCallback(accept_triangle);
+
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position.setValue(0.0f, 0.0f, 10.0f);
+  camera->height = 20.0f;
+  root->addChild(camera);
+
+  // a small cube hidden behind a larger one, and a visible cube to
+  // the right
+  root->addChild(new SoCube);
+  SoSeparator * hidden = new SoSeparator;
+  SoTranslation * t = new SoTranslation;
+  t->translation.setValue(0.0f, 0.0f, -5.0f);
+  hidden->addChild(t);
+  SoCube * hiddencube = new SoCube;
+  hiddencube->width = hiddencube->height = hiddencube->depth = 1.0f;
+  hidden->addChild(hiddencube);
+  root->addChild(hidden);
+  SoSeparator * right = new SoSeparator;
+  t = new SoTranslation;
+  t->translation.setValue(6.0f, 0.0f, 0.0f);
+  right->addChild(t);
+  right->addChild(new SoCube);
+  root->addChild(right);
+
+  SbViewportRegion vp(200, 200);
+  SbVec2f lasso[4] = {
+    SbVec2f(0.1f, 0.1f), SbVec2f(0.9f, 0.1f),
+    SbVec2f(0.9f, 0.9f), SbVec2f(0.1f, 0.9f)
+  };
+
+  root->lassoMode = SoExtSelection::ALL_SHAPES;
+  root->select(root, 4, lasso, vp, FALSE);
+  BOOST_CHECK_EQUAL(root->getNumSelected(), 3);
+
+  root->lassoMode = SoExtSelection::VISIBLE_SHAPES;
+  root->select(root, 4, lasso, vp, FALSE);
+  BOOST_CHECK_EQUAL(root->getNumSelected(), 2);
+  for (int i = 0; i < root->getNumSelected(); i++) {
+    BOOST_CHECK(root->getPath(i)->getTail() != hiddencube);
+  }
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -193,6 +193,7 @@
 #endif // HAVE_CONFIG_H
 
 #include <cassert>
+#include <cstdlib> // atoi()
 
 #include <Inventor/SoInput.h>
 #include <Inventor/SoOutput.h>
@@ -205,14 +206,24 @@
 #include <Inventor/actions/SoAudioRenderAction.h>
 #include <Inventor/errors/SoReadError.h>
 #include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
 #include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoCullElement.h>
+#include <Inventor/elements/SoLocalBBoxMatrixElement.h>
+#include <Inventor/caches/SoBoundingBoxCache.h>
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbXfBox3f.h>
 #include <Inventor/system/gl.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/C/tidbits.h> // coin_getenv()
 
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoGL.h"
 #include "glue/glp.h"
 #include "io/SoWriterefCounter.h"
+#include "actions/SoSearchActionP.h"
 
 #include <Inventor/annex/Profiler/SoProfiler.h>
 #include "profiler/SoNodeProfiling.h"
@@ -225,9 +236,10 @@
 */
 
 // *************************************************************************
-// Note: just static data here, as there's no Cheshire Cat pattern (i.e.
-// pimpl-ptr) implemented for SoNode. (The class should be as slim as
-// possible.)
+// Note: the pimpl-ptr is only allocated for groups with enough
+// children to keep child culling data (see
+// SoGroup::setChildCullingThreshold()), or when the group is searched
+// with SoSearchAction, as the class should be as slim as possible.
 
 class SoGroupP {
 public:
@@ -235,9 +247,434 @@ public:
   static GLRenderFunc * glrenderfunc;
   static void childGLRender(SoGroup * thisp, SoNode * child, SoGLRenderAction * action);
   static void childGLRenderProfiler(SoGroup * thisp, SoNode * child, SoGLRenderAction * action);
+
+  static int cullthreshold;
+
+  // A node in the bounding box hierarchy of a child run. The left
+  // subnode (if any) is stored right after its parent, so only the
+  // index of the right subnode is needed.
+  struct BoxNode {
+    SbBox3f box;
+    int begin, end; // range of child indices covered by the node
+    int right; // index of right subnode, or -1 for leaf nodes
+    SbBool cullable; // FALSE if some child in the range has an empty bbox
+  };
+
+  // A run of consecutive children which do not affect the traversal
+  // state. All children in a run share the same coordinate system,
+  // so their bounding boxes can be tested together.
+  class ChildRun {
+  public:
+    ChildRun(const int beginidx, const int endidx)
+      : begin(beginidx), end(endidx), cache(NULL), numcenters(0) { }
+    ~ChildRun() { if (this->cache) this->cache->unref(); }
+
+    int begin, end;
+    SoBoundingBoxCache * cache;
+    SbList<SbBox3f> childboxes;
+    SbList<BoxNode> nodes;
+    SbVec3f centersum;
+    int numcenters;
+  };
+
+  // Culls runs of children against a bounding volume during traversal.
+  class Culler {
+  public:
+    Culler(SoGroupP * data, SoState * state)
+      : state(state), data(data), runend(-1), visiblepos(0) { }
+    virtual ~Culler() { }
+
+    int next(int childidx) {
+      return this->data ? this->nextVisible(childidx) : childidx;
+    }
+
+  protected:
+    // called when entering a run, return FALSE to disable culling of it
+    virtual SbBool beginRun(void) = 0;
+    // return TRUE if the box is outside the volume
+    virtual SbBool isOutside(const SbBox3f & box) = 0;
+
+    SoState * state;
+
+  private:
+    int nextVisible(int childidx);
+    void collectVisible(const ChildRun * run, const int nodeidx);
+
+    SoGroupP * data;
+    int runend; // end of the run being traversed, or -1
+    SbList<int> visible;
+    int visiblepos;
+  };
+
+  class FrustumCuller : public Culler {
+  public:
+    FrustumCuller(SoGroupP * data, SoState * state)
+      : Culler(data, state) { }
+  protected:
+    virtual SbBool beginRun(void) {
+      return !SoCullElement::completelyInside(this->state);
+    }
+    virtual SbBool isOutside(const SbBox3f & box) {
+      return SoCullElement::cullTest(this->state, box, TRUE);
+    }
+  };
+
+  class RayCuller : public Culler {
+  public:
+    RayCuller(SoGroupP * data, SoRayPickAction * action)
+      : Culler(data, action->getState()), action(action) { }
+  protected:
+    virtual SbBool beginRun(void) {
+      this->action->setObjectSpace();
+      return TRUE;
+    }
+    virtual SbBool isOutside(const SbBox3f & box) {
+      return !this->action->intersect(box, TRUE);
+    }
+  private:
+    SoRayPickAction * action;
+  };
+
+  SoGroupP(void) : valid(FALSE), summaryvalid(FALSE) { }
+  ~SoGroupP() { this->clear(); }
+
+  static SoGroupP * getCullData(SoGroup * group, const SbBool create);
+  void invalidate(void);
+  void clear(void);
+  void buildRuns(SoGroup * group);
+  void getRunBoundingBox(SoGroup * group, ChildRun * run,
+                         SoGetBoundingBoxAction * action,
+                         SbVec3f & acccenter, int & numcenters);
+  static int buildNodes(ChildRun * run, const int begin, const int end);
+
+  ChildRun * getRun(const int childidx) const {
+    const int runidx = this->childrun[childidx];
+    return runidx >= 0 ? this->runs[runidx] : NULL;
+  }
+
+  SbList<ChildRun *> runs;
+  SbList<int> childrun; // index into runs for each child, or -1
+  SbBool valid;
+
+  // Summary of the node types below the group, for pruning
+  // SoSearchAction traversals. See SoSearchActionP.
+  static const uint32_t * getTypeSummary(SoGroup * group);
+  static SbBool addToTypeSummary(SoSearchActionP::TypeSummary summary, SoNode * node);
+
+  SoSearchActionP::TypeSummary typesummary;
+  SbBool summaryvalid;
+  SbBool summaryopaque; // TRUE if the subgraph could not be summarized
+  uint32_t summarystamp;
+  int summarynumchildren;
 };
 
 SoGroupP::GLRenderFunc * SoGroupP::glrenderfunc = NULL;
+int SoGroupP::cullthreshold = 0;
+
+// Adds the types of node and the nodes below it to summary. Returns
+// FALSE if the nodes below it can not be summarized.
+SbBool
+SoGroupP::addToTypeSummary(SoSearchActionP::TypeSummary summary, SoNode * node)
+{
+  SoSearchActionP::addType(summary, node->getTypeId());
+  if (node->getChildren() == NULL) return TRUE;
+  if (!node->isOfType(SoGroup::getClassTypeId())) return FALSE;
+
+  const uint32_t * childsummary = SoGroupP::getTypeSummary((SoGroup *) node);
+  if (childsummary == NULL) return FALSE;
+  for (int i = 0; i < SoSearchActionP::NUM_TYPE_BITS / 32; i++) {
+    summary[i] |= childsummary[i];
+  }
+  return TRUE;
+}
+
+// Only groups which keep their children in their own child list are
+// summarized, as changes to the child list will notify the group.
+// Other nodes with children, like node kits and the VRML97 grouping
+// nodes which keep their children in fields, stop the summary.
+const uint32_t *
+SoGroupP::getTypeSummary(SoGroup * group)
+{
+  if (group->getNodeType() & SoNode::VRML2) return NULL;
+
+  SoGroupP * data = group->pimpl;
+  if (!data) {
+    data = new SoGroupP;
+    group->pimpl = data;
+  }
+  const int numchildren = group->getNumChildren();
+  // also check the number of children, in case children were added
+  // or removed while notification was disabled
+  if (!data->summaryvalid ||
+      data->summarystamp != SoSearchActionP::structurestamp ||
+      data->summarynumchildren != numchildren) {
+    memset(data->typesummary, 0, sizeof(data->typesummary));
+    data->summaryopaque = FALSE;
+    SoNode ** childarray = (SoNode **) group->getChildren()->getArrayPtr();
+    for (int i = 0; i < numchildren && !data->summaryopaque; i++) {
+      if (!SoGroupP::addToTypeSummary(data->typesummary, childarray[i])) {
+        data->summaryopaque = TRUE;
+      }
+    }
+    data->summaryvalid = TRUE;
+    data->summarystamp = SoSearchActionP::structurestamp;
+    data->summarynumchildren = numchildren;
+  }
+  return data->summaryopaque ? NULL : data->typesummary;
+}
+
+const uint32_t *
+SoSearchActionP::getTypeSummary(SoGroup * group)
+{
+  return SoGroupP::getTypeSummary(group);
+}
+
+// Returns the child culling data for the group, or NULL if child
+// culling is not active for it. If create is TRUE, the data will be
+// (re)built if necessary, otherwise NULL is returned if it isn't up
+// to date.
+SoGroupP *
+SoGroupP::getCullData(SoGroup * group, const SbBool create)
+{
+  if (SoGroupP::cullthreshold <= 0 ||
+      group->getNumChildren() < SoGroupP::cullthreshold) return NULL;
+
+  SoGroupP * data = group->pimpl;
+  // also check the number of children, in case children were added
+  // or removed while notification was disabled
+  if (data && data->valid &&
+      data->childrun.getLength() == group->getNumChildren()) return data;
+  if (!create) return NULL;
+
+  if (!data) {
+    data = new SoGroupP;
+    group->pimpl = data;
+  }
+  data->buildRuns(group);
+  return data;
+}
+
+// Marks the data as out of date. The runs are not deleted until the
+// data is rebuilt, as they might be in use in an ongoing traversal.
+void
+SoGroupP::invalidate(void)
+{
+  for (int i = 0; i < this->runs.getLength(); i++) {
+    if (this->runs[i]->cache) this->runs[i]->cache->invalidate();
+  }
+  this->valid = FALSE;
+}
+
+void
+SoGroupP::clear(void)
+{
+  for (int i = 0; i < this->runs.getLength(); i++) {
+    delete this->runs[i];
+  }
+  this->runs.truncate(0);
+  this->childrun.truncate(0);
+  this->valid = FALSE;
+}
+
+// Splits the children in runs of consecutive children which don't
+// affect the state. The bounding boxes are calculated later, in
+// getRunBoundingBox().
+void
+SoGroupP::buildRuns(SoGroup * group)
+{
+  this->clear();
+
+  const int n = group->getNumChildren();
+  SoNode ** childarray = (SoNode**) group->getChildren()->getArrayPtr();
+  int i = 0;
+  while (i < n) {
+    if (childarray[i]->affectsState()) {
+      this->childrun.append(-1);
+      i++;
+      continue;
+    }
+    int end = i + 1;
+    while (end < n && !childarray[end]->affectsState()) end++;
+    // culling a run of just a few children isn't worth the effort
+    if (end - i < 2) {
+      for (; i < end; i++) this->childrun.append(-1);
+      continue;
+    }
+    const int runidx = this->runs.getLength();
+    this->runs.append(new ChildRun(i, end));
+    for (; i < end; i++) this->childrun.append(runidx);
+  }
+  this->valid = TRUE;
+}
+
+// Builds a bounding box hierarchy over the children in [begin, end),
+// keeping the children order. Returns the index of the node created
+// for the range.
+int
+SoGroupP::buildNodes(ChildRun * run, const int begin, const int end)
+{
+  // leaf nodes contain at most this number of children
+  static const int LEAFSIZE = 8;
+
+  const int idx = run->nodes.getLength();
+  BoxNode node;
+  node.begin = begin;
+  node.end = end;
+  node.right = -1;
+  node.cullable = TRUE;
+  run->nodes.append(node);
+
+  if (end - begin > LEAFSIZE) {
+    const int mid = (begin + end) / 2;
+    (void) SoGroupP::buildNodes(run, begin, mid);
+    const int right = SoGroupP::buildNodes(run, mid, end);
+    BoxNode & parent = run->nodes[idx];
+    const BoxNode & l = run->nodes[idx + 1];
+    const BoxNode & r = run->nodes[right];
+    parent.right = right;
+    parent.box = l.box;
+    parent.box.extendBy(r.box);
+    parent.cullable = l.cullable && r.cullable;
+  }
+  else {
+    BoxNode & leaf = run->nodes[idx];
+    for (int i = begin; i < end; i++) {
+      const SbBox3f & childbox = run->childboxes[i - run->begin];
+      if (childbox.isEmpty()) leaf.cullable = FALSE;
+      else leaf.box.extendBy(childbox);
+    }
+  }
+  return idx;
+}
+
+// Calculates the bounding box for a run of children, using the
+// cached bounding box if it is still valid.
+void
+SoGroupP::getRunBoundingBox(SoGroup * group, ChildRun * run,
+                            SoGetBoundingBoxAction * action,
+                            SbVec3f & acccenter, int & numcenters)
+{
+  SoState * state = action->getState();
+
+  if (!run->cache || !run->cache->isValid(state)) {
+    SbXfBox3f abox = action->getXfBoundingBox();
+    SbXfBox3f runbox;
+    run->childboxes.truncate(0);
+    run->nodes.truncate(0);
+    run->centersum.setValue(0.0f, 0.0f, 0.0f);
+    run->numcenters = 0;
+
+    SbBool storedinvalid = SoCacheElement::setInvalid(FALSE);
+    state->push();
+
+    if (run->cache) run->cache->unref();
+    run->cache = new SoBoundingBoxCache(state);
+    run->cache->ref();
+    // set active cache to record cache dependencies
+    SoCacheElement::set(state, run->cache);
+
+    // the children in the run don't affect the state, so the boxes
+    // can all be calculated in the coordinate system of the run
+    SoLocalBBoxMatrixElement::makeIdentity(state);
+    for (int i = run->begin; i < run->end; i++) {
+      action->getXfBoundingBox().makeEmpty();
+      group->getChildren()->traverse(action, i);
+
+      const SbXfBox3f & childbox = action->getXfBoundingBox();
+      if (childbox.isEmpty()) {
+        run->childboxes.append(SbBox3f());
+      }
+      else {
+        run->childboxes.append(childbox.project());
+        runbox.extendBy(childbox);
+      }
+      if (action->isCenterSet()) {
+        run->centersum += action->getCenter();
+        run->numcenters++;
+        action->resetCenter();
+      }
+    }
+    SbVec3f center(0.0f, 0.0f, 0.0f);
+    if (run->numcenters) center = run->centersum / float(run->numcenters);
+    run->cache->set(runbox, run->numcenters > 0, center);
+
+    state->pop();
+    SoCacheElement::setInvalid(storedinvalid);
+    action->getXfBoundingBox() = abox; // reset action bbox
+
+    (void) SoGroupP::buildNodes(run, run->begin, run->end);
+  }
+  else {
+    SoCacheElement::addCacheDependency(state, run->cache);
+    if (run->cache->hasLinesOrPoints()) {
+      SoBoundingBoxCache::setHasLinesOrPoints(state);
+    }
+  }
+
+  const SbXfBox3f & box = run->cache->getBox();
+  if (!box.isEmpty()) action->extendBy(box);
+
+  if (run->numcenters > 0) {
+    // the centers are in the coordinate system of the run, transform
+    // them the same way SoGetBoundingBoxAction::setCenter() would
+    SbVec3f center;
+    SoLocalBBoxMatrixElement::get(state).multVecMatrix(run->cache->getCenter(), center);
+    acccenter += center * float(run->numcenters);
+    numcenters += run->numcenters;
+  }
+}
+
+// Returns the index of the next child, starting at childidx, which
+// should be traversed.
+int
+SoGroupP::Culler::nextVisible(int childidx)
+{
+  for (;;) {
+    if (this->runend >= 0) {
+      if (childidx < this->runend) {
+        const int n = this->visible.getLength();
+        while (this->visiblepos < n && this->visible[this->visiblepos] < childidx) {
+          this->visiblepos++;
+        }
+        if (this->visiblepos < n) return this->visible[this->visiblepos];
+        childidx = this->runend;
+      }
+      this->runend = -1;
+    }
+    if (childidx >= this->data->childrun.getLength()) return childidx;
+
+    const ChildRun * run = this->data->getRun(childidx);
+    if (!run || run->begin != childidx || !run->cache ||
+        run->nodes.getLength() == 0 || !run->cache->isValid(this->state) ||
+        !this->beginRun()) {
+      return childidx;
+    }
+    this->runend = run->end;
+    this->visible.truncate(0);
+    this->visiblepos = 0;
+    this->collectVisible(run, 0);
+  }
+}
+
+void
+SoGroupP::Culler::collectVisible(const ChildRun * run, const int nodeidx)
+{
+  const BoxNode & node = run->nodes[nodeidx];
+  if (node.cullable && this->isOutside(node.box)) return;
+
+  if (node.right >= 0) {
+    this->collectVisible(run, nodeidx + 1);
+    this->collectVisible(run, node.right);
+  }
+  else {
+    for (int i = node.begin; i < node.end; i++) {
+      const SbBox3f & childbox = run->childboxes[i - run->begin];
+      if (childbox.isEmpty() || !this->isOutside(childbox)) {
+        this->visible.append(i);
+      }
+    }
+  }
+}
 
 // *************************************************************************
 
@@ -250,7 +687,7 @@ SO_NODE_SOURCE(SoGroup);
 */
 SoGroup::SoGroup(void)
 {
-  this->pimpl = NULL; // just set to NULL for now
+  this->pimpl = NULL; // allocated on demand, see SoGroupP::getCullData()
   SO_NODE_INTERNAL_CONSTRUCTOR(SoGroup);
 
   this->children = new SoChildList(this);
@@ -267,6 +704,7 @@ SoGroup::SoGroup(void)
 */
 SoGroup::SoGroup(int nchildren)
 {
+  this->pimpl = NULL;
   SO_NODE_INTERNAL_CONSTRUCTOR(SoGroup);
 
   this->children = new SoChildList(this, nchildren);
@@ -279,6 +717,7 @@ SoGroup::SoGroup(int nchildren)
 SoGroup::~SoGroup()
 {
   delete this->children;
+  delete this->pimpl;
 }
 
 /*!
@@ -533,6 +972,67 @@ SoGroup::initClass(void)
   if (SoProfiler::isEnabled()) {
     SoGroupP::glrenderfunc = SoGroupP::childGLRenderProfiler;
   }
+
+  const char * env = coin_getenv("COIN_GROUP_CULLING_THRESHOLD");
+  if (env) SoGroup::setChildCullingThreshold(atoi(env));
+}
+
+/*!
+  Sets the minimum number of children a group node must have before
+  it keeps bounding boxes for its children, to be able to skip
+  children outside the view volume during rendering, and children
+  not hit by the ray during ray picking.
+
+  The bounding boxes are calculated during SoGetBoundingBoxAction
+  traversals, and are kept for runs of consecutive children which do
+  not affect the traversal state (like SoSeparator and SoShape
+  nodes). They are invalidated when the group or anything below it
+  changes. Successive SoGetBoundingBoxAction traversals will also use
+  the bounding boxes instead of traversing the children again, as
+  long as they are valid.
+
+  This is a global value which will be used for all group nodes. The
+  default value is 0, which disables child culling. The value can
+  also be set with the environment variable
+  COIN_GROUP_CULLING_THRESHOLD.
+
+  \sa SoSeparator::renderCulling
+  \since Coin 4.0
+*/
+void
+SoGroup::setChildCullingThreshold(const int numchildren)
+{
+  SoGroupP::cullthreshold = numchildren;
+}
+
+/*!
+  Returns the minimum number of children a group node must have
+  before it keeps bounding boxes for child culling. 0 means child
+  culling is disabled.
+
+  \sa setChildCullingThreshold()
+  \since Coin 4.0
+*/
+int
+SoGroup::getChildCullingThreshold(void)
+{
+  return SoGroupP::cullthreshold;
+}
+
+// Doc from superclass.
+void
+SoGroup::notify(SoNotList * nl)
+{
+  // the children bounding boxes might have changed, and children
+  // might have been added or removed
+  if (this->pimpl) this->pimpl->invalidate();
+
+  if (SoSearchActionP::isStructuralChange(nl)) {
+    if (this->pimpl) this->pimpl->summaryvalid = FALSE;
+    // the groups above will not be notified
+    if (!this->isNotifyEnabled()) SoSearchActionP::invalidateAllSummaries();
+  }
+  inherited::notify(nl);
 }
 
 // *************************************************************************
@@ -563,19 +1063,34 @@ SoGroup::getBoundingBox(SoGetBoundingBoxAction * action)
   int numindices;
   const int * indices;
   int lastchildindex;
+  SoAction::PathCode pathcode = action->getPathCode(numindices, indices);
 
-  if (action->getPathCode(numindices, indices) == SoAction::IN_PATH)
+  if (pathcode == SoAction::IN_PATH)
     lastchildindex = indices[numindices-1];
   else
     lastchildindex = this->getNumChildren() - 1;
 
   assert(lastchildindex < this->getNumChildren());
 
+  // child bounding boxes are only kept for normal traversals
+  SoGroupP * culldata = NULL;
+  if ((pathcode == SoAction::NO_PATH || pathcode == SoAction::BELOW_PATH) &&
+      !action->isInCameraSpace() && !action->isResetPath()) {
+    culldata = SoGroupP::getCullData(this, TRUE);
+  }
+
   // Initialize accumulation variables.
   SbVec3f acccenter(0.0f, 0.0f, 0.0f);
   int numcenters = 0;
 
   for (int i = 0; i <= lastchildindex; i++) {
+    SoGroupP::ChildRun * run = culldata ? culldata->getRun(i) : NULL;
+    if (run) {
+      culldata->getRunBoundingBox(this, run, action, acccenter, numcenters);
+      i = run->end - 1;
+      continue;
+    }
+
     this->getChildren()->traverse(action, i);
 
     // If center point is set, accumulate.
@@ -639,9 +1154,17 @@ SoGroup::GLRender(SoGLRenderAction * action)
     }
   }
   else {
+    // skip children outside the view volume, but not while building
+    // a render cache, as the cache must contain all children
+    SoGroupP * culldata = NULL;
+    if (pathcode != SoAction::OFF_PATH && !state->isCacheOpen()) {
+      culldata = SoGroupP::getCullData(this, FALSE);
+    }
+    SoGroupP::FrustumCuller culler(culldata, state);
+
     action->pushCurPath();
     int n = this->getChildren()->getLength();
-    for (int i = 0; i < n && !action->hasTerminated(); i++) {
+    for (int i = culler.next(0); i < n && !action->hasTerminated(); i = culler.next(i+1)) {
       action->popPushCurPath(i, childarray[i]);
 
       if (pathcode == SoAction::OFF_PATH && !childarray[i]->affectsState()) {
@@ -710,7 +1233,26 @@ SoGroup::getMatrix(SoGetMatrixAction * action)
 void
 SoGroup::pick(SoPickAction * action)
 {
-  SoGroup::doAction((SoAction *)action);
+  SoGroupP * culldata = NULL;
+  if (action->isOfType(SoRayPickAction::getClassTypeId()) &&
+      ((SoRayPickAction *)action)->hasWorldSpaceRay()) {
+    int numindices;
+    const int * indices;
+    if (action->getPathCode(numindices, indices) != SoAction::IN_PATH) {
+      culldata = SoGroupP::getCullData(this, FALSE);
+    }
+  }
+  if (culldata == NULL) {
+    SoGroup::doAction((SoAction *)action);
+    return;
+  }
+
+  // skip children not intersected by the pick ray
+  SoGroupP::RayCuller culler(culldata, (SoRayPickAction *)action);
+  const int n = this->getNumChildren();
+  for (int i = culler.next(0); i < n && !action->hasTerminated(); i = culler.next(i+1)) {
+    this->getChildren()->traverse(action, i);
+  }
 }
 
 // Doc from superclass.
@@ -905,3 +1447,116 @@ SoGroup::getPrimitiveCount(SoGetPrimitiveCountAction * action)
 {
   SoGroup::doAction((SoAction *)action);
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+BOOST_AUTO_TEST_CASE(childCulling)
+{
+  const int oldthreshold = SoGroup::getChildCullingThreshold();
+
+  SoGroup * root = new SoGroup;
+  root->ref();
+  root->addChild(new SoTranslation); // affects state, splits the runs
+  SoTranslation * movedcube = NULL;
+  for (int i = 0; i < 64; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * t = new SoTranslation;
+    t->translation.setValue(float(i) * 3.0f, 0.0f, 0.0f);
+    sep->addChild(t);
+    sep->addChild(new SoCube);
+    root->addChild(sep);
+    if (i == 10) movedcube = t;
+  }
+
+  SbViewportRegion vp(100, 100);
+  SoGetBoundingBoxAction bba(vp);
+  bba.apply(root);
+  const SbBox3f reference = bba.getBoundingBox();
+  const SbVec3f referencecenter = bba.getCenter();
+
+  SoGroup::setChildCullingThreshold(16);
+  // first traversal builds the child bounds, the second uses them
+  for (int pass = 0; pass < 2; pass++) {
+    bba.apply(root);
+    BOOST_CHECK_MESSAGE(bba.getBoundingBox().getMin().equals(reference.getMin(), 1e-4f) &&
+                        bba.getBoundingBox().getMax().equals(reference.getMax(), 1e-4f),
+                        "bounding box differs with child culling");
+    BOOST_CHECK_MESSAGE(bba.getCenter().equals(referencecenter, 1e-4f),
+                        "bounding box center differs with child culling");
+  }
+
+  SoRayPickAction rpa(vp);
+  rpa.setRay(SbVec3f(30.0f, 0.0f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  rpa.apply(root);
+  SoPickedPoint * pp = rpa.getPickedPoint();
+  BOOST_CHECK_MESSAGE(pp != NULL, "ray missed the cube");
+  if (pp) {
+    BOOST_CHECK_EQUAL(pp->getPath()->getIndex(1), 11);
+  }
+
+  // changes below the group must invalidate the child bounds
+  movedcube->translation.setValue(500.0f, 0.0f, 0.0f);
+  bba.apply(root);
+  BOOST_CHECK_MESSAGE(bba.getBoundingBox().getMax()[0] > 500.0f,
+                      "child bounds were not invalidated");
+  rpa.setRay(SbVec3f(500.0f, 0.0f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  rpa.apply(root);
+  pp = rpa.getPickedPoint();
+  BOOST_CHECK_MESSAGE(pp != NULL && pp->getPath()->getIndex(1) == 11,
+                      "moved cube was not picked");
+
+  SoGroup::setChildCullingThreshold(oldthreshold);
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(searchPruning)
+{
+  SoGroup * root = new SoGroup;
+  root->ref();
+  SoSeparator * sep = new SoSeparator;
+  sep->addChild(new SoCube);
+  root->addChild(sep);
+
+  SoSearchAction sa;
+  sa.setType(SoMaterial::getClassTypeId());
+  sa.setInterest(SoSearchAction::ALL);
+  sa.apply(root);
+  BOOST_CHECK_EQUAL(sa.getPaths().getLength(), 0);
+
+  // a structural change hidden from the parent by disabled
+  // notification must still invalidate the type summaries
+  SbBool old = sep->enableNotify(FALSE);
+  sep->addChild(new SoMaterial);
+  sep->enableNotify(old);
+  sa.apply(root);
+  BOOST_CHECK_EQUAL(sa.getPaths().getLength(), 1);
+
+  SoMaterial * named = new SoMaterial;
+  named->setName("searchPruningTarget");
+  sep->addChild(named);
+  sa.reset();
+  sa.setName("searchPruningTarget");
+  sa.apply(root);
+  BOOST_CHECK_MESSAGE(sa.getPath() != NULL && sa.getPath()->getTail() == named,
+                      "named node not found");
+
+  sa.reset();
+  sa.setName("searchPruningNoSuchName");
+  sa.apply(root);
+  BOOST_CHECK(sa.getPath() == NULL);
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
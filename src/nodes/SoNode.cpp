@@ -219,6 +219,7 @@ SbUniqueId is not really a class, just a \c typedef.
 #include "rendering/SoGL.h"
 #include "nodes/SoSubNodeP.h"
 #include "nodes/SoUnknownNode.h"
+#include "actions/SoSearchActionP.h"
 #include "threads/threadsutilp.h"
 #include "glue/glp.h"
 #include "misc/SoDBP.h" // for global envvar COIN_PROFILER
@@ -1202,7 +1203,13 @@ SoNode::searchS(SoAction * action, SoNode * node)
   assert(action && node);
   assert(action->getTypeId().isDerivedFrom(SoSearchAction::getClassTypeId()));
   SoSearchAction * const searchAction = (SoSearchAction *)(action);
-  node->search(searchAction);
+  // only check the node itself if no node below it can match
+  if (SoSearchActionP::get(searchAction)->skipChildren(node)) {
+    node->SoNode::search(searchAction);
+  }
+  else {
+    node->search(searchAction);
+  }
 }
 
 // Note that this documentation will also be used for all subclasses
@@ -1242,7 +1249,11 @@ SoNode::search(SoSearchAction * action)
   }
 
   if (lookfor & SoSearchAction::NAME) {
-    hit = this->getName() == action->getName();
+    // use the nodes found through the name dictionary if possible, to
+    // avoid looking up the name of every node
+    const SoSearchActionP * searchp = SoSearchActionP::get(action);
+    if (searchp->namecandidates) hit = searchp->isCandidate(this);
+    else hit = this->getName() == action->getName();
     if (!hit) { return; }
   }
 
@@ -112,6 +112,9 @@
 // environment variable
 static int COIN_RANDOMIZE_RENDER_CACHING = -1;
 
+// compiled traversal of static subgraphs, see setCompiledTraversal()
+static SbBool compiledtraversal = FALSE;
+
 // Maximum number of caches available for allocation for the
 // rendercaching.
 int SoSeparator::numrendercaches = 2;
@@ -336,7 +339,9 @@ public:
 
   enum { YES, NO, MAYBE } hassoundchild;
 
-  SoGLCacheList * getGLCacheList(SbBool createifnull);
+  SoGLCacheList * getGLCacheList(SbBool createifnull) const;
+  static void registerGLCacheFootprint(SoGLRenderAction * action,
+                                       const SoGLCacheList * glcachelist);
 
   void invalidateGLCaches(void) {
     glcachestorage->applyToAll(invalidate_gl_cache, NULL);
@@ -355,6 +360,38 @@ public:
 
   static SbBool doCull(SoSeparatorP * thisp, SoState * state,
                        SbBool (* cullfunc)(SoState *, const SbBox3f &, const SbBool));
+
+  // compiled traversal. The children subgraph is flattened into a
+  // list of instructions, with nested SoGroup and SoSeparator nodes
+  // replaced by begin/end pairs.
+  enum InstructionType { LEAF, GROUP_BEGIN, SEPARATOR_BEGIN, END };
+  struct Instruction {
+    SoNode * node;
+    int childindex;
+    InstructionType type;
+    // for begin instructions: the index of the matching end
+    // instruction. For end instructions: the index of the begin
+    // instruction.
+    int match;
+  };
+  // a compiled program is never changed after it has been
+  // published. Traversals running it hold a reference, so that
+  // another thread can replace it meanwhile.
+  struct Program {
+    SbList <Instruction> instructions;
+    int refcount;
+  };
+  Program * program;
+  SbBool programvalid;
+  int numstatictraversals;
+
+  Program * refProgram(SoAction * action);
+  void unrefProgram(Program * program);
+  void compileProgram(void);
+  void clearProgram(void);
+  static void deleteProgram(Program * program);
+  static void compileChildren(SbList <Instruction> & program, SoGroup * group, int & numgroups);
+  void runProgram(SoAction * action, const Program * program);
 };
 
 #define PRIVATE(obj) ((obj)->pimpl)
@@ -363,7 +400,7 @@ public:
 // *************************************************************************
 
 SoGLCacheList *
-SoSeparatorP::getGLCacheList(SbBool createifnull)
+SoSeparatorP::getGLCacheList(SbBool createifnull) const
 {
   soseparator_storage * ptr =
     (soseparator_storage*) this->glcachestorage->get();
@@ -373,6 +410,27 @@ SoSeparatorP::getGLCacheList(SbBool createifnull)
   return ptr->glcachelist;
 }
 
+// registers the client side memory used by the render caches with
+// the profiler. The separator may be rendered several times during
+// one traversal, and the cache list is the only thing adding to its
+// footprint, so the previous value is replaced rather than added to.
+void
+SoSeparatorP::registerGLCacheFootprint(SoGLRenderAction * action,
+                                       const SoGLCacheList * glcachelist)
+{
+  SoState * state = action->getState();
+  if (!state->isElementEnabled(SoProfilerElement::getClassStackIndex())) return;
+  SoProfilerElement * e = SoProfilerElement::get(state);
+  if (!e) return;
+
+  SoGLCacheList::Statistics stats;
+  glcachelist->getStatistics(stats);
+  SbProfilingData & data = e->getProfilingData();
+  int entry = data.getIndex(action->getCurPath(), TRUE);
+  assert(entry != -1);
+  data.setNodeFootprint(entry, SbProfilingData::MEMORY_SIZE, stats.memory);
+}
+
 // *************************************************************************
 
 SO_NODE_SOURCE(SoSeparator);
@@ -456,6 +514,10 @@ SoSeparator::commonConstructor(void)
   }
 
   PRIVATE(this)->hassoundchild = SoSeparatorP::MAYBE;
+
+  PRIVATE(this)->program = NULL;
+  PRIVATE(this)->programvalid = FALSE;
+  PRIVATE(this)->numstatictraversals = 0;
 }
 
 /*!
@@ -466,6 +528,7 @@ SoSeparator::~SoSeparator()
   if (PRIVATE(this)->bboxcache) {
     PRIVATE(this)->bboxcache->unref();
   }
+  PRIVATE(this)->clearProgram();
 }
 
 /*!
@@ -479,6 +542,9 @@ SoSeparator::initClass(void)
   SO_ENABLE(SoGetBoundingBoxAction, SoCacheElement);
   SO_ENABLE(SoGLRenderAction, SoCacheElement);
   SoSeparator::numrendercaches = 2;
+
+  const char * env = coin_getenv("COIN_SEPARATOR_COMPILED_TRAVERSAL");
+  compiledtraversal = env && (atoi(env) > 0);
 }
 
 // Doc from superclass.
@@ -571,7 +637,14 @@ SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
 
     SoLocalBBoxMatrixElement::makeIdentity(state);
     action->getXfBoundingBox().makeEmpty();
-    inherited::getBoundingBox(action);
+    SoSeparatorP::Program * program = PRIVATE(this)->refProgram(action);
+    if (program) {
+      PRIVATE(this)->runProgram(action, program);
+      PRIVATE(this)->unrefProgram(program);
+    }
+    else {
+      inherited::getBoundingBox(action);
+    }
 
     childrenbbox = action->getXfBoundingBox();
     childrencenterset = action->isCenterSet();
@@ -611,7 +684,14 @@ SoSeparator::callback(SoCallbackAction * action)
   // action traversal.
 
   if (!this->cullTest(state)) {
-    SoGroup::callback(action);
+    SoSeparatorP::Program * program = PRIVATE(this)->refProgram(action);
+    if (program) {
+      PRIVATE(this)->runProgram(action, program);
+      PRIVATE(this)->unrefProgram(program);
+    }
+    else {
+      SoGroup::callback(action);
+    }
   }
   state->pop();
 }
@@ -683,6 +763,7 @@ SoSeparator::GLRenderBelowPath(SoGLRenderAction * action)
         if (e) {
           e->getProfilingData().setNodeFlag(action->getCurPath(), SbProfilingData::GL_CACHED_FLAG, TRUE);
         }
+        SoSeparatorP::registerGLCacheFootprint(action, glcachelist);
       }
 
       return;
@@ -749,6 +830,9 @@ SoSeparator::GLRenderBelowPath(SoGLRenderAction * action)
   state->pop();
   if (createcache) {
     createcache->close(action);
+    if (SoProfiler::isEnabled()) {
+      SoSeparatorP::registerGLCacheFootprint(action, createcache);
+    }
   }
 }
 
@@ -864,7 +948,17 @@ SoSeparator::rayPick(SoRayPickAction * action)
       !PRIVATE(this)->bboxcache || !PRIVATE(this)->bboxcache->isValid(action->getState()) ||
       !action->hasWorldSpaceRay() ||
       ray_intersect(action, PRIVATE(this)->bboxcache->getProjectedBox())) {
-    SoSeparator::doAction(action);
+    SoSeparatorP::Program * program = PRIVATE(this)->refProgram(action);
+    if (program) {
+      SoState * state = action->getState();
+      state->push();
+      PRIVATE(this)->runProgram(action, program);
+      state->pop();
+      PRIVATE(this)->unrefProgram(program);
+    }
+    else {
+      SoSeparator::doAction(action);
+    }
   }
 }
 
@@ -930,6 +1024,60 @@ SoSeparator::getNumRenderCaches(void)
   return SoSeparator::numrendercaches;
 }
 
+/*!
+  Enables or disables compiled traversal of static subgraphs. The
+  default is \c FALSE, unless the environment variable
+  COIN_SEPARATOR_COMPILED_TRAVERSAL is set to 1.
+
+  When enabled, an SoSeparator that has been traversed a couple of
+  times without any changes in its subgraph flattens the subgraph
+  into a linear list of instructions. The SoGroup and SoSeparator
+  nodes in the subgraph are replaced by begin and end instructions,
+  and the list is then replayed for SoCallbackAction,
+  SoGetBoundingBoxAction and SoRayPickAction, instead of traversing
+  the groups recursively. Pre and post callbacks, culling and pick
+  culling are handled just like for a normal traversal. The list is
+  discarded as soon as anything in the subgraph changes.
+
+  Subclasses of SoGroup and SoSeparator, like SoSwitch, are traversed
+  as usual, and subgraphs instancing the same nodes very many times
+  are not compiled.
+
+  \since Coin 4.0
+*/
+void
+SoSeparator::setCompiledTraversal(const SbBool onoff)
+{
+  compiledtraversal = onoff;
+}
+
+/*!
+  Returns whether compiled traversal of static subgraphs is enabled.
+
+  \sa setCompiledTraversal()
+  \since Coin 4.0
+*/
+SbBool
+SoSeparator::isCompiledTraversal(void)
+{
+  return compiledtraversal;
+}
+
+/*!
+  Returns the render cache list used when this separator is rendered
+  by the calling thread, or \c NULL if the separator has not been
+  rendered with render caching enabled. Use
+  SoGLCacheList::getStatistics() to find out how well render caching
+  works for the separator.
+
+  \since Coin 4.0
+*/
+const SoGLCacheList *
+SoSeparator::getGLCacheList(void) const
+{
+  return PRIVATE(this)->getGLCacheList(FALSE);
+}
+
 // Doc from superclass.
 SbBool
 SoSeparator::affectsState(void) const
@@ -959,6 +1107,8 @@ SoSeparator::notify(SoNotList * nl)
   if (PRIVATE(this)->bboxcache) PRIVATE(this)->bboxcache->invalidate();
   PRIVATE(this)->invalidateGLCaches();
   PRIVATE(this)->hassoundchild = SoSeparatorP::MAYBE;
+  PRIVATE(this)->programvalid = FALSE;
+  PRIVATE(this)->numstatictraversals = 0;
   PRIVATE(this)->unlock();
 }
 
@@ -983,33 +1133,286 @@ SoSeparator::readInstance(SoInput * in, unsigned short flags)
 
 // *************************************************************************
 
+// the maximum number of instructions in a compiled traversal. Larger
+// subgraphs (typically with a lot of instancing) are not compiled.
+#define SOSEPARATOR_MAX_PROGRAM_SIZE 100000
+
+// Returns the compiled program if action should traverse the
+// children using it, compiling it if the subgraph has been static
+// for a while. The returned program is referenced, and must be
+// released with unrefProgram() after the traversal.
+SoSeparatorP::Program *
+SoSeparatorP::refProgram(SoAction * action)
+{
+  if (!compiledtraversal) return NULL;
+
+  const SoAction::PathCode pathcode = action->getCurPathCode();
+  if (pathcode != SoAction::NO_PATH && pathcode != SoAction::BELOW_PATH) return NULL;
+
+  // subclasses of the actions might have other methods for the group
+  // nodes, so only the exact action types are handled
+  const SoType type = action->getTypeId();
+  if (type == SoGetBoundingBoxAction::getClassTypeId()) {
+    if (static_cast<SoGetBoundingBoxAction *>(action)->isResetPath()) return NULL;
+  }
+  else if (type != SoCallbackAction::getClassTypeId() &&
+           type != SoRayPickAction::getClassTypeId()) {
+    return NULL;
+  }
+
+  this->lock();
+  if (!this->programvalid && ++this->numstatictraversals >= 2) {
+    this->compileProgram();
+  }
+  Program * program = this->programvalid ? this->program : NULL;
+  if (program) program->refcount++;
+  this->unlock();
+  return program;
+}
+
+void
+SoSeparatorP::unrefProgram(Program * program)
+{
+  this->lock();
+  const int refcount = --program->refcount;
+  this->unlock();
+  if (refcount == 0) SoSeparatorP::deleteProgram(program);
+}
+
+void
+SoSeparatorP::deleteProgram(Program * program)
+{
+  // the nodes are referenced so that the program never refers to
+  // destructed nodes, even if nodes are removed while notification
+  // is disabled
+  for (int i = 0; i < program->instructions.getLength(); i++) {
+    program->instructions[i].node->unref();
+  }
+  delete program;
+}
+
+void
+SoSeparatorP::compileChildren(SbList <Instruction> & program, SoGroup * group, int & numgroups)
+{
+  const SoChildList * children = group->getChildren();
+  const int n = children->getLength();
+  for (int i = 0; i < n && program.getLength() < SOSEPARATOR_MAX_PROGRAM_SIZE; i++) {
+    SoNode * child = (*children)[i];
+    const SoType type = child->getTypeId();
+    const SbBool isseparator = type == SoSeparator::getClassTypeId();
+    child->ref();
+
+    Instruction instr;
+    instr.node = child;
+    instr.childindex = i;
+    instr.match = -1;
+    if (isseparator || type == SoGroup::getClassTypeId()) {
+      const int begin = program.getLength();
+      instr.type = isseparator ? SEPARATOR_BEGIN : GROUP_BEGIN;
+      program.append(instr);
+      SoSeparatorP::compileChildren(program, static_cast<SoGroup *>(child), numgroups);
+      instr.type = END;
+      instr.match = begin;
+      child->ref();
+      program.append(instr);
+      program[begin].match = program.getLength() - 1;
+      numgroups++;
+    }
+    else {
+      instr.type = LEAF;
+      program.append(instr);
+    }
+  }
+}
+
+// Called with the lock held.
+void
+SoSeparatorP::compileProgram(void)
+{
+  this->clearProgram();
+  Program * program = new Program;
+  program->refcount = 1;
+  int numgroups = 0;
+  SoSeparatorP::compileChildren(program->instructions, PUBLIC(this), numgroups);
+  // nothing to gain without nested groups
+  if (numgroups == 0 || program->instructions.getLength() >= SOSEPARATOR_MAX_PROGRAM_SIZE) {
+    SoSeparatorP::deleteProgram(program);
+    program = NULL;
+  }
+  this->program = program;
+  this->programvalid = TRUE;
+}
+
+// Called with the lock held, or from the destructor.
+void
+SoSeparatorP::clearProgram(void)
+{
+  Program * program = this->program;
+  this->program = NULL;
+  this->programvalid = FALSE;
+  if (program && --program->refcount == 0) {
+    SoSeparatorP::deleteProgram(program);
+  }
+}
+
+namespace {
+
+// a group being traversed by SoSeparatorP::runProgram()
+struct ProgramFrame {
+  int begin;
+  SbBool pushedstate;
+  SbVec3f acccenter;
+  int numcenters;
+};
+
+} // namespace
+
+// Traverses the children using the compiled program. Behaves like
+// SoGroup::callback(), SoGroup::getBoundingBox() or
+// SoGroup::doAction() (for SoRayPickAction) for the separator and
+// all the flattened groups below it.
+void
+SoSeparatorP::runProgram(SoAction * action, const Program * program)
+{
+  const SoType type = action->getTypeId();
+  const SbBool iscallback = type == SoCallbackAction::getClassTypeId();
+  const SbBool isbbox = type == SoGetBoundingBoxAction::getClassTypeId();
+  SoCallbackAction * cbaction = iscallback ? static_cast<SoCallbackAction *>(action) : NULL;
+  SoGetBoundingBoxAction * bbaction = isbbox ? static_cast<SoGetBoundingBoxAction *>(action) : NULL;
+  SoRayPickAction * rpaction = (!iscallback && !isbbox) ? static_cast<SoRayPickAction *>(action) : NULL;
+
+  SoState * state = action->getState();
+  const SoAction::PathCode pathcode = action->getCurPathCode();
+  const Instruction * instr = program->instructions.getArrayPtr();
+  const int n = program->instructions.getLength();
+
+  SbList <ProgramFrame> stack;
+  ProgramFrame frame;
+  frame.begin = -1;
+  frame.pushedstate = FALSE;
+  frame.acccenter.setValue(0.0f, 0.0f, 0.0f);
+  frame.numcenters = 0;
+  stack.push(frame);
+
+  int i = 0;
+  while (TRUE) {
+    const SbBool terminated = action->hasTerminated();
+    if (i < n && !terminated && instr[i].type != END) {
+      const Instruction & cur = instr[i];
+      action->pushCurPath(cur.childindex, cur.node);
+
+      // nested separators keep their own bounding box caches
+      if (cur.type == LEAF || (isbbox && cur.type == SEPARATOR_BEGIN)) {
+        action->traverse(cur.node);
+        action->popCurPath(pathcode);
+        if (isbbox && bbaction->isCenterSet()) {
+          ProgramFrame & top = stack[stack.getLength()-1];
+          top.acccenter += bbaction->getCenter();
+          top.numcenters++;
+          bbaction->resetCenter();
+        }
+        i = (cur.type == LEAF) ? i + 1 : cur.match + 1;
+        continue;
+      }
+
+      SbBool traversechildren = TRUE;
+      frame.begin = i;
+      frame.pushedstate = FALSE;
+      frame.acccenter.setValue(0.0f, 0.0f, 0.0f);
+      frame.numcenters = 0;
+
+      if (iscallback) {
+        cbaction->setCurrentNode(cur.node);
+        cbaction->invokePreCallbacks(cur.node);
+        traversechildren = cbaction->getCurrentResponse() == SoCallbackAction::CONTINUE;
+        if (traversechildren && cur.type == SEPARATOR_BEGIN) {
+          state->push();
+          frame.pushedstate = TRUE;
+          SoSeparator * sep = static_cast<SoSeparator *>(cur.node);
+          traversechildren = !SoSeparatorP::doCull(&PRIVATE(sep).get(), state, SoCullElement::cullBox);
+        }
+      }
+      else if (rpaction && cur.type == SEPARATOR_BEGIN) {
+        SoSeparator * sep = static_cast<SoSeparator *>(cur.node);
+        SoBoundingBoxCache * bboxcache = PRIVATE(sep)->bboxcache;
+        if (sep->pickCulling.getValue() != SoSeparator::OFF &&
+            bboxcache && bboxcache->isValid(state) &&
+            rpaction->hasWorldSpaceRay() &&
+            !ray_intersect(rpaction, bboxcache->getProjectedBox())) {
+          action->popCurPath(pathcode);
+          i = cur.match + 1;
+          continue;
+        }
+        state->push();
+        frame.pushedstate = TRUE;
+      }
+
+      stack.push(frame);
+      // the end instruction will unwind the group
+      i = traversechildren ? i + 1 : cur.match;
+      continue;
+    }
+
+    // end of a group, or unwinding after the action was terminated
+    if (stack.getLength() == 1) break;
+    frame = stack.pop();
+    const Instruction & begin = instr[frame.begin];
+    if (frame.pushedstate) state->pop();
+    if (iscallback) {
+      cbaction->invokePostCallbacks(begin.node);
+    }
+    else if (isbbox && frame.numcenters != 0) {
+      bbaction->setCenter(frame.acccenter / float(frame.numcenters), FALSE);
+    }
+    action->popCurPath(pathcode);
+    if (isbbox && bbaction->isCenterSet()) {
+      ProgramFrame & top = stack[stack.getLength()-1];
+      top.acccenter += bbaction->getCenter();
+      top.numcenters++;
+      bbaction->resetCenter();
+    }
+    i = terminated ? n : begin.match + 1;
+  }
+
+  frame = stack[0];
+  if (isbbox && frame.numcenters != 0) {
+    bbaction->setCenter(frame.acccenter / float(frame.numcenters), FALSE);
+  }
+}
+
+#undef SOSEPARATOR_MAX_PROGRAM_SIZE
+
+// *************************************************************************
+
 SbBool
 SoSeparatorP::doCull(SoSeparatorP * thisp, SoState * state,
                      SbBool (* cullfunc)(SoState *, const SbBox3f &, const SbBool))
 {
   if (PUBLIC(thisp)->renderCulling.getValue() == SoSeparator::OFF) return FALSE;
-  if (SoCullElement::completelyInside(state)) return FALSE;
 
   SbBool outside = FALSE;
   if (thisp->bboxcache &&
       thisp->bboxcache->isValid(state)) {
     const SbBox3f & bbox = thisp->bboxcache->getProjectedBox();
     if (!bbox.isEmpty()) {
-      outside = (*cullfunc)(state, bbox, TRUE);
+      if (!SoCullElement::completelyInside(state)) {
+        outside = (*cullfunc)(state, bbox, TRUE);
+      }
+      // occlusion culling is only done while rendering
+      SoAction * action = state->getAction();
+      if (!outside && action->isOfType(SoGLRenderAction::getClassTypeId())) {
+        outside = static_cast<SoGLRenderAction *>(action)->isOccluded(bbox);
+      }
     }
   }
 
-#if 0
-// temporarily disabled. setNodeFlag() needs current path, which is
-// unavailable here
   if (outside && SoProfiler::isEnabled()) {
     SoProfilerElement * elt = SoProfilerElement::get(state);
     if (elt) {
-      // FIXME: need current path to set this flag. move outside cullTest()?
-      // elt->getProfilingData().setNodeFlag(PUBLIC(thisp)->getCurPath(), SbProfilingData::CULLED_FLAG, TRUE);
+      elt->getProfilingData().setNodeFlag(state->getAction()->getCurPath(),
+                                          SbProfilingData::CULLED_FLAG, TRUE);
     }
   }
-#endif
 
   return outside;
 }
@@ -1017,10 +1420,12 @@ SoSeparatorP::doCull(SoSeparatorP * thisp, SoState * state,
 /*!
   Internal method which do view frustum culling. For now, view frustum
   culling is performed if the renderCulling field is \c AUTO or \c ON,
-  and the bounding box cache is valid.
+  and the bounding box cache is valid. When rendering with occluders
+  set (see SoGLRenderAction::setOccluders()), separators completely
+  hidden by the occluders are culled as well.
 
-  Returns \c TRUE if this separator is outside view frustum, \c FALSE
-  if inside.
+  Returns \c TRUE if this separator is outside view frustum or
+  occluded, \c FALSE otherwise.
 */
 SbBool
 SoSeparator::cullTest(SoState * state)
@@ -1044,3 +1449,297 @@ SoSeparator::cullTestNoPush(SoState * state)
 #undef PRIVATE
 #undef PUBLIC
 #undef GLCACHE_DEBUG
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/annex/Profiler/SbProfilingData.h>
+#include <Inventor/annex/Profiler/SoProfiler.h>
+#include <Inventor/annex/Profiler/elements/SoProfilerElement.h>
+#include <Inventor/caches/SoGLCacheList.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+namespace {
+
+struct TraversalCounts {
+  int numtriangles;
+  int numseparators;
+  int numpostseparators;
+  int numcubes;
+};
+
+SoCallbackAction::Response
+count_pre_separator(void * closure, SoCallbackAction *, const SoNode *)
+{
+  static_cast<TraversalCounts *>(closure)->numseparators++;
+  return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response
+count_post_separator(void * closure, SoCallbackAction *, const SoNode *)
+{
+  static_cast<TraversalCounts *>(closure)->numpostseparators++;
+  return SoCallbackAction::CONTINUE;
+}
+
+SoCallbackAction::Response
+count_cube(void * closure, SoCallbackAction *, const SoNode *)
+{
+  static_cast<TraversalCounts *>(closure)->numcubes++;
+  return SoCallbackAction::PRUNE;
+}
+
+void
+count_triangle(void * closure, SoCallbackAction *,
+               const SoPrimitiveVertex *, const SoPrimitiveVertex *,
+               const SoPrimitiveVertex *)
+{
+  static_cast<TraversalCounts *>(closure)->numtriangles++;
+}
+
+TraversalCounts
+run_callback_action(SoNode * root)
+{
+  TraversalCounts counts = { 0, 0, 0, 0 };
+  SoCallbackAction cba;
+  cba.addPreCallback(SoSeparator::getClassTypeId(), count_pre_separator, &counts);
+  cba.addPostCallback(SoSeparator::getClassTypeId(), count_post_separator, &counts);
+  cba.addTriangleCallback(SoCube::getClassTypeId(), count_triangle, &counts);
+  cba.apply(root);
+  return counts;
+}
+
+SoSeparator *
+make_static_scene(SoTranslation *& moved)
+{
+  SoSeparator * root = new SoSeparator;
+  root->addChild(new SoCube);
+  for (int i = 0; i < 4; i++) {
+    SoGroup * group = new SoGroup;
+    SoTranslation * t = new SoTranslation;
+    t->translation.setValue(3.0f, 0.0f, 0.0f);
+    group->addChild(t);
+    SoSeparator * sep = new SoSeparator;
+    sep->addChild(new SoTranslation);
+    sep->addChild(new SoCube);
+    group->addChild(sep);
+    group->addChild(new SoCube);
+    root->addChild(group);
+    if (i == 2) moved = static_cast<SoTranslation *>(sep->getChild(0));
+  }
+  return root;
+}
+
+struct PolicyCalls {
+  int numcalls;
+  SoGLCacheList::Statistics last;
+};
+
+SbBool
+record_cache_policy(void * closure, const SoGLCacheList *,
+                    const SoGLCacheList::Statistics & stats)
+{
+  PolicyCalls * calls = static_cast<PolicyCalls *>(closure);
+  calls->numcalls++;
+  calls->last = stats;
+  // building a cache needs an OpenGL context
+  return FALSE;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(compiledTraversal)
+{
+  const SbBool oldflag = SoSeparator::isCompiledTraversal();
+  SbViewportRegion vp(100, 100);
+
+  SoTranslation * moved = NULL;
+  SoSeparator * root = make_static_scene(moved);
+  root->ref();
+
+  SoSeparator::setCompiledTraversal(FALSE);
+  const TraversalCounts reference = run_callback_action(root);
+  SoGetBoundingBoxAction bba(vp);
+  bba.apply(root);
+  const SbBox3f refbox = bba.getBoundingBox();
+  const SbVec3f refcenter = bba.getCenter();
+
+  SoSeparator::setCompiledTraversal(TRUE);
+  // the first traversals are done before the program is compiled
+  for (int i = 0; i < 3; i++) {
+    const TraversalCounts counts = run_callback_action(root);
+    BOOST_CHECK_EQUAL(counts.numtriangles, reference.numtriangles);
+    BOOST_CHECK_EQUAL(counts.numseparators, reference.numseparators);
+    BOOST_CHECK_EQUAL(counts.numpostseparators, reference.numpostseparators);
+
+    bba.apply(root);
+    BOOST_CHECK(bba.getBoundingBox().getMin() == refbox.getMin());
+    BOOST_CHECK(bba.getBoundingBox().getMax() == refbox.getMax());
+    BOOST_CHECK((bba.getCenter() - refcenter).length() < 1e-5f);
+  }
+  BOOST_CHECK_EQUAL(reference.numseparators, 5);
+  BOOST_CHECK_EQUAL(reference.numtriangles, 9 * 12);
+
+  // pruning in a pre callback must skip the cube
+  {
+    TraversalCounts counts = { 0, 0, 0, 0 };
+    SoCallbackAction cba;
+    cba.addPreCallback(SoCube::getClassTypeId(), count_cube, &counts);
+    cba.addTriangleCallback(SoCube::getClassTypeId(), count_triangle, &counts);
+    cba.apply(root);
+    BOOST_CHECK_EQUAL(counts.numcubes, 9);
+    BOOST_CHECK_EQUAL(counts.numtriangles, 0);
+  }
+
+  // the translations accumulate, the third group has its cubes at x = 9
+  SoRayPickAction rpa(vp);
+  rpa.setRay(SbVec3f(9.0f, 0.0f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  rpa.apply(root);
+  SoPickedPoint * pp = rpa.getPickedPoint();
+  BOOST_CHECK(pp != NULL);
+  if (pp) {
+    BOOST_CHECK((pp->getPoint() - SbVec3f(9.0f, 0.0f, 1.0f)).length() < 1e-5f);
+  }
+
+  // changes below the separator invalidate the program
+  moved->translation.setValue(0.0f, 5.0f, 0.0f);
+  bba.apply(root);
+  BOOST_CHECK_EQUAL(bba.getBoundingBox().getMax()[1], 6.0f);
+  rpa.apply(root);
+  pp = rpa.getPickedPoint();
+  BOOST_CHECK(pp != NULL);
+  if (pp) {
+    // the cube directly below the group is still hit
+    BOOST_CHECK((pp->getPoint() - SbVec3f(9.0f, 0.0f, 1.0f)).length() < 1e-5f);
+  }
+  rpa.setRay(SbVec3f(9.0f, 5.0f, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  rpa.apply(root);
+  BOOST_CHECK(rpa.getPickedPoint() != NULL);
+
+  root->unref();
+  SoSeparator::setCompiledTraversal(oldflag);
+}
+
+BOOST_AUTO_TEST_CASE(renderCachePolicy)
+{
+  SoSeparator * sep = new SoSeparator;
+  sep->ref();
+  BOOST_CHECK_MESSAGE(sep->getGLCacheList() == NULL,
+                      "separator which has not been rendered has a cache list");
+  sep->unref();
+
+  SoGLCacheList list;
+  SoGLCacheList::Statistics stats;
+  list.getStatistics(stats);
+  BOOST_CHECK_EQUAL(stats.numhits, 0u);
+  BOOST_CHECK_EQUAL(stats.numcaches, 0);
+
+  // no measurements: cache after two unchanged traversals
+  stats.numframesok = 1;
+  BOOST_CHECK(!SoGLCacheList::costBasedCachePolicy(NULL, &list, stats));
+  stats.numframesok = 2;
+  stats.traversaltime = 0.01;
+  BOOST_CHECK(SoGLCacheList::costBasedCachePolicy(NULL, &list, stats));
+
+  // an expensive cache which is invalidated every third traversal
+  // does not pay off
+  stats.buildtime = 0.05;
+  stats.cachedtime = 0.008;
+  stats.framesbetweeninvalidations = 3.0;
+  BOOST_CHECK(!SoGLCacheList::costBasedCachePolicy(NULL, &list, stats));
+
+  // ...unless the subgraph has been static for a while
+  stats.numframesok = 30;
+  BOOST_CHECK(SoGLCacheList::costBasedCachePolicy(NULL, &list, stats));
+
+  // never cache if calling the cache is slower than traversing
+  stats.cachedtime = 0.02;
+  BOOST_CHECK(!SoGLCacheList::costBasedCachePolicy(NULL, &list, stats));
+}
+
+BOOST_AUTO_TEST_CASE(renderCacheStatistics)
+{
+  const SbBool wasprofiling = SoProfiler::isEnabled();
+  SoProfiler::init();
+  SoProfiler::enable(TRUE);
+
+  PolicyCalls calls;
+  calls.numcalls = 0;
+  SoGLCacheList::setCachePolicyCallback(record_cache_policy, &calls);
+
+  // drive the cache list the way SoSeparator::GLRenderBelowPath()
+  // does, without rendering anything
+  SoGLRenderAction action(SbViewportRegion(100, 100));
+  SoState * state = action.getState();
+  SoProfilerElement * elt = SoProfilerElement::get(state);
+  BOOST_REQUIRE(elt != NULL);
+  SbProfilingData & data = elt->getProfilingData();
+  data.reset();
+  // set the rendering mode, so it isn't queried from OpenGL
+  state->push();
+  SoGLCacheContextElement::set(state, 0, FALSE, FALSE);
+
+  SoGLCacheList list;
+  const int numframes = 4;
+  for (int i = 0; i < numframes; i++) {
+    BOOST_CHECK(!list.call(&action));
+    list.open(&action, TRUE);
+    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
+    list.close(&action);
+  }
+
+  SoGLCacheList::Statistics stats;
+  list.getStatistics(stats);
+  BOOST_CHECK_EQUAL(stats.nummisses, static_cast<uint32_t>(numframes));
+  BOOST_CHECK_EQUAL(stats.numhits, 0u);
+  BOOST_CHECK_EQUAL(stats.numbuilds, 0u);
+  BOOST_CHECK_EQUAL(stats.numframesok, numframes);
+  BOOST_CHECK_EQUAL(stats.cachedtime, 0.0);
+  BOOST_CHECK(stats.memory > 0);
+  BOOST_CHECK_EQUAL(data.getActionStatistic(SbProfilingData::GL_CACHE_MISSES),
+                    static_cast<double>(numframes));
+  BOOST_CHECK_EQUAL(data.getActionStatistic(SbProfilingData::GL_CACHE_HITS), 0.0);
+  BOOST_CHECK_EQUAL(data.getActionStatistic(SbProfilingData::GL_CACHE_BUILDS), 0.0);
+
+  // the policy is consulted once the subgraph has been unchanged for
+  // a traversal, and sees the statistics of the list
+  BOOST_CHECK_EQUAL(calls.numcalls, numframes - 1);
+  BOOST_CHECK_EQUAL(calls.last.numframesok, numframes - 1);
+  BOOST_CHECK_EQUAL(calls.last.nummisses, static_cast<uint32_t>(numframes));
+
+  // a change ends the run of unchanged traversals
+  list.invalidateAll();
+  list.getStatistics(stats);
+  BOOST_CHECK_EQUAL(stats.numinvalidations, 1u);
+  BOOST_CHECK_EQUAL(stats.numframesok, 0);
+  BOOST_CHECK_EQUAL(stats.framesbetweeninvalidations, static_cast<double>(numframes));
+
+  // nothing is reported to the profiler when it is disabled
+  SoProfiler::enable(FALSE);
+  BOOST_CHECK(!list.call(&action));
+  BOOST_CHECK_EQUAL(data.getActionStatistic(SbProfilingData::GL_CACHE_MISSES),
+                    static_cast<double>(numframes));
+  list.getStatistics(stats);
+  BOOST_CHECK_EQUAL(stats.nummisses, static_cast<uint32_t>(numframes + 1));
+
+  list.resetStatistics();
+  list.getStatistics(stats);
+  BOOST_CHECK_EQUAL(stats.nummisses, 0u);
+  BOOST_CHECK_EQUAL(stats.framesbetweeninvalidations, 0.0);
+
+  state->pop();
+  SoGLCacheList::setCachePolicyCallback(NULL, NULL);
+  SoProfiler::enable(wasprofiling);
+}
+
+#endif // COIN_TEST_SUITE
@@ -76,6 +76,7 @@
 #include "nodes/SoSubNodeP.h"
 #include "coindefs.h" // COIN_OBSOLETED()
 #include "io/SoWriterefCounter.h"
+#include "actions/SoSearchActionP.h"
 
 // *************************************************************************
 
@@ -480,6 +481,11 @@ SoSwitch::notify(SoNotList * nl)
     inherited::notify(nl);
     PRIVATE(this)->notifyCalled();
   }
+  else if (SoSearchActionP::isStructuralChange(nl)) {
+    // inactive children are still searched when searching all nodes,
+    // so make sure search summaries above the changed node are rebuilt
+    SoSearchActionP::invalidateAllSummaries();
+  }
 }
 
 #undef PRIVATE
@@ -164,6 +164,8 @@ public:
   std::map<SbProfilingNodeTypeKey, SbTypeProfilingData> nodeTypeData;
   std::map<SbProfilingNodeNameKey, SbNameProfilingData> nodeNameData;
 
+  std::map<int, double> actionStats;
+
 }; // SbProfilingDataP
 
 #define PRIVATE(obj) ((obj)->pimpl)
@@ -216,6 +218,7 @@ SbProfilingData::reset(void)
   PRIVATE(this)->nodeData.clear();
   PRIVATE(this)->nodeTypeData.clear();
   PRIVATE(this)->nodeNameData.clear();
+  PRIVATE(this)->actionStats.clear();
   assert(PRIVATE(this)->nodeData.size() == 0);
   assert(PRIVATE(this)->nodeTypeData.size() == 0);
   assert(PRIVATE(this)->nodeNameData.size() == 0);
@@ -235,6 +238,7 @@ SbProfilingData::operator = (const SbProfilingData & rhs)
   PRIVATE(this)->nodeData = PRIVATE(&rhs)->nodeData;
   PRIVATE(this)->nodeTypeData = PRIVATE(&rhs)->nodeTypeData;
   PRIVATE(this)->nodeNameData = PRIVATE(&rhs)->nodeNameData;
+  PRIVATE(this)->actionStats = PRIVATE(&rhs)->actionStats;
   assert(PRIVATE(this)->nodeData.size() == PRIVATE(&rhs)->nodeData.size());
   return *this;
 }
@@ -397,6 +401,14 @@ SbProfilingData::operator += (const SbProfilingData & rhs)
     }
   }
 
+  { // actionStats
+    std::map<int, double>::const_iterator it = PRIVATE(&rhs)->actionStats.begin();
+    while (it != PRIVATE(&rhs)->actionStats.end()) {
+      PRIVATE(this)->actionStats[it->first] += it->second;
+      ++it;
+    }
+  }
+
   assert(PRIVATE(this)->nodeData.size() >= PRIVATE(&rhs)->nodeData.size());
   assert(PRIVATE(this)->nodeTypeData.size() >= PRIVATE(&rhs)->nodeTypeData.size());
   assert(PRIVATE(this)->nodeNameData.size() >= PRIVATE(&rhs)->nodeNameData.size());
@@ -983,6 +995,37 @@ SbProfilingData::getNodeFootprint(int idx, FootprintType footprinttype, unsigned
   return footprint;
 }
 
+/*!
+  Adds \a value to the action wide statistic \a stat. This is used
+  for counts which don't belong to a single node, like the number of
+  occlusion tests done by SoGLRenderAction during a traversal.
+
+  \sa getActionStatistic()
+  \since Coin 4.0
+*/
+
+void
+SbProfilingData::addActionStatistic(ActionStatistic stat, double value)
+{
+  PRIVATE(this)->actionStats[stat] += value;
+}
+
+/*!
+  Returns the value of the action wide statistic \a stat, or 0 if
+  nothing has been recorded for it.
+
+  \sa addActionStatistic()
+  \since Coin 4.0
+*/
+
+double
+SbProfilingData::getActionStatistic(ActionStatistic stat) const
+{
+  std::map<int, double>::const_iterator it = PRIVATE(this)->actionStats.find(stat);
+  if (it == PRIVATE(this)->actionStats.end()) return 0.0;
+  return it->second;
+}
+
 /*!
 */
 
@@ -1241,6 +1284,7 @@ SbProfilingData::operator == (const SbProfilingData & rhs) const
     if (PRIVATE(this)->nodeData[c] != PRIVATE(&rhs)->nodeData[c])
       return FALSE;
   }
+  if (PRIVATE(this)->actionStats != PRIVATE(&rhs)->actionStats) return FALSE;
 
   // NOTE: the type and name info maps are not checked, because they
   // are just aggregates of the nodedata records and would be equal if
@@ -82,11 +82,13 @@ SbLineProjector::tryProject(const SbVec2f & point, const float epsilon, SbVec3f
   SbLine wrldline;
   this->workingToWorld.multLineMatrix(this->line, wrldline);
 
-  SbVec3f pt1 = wrldline.getPosition();
-  SbVec3f pt2 = pt1 + wrldline.getDirection();
-  
-  this->viewVol.projectToScreen(pt1, pt1);
-  this->viewVol.projectToScreen(pt2, pt2);
+  SbVec3f pts[2];
+  pts[0] = wrldline.getPosition();
+  pts[1] = pts[0] + wrldline.getDirection();
+  this->viewVol.projectToScreen(pts, pts, 2);
+
+  SbVec3f pt1 = pts[0];
+  SbVec3f pt2 = pts[1];
 
   // account for the view volume aspect ratio when creating the screen space line
   const float vvwidth  = (this->viewVol.getWidth()  == 0.0f) ? 1.0f : this->viewVol.getWidth();
@@ -268,6 +268,28 @@
   }
   \endcode
 
+  For very large images, like posters, the full image buffer may not
+  fit in memory. Use setTileRowCallback() to receive the image in
+  bands of rows as they are finished, or renderToRGB() to write the
+  image directly to an SGI RGB file. Only one row of tiles is kept in
+  memory at a time.
+
+  \code
+  static void
+  row_cb(void * closure, const SoOffscreenRenderer * renderer,
+         const unsigned char * rows, int firstrow, int numrows)
+  {
+    // rows contains numrows rows, from the bottom of the band, each
+    // width * renderer->getComponents() bytes long
+  }
+
+  // [...]
+
+  SoOffscreenRenderer renderer(SbViewportRegion(30000, 20000));
+  renderer.setTileRowCallback(row_cb, myclosure);
+  SbBool ok = renderer.render(root);
+  \endcode
+
 */
 
 // As first mentioned to me by kyrah, the functionality of this class
@@ -316,9 +338,13 @@
 #include <cstring> // memset(), memcpy()
 #include <cmath> // for ceil()
 #include <climits> // SHRT_MAX
+#ifndef _WIN32
+#include <sys/types.h> // off_t
+#endif // !_WIN32
 
 #include <Inventor/C/glue/gl.h>
 #include <Inventor/C/tidbits.h>
+#include <Inventor/C/threads/wpool.h>
 #include <Inventor/SbMatrix.h>
 #include <Inventor/SbVec2f.h>
 #include <Inventor/SbViewportRegion.h>
@@ -343,6 +369,7 @@
 #include "glue/simage_wrapper.h"
 #include "tidbitsp.h"
 #include "coindefs.h" // COIN_STUB()
+#include "threads/threadsutilp.h"
 
 #include <boost/current_function.hpp>
 
@@ -372,6 +399,62 @@
   \sa setComponents()
 */
 
+/*!
+  \typedef void SoOffscreenRenderer::TileRowCB(void * closure, const SoOffscreenRenderer * renderer, const unsigned char * rows, int firstrow, int numrows)
+
+  The type of the callback receiving finished rows of the image when
+  rendering in streaming mode. \a rows points to \a numrows rows of
+  pixels, starting with row \a firstrow counted from the bottom of the
+  image. Each row is as wide as the viewport, with
+  SoOffscreenRenderer::getComponents() bytes per pixel. The buffer is
+  only valid during the callback.
+
+  \sa setTileRowCallback()
+  \since Coin 4.0
+*/
+
+// *************************************************************************
+
+#ifdef HAVE_THREADS
+
+// the worker thread used for writing streamed images to disk while
+// the next row of tiles is being rendered
+static cc_wpool * offscreenoutputpool = NULL;
+
+static void
+offscreen_output_pool_cleanup(void)
+{
+  if (offscreenoutputpool) cc_wpool_destruct(offscreenoutputpool);
+  offscreenoutputpool = NULL;
+}
+
+static cc_wpool *
+offscreen_output_pool(void)
+{
+  CC_GLOBAL_LOCK;
+  if (offscreenoutputpool == NULL) {
+    offscreenoutputpool = cc_wpool_construct(1);
+    coin_atexit((coin_atexit_f*) offscreen_output_pool_cleanup, CC_ATEXIT_NORMAL);
+  }
+  CC_GLOBAL_UNLOCK;
+  return offscreenoutputpool;
+}
+
+#endif // HAVE_THREADS
+
+// Seeks to an absolute position in a file. The planes of a large RGB
+// file can start beyond 2 GB, and long is 32 bits on Windows, so
+// fseek() can't be used.
+static int
+offscreen_fseek(FILE * fp, const int64_t offset)
+{
+#ifdef _WIN32
+  return _fseeki64(fp, __int64(offset), SEEK_SET);
+#else // !_WIN32
+  return fseeko(fp, off_t(offset), SEEK_SET);
+#endif // !_WIN32
+}
+
 // *************************************************************************
 
 class SoOffscreenRendererP {
@@ -387,6 +470,10 @@ public:
     this->components = SoOffscreenRenderer::RGB;
     this->buffer = NULL;
     this->bufferbytesize = 0;
+    this->streamed = FALSE;
+    this->rowcb = NULL;
+    this->rowcbclosure = NULL;
+    this->asyncrows = FALSE;
     this->lastnodewasacamera = FALSE;
 	
     if (glrenderaction) {
@@ -419,6 +506,23 @@ public:
 
   static SbBool writeToRGB(FILE * fp, unsigned int w, unsigned int h,
                            unsigned int nrcomponents, const uint8_t * imgbuf);
+  static void writeRGBHeader(FILE * fp, unsigned int w, unsigned int h,
+                             unsigned int nrcomponents);
+
+  SbBool renderToRGB(SoBase * base, const char * filename);
+  static void rgbRowCB(void * closure, const SoOffscreenRenderer * renderer,
+                       const unsigned char * rows, int firstrow, int numrows);
+
+  // delivery of a finished band of rows in streaming mode
+  struct RowJob {
+    SoOffscreenRendererP * thisp;
+    const unsigned char * rows;
+    int firstrow;
+    int numrows;
+  };
+  static void rowJob(void * closure);
+  void deliverRows(RowJob & job);
+  void waitForRows(void);
 
   SbViewportRegion viewport;
   SbColor backgroundcolor;
@@ -431,6 +535,15 @@ public:
 
   unsigned char * buffer;
   size_t bufferbytesize;
+  // TRUE if the last render() streamed its output, and there is no
+  // full image in the buffer
+  SbBool streamed;
+
+  SoOffscreenRenderer::TileRowCB * rowcb;
+  void * rowcbclosure;
+  // deliver rows from a worker thread, while the next row of tiles is
+  // rendered. Only used when writing to file from renderToRGB().
+  SbBool asyncrows;
 
   CoinOffscreenGLCanvas glcanvas;
   int glcanvassize[2];
@@ -779,10 +892,18 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
   // control from the offscreenrenderer.
   const int bigimagechangelimit = SoGLBigImage::setChangeLimit(INT_MAX);
 
+  // In streaming mode, only a band of tiles is kept in memory. Two
+  // bands when they are delivered asynchronously.
+  const SbBool streaming = (this->rowcb != NULL);
+  const size_t bandbytesize =
+    size_t(fullsize[0]) * size_t(glsize[1]) * size_t(PUBLIC(this)->getComponents());
+  this->streamed = streaming;
+
   // Deallocate old and allocate new target buffer, if necessary.
   //
   // If we need more space:
-  const size_t bufsize =
+  const size_t bufsize = streaming ?
+    bandbytesize * (this->asyncrows ? 2 : 1) :
     size_t(fullsize[0]) * size_t(fullsize[1]) * size_t(PUBLIC(this)->getComponents());
   SbBool alloc = (bufsize > this->bufferbytesize);
   // or if old buffer was much larger, free up the memory by fitting
@@ -795,7 +916,7 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
     this->bufferbytesize = bufsize;
   }
 
-  if (SoOffscreenRendererP::debugTileOutputPrefix()) {
+  if (SoOffscreenRendererP::debugTileOutputPrefix() && !streaming) {
     (void)memset(this->buffer, 0x00, bufsize);
   }
 
@@ -831,7 +952,9 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
     forcetiled || (fullsize[0] > glsize[0]) || (fullsize[1] > glsize[1]);
 
   // Shall we use subscreen rendering or regular one-screen renderer?
-  if (tiledrendering) {
+  // Streaming output always goes through the subscreen loop, even if
+  // the image fits in a single tile.
+  if (tiledrendering || streaming) {
     // we need to copy from GL to system memory if we're doing tiled rendering
     this->didreadbuffer = TRUE;
 
@@ -841,10 +964,19 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
 
     // We have to grab cameras using this callback during rendering
     this->visitedcamera = NULL;
-    this->renderaction->setAbortCallback(SoOffscreenRendererP::GLRenderAbortCallback, this);
+    if (tiledrendering) {
+      this->renderaction->setAbortCallback(SoOffscreenRendererP::GLRenderAbortCallback, this);
+    }
+
+    RowJob rowjob;
+    rowjob.thisp = this;
 
     // Render entire scene graph for each subscreen.
     for (int y=0; y < this->numsubscreens[1]; y++) {
+      // the band of tiles currently rendered to, when streaming
+      unsigned char * band = this->buffer;
+      if (streaming && this->asyncrows) band += (y % 2) * bandbytesize;
+
       for (int x=0; x < this->numsubscreens[0]; x++) {
         this->currenttile = SbVec2s(x, y);
 
@@ -860,7 +992,11 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
           if (this->subsize[1] == 0) { this->subsize[1] = glsize[1]; }
         }
 
-        SbViewportRegion subviewport = SbViewportRegion(SbVec2s(this->subsize[0], this->subsize[1]));
+        // keep the pixels-per-inch setting of the caller's viewport
+        const SbVec2s tilesize(this->subsize[0], this->subsize[1]);
+        SbViewportRegion subviewport = this->viewport;
+        subviewport.setWindowSize(tilesize);
+        subviewport.setViewportPixels(SbVec2s(0, 0), tilesize);
         this->renderaction->setViewportRegion(subviewport);
 
         if (base->isOfType(SoNode::getClassTypeId()))
@@ -873,10 +1009,17 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
 
         const unsigned int nrcomp = PUBLIC(this)->getComponents();
 
+        const SbVec2s vpsize = subviewport.getViewportSizePixels();
+        if (streaming) {
+          const size_t BANDBUF_OFFSET = size_t(glsize[0]) * x * nrcomp;
+          this->glcanvas.readPixels(band + BANDBUF_OFFSET,
+                                    vpsize, fullsize[0], nrcomp);
+          continue;
+        }
+
         const int MAINBUF_OFFSET =
           (glsize[1] * y * fullsize[0] + glsize[0] * x) * nrcomp;
 
-        const SbVec2s vpsize = subviewport.getViewportSizePixels();
         this->glcanvas.readPixels(this->buffer + MAINBUF_OFFSET,
                                   vpsize, fullsize[0], nrcomp);
 
@@ -905,11 +1048,23 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
 #endif // debug
         }
       }
+
+      if (streaming) {
+        // the row of tiles is finished, hand it over
+        this->waitForRows();
+        rowjob.rows = band;
+        rowjob.firstrow = glsize[1] * y;
+        rowjob.numrows = this->subsize[1];
+        this->deliverRows(rowjob);
+      }
     }
+    this->waitForRows();
 
-    this->renderaction->setAbortCallback(NULL, this);
+    if (tiledrendering) {
+      this->renderaction->setAbortCallback(NULL, this);
+    }
 
-    if (!this->visitedcamera) {
+    if (tiledrendering && !this->visitedcamera) {
       SoDebugError::postWarning("SoOffscreenRenderer::renderFromBase",
                                 "No camera node found in scene graph while rendering offscreen image. "
                                 "The result will most likely be incorrect.");
@@ -1022,14 +1177,220 @@ SoOffscreenRenderer::render(SoPath * scene)
   return PRIVATE(this)->renderFromBase(scene);
 }
 
+/*!
+  Sets a callback which receives the image in bands of rows while it
+  is being rendered, instead of collecting the full image in the
+  internal buffer. This makes it possible to render images which are
+  too large to fit in memory. Only a single row of tiles, i.e. the
+  width of the image times the height of the largest offscreen
+  canvas, is kept in memory at a time.
+
+  The bands are delivered from the bottom of the image and up. When
+  the callback is set, getBuffer() returns \c NULL after rendering,
+  and the writeTo*() methods can not be used. Pass \c NULL to get the
+  default behavior back.
+
+  \sa renderToRGB()
+  \since Coin 4.0
+*/
+void
+SoOffscreenRenderer::setTileRowCallback(TileRowCB * func, void * closure)
+{
+  PRIVATE(this)->rowcb = func;
+  PRIVATE(this)->rowcbclosure = closure;
+}
+
+/*!
+  Renders the scene graph rooted at \a scene directly into an SGI RGB
+  file named \a filename, in the same format as writeToRGB(). The
+  image is streamed to the file as the rows of tiles are finished, so
+  the full image is never kept in memory. When Coin is built with
+  thread support, each band is written to disk while the next one is
+  rendered.
+
+  Returns \c TRUE if the image was rendered and written without
+  errors.
+
+  \sa setTileRowCallback()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::renderToRGB(SoNode * scene, const char * filename)
+{
+  return PRIVATE(this)->renderToRGB(scene, filename);
+}
+
+/*!
+  Renders the scene graph in the \a scene path directly into an SGI
+  RGB file named \a filename.
+
+  \sa renderToRGB(SoNode *, const char *)
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::renderToRGB(SoPath * scene, const char * filename)
+{
+  return PRIVATE(this)->renderToRGB(scene, filename);
+}
+
+/*!
+  Writes a band of \a numrows rows starting at row \a firstrow, as
+  handed to a TileRowCB, at its place in the SGI RGB file \a fp. The
+  file header is written with the band starting at row 0. The size of
+  the image and the number of components are taken from the viewport
+  region and getComponents(), so the bands can be written in any
+  order.
+
+  This is how renderToRGB() writes its file. Use it from your own tile
+  row callback to write the image while also processing the rows in
+  some other way.
+
+  Returns \c FALSE if the rows could not be written.
+
+  \sa setTileRowCallback()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::writeRowsToRGB(FILE * fp, const unsigned char * rows,
+                                    int firstrow, int numrows) const
+{
+  const SbVec2s size = this->getViewportRegion().getViewportSizePixels();
+  const unsigned int w = size[0];
+  const unsigned int h = size[1];
+  const unsigned int nc = this->getComponents();
+
+  SbBool ok = TRUE;
+  if (firstrow == 0) {
+    ok = (offscreen_fseek(fp, 0) == 0);
+    if (ok) SoOffscreenRendererP::writeRGBHeader(fp, w, h, nc);
+  }
+
+  // the SGI RGB format stores one plane per component, so the rows
+  // are written at their position in each plane
+  unsigned char * tmpbuf = new unsigned char[w];
+  for (unsigned int c = 0; ok && c < nc; c++) {
+    const int64_t offset = 512 +
+      (int64_t(c) * h + int64_t(firstrow)) * w;
+    ok = (offscreen_fseek(fp, offset) == 0);
+    for (int y = 0; ok && y < numrows; y++) {
+      const unsigned char * src = rows + size_t(y) * w * nc + c;
+      for (unsigned int x = 0; x < w; x++) {
+        tmpbuf[x] = src[x * nc];
+      }
+      ok = (fwrite(tmpbuf, 1, w, fp) == w);
+    }
+  }
+  delete[] tmpbuf;
+  return ok;
+}
+
+// *************************************************************************
+
+void
+SoOffscreenRendererP::rowJob(void * closure)
+{
+  RowJob * job = static_cast<RowJob *>(closure);
+  SoOffscreenRendererP * thisp = job->thisp;
+  thisp->rowcb(thisp->rowcbclosure, PUBLIC(thisp),
+               job->rows, job->firstrow, job->numrows);
+}
+
+// Hands a finished band of rows to the row callback, from the output
+// worker thread if rows are delivered asynchronously.
+void
+SoOffscreenRendererP::deliverRows(RowJob & job)
+{
+#ifdef HAVE_THREADS
+  if (this->asyncrows) {
+    cc_wpool * pool = offscreen_output_pool();
+    cc_wpool_begin(pool, 1);
+    cc_wpool_start_worker(pool, SoOffscreenRendererP::rowJob, &job);
+    cc_wpool_end(pool);
+    return;
+  }
+#endif // HAVE_THREADS
+  SoOffscreenRendererP::rowJob(&job);
+}
+
+// Waits until the last band handed to deliverRows() is done.
+void
+SoOffscreenRendererP::waitForRows(void)
+{
+#ifdef HAVE_THREADS
+  if (this->asyncrows && offscreenoutputpool) {
+    cc_wpool_wait_all(offscreenoutputpool);
+  }
+#endif // HAVE_THREADS
+}
+
+namespace {
+
+struct RGBOutput {
+  FILE * fp;
+  SbBool ok;
+};
+
+} // anonymous namespace
+
+// Row callback for renderToRGB().
+void
+SoOffscreenRendererP::rgbRowCB(void * closure,
+                               const SoOffscreenRenderer * renderer,
+                               const unsigned char * rows,
+                               int firstrow, int numrows)
+{
+  RGBOutput * out = static_cast<RGBOutput *>(closure);
+  if (!out->ok) return;
+  out->ok = renderer->writeRowsToRGB(out->fp, rows, firstrow, numrows);
+}
+
+SbBool
+SoOffscreenRendererP::renderToRGB(SoBase * base, const char * filename)
+{
+  FILE * fp = fopen(filename, "wb");
+  if (!fp) {
+    SoDebugError::postWarning("SoOffscreenRenderer::renderToRGB",
+                              "couldn't open file '%s'", filename);
+    return FALSE;
+  }
+
+  RGBOutput out;
+  out.fp = fp;
+  out.ok = TRUE;
+
+  SoOffscreenRenderer::TileRowCB * oldcb = this->rowcb;
+  void * oldclosure = this->rowcbclosure;
+  this->rowcb = SoOffscreenRendererP::rgbRowCB;
+  this->rowcbclosure = &out;
+  this->asyncrows = TRUE;
+
+  SbBool ok = this->renderFromBase(base);
+
+  this->rowcb = oldcb;
+  this->rowcbclosure = oldclosure;
+  this->asyncrows = FALSE;
+
+  if (ok && !out.ok) {
+    SoDebugError::postWarning("SoOffscreenRenderer::renderToRGB",
+                              "error when writing RGB file '%s'", filename);
+  }
+  if (fclose(fp) != 0) { ok = FALSE; }
+  return ok && out.ok;
+}
+
 // *************************************************************************
 
 /*!
   Returns the offscreen memory buffer.
+
+  Returns \c NULL if the last image was rendered in streaming mode, as
+  set up by setTileRowCallback() or renderToRGB(), since the full image
+  is then never kept in memory.
 */
 unsigned char *
 SoOffscreenRenderer::getBuffer(void) const
 {
+  if (PRIVATE(this)->streamed) { return NULL; }
   if (!PRIVATE(this)->didreadbuffer) {
     const SbVec2s dims = this->getViewportRegion().getViewportSizePixels();
     //fprintf(stderr,"reading pixels: %d %d\n", dims[0], dims[1]);
@@ -1101,13 +1462,11 @@ write_short(FILE * fp, unsigned short val)
   return fwrite(&tmp, 2, 1, fp);
 }
 
-SbBool
-SoOffscreenRendererP::writeToRGB(FILE * fp, unsigned int w, unsigned int h,
-                                 unsigned int nrcomponents,
-                                 const uint8_t * imgbuf)
+// Writes the 512 byte header of an uncompressed SGI RGB file.
+void
+SoOffscreenRendererP::writeRGBHeader(FILE * fp, unsigned int w, unsigned int h,
+                                     unsigned int nrcomponents)
 {
-  // FIXME: add code to rle rows, pederb 2000-01-10
-
   (void)write_short(fp, 0x01da); // imagic
   (void)write_short(fp, 0x0001); // raw (no rle yet)
 
@@ -1127,6 +1486,16 @@ SoOffscreenRendererP::writeToRGB(FILE * fp, unsigned int w, unsigned int h,
   strcpy((char *)buf+8, "https://github.com/coin3d/");
   const size_t wrote = fwrite(buf, 1, BUFSIZE, fp);
   assert(wrote == BUFSIZE);
+}
+
+SbBool
+SoOffscreenRendererP::writeToRGB(FILE * fp, unsigned int w, unsigned int h,
+                                 unsigned int nrcomponents,
+                                 const uint8_t * imgbuf)
+{
+  // FIXME: add code to rle rows, pederb 2000-01-10
+
+  SoOffscreenRendererP::writeRGBHeader(fp, w, h, nrcomponents);
 
   unsigned char * tmpbuf = new unsigned char[w];
 
@@ -1165,10 +1534,12 @@ SoOffscreenRenderer::writeToRGB(FILE * fp) const
   if (SoOffscreenRendererP::offscreenContextsNotSupported()) { return FALSE; }
 
   SbVec2s size = PRIVATE(this)->viewport.getViewportSizePixels();
+  const unsigned char * buffer = this->getBuffer();
+  if (!buffer) { return FALSE; }
 
   return SoOffscreenRendererP::writeToRGB(fp, size[0], size[1],
                                           this->getComponents(),
-                                          this->getBuffer());
+                                          buffer);
 }
 
 /*!
@@ -1252,6 +1623,7 @@ SoOffscreenRenderer::writeToPostScript(FILE * fp,
                           (short)(printsize[1]*defaultdpi));
 
   const unsigned char * src = this->getBuffer();
+  if (!src) { return FALSE; }
   const int chan = nc <= 2 ? 1 : 3;
   const SbVec2s scaledsize((short) ceil(size[0]*defaultdpi/dpi),
                            (short) ceil(size[1]*defaultdpi/dpi));
@@ -1603,6 +1975,7 @@ SoOffscreenRenderer::writeToFile(const SbString & filename, const SbName & filet
   SbVec2s size = PRIVATE(this)->viewport.getViewportSizePixels();
   int comp = (int) this->getComponents();
   unsigned char * bytes = this->getBuffer();
+  if (!bytes) { return FALSE; }
   int ret = simage_wrapper()->simage_save_image(filename.getString(),
                                                 bytes,
                                                 int(size[0]), int(size[1]), comp,
@@ -1781,3 +2154,96 @@ SoOffscreenRendererP::offscreenContextsNotSupported(void)
 
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+
+namespace {
+
+unsigned char
+rgb_test_pixel(unsigned int x, unsigned int y, unsigned int c)
+{
+  return static_cast<unsigned char>((x * 7 + y * 13 + c * 61) & 0xff);
+}
+
+// writes the rows [firstrow, firstrow + numrows) of the test image
+SbBool
+rgb_test_write_band(const SoOffscreenRenderer & renderer, FILE * fp,
+                    int firstrow, int numrows)
+{
+  const SbVec2s size = renderer.getViewportRegion().getViewportSizePixels();
+  const unsigned int w = size[0];
+  const unsigned int nc = renderer.getComponents();
+  SbList <unsigned char> rows;
+  for (int y = 0; y < numrows; y++) {
+    for (unsigned int x = 0; x < w; x++) {
+      for (unsigned int c = 0; c < nc; c++) {
+        rows.append(rgb_test_pixel(x, firstrow + y, c));
+      }
+    }
+  }
+  return renderer.writeRowsToRGB(fp, rows.getArrayPtr(), firstrow, numrows);
+}
+
+unsigned int
+rgb_test_short(const unsigned char * buf)
+{
+  return (static_cast<unsigned int>(buf[0]) << 8) | buf[1];
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(writeRowsToRGB)
+{
+  const unsigned int w = 37, h = 10;
+  const SoOffscreenRenderer::Components components[] = {
+    SoOffscreenRenderer::LUMINANCE,
+    SoOffscreenRenderer::RGB_TRANSPARENCY
+  };
+  for (int i = 0; i < 2; i++) {
+    SoOffscreenRenderer renderer(SbViewportRegion(w, h));
+    renderer.setComponents(components[i]);
+    const unsigned int nc = renderer.getComponents();
+
+    FILE * fp = tmpfile();
+    BOOST_REQUIRE(fp != NULL);
+    // the bands don't have to be written in order
+    BOOST_CHECK(rgb_test_write_band(renderer, fp, 8, 2));
+    BOOST_CHECK(rgb_test_write_band(renderer, fp, 0, 4));
+    BOOST_CHECK(rgb_test_write_band(renderer, fp, 4, 4));
+
+    BOOST_CHECK_EQUAL(fseek(fp, 0, SEEK_END), 0);
+    BOOST_CHECK_EQUAL(ftell(fp), long(512 + nc * w * h));
+
+    unsigned char header[512];
+    rewind(fp);
+    BOOST_REQUIRE_EQUAL(fread(header, 1, 512, fp), size_t(512));
+    BOOST_CHECK_EQUAL(rgb_test_short(header + 0), 0x01dau);
+    BOOST_CHECK_EQUAL(rgb_test_short(header + 2), 0x0001u);
+    BOOST_CHECK_EQUAL(rgb_test_short(header + 4), nc == 1 ? 2u : 3u);
+    BOOST_CHECK_EQUAL(rgb_test_short(header + 6), w);
+    BOOST_CHECK_EQUAL(rgb_test_short(header + 8), h);
+    BOOST_CHECK_EQUAL(rgb_test_short(header + 10), nc);
+
+    // one plane per component, each starting with the bottom row
+    const unsigned int testrows[] = { 0, 3, 4, 9 };
+    unsigned char row[w];
+    for (unsigned int c = 0; c < nc; c++) {
+      for (int r = 0; r < 4; r++) {
+        const unsigned int y = testrows[r];
+        BOOST_REQUIRE_EQUAL(fseek(fp, long(512 + (c * h + y) * w), SEEK_SET), 0);
+        BOOST_REQUIRE_EQUAL(fread(row, 1, w, fp), size_t(w));
+        unsigned int numwrong = 0;
+        for (unsigned int x = 0; x < w; x++) {
+          if (row[x] != rgb_test_pixel(x, y, c)) numwrong++;
+        }
+        BOOST_CHECK_MESSAGE(numwrong == 0,
+                            "wrong pixels in row " << y << " of plane " << c);
+      }
+    }
+    fclose(fp);
+  }
+}
+
+#endif // COIN_TEST_SUITE
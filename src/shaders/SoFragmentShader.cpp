@@ -59,6 +59,7 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "glue/glp.h"
+#include "glue/cg.h"
 
 // *************************************************************************
 
@@ -119,9 +120,8 @@ SoFragmentShader::isSupported(SourceType sourceType)
   else if (sourceType == GLSL_PROGRAM) {
     return SoGLDriverDatabase::isSupported(glue, SO_GL_ARB_SHADER_OBJECT);
   }
-  // FIXME: Add support for detecting missing Cg support (20050427
-  // handegar)
-  else if (sourceType == CG_PROGRAM) return TRUE;
+  // the Cg library glue is loaded on first use
+  else if (sourceType == CG_PROGRAM) return cc_cgglue_available();
 
   return FALSE;
 }
@@ -104,6 +104,7 @@
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoVBO.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/soshape_pickcache.h"
 
 // *************************************************************************
 
@@ -835,7 +836,30 @@ SoFaceSet::generatePrimitives(SoAction *action)
   vertex.setDetail(&pointDetail);
   vertex.setNormal(*currnormal);
 
+  // when picking with a pick cache, only the faces hit by the pick
+  // ray are generated
+  soshape_pickcache * pickcache = soshape_pickcache::getActive(this, action);
+  const int32_t startidx = idx;
+  const int32_t * numvertptr = ptr;
+  int pickface = 0;
+
   while (ptr < end) {
+    if (pickcache) {
+      if (pickcache->isBuilding()) {
+        pickcache->beginFace(idx - startidx);
+      }
+      else {
+        if (pickface == pickcache->getNumFaces()) break;
+        const int face = pickcache->getFace(pickface++);
+        const int start = pickcache->getFaceStart(face);
+        ptr = numvertptr + face;
+        idx = startidx + start;
+        matnr = (mbind == PER_FACE) ? face : start;
+        normnr = (nbind == PER_FACE) ? face : start;
+        texnr = start;
+        faceDetail.setFaceIndex(face);
+      }
+    }
     n = *ptr++;
     if (n == 3) newmode = TRIANGLES;
     else if (n == 4) newmode = QUADS;
@@ -1129,3 +1153,99 @@ SoFaceSet::useConvexCache(SoAction * action)
 #undef STATUS_CONCAV
 #undef UNKNOWN_TYPE
 #undef MIXED_TYPE
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+
+// the grid has 2 * 12 * 12 triangles, which is enough for a pick cache
+#define FACESET_TEST_CELLS 12
+#define FACESET_TEST_PALETTE 1024
+
+BOOST_AUTO_TEST_CASE(pickCacheReplay)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coords = new SoCoordinate3;
+  SoMaterial * material = new SoMaterial;
+  SoNormal * normals = new SoNormal;
+  SoTexture2 * texture = new SoTexture2;
+  SoTextureCoordinate2 * texcoords = new SoTextureCoordinate2;
+  SoMaterialBinding * mb = new SoMaterialBinding;
+  SoNormalBinding * nb = new SoNormalBinding;
+  SoFaceSet * fs = new SoFaceSet;
+  root->addChild(coords);
+  root->addChild(material);
+  root->addChild(normals);
+  root->addChild(texture);
+  root->addChild(texcoords);
+  root->addChild(mb);
+  root->addChild(nb);
+  root->addChild(fs);
+
+  // texture coordinates are only picked when texturing is enabled
+  const unsigned char pixel[] = { 0xff, 0xff, 0xff };
+  texture->image.setValue(SbVec2s(1, 1), 3, pixel);
+
+  for (int i = 0; i < FACESET_TEST_PALETTE; i++) {
+    const float a = float(i) / FACESET_TEST_PALETTE;
+    material->diffuseColor.set1Value(i, SbColor(a, 1.0f - a, 0.5f));
+    SbVec3f normal(float(cos(a * 60.0f)), float(sin(a * 60.0f)), 2.0f);
+    normal.normalize();
+    normals->vector.set1Value(i, normal);
+    texcoords->point.set1Value(i, SbVec2f(a, 1.0f - a * a));
+  }
+
+  // a grid with triangles in every third cell and quads in the other
+  // cells, after a few unused coordinates skipped by startIndex
+  fs->startIndex = 3;
+  fs->numVertices.setNum(0);
+  for (int i = 0; i < 3; i++) {
+    coords->point.set1Value(i, SbVec3f(-1.0f, -1.0f, 0.0f));
+  }
+  for (int j = 0; j < FACESET_TEST_CELLS; j++) {
+    for (int i = 0; i < FACESET_TEST_CELLS; i++) {
+      const SbVec3f a(float(i), float(j), 0.0f);
+      const SbVec3f b = a + SbVec3f(1.0f, 0.0f, 0.0f);
+      const SbVec3f c = a + SbVec3f(1.0f, 1.0f, 0.0f);
+      const SbVec3f d = a + SbVec3f(0.0f, 1.0f, 0.0f);
+      if ((i + j) % 3 == 0) {
+        const SbVec3f tris[] = { a, b, c, a, c, d };
+        coords->point.setValues(coords->point.getNum(), 6, tris);
+        fs->numVertices.set1Value(fs->numVertices.getNum(), 3);
+        fs->numVertices.set1Value(fs->numVertices.getNum(), 3);
+      }
+      else {
+        const SbVec3f quad[] = { a, b, c, d };
+        coords->point.setValues(coords->point.getNum(), 4, quad);
+        fs->numVertices.set1Value(fs->numVertices.getNum(), 4);
+      }
+    }
+  }
+
+  // the indexed bindings are handled like the unindexed ones
+  const int bindings[] = {
+    SoMaterialBinding::PER_FACE,
+    SoMaterialBinding::PER_FACE_INDEXED,
+    SoMaterialBinding::PER_VERTEX_INDEXED
+  };
+  for (int b = 0; b < 3; b++) {
+    mb->value = bindings[b];
+    nb->value = bindings[b];
+    BOOST_CHECK_MESSAGE(CountPickCacheMismatches(root, fs, FACESET_TEST_CELLS) == 0,
+                        "picking with the pick cache should give the same points and details "
+                        "as picking without it");
+  }
+  root->unref();
+}
+
+#undef FACESET_TEST_PALETTE
+#undef FACESET_TEST_CELLS
+
+#endif // COIN_TEST_SUITE
@@ -229,6 +229,7 @@
 #include "rendering/SoVertexArrayIndexer.h"
 #include "rendering/SoVBO.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/soshape_pickcache.h"
 
 // *************************************************************************
 
@@ -815,7 +816,35 @@ SoIndexedFaceSet::generatePrimitives(SoAction *action)
   int matnr = 0;
   int normnr = 0;
 
+  // when picking with a pick cache, only the faces hit by the pick
+  // ray are generated
+  soshape_pickcache * pickcache = soshape_pickcache::getActive(this, action);
+  const int32_t * mindicesbase = mindices;
+  const int32_t * nindicesbase = nindices;
+  const int32_t * tindicesbase = tindices;
+  int pickface = 0;
+
   while (viptr + 2 < viendptr) {
+    if (pickcache) {
+      if (pickcache->isBuilding()) {
+        pickcache->beginFace((int) (viptr - cindices));
+      }
+      else {
+        if (pickface == pickcache->getNumFaces()) break;
+        const int face = pickcache->getFace(pickface++);
+        const int start = pickcache->getFaceStart(face);
+        // every face before this one was terminated by a -1 index
+        viptr = cindices + start;
+        matnr = (mbind == PER_FACE) ? face : start - face;
+        normnr = (nbind == PER_FACE) ? face : start - face;
+        texidx = start - face;
+        if (mindicesbase) mindices = mindicesbase + ((mbind == PER_FACE_INDEXED) ? face : start);
+        if (nindicesbase) nindices = nindicesbase + ((nbind == PER_FACE_INDEXED) ? face : start);
+        if (tindicesbase) tindices = tindicesbase + ((tbind != NONE) ? start : face);
+        faceDetail.setFaceIndex(face);
+        faceDetail.setPartIndex(face);
+      }
+    }
     v1 = *viptr++;
     v2 = *viptr++;
     v3 = *viptr++;
@@ -1137,3 +1166,120 @@ SoIndexedFaceSet::generateDefaultNormals(SoState * state,
 #undef STATUS_CONCAVE
 #undef LOCK_VAINDEXER
 #undef UNLOCK_VAINDEXER
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
+
+// the grid has 2 * 12 * 12 triangles, which is enough for a pick cache
+#define IFS_TEST_CELLS 12
+#define IFS_TEST_PALETTE 256
+
+BOOST_AUTO_TEST_CASE(pickCacheReplay)
+{
+  // a grid with triangles in every third cell and quads in the other
+  // cells, so that the faces start at irregular indices
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coords = new SoCoordinate3;
+  SoMaterial * material = new SoMaterial;
+  SoNormal * normals = new SoNormal;
+  SoTexture2 * texture = new SoTexture2;
+  SoTextureCoordinate2 * texcoords = new SoTextureCoordinate2;
+  SoMaterialBinding * mb = new SoMaterialBinding;
+  SoNormalBinding * nb = new SoNormalBinding;
+  SoTextureCoordinateBinding * tb = new SoTextureCoordinateBinding;
+  SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+  root->addChild(coords);
+  root->addChild(material);
+  root->addChild(normals);
+  root->addChild(texture);
+  root->addChild(texcoords);
+  root->addChild(mb);
+  root->addChild(nb);
+  root->addChild(tb);
+  root->addChild(ifs);
+
+  const int n = IFS_TEST_CELLS + 1;
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      coords->point.set1Value(j * n + i, SbVec3f(float(i), float(j), 0.0f));
+    }
+  }
+  for (int i = 0; i < IFS_TEST_PALETTE; i++) {
+    const float a = float(i) / IFS_TEST_PALETTE;
+    material->diffuseColor.set1Value(i, SbColor(a, 1.0f - a, 0.5f));
+    SbVec3f normal(float(cos(a * 6.0f)), float(sin(a * 6.0f)), 2.0f);
+    normal.normalize();
+    normals->vector.set1Value(i, normal);
+    texcoords->point.set1Value(i, SbVec2f(a, 1.0f - a * a));
+  }
+
+  // texture coordinates are only picked when texturing is enabled
+  const unsigned char pixel[] = { 0xff, 0xff, 0xff };
+  texture->image.setValue(SbVec2s(1, 1), 3, pixel);
+
+  int numfaces = 0;
+  for (int j = 0; j < IFS_TEST_CELLS; j++) {
+    for (int i = 0; i < IFS_TEST_CELLS; i++) {
+      const int32_t a = j * n + i, b = a + 1, c = a + n + 1, d = a + n;
+      if ((i + j) % 3 == 0) {
+        const int32_t tris[] = { a, b, c, -1, a, c, d, -1 };
+        ifs->coordIndex.setValues(ifs->coordIndex.getNum(), 8, tris);
+        numfaces += 2;
+      }
+      else {
+        const int32_t quad[] = { a, b, c, d, -1 };
+        ifs->coordIndex.setValues(ifs->coordIndex.getNum(), 5, quad);
+        numfaces += 1;
+      }
+    }
+  }
+  const int numindices = ifs->coordIndex.getNum();
+  const int32_t * coordindex = ifs->coordIndex.getValues(0);
+  for (int i = 0; i < numindices; i++) {
+    ifs->textureCoordIndex.set1Value(i, coordindex[i] < 0 ? -1 : (i * 5) % IFS_TEST_PALETTE);
+  }
+  tb->value = SoTextureCoordinateBinding::PER_VERTEX_INDEXED;
+
+  const int bindings[] = {
+    SoMaterialBinding::PER_FACE,
+    SoMaterialBinding::PER_FACE_INDEXED,
+    SoMaterialBinding::PER_VERTEX_INDEXED
+  };
+  for (int b = 0; b < 3; b++) {
+    mb->value = bindings[b];
+    nb->value = bindings[b];
+    ifs->materialIndex.setNum(0);
+    ifs->normalIndex.setNum(0);
+    if (bindings[b] == SoMaterialBinding::PER_FACE_INDEXED) {
+      for (int i = 0; i < numfaces; i++) {
+        ifs->materialIndex.set1Value(i, (i * 7) % IFS_TEST_PALETTE);
+        ifs->normalIndex.set1Value(i, (i * 11) % IFS_TEST_PALETTE);
+      }
+    }
+    else if (bindings[b] == SoMaterialBinding::PER_VERTEX_INDEXED) {
+      for (int i = 0; i < numindices; i++) {
+        const SbBool end = coordindex[i] < 0;
+        ifs->materialIndex.set1Value(i, end ? -1 : (i * 13) % IFS_TEST_PALETTE);
+        ifs->normalIndex.set1Value(i, end ? -1 : (i * 3) % IFS_TEST_PALETTE);
+      }
+    }
+    BOOST_CHECK_MESSAGE(CountPickCacheMismatches(root, ifs, IFS_TEST_CELLS) == 0,
+                        "picking with the pick cache should give the same points and details "
+                        "as picking without it");
+  }
+  root->unref();
+}
+
+#undef IFS_TEST_PALETTE
+#undef IFS_TEST_CELLS
+
+#endif // COIN_TEST_SUITE
@@ -111,6 +111,7 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/soshape_pickcache.h"
 
 SO_NODE_SOURCE(SoIndexedTriangleStripSet);
 
@@ -548,7 +549,48 @@ SoIndexedTriangleStripSet::generatePrimitives(SoAction * action)
   vertex.setNormal(*currnormal);
   vertex.setDetail(&pointdetail);
 
+  // when picking with a pick cache, only the strips hit by the pick
+  // ray are generated
+  soshape_pickcache * pickcache = soshape_pickcache::getActive(this, action);
+  const int32_t * mindicesbase = mindices;
+  const int32_t * nindicesbase = nindices;
+  const int32_t * tindicesbase = tindices;
+  int pickstrip = 0;
+
   while (viptr + 2 < viendptr) {
+    if (pickcache) {
+      if (pickcache->isBuilding()) {
+        pickcache->beginFace((int) (viptr - cindices));
+      }
+      else {
+        if (pickstrip == pickcache->getNumFaces()) break;
+        const int strip = pickcache->getFace(pickstrip++);
+        const int start = pickcache->getFaceStart(strip);
+        // every strip before this one was terminated by a -1 index
+        const int numvertices = start - strip;
+        const int numtriangles = numvertices - 2 * strip;
+        viptr = cindices + start;
+        if (mbind == PER_VERTEX) matnr = numvertices;
+        else if (mbind == PER_TRIANGLE) matnr = numtriangles;
+        else if (mbind == PER_STRIP) matnr = strip;
+        if (nbind == PER_VERTEX) normnr = numvertices;
+        else if (nbind == PER_TRIANGLE) normnr = numtriangles;
+        else if (nbind == PER_STRIP) normnr = strip;
+        if (mindicesbase) {
+          if (mbind == PER_VERTEX_INDEXED) mindices = mindicesbase + start;
+          else if (mbind == PER_TRIANGLE_INDEXED) mindices = mindicesbase + numtriangles;
+          else if (mbind == PER_STRIP_INDEXED) mindices = mindicesbase + strip;
+        }
+        if (nindicesbase) {
+          if (nbind == PER_VERTEX_INDEXED) nindices = nindicesbase + start;
+          else if (nbind == PER_TRIANGLE_INDEXED) nindices = nindicesbase + numtriangles;
+          else if (nbind == PER_STRIP_INDEXED) nindices = nindicesbase + strip;
+        }
+        if (tindicesbase) tindices = tindicesbase + (dotextures ? start : strip);
+        texidx = numvertices;
+        facedetail.setPartIndex(strip);
+      }
+    }
     facedetail.setFaceIndex(0);
 
     v1 = *viptr++;
@@ -718,3 +760,118 @@ SoIndexedTriangleStripSet::generatePrimitives(SoAction * action)
     state->pop();
   }
 }
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
+
+// the grid has 2 * 12 * 12 triangles, which is enough for a pick cache
+#define STRIPSET_TEST_CELLS 12
+#define STRIPSET_TEST_PALETTE 512
+
+BOOST_AUTO_TEST_CASE(pickCacheReplay)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coords = new SoCoordinate3;
+  SoMaterial * material = new SoMaterial;
+  SoNormal * normals = new SoNormal;
+  SoTexture2 * texture = new SoTexture2;
+  SoTextureCoordinate2 * texcoords = new SoTextureCoordinate2;
+  SoMaterialBinding * mb = new SoMaterialBinding;
+  SoNormalBinding * nb = new SoNormalBinding;
+  SoTextureCoordinateBinding * tb = new SoTextureCoordinateBinding;
+  SoIndexedTriangleStripSet * strips = new SoIndexedTriangleStripSet;
+  root->addChild(coords);
+  root->addChild(material);
+  root->addChild(normals);
+  root->addChild(texture);
+  root->addChild(texcoords);
+  root->addChild(mb);
+  root->addChild(nb);
+  root->addChild(tb);
+  root->addChild(strips);
+
+  // texture coordinates are only picked when texturing is enabled
+  const unsigned char pixel[] = { 0xff, 0xff, 0xff };
+  texture->image.setValue(SbVec2s(1, 1), 3, pixel);
+
+  const int n = STRIPSET_TEST_CELLS + 1;
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      coords->point.set1Value(j * n + i, SbVec3f(float(i), float(j), 0.0f));
+    }
+  }
+  for (int i = 0; i < STRIPSET_TEST_PALETTE; i++) {
+    const float a = float(i) / STRIPSET_TEST_PALETTE;
+    material->diffuseColor.set1Value(i, SbColor(a, 1.0f - a, 0.5f));
+    SbVec3f normal(float(cos(a * 30.0f)), float(sin(a * 30.0f)), 2.0f);
+    normal.normalize();
+    normals->vector.set1Value(i, normal);
+    texcoords->point.set1Value(i, SbVec2f(a, 1.0f - a * a));
+  }
+
+  // each row of cells is split into strips of different lengths, so
+  // that the strips start at irregular indices
+  int numstrips = 0, numtriangles = 0;
+  for (int j = 0; j < STRIPSET_TEST_CELLS; j++) {
+    int first = 0;
+    while (first < STRIPSET_TEST_CELLS) {
+      int last = first + 1 + (numstrips % 4);
+      if (last > STRIPSET_TEST_CELLS) last = STRIPSET_TEST_CELLS;
+      for (int i = first; i <= last; i++) {
+        strips->coordIndex.set1Value(strips->coordIndex.getNum(), j * n + i);
+        strips->coordIndex.set1Value(strips->coordIndex.getNum(), (j + 1) * n + i);
+      }
+      strips->coordIndex.set1Value(strips->coordIndex.getNum(), -1);
+      numtriangles += 2 * (last - first);
+      numstrips++;
+      first = last;
+    }
+  }
+  const int numindices = strips->coordIndex.getNum();
+  const int32_t * coordindex = strips->coordIndex.getValues(0);
+  for (int i = 0; i < numindices; i++) {
+    strips->textureCoordIndex.set1Value(i, coordindex[i] < 0 ? -1 : (i * 5) % STRIPSET_TEST_PALETTE);
+  }
+  tb->value = SoTextureCoordinateBinding::PER_VERTEX_INDEXED;
+
+  // PER_FACE binds per triangle and PER_PART per strip
+  const int bindings[] = {
+    SoMaterialBinding::PER_FACE,
+    SoMaterialBinding::PER_FACE_INDEXED,
+    SoMaterialBinding::PER_VERTEX_INDEXED,
+    SoMaterialBinding::PER_PART_INDEXED
+  };
+  for (int b = 0; b < 4; b++) {
+    mb->value = bindings[b];
+    nb->value = bindings[b];
+    strips->materialIndex.setNum(0);
+    strips->normalIndex.setNum(0);
+    int num = 0;
+    if (bindings[b] == SoMaterialBinding::PER_FACE_INDEXED) num = numtriangles;
+    else if (bindings[b] == SoMaterialBinding::PER_PART_INDEXED) num = numstrips;
+    else if (bindings[b] == SoMaterialBinding::PER_VERTEX_INDEXED) num = numindices;
+    for (int i = 0; i < num; i++) {
+      const SbBool end = num == numindices && coordindex[i] < 0;
+      strips->materialIndex.set1Value(i, end ? -1 : (i * 7) % STRIPSET_TEST_PALETTE);
+      strips->normalIndex.set1Value(i, end ? -1 : (i * 11) % STRIPSET_TEST_PALETTE);
+    }
+    BOOST_CHECK_MESSAGE(CountPickCacheMismatches(root, strips, STRIPSET_TEST_CELLS) == 0,
+                        "picking with the pick cache should give the same points and details "
+                        "as picking without it");
+  }
+  root->unref();
+}
+
+#undef STRIPSET_TEST_PALETTE
+#undef STRIPSET_TEST_CELLS
+
+#endif // COIN_TEST_SUITE
@@ -101,6 +101,9 @@
 #include <Inventor/misc/SoGLBigImage.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
 #include <Inventor/misc/SoState.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoIndexedTriangleStripSet.h>
 #include <Inventor/nodes/SoLight.h>
 #include <Inventor/nodes/SoVertexProperty.h>
 #include <Inventor/nodes/SoVertexShape.h>
@@ -128,6 +131,7 @@
 #include "soshape_trianglesort.h"
 #include "soshape_bigtexture.h"
 #include "soshape_bumprender.h"
+#include "soshape_pickcache.h"
 
 // *************************************************************************
 
@@ -175,6 +179,7 @@ public:
   SoShapeP() {
     this->bboxcache = NULL;
     this->pvcache = NULL;
+    this->pickcache = NULL;
     this->bumprender = NULL;
     this->rendercnt = 0;
     this->flags = 0;
@@ -182,6 +187,7 @@ public:
   ~SoShapeP() {
     if (this->bboxcache) { this->bboxcache->unref(); }
     if (this->pvcache) { this->pvcache->unref(); }
+    if (this->pickcache) { this->pickcache->unref(); }
     delete this->bumprender;
   }
   enum {
@@ -192,12 +198,14 @@ public:
     SHOULD_BBOX_CACHE = 0x1,
     NEED_SETUP_SHAPE_HINTS = 0x2,
     DISABLE_VERTEX_ARRAY_CACHE = 0x4,
+    SHOULD_PICK_CACHE = 0x8
   };
 
   static void calibrateBBoxCache(void);
   static double bboxcachetimelimit;
   SoBoundingBoxCache * bboxcache;
   SoPrimitiveVertexCache * pvcache;
+  soshape_pickcache * pickcache;
   soshape_bumprender * bumprender;
   uint32_t flags : FLAG_BITS;
   // stores the number of frames rendered with no node changes
@@ -247,6 +255,42 @@ public:
   void unlock(void) { }
 #endif // ! COIN_THREADSAFE
 
+  // the shapes which generate primitives from the faces listed in
+  // an active soshape_pickcache when picking
+  static SbBool canPickCache(const SoShape * shape) {
+    const SoType type = shape->getTypeId();
+    return
+      type == SoIndexedFaceSet::getClassTypeId() ||
+      type == SoFaceSet::getClassTypeId() ||
+      type == SoIndexedTriangleStripSet::getClassTypeId()
+#ifdef HAVE_VRML97
+      || type == SoVRMLIndexedFaceSet::getClassTypeId()
+#endif // HAVE_VRML97
+      ;
+  }
+
+  // returns the pick cache if it is valid and worth using. Sets
+  // build to TRUE if a new cache should be built while picking.
+  soshape_pickcache * getPickCache(SoState * state, SbBool & build) {
+    build = FALSE;
+    if (this->pickcache) {
+      if (this->pickcache->isValid(state)) {
+        return this->pickcache->isUsable() ? this->pickcache : NULL;
+      }
+      this->lock();
+      this->pickcache->unref();
+      this->pickcache = NULL;
+      this->unlock();
+      // don't create pick caches for shapes that change
+      this->flags &= ~SHOULD_PICK_CACHE;
+    }
+    // only build the cache the second time in a row the shape is
+    // picked without changes
+    if (this->flags & SHOULD_PICK_CACHE) build = TRUE;
+    else this->flags |= SHOULD_PICK_CACHE;
+    return NULL;
+  }
+
   static void cleanup(void);
 };
 
@@ -378,6 +422,7 @@ SoShape::initClass(void)
                   soshape_construct_staticdata,
                   soshape_destruct_staticdata);
   SoShapeP::calibrateBBoxCache();
+  soshape_pickcache::initClass();
 
   coin_atexit((coin_atexit_f *)SoShapeP::cleanup, CC_ATEXIT_NORMAL);
 }
@@ -448,6 +493,12 @@ soshape_ray_intersect(SoRayPickAction * action, const SbBox3f & box)
 
 /*!
   Calculates picked point based on primitives generated by subclasses.
+
+  SoIndexedFaceSet, SoFaceSet, SoIndexedTriangleStripSet and
+  SoVRMLIndexedFaceSet keep their triangles in a cache when they are
+  picked repeatedly without changes. The pick ray is then tested
+  against the cached triangles, and primitives (and picked point
+  details) are only generated for the faces which are hit.
 */
 void
 SoShape::rayPick(SoRayPickAction * action)
@@ -458,7 +509,43 @@ SoShape::rayPick(SoRayPickAction * action)
     if (!PRIVATE(this)->bboxcache ||
         !PRIVATE(this)->bboxcache->isValid(action->getState()) ||
         soshape_ray_intersect(action, PRIVATE(this)->bboxcache->getProjectedBox())) {
-      this->generatePrimitives(action);
+      SoState * state = action->getState();
+      SbBool buildpickcache = FALSE;
+      soshape_pickcache * pickcache = NULL;
+      if (SoShapeP::canPickCache(this)) {
+        pickcache = PRIVATE(this)->getPickCache(state, buildpickcache);
+      }
+      if (buildpickcache) {
+        // only the triangles are collected while building the cache,
+        // so that it only depends on the state the shape depends on.
+        // Must push state to make cache dependencies work.
+        state->push();
+        SbBool storedinvalid = SoCacheElement::setInvalid(FALSE);
+        PRIVATE(this)->lock();
+        PRIVATE(this)->pickcache = new soshape_pickcache(state);
+        PRIVATE(this)->pickcache->ref();
+        PRIVATE(this)->unlock();
+        SoCacheElement::set(state, PRIVATE(this)->pickcache);
+        soshape_pickcache::setActive(this, PRIVATE(this)->pickcache);
+        this->generatePrimitives(action);
+        soshape_pickcache::setActive(this, NULL);
+        PRIVATE(this)->pickcache->close();
+        state->pop();
+        SoCacheElement::setInvalid(storedinvalid);
+        if (PRIVATE(this)->pickcache->isUsable()) {
+          pickcache = PRIVATE(this)->pickcache;
+        }
+      }
+      if (pickcache) {
+        if (pickcache->findFaces(action)) {
+          soshape_pickcache::setActive(this, pickcache);
+          this->generatePrimitives(action);
+          soshape_pickcache::setActive(this, NULL);
+        }
+      }
+      else {
+        this->generatePrimitives(action);
+      }
     }
   }
 }
@@ -993,6 +1080,12 @@ SoShape::invokeTriangleCallbacks(SoAction * const action,
   if (action->getTypeId().isDerivedFrom(SoRayPickAction::getClassTypeId())) {
     SoRayPickAction * ra = (SoRayPickAction *) action;
 
+    if (PRIVATE(this)->pickcache && PRIVATE(this)->pickcache->isBuilding()) {
+      // the pick cache is built first, and then picked with
+      PRIVATE(this)->pickcache->addTriangle(v1, v2, v3);
+      return;
+    }
+
     SbVec3f intersection;
     SbVec3f barycentric;
     SbBool front;
@@ -1432,7 +1525,10 @@ SoShape::notify(SoNotList * nl)
   if (PRIVATE(this)->pvcache) {
     PRIVATE(this)->pvcache->invalidate();
   }
-  PRIVATE(this)->flags &= ~SoShapeP::SHOULD_BBOX_CACHE;
+  if (PRIVATE(this)->pickcache) {
+    PRIVATE(this)->pickcache->invalidate();
+  }
+  PRIVATE(this)->flags &= ~(SoShapeP::SHOULD_BBOX_CACHE|SoShapeP::SHOULD_PICK_CACHE);
   PRIVATE(this)->rendercnt = 0;
   PRIVATE(this)->unlock();
 }
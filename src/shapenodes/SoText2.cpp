@@ -327,6 +327,44 @@ SoText2::initClass(void)
   SO_NODE_INTERNAL_INIT_CLASS(SoText2, SO_FROM_INVENTOR_2_1);
 }
 
+/*!
+  Generates the glyphs for all the characters in the UTF-8 string \a
+  characters, for the font \a fontname at \a size, ahead of time.
+
+  The glyphs are rasterized by worker threads, and this function
+  returns right away. The generated glyphs are kept cached for the
+  lifetime of the application, so SoText2 nodes using this font will
+  find them ready when they are first rendered. This is useful for
+  scenes with a large number of labels, to avoid a stall on the first
+  frame.
+
+  The number of worker threads can be set with the
+  COIN_GLYPH_PREWARM_THREADS environment variable. Set it to 0 to
+  make the function generate the glyphs before returning.
+
+  \sa SoText3::prewarmGlyphs()
+  \since Coin 4.0
+*/
+void
+SoText2::prewarmGlyphs(const SbString & characters, const SbName & fontname,
+                       const float size)
+{
+  const char * p = characters.getString();
+  const size_t length = cc_string_utf8_validate_length(p);
+  if (length == 0) return;
+
+  SbList <uint32_t> chars((int) length);
+  for (size_t i = 0; i < length; i++) {
+    chars.append(cc_string_utf8_get_char(p));
+    p = cc_string_utf8_next_char(p);
+  }
+
+  cc_font_specification spec;
+  cc_fontspec_construct(&spec, fontname.getString(), size, 0.0f);
+  cc_glyph2d_prewarm(chars.getArrayPtr(), chars.getLength(), &spec, 0.0f);
+  cc_fontspec_clean(&spec);
+}
+
 // **************************************************************************
 
 // doc in super
@@ -986,3 +1024,119 @@ SoText2P::setRasterPos3f(GLfloat x, GLfloat y, GLfloat z)
 
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/nodes/SoFont.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/threads/SbThread.h>
+
+#define TEXT2_TEST_THREADS 4
+
+// the same text in a range of font sizes, so the text node rebuilds
+// its glyph cache, and unreferences the previous glyphs, for each size
+static SoSeparator *
+text2_test_scene(const float firstsize, const int numsizes)
+{
+  SoSeparator * root = new SoSeparator;
+  SoText2 * text = new SoText2;
+  text->string.set1Value(0, "The quick brown fox");
+  text->string.set1Value(1, "jumps over the lazy dog");
+  for (int i = 0; i < numsizes; i++) {
+    SoFont * font = new SoFont;
+    font->size = firstsize + float(i);
+    root->addChild(font);
+    root->addChild(text);
+  }
+  return root;
+}
+
+static SbBox3f
+text2_test_bbox(SoNode * root)
+{
+  SoGetBoundingBoxAction bba(SbViewportRegion(640, 480));
+  bba.apply(root);
+  return bba.getBoundingBox();
+}
+
+struct Text2TestThreadData {
+  SoNode * root;
+  SbBox3f bbox;
+};
+
+static void *
+text2_test_thread(void * closure)
+{
+  Text2TestThreadData * data = static_cast<Text2TestThreadData *>(closure);
+  for (int i = 0; i < 4; i++) {
+    data->bbox = text2_test_bbox(data->root);
+  }
+  return NULL;
+}
+
+// runs the scene in a number of threads, and checks that they all get
+// the bounding box \a expected, or the same box if it's empty
+static SbBool
+text2_test_run_threads(const float firstsize, const int numsizes, SbBox3f & expected)
+{
+  Text2TestThreadData data[TEXT2_TEST_THREADS];
+  SbThread * threads[TEXT2_TEST_THREADS];
+  for (int i = 0; i < TEXT2_TEST_THREADS; i++) {
+    data[i].root = text2_test_scene(firstsize, numsizes);
+    data[i].root->ref();
+  }
+  for (int i = 0; i < TEXT2_TEST_THREADS; i++) {
+    threads[i] = SbThread::create(text2_test_thread, &data[i]);
+  }
+  SbBool equal = TRUE;
+  for (int i = 0; i < TEXT2_TEST_THREADS; i++) {
+    threads[i]->join();
+    SbThread::destroy(threads[i]);
+    if (expected.isEmpty()) expected = data[i].bbox;
+    if (data[i].bbox.getMin() != expected.getMin() ||
+        data[i].bbox.getMax() != expected.getMax()) equal = FALSE;
+    data[i].root->unref();
+  }
+  return equal;
+}
+
+BOOST_AUTO_TEST_CASE(concurrentGlyphLookups)
+{
+  // more unused glyphs than the cache keeps, so they are evicted
+  // while the other threads look up glyphs
+  SoSeparator * root = text2_test_scene(10.0f, 60);
+  root->ref();
+  SbBox3f expected = text2_test_bbox(root);
+  BOOST_REQUIRE(!expected.isEmpty());
+  root->unref();
+
+  BOOST_CHECK_MESSAGE(text2_test_run_threads(10.0f, 60, expected),
+                      "concurrent glyph lookups should give the same bounding boxes");
+}
+
+BOOST_AUTO_TEST_CASE(prewarmGlyphs)
+{
+  // look up the glyphs while they are being generated by the
+  // prewarm workers
+  const char * str = "The quick brown fox jumps over the lazy dog";
+  SoText2::prewarmGlyphs(str, "defaultFont", 80.0f);
+  SoText2::prewarmGlyphs(str, "defaultFont", 81.0f);
+  SbBox3f bbox;
+  BOOST_CHECK_MESSAGE(text2_test_run_threads(80.0f, 2, bbox),
+                      "lookups during prewarming should give the same bounding boxes");
+
+  // the prewarmed glyphs stay cached when no node uses them
+  SoText2::prewarmGlyphs(str, "defaultFont", 80.0f);
+  SoSeparator * root = text2_test_scene(80.0f, 2);
+  root->ref();
+  const SbBox3f after = text2_test_bbox(root);
+  BOOST_CHECK_MESSAGE(!bbox.isEmpty() &&
+                      after.getMin() == bbox.getMin() && after.getMax() == bbox.getMax(),
+                      "prewarmed glyphs should match the ones looked up");
+  root->unref();
+}
+
+#undef TEXT2_TEST_THREADS
+
+#endif // COIN_TEST_SUITE
@@ -343,6 +343,41 @@ SoText3::initClass(void)
   SO_NODE_INTERNAL_INIT_CLASS(SoText3, SO_FROM_INVENTOR_2_1);
 }
 
+/*!
+  Tessellates the glyphs for all the characters in the UTF-8 string
+  \a characters, for the font \a fontname at \a complexity, ahead of
+  time.
+
+  The glyphs are generated by worker threads, and this function
+  returns right away. The generated glyphs are kept cached for the
+  lifetime of the application, and are shared by SoText3,
+  SoAsciiText and SoVRMLText nodes using the same font and a
+  complexity value which rounds to the same tenth.
+
+  \sa SoText2::prewarmGlyphs()
+  \since Coin 4.0
+*/
+void
+SoText3::prewarmGlyphs(const SbString & characters, const SbName & fontname,
+                       const float complexity)
+{
+  const char * p = characters.getString();
+  const size_t length = cc_string_utf8_validate_length(p);
+  if (length == 0) return;
+
+  SbList <uint32_t> chars((int) length);
+  for (size_t i = 0; i < length; i++) {
+    chars.append(cc_string_utf8_get_char(p));
+    p = cc_string_utf8_next_char(p);
+  }
+
+  // the size doesn't matter, 3D glyphs are normalized
+  cc_font_specification spec;
+  cc_fontspec_construct(&spec, fontname.getString(), 1.0f, complexity);
+  cc_glyph3d_prewarm(chars.getArrayPtr(), chars.getLength(), &spec);
+  cc_fontspec_clean(&spec);
+}
+
 // doc in parent
 void
 SoText3::computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
@@ -61,3 +61,4 @@
 #include "soshape_primdata.cpp"
 #include "soshape_trianglesort.cpp"
 #include "soshape_bumprender.cpp"
+#include "soshape_pickcache.cpp"
@@ -0,0 +1,439 @@
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include "shapenodes/soshape_pickcache.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <Inventor/SbLine.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/details/SoPointDetail.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/threads/SbStorage.h>
+
+#include "tidbitsp.h"
+
+// shapes with fewer triangles than this are picked without the cache
+#define PICKCACHE_MIN_TRIANGLES 256
+// max number of triangles in a leaf node
+#define PICKCACHE_LEAF_SIZE 4
+// max depth of the tree when splitting nodes in the middle, median
+// splits are used below this depth
+#define PICKCACHE_MIDDLE_DEPTH 24
+// deeper than any tree built from a 32 bit triangle count
+#define PICKCACHE_STACK_SIZE 64
+
+typedef struct {
+  const SoShape * shape;
+  soshape_pickcache * cache;
+} soshape_pickcache_active;
+
+static SbStorage * soshape_pickcache_storage = NULL;
+
+static void
+soshape_pickcache_construct_active(void * closure)
+{
+  soshape_pickcache_active * data = (soshape_pickcache_active *) closure;
+  data->shape = NULL;
+  data->cache = NULL;
+}
+
+static void
+soshape_pickcache_cleanup(void)
+{
+  delete soshape_pickcache_storage;
+  soshape_pickcache_storage = NULL;
+}
+
+// the center of a triangle, sorted while building the hierarchy
+struct soshape_pickcache::builditem {
+  float center[3];
+  int32_t triangle;
+};
+
+// sorts build items on the center of the triangles along an axis
+class soshape_pickcache_center_less {
+public:
+  soshape_pickcache_center_less(const int axis) : axis(axis) { }
+  template <class Item>
+  bool operator()(const Item & a, const Item & b) const {
+    return a.center[this->axis] < b.center[this->axis];
+  }
+private:
+  int axis;
+};
+
+// tests if the center of a build item is below a value along an axis
+class soshape_pickcache_center_below {
+public:
+  soshape_pickcache_center_below(const int axis, const float value)
+    : axis(axis), value(value) { }
+  template <class Item>
+  bool operator()(const Item & item) const {
+    return item.center[this->axis] < this->value;
+  }
+private:
+  int axis;
+  float value;
+};
+
+soshape_pickcache::soshape_pickcache(SoState * const state)
+  : SoCache(state),
+    building(TRUE)
+{
+}
+
+soshape_pickcache::~soshape_pickcache()
+{
+}
+
+void
+soshape_pickcache::initClass(void)
+{
+  soshape_pickcache_storage =
+    new SbStorage(sizeof(soshape_pickcache_active),
+                  soshape_pickcache_construct_active, NULL);
+  coin_atexit((coin_atexit_f *)soshape_pickcache_cleanup, CC_ATEXIT_NORMAL);
+}
+
+soshape_pickcache *
+soshape_pickcache::getActive(const SoShape * shape, SoAction * action)
+{
+  if (!action->isOfType(SoRayPickAction::getClassTypeId())) return NULL;
+  soshape_pickcache_active * data =
+    (soshape_pickcache_active *) soshape_pickcache_storage->get();
+  return (data->shape == shape) ? data->cache : NULL;
+}
+
+void
+soshape_pickcache::setActive(const SoShape * shape, soshape_pickcache * cache)
+{
+  soshape_pickcache_active * data =
+    (soshape_pickcache_active *) soshape_pickcache_storage->get();
+  data->shape = cache ? shape : NULL;
+  data->cache = cache;
+}
+
+int
+soshape_pickcache::addVertex(const SoPrimitiveVertex * v)
+{
+  // the same coordinate index always gives the same point while the
+  // shape generates its primitives, so share vertices on it
+  const SoDetail * detail = v->getDetail();
+  int coordidx = -1;
+  if (detail && detail->getTypeId() == SoPointDetail::getClassTypeId()) {
+    coordidx = static_cast<const SoPointDetail *>(detail)->getCoordinateIndex();
+  }
+  if (coordidx >= 0) {
+    while (this->coordmap.getLength() <= coordidx) this->coordmap.append(-1);
+    if (this->coordmap[coordidx] >= 0) return this->coordmap[coordidx];
+    this->coordmap[coordidx] = this->vertices.getLength();
+  }
+  this->vertices.append(v->getPoint());
+  return this->vertices.getLength() - 1;
+}
+
+void
+soshape_pickcache::addTriangle(const SoPrimitiveVertex * v0,
+                               const SoPrimitiveVertex * v1,
+                               const SoPrimitiveVertex * v2)
+{
+  this->triangles.append(this->addVertex(v0));
+  this->triangles.append(this->addVertex(v1));
+  this->triangles.append(this->addVertex(v2));
+  this->trianglefaces.append(this->facestart.getLength() - 1);
+}
+
+// Builds the subtree for items [first, first+num>. Only the centers
+// are moved around while splitting, the boxes are computed in close()
+// once the triangles are stored in leaf order.
+int
+soshape_pickcache::buildNode(const int nodeidx, builditem * items,
+                             const int first, const int num, const int depth)
+{
+  float cmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float cmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (int i = first; i < first + num; i++) {
+    const float * c = items[i].center;
+    for (int k = 0; k < 3; k++) {
+      if (c[k] < cmin[k]) cmin[k] = c[k];
+      if (c[k] > cmax[k]) cmax[k] = c[k];
+    }
+  }
+  int axis = 0;
+  for (int k = 1; k < 3; k++) {
+    if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis]) axis = k;
+  }
+
+  if (num <= PICKCACHE_LEAF_SIZE || cmax[axis] <= cmin[axis]) {
+    node & n = this->nodes[nodeidx];
+    n.first = first;
+    n.num = num;
+    return 1;
+  }
+
+  // split at the middle of the centers, which is cheap and works
+  // well for evenly tessellated shapes. Median splits are used below
+  // PICKCACHE_MIDDLE_DEPTH, or if one side would be empty, to bound
+  // the depth of the tree.
+  int half = 0;
+  if (depth < PICKCACHE_MIDDLE_DEPTH) {
+    const float mid = (cmin[axis] + cmax[axis]) * 0.5f;
+    half = static_cast<int>(std::partition(items + first, items + first + num,
+                                           soshape_pickcache_center_below(axis, mid)) -
+                            (items + first));
+  }
+  if (half == 0 || half == num) {
+    half = num / 2;
+    std::nth_element(items + first, items + first + half, items + first + num,
+                     soshape_pickcache_center_less(axis));
+  }
+
+  const int child = this->nodes.getLength();
+  node empty;
+  std::memset(&empty, 0, sizeof(node));
+  this->nodes.append(empty);
+  this->nodes.append(empty);
+
+  const int depth0 = this->buildNode(child, items, first, half, depth + 1);
+  const int depth1 = this->buildNode(child + 1, items, first + half, num - half, depth + 1);
+
+  // the list might have been reallocated while building the children
+  node & n = this->nodes[nodeidx];
+  n.first = child;
+  n.num = 0;
+  return 1 + SbMax(depth0, depth1);
+}
+
+void
+soshape_pickcache::close(void)
+{
+  this->building = FALSE;
+  this->coordmap.truncate(0, TRUE);
+
+  const int numtriangles = this->trianglefaces.getLength();
+  SbBool usable = numtriangles >= PICKCACHE_MIN_TRIANGLES;
+  // triangles generated outside of a face can't be replayed
+  for (int i = 0; usable && i < numtriangles; i++) {
+    if (this->trianglefaces[i] < 0) usable = FALSE;
+  }
+  if (!usable) {
+    this->facestart.truncate(0, TRUE);
+    this->vertices.truncate(0, TRUE);
+    this->triangles.truncate(0, TRUE);
+    this->trianglefaces.truncate(0, TRUE);
+    return;
+  }
+
+  builditem * items = new builditem[numtriangles];
+  const SbVec3f * v = this->vertices.getArrayPtr();
+  const int32_t * t = this->triangles.getArrayPtr();
+  for (int i = 0; i < numtriangles; i++) {
+    const SbVec3f c = (v[t[i*3]] + v[t[i*3+1]] + v[t[i*3+2]]) / 3.0f;
+    items[i].center[0] = c[0];
+    items[i].center[1] = c[1];
+    items[i].center[2] = c[2];
+    items[i].triangle = i;
+  }
+
+  node root;
+  std::memset(&root, 0, sizeof(node));
+  this->nodes.append(root);
+  const int depth = this->buildNode(0, items, 0, numtriangles, 0);
+
+  if (depth >= PICKCACHE_STACK_SIZE) {
+    // can't happen, as median splits are used for the deeper nodes,
+    // but findFaces() must never overrun its stack
+    delete[] items;
+    this->nodes.truncate(0, TRUE);
+    this->facestart.truncate(0, TRUE);
+    this->vertices.truncate(0, TRUE);
+    this->triangles.truncate(0, TRUE);
+    this->trianglefaces.truncate(0, TRUE);
+    return;
+  }
+
+  // store the triangles in leaf order
+  SbList <int32_t> sortedtriangles(numtriangles * 3);
+  SbList <int32_t> sortedfaces(numtriangles);
+  for (int i = 0; i < numtriangles; i++) {
+    const int32_t triangle = items[i].triangle;
+    sortedtriangles.append(t[triangle*3]);
+    sortedtriangles.append(t[triangle*3+1]);
+    sortedtriangles.append(t[triangle*3+2]);
+    sortedfaces.append(this->trianglefaces[triangle]);
+  }
+  delete[] items;
+  this->triangles = sortedtriangles;
+  this->trianglefaces = sortedfaces;
+
+  // children are always stored after their parent, so the boxes can
+  // be computed bottom-up in a single pass
+  t = this->triangles.getArrayPtr();
+  for (int i = this->nodes.getLength() - 1; i >= 0; i--) {
+    node & n = this->nodes[i];
+    if (n.num == 0) {
+      const node & n0 = this->nodes[n.first];
+      const node & n1 = this->nodes[n.first + 1];
+      for (int k = 0; k < 3; k++) {
+        n.min[k] = SbMin(n0.min[k], n1.min[k]);
+        n.max[k] = SbMax(n0.max[k], n1.max[k]);
+      }
+      continue;
+    }
+    for (int k = 0; k < 3; k++) {
+      n.min[k] = FLT_MAX;
+      n.max[k] = -FLT_MAX;
+    }
+    for (int j = n.first * 3; j < (n.first + n.num) * 3; j++) {
+      const SbVec3f & p = v[t[j]];
+      for (int k = 0; k < 3; k++) {
+        if (p[k] < n.min[k]) n.min[k] = p[k];
+        if (p[k] > n.max[k]) n.max[k] = p[k];
+      }
+    }
+  }
+  this->nodes.fit();
+  this->vertices.fit();
+  this->facestart.fit();
+
+  // pad the boxes a little, as the boxes are tested against the
+  // single precision line while triangles are tested against the
+  // double precision line in SoRayPickAction
+  const node & r = this->nodes[0];
+  float size = 0.0f;
+  for (int k = 0; k < 3; k++) {
+    size = SbMax(size, SbMax(static_cast<float>(fabs(r.min[k])),
+                             static_cast<float>(fabs(r.max[k]))));
+  }
+  const float pad = size * 1.0e-5f + FLT_MIN;
+  for (int i = 0; i < this->nodes.getLength(); i++) {
+    node & n = this->nodes[i];
+    for (int k = 0; k < 3; k++) {
+      n.min[k] -= pad;
+      n.max[k] += pad;
+    }
+  }
+}
+
+SbBool
+soshape_pickcache::isUsable(void) const
+{
+  return this->nodes.getLength() > 0;
+}
+
+// tests the infinite line against the box of a node
+static inline SbBool
+soshape_pickcache_line_hits_box(const float * min, const float * max,
+                                const SbVec3f & pos, const SbVec3f & dir)
+{
+  float tmin = -FLT_MAX;
+  float tmax = FLT_MAX;
+  for (int k = 0; k < 3; k++) {
+    if (dir[k] == 0.0f) {
+      if (pos[k] < min[k] || pos[k] > max[k]) return FALSE;
+    }
+    else {
+      float t0 = (min[k] - pos[k]) / dir[k];
+      float t1 = (max[k] - pos[k]) / dir[k];
+      if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+      if (t0 > tmin) tmin = t0;
+      if (t1 < tmax) tmax = t1;
+      if (tmin > tmax) return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// Finds the faces with triangles the pick ray intersects, and returns
+// the number of faces. SoShape::invokeTriangleCallbacks() does the
+// same intersection test when the faces are generated, and also
+// tests against the near and far planes.
+int
+soshape_pickcache::findFaces(SoRayPickAction * action)
+{
+  this->hitfaces.truncate(0);
+  if (this->nodes.getLength() == 0) return 0;
+
+  const SbLine & line = action->getLine();
+  const SbVec3f & pos = line.getPosition();
+  const SbVec3f & dir = line.getDirection();
+
+  const node * nodes = this->nodes.getArrayPtr();
+  const SbVec3f * v = this->vertices.getArrayPtr();
+  const int32_t * t = this->triangles.getArrayPtr();
+
+  SbVec3f isect, bary;
+  SbBool front;
+
+  int stack[PICKCACHE_STACK_SIZE];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const node & n = nodes[stack[--top]];
+    if (!soshape_pickcache_line_hits_box(n.min, n.max, pos, dir)) continue;
+    if (n.num == 0) {
+      stack[top++] = n.first;
+      stack[top++] = n.first + 1;
+      continue;
+    }
+    for (int i = n.first; i < n.first + n.num; i++) {
+      if (action->intersect(v[t[i*3]], v[t[i*3+1]], v[t[i*3+2]],
+                            isect, bary, front)) {
+        this->hitfaces.append(this->trianglefaces[i]);
+      }
+    }
+  }
+
+  // generate each face once, in the order the shape generates them
+  const int num = this->hitfaces.getLength();
+  if (num > 1) {
+    int * faces = &this->hitfaces[0];
+    std::sort(faces, faces + num);
+    this->hitfaces.truncate(static_cast<int>(std::unique(faces, faces + num) - faces));
+  }
+  return this->hitfaces.getLength();
+}
+
+#undef PICKCACHE_STACK_SIZE
+#undef PICKCACHE_MIDDLE_DEPTH
+#undef PICKCACHE_LEAF_SIZE
+#undef PICKCACHE_MIN_TRIANGLES
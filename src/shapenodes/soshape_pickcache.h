@@ -0,0 +1,113 @@
+#ifndef COIN_SOSHAPE_PICKCACHE_H
+#define COIN_SOSHAPE_PICKCACHE_H
+
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/caches/SoCache.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/SbVec3f.h>
+
+class SoAction;
+class SoRayPickAction;
+class SoPrimitiveVertex;
+class SoShape;
+
+// Caches the triangles of a shape in a bounding volume hierarchy, so
+// that SoShape::rayPick() only needs to generate primitives for the
+// faces the pick ray actually hits.
+//
+// The cache is filled while SoShape::rayPick() generates primitives
+// for the complete shape. The shape calls beginFace() with the index
+// into its index array where each face starts, and SoShape adds the
+// triangles. When picking with a valid cache, the shape is asked to
+// generate primitives only for a sorted list of faces, starting each
+// face at the index it gave in beginFace().
+
+class soshape_pickcache : public SoCache {
+  typedef SoCache inherited;
+public:
+  soshape_pickcache(SoState * const state);
+
+  static void initClass(void);
+
+  // the cache SoShape::rayPick() is building or picking with for
+  // shape in the current thread, or NULL
+  static soshape_pickcache * getActive(const SoShape * shape, SoAction * action);
+  static void setActive(const SoShape * shape, soshape_pickcache * cache);
+
+  SbBool isBuilding(void) const { return this->building; }
+  void beginFace(const int startindex) { this->facestart.append(startindex); }
+  void addTriangle(const SoPrimitiveVertex * v0,
+                   const SoPrimitiveVertex * v1,
+                   const SoPrimitiveVertex * v2);
+  void close(void);
+
+  SbBool isUsable(void) const;
+  int findFaces(SoRayPickAction * action);
+  int getNumFaces(void) const { return this->hitfaces.getLength(); }
+  int getFace(const int idx) const { return this->hitfaces[idx]; }
+  int getFaceStart(const int face) const { return this->facestart[face]; }
+
+protected:
+  virtual ~soshape_pickcache();
+
+private:
+  struct node {
+    float min[3];
+    float max[3];
+    int32_t first;   // first triangle (leaf) or first child (inner node)
+    int32_t num;     // number of triangles, 0 for inner nodes
+  };
+
+  struct builditem;
+
+  int addVertex(const SoPrimitiveVertex * v);
+  int buildNode(const int nodeidx, builditem * items,
+                const int first, const int num, const int depth);
+
+  SbBool building;
+  SbList <int32_t> facestart;
+  SbList <SbVec3f> vertices;
+  SbList <int32_t> triangles;     // three vertex indices per triangle
+  SbList <int32_t> trianglefaces;
+  SbList <node> nodes;
+  SbList <int32_t> coordmap;      // coordinate index -> vertex, while building
+  SbList <int> hitfaces;
+};
+
+#endif // !COIN_SOSHAPE_PICKCACHE_H
@@ -31,7 +31,7 @@
 \**************************************************************************/
 
 #ifdef HAVE_CONFIG_H
-#include <config.h>
+#include "config.h"
 #endif // HAVE_CONFIG_H
 
 #ifdef HAVE_VRML97
@@ -250,6 +250,7 @@
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
 #include "nodes/SoSubNodeP.h"
+#include "shapenodes/soshape_pickcache.h"
 
 // *************************************************************************
 
@@ -839,7 +840,34 @@ SoVRMLIndexedFaceSet::generatePrimitives(SoAction * action)
   int matnr = 0;
   int normnr = 0;
 
+  // when picking with a pick cache, only the faces hit by the pick
+  // ray are generated
+  soshape_pickcache * pickcache = soshape_pickcache::getActive(this, action);
+  const int32_t * mindicesbase = mindices;
+  const int32_t * nindicesbase = nindices;
+  const int32_t * tindicesbase = tindices;
+  int pickface = 0;
+
   while (viptr + 2 < viendptr) {
+    if (pickcache) {
+      if (pickcache->isBuilding()) {
+        pickcache->beginFace((int) (viptr - cindices));
+      }
+      else {
+        if (pickface == pickcache->getNumFaces()) break;
+        const int face = pickcache->getFace(pickface++);
+        const int start = pickcache->getFaceStart(face);
+        // every face before this one was terminated by a -1 index
+        viptr = cindices + start;
+        matnr = (mbind == PER_FACE) ? face : start - face;
+        normnr = (nbind == PER_FACE) ? face : start - face;
+        texidx = start - face;
+        if (mindicesbase) mindices = mindicesbase + ((mbind == PER_FACE_INDEXED) ? face : start);
+        if (nindicesbase) nindices = nindicesbase + ((nbind == PER_FACE_INDEXED) ? face : start);
+        if (tindicesbase) tindices = tindicesbase + ((tbind != NONE) ? start : face);
+        faceDetail.setFaceIndex(face);
+      }
+    }
     v1 = *viptr++;
     v2 = *viptr++;
     v3 = *viptr++;
@@ -1103,3 +1131,107 @@ SoVRMLIndexedFaceSet::useConvexCache(SoAction * action,
 #undef STATUS_CONCAVE
 
 #endif // HAVE_VRML97
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/VRMLnodes/SoVRMLColor.h>
+#include <Inventor/VRMLnodes/SoVRMLCoordinate.h>
+#include <Inventor/VRMLnodes/SoVRMLIndexedFaceSet.h>
+#include <Inventor/VRMLnodes/SoVRMLNormal.h>
+#include <Inventor/VRMLnodes/SoVRMLTextureCoordinate.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTexture2.h>
+
+// the grid has 2 * 12 * 12 triangles, which is enough for a pick cache
+#define IFS_TEST_CELLS 12
+#define IFS_TEST_PALETTE 256
+
+BOOST_AUTO_TEST_CASE(pickCacheReplay)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoTexture2 * texture = new SoTexture2;
+  SoVRMLIndexedFaceSet * ifs = new SoVRMLIndexedFaceSet;
+  SoVRMLCoordinate * coords = new SoVRMLCoordinate;
+  SoVRMLColor * colors = new SoVRMLColor;
+  SoVRMLNormal * normals = new SoVRMLNormal;
+  SoVRMLTextureCoordinate * texcoords = new SoVRMLTextureCoordinate;
+  ifs->coord = coords;
+  ifs->color = colors;
+  ifs->normal = normals;
+  ifs->texCoord = texcoords;
+  root->addChild(texture);
+  root->addChild(ifs);
+
+  // texture coordinates are only picked when texturing is enabled
+  const unsigned char pixel[] = { 0xff, 0xff, 0xff };
+  texture->image.setValue(SbVec2s(1, 1), 3, pixel);
+
+  const int n = IFS_TEST_CELLS + 1;
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      coords->point.set1Value(j * n + i, SbVec3f(float(i), float(j), 0.0f));
+    }
+  }
+  for (int i = 0; i < IFS_TEST_PALETTE; i++) {
+    const float a = float(i) / IFS_TEST_PALETTE;
+    colors->color.set1Value(i, SbColor(a, 1.0f - a, 0.5f));
+    SbVec3f normal(float(cos(a * 6.0f)), float(sin(a * 6.0f)), 2.0f);
+    normal.normalize();
+    normals->vector.set1Value(i, normal);
+    texcoords->point.set1Value(i, SbVec2f(a, 1.0f - a * a));
+  }
+
+  // a grid with triangles in every third cell and quads in the other
+  // cells, so that the faces start at irregular indices
+  int numfaces = 0;
+  for (int j = 0; j < IFS_TEST_CELLS; j++) {
+    for (int i = 0; i < IFS_TEST_CELLS; i++) {
+      const int32_t a = j * n + i, b = a + 1, c = a + n + 1, d = a + n;
+      if ((i + j) % 3 == 0) {
+        const int32_t tris[] = { a, b, c, -1, a, c, d, -1 };
+        ifs->coordIndex.setValues(ifs->coordIndex.getNum(), 8, tris);
+        numfaces += 2;
+      }
+      else {
+        const int32_t quad[] = { a, b, c, d, -1 };
+        ifs->coordIndex.setValues(ifs->coordIndex.getNum(), 5, quad);
+        numfaces += 1;
+      }
+    }
+  }
+  const int numindices = ifs->coordIndex.getNum();
+  const int32_t * coordindex = ifs->coordIndex.getValues(0);
+  for (int i = 0; i < numindices; i++) {
+    ifs->texCoordIndex.set1Value(i, coordindex[i] < 0 ? -1 : (i * 5) % IFS_TEST_PALETTE);
+  }
+
+  // per face, per face indexed and per vertex indexed bindings
+  for (int b = 0; b < 3; b++) {
+    ifs->colorPerVertex = b == 2;
+    ifs->normalPerVertex = b == 2;
+    ifs->colorIndex.setNum(0);
+    ifs->normalIndex.setNum(0);
+    if (b == 1) {
+      for (int i = 0; i < numfaces; i++) {
+        ifs->colorIndex.set1Value(i, (i * 7) % IFS_TEST_PALETTE);
+        ifs->normalIndex.set1Value(i, (i * 11) % IFS_TEST_PALETTE);
+      }
+    }
+    else if (b == 2) {
+      for (int i = 0; i < numindices; i++) {
+        const SbBool end = coordindex[i] < 0;
+        ifs->colorIndex.set1Value(i, end ? -1 : (i * 13) % IFS_TEST_PALETTE);
+        ifs->normalIndex.set1Value(i, end ? -1 : (i * 3) % IFS_TEST_PALETTE);
+      }
+    }
+    BOOST_CHECK_MESSAGE(CountPickCacheMismatches(root, ifs, IFS_TEST_CELLS) == 0,
+                        "picking with the pick cache should give the same points and details "
+                        "as picking without it");
+  }
+  root->unref();
+}
+
+#undef IFS_TEST_PALETTE
+#undef IFS_TEST_CELLS
+
+#endif // COIN_TEST_SUITE
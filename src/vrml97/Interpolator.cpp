@@ -31,7 +31,7 @@
 \**************************************************************************/
 
 #ifdef HAVE_CONFIG_H
-#include <config.h>
+#include "config.h"
 #endif // HAVE_CONFIG_H
 
 #ifdef HAVE_VRML97
@@ -80,9 +80,50 @@
 
 #include <Inventor/VRMLnodes/SoVRMLInterpolator.h>
 
+#include <cstdlib> // atoi()
+#include <cstring> // memcpy()
+#include <algorithm> // std::upper_bound()
+
 #include <Inventor/VRMLnodes/SoVRMLMacros.h>
 
+#include <Inventor/SoDB.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/C/tidbits.h> // coin_getenv()
+#include <Inventor/lists/SbList.h>
+
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/wpool.h>
+#endif // HAVE_THREADS
+
 #include "engines/SoSubNodeEngineP.h"
+#include "vrml97/SoVRMLSubInterpolatorP.h"
+#include "tidbitsp.h" // coin_atexit()
+#include "threads/threadsutilp.h"
+
+#ifndef DOXYGEN_SKIP_THIS
+
+class SoVRMLInterpolatorP {
+public:
+  SoVRMLInterpolatorP(void)
+    : lastsegment(0), batchsegment(-1), numsortedkeys(-1), keyssorted(FALSE) { }
+
+  // The index of the first key larger than the fraction at the last
+  // lookup. Used as a starting hint, since the fraction normally moves
+  // forward in small steps.
+  int lastsegment;
+  // The segment found by the previous interpolator in
+  // evaluateFractions(), or -1. Tried before lastsegment, since
+  // interpolators driven by the same time sensor often share keys.
+  int batchsegment;
+  // The number of keys when keyssorted was last checked, or -1 if the
+  // keys have changed since.
+  int numsortedkeys;
+  SbBool keyssorted;
+};
+
+#endif // DOXYGEN_SKIP_THIS
+
+#define PRIVATE(obj) ((obj)->pimpl)
 
 SO_NODEENGINE_ABSTRACT_SOURCE(SoVRMLInterpolator);
 
@@ -97,6 +138,8 @@ SoVRMLInterpolator::initClass(void) // static
 
 SoVRMLInterpolator::SoVRMLInterpolator(void) // protected
 {
+  PRIVATE(this) = new SoVRMLInterpolatorP;
+
   SO_NODEENGINE_CONSTRUCTOR(SoVRMLInterpolator);
 
   SO_VRMLNODE_ADD_EVENT_IN(set_fraction);
@@ -114,6 +157,64 @@ SoVRMLInterpolator::SoVRMLInterpolator(void) // protected
 
 SoVRMLInterpolator::~SoVRMLInterpolator() // virtual, protected
 {
+  delete PRIVATE(this);
+}
+
+/*!
+  Sets \a fraction as the new set_fraction value of the
+  \a numinterpolators interpolators in \a interpolators, and
+  evaluates them all in one pass.
+
+  The interpolated values are written to the connected fields right
+  away, instead of when each field is read. The key interval found for
+  one interpolator is tried first for the next one, so interpolators
+  with the same keys only search their keys once. All notifications
+  are sent in a single SoDB::startNotify()/endNotify() pass.
+
+  Use this to advance many interpolators driven by the same
+  SoVRMLTimeSensor fraction.
+
+  \since Coin 4.0
+*/
+void
+SoVRMLInterpolator::evaluateFractions(SoVRMLInterpolator * const * interpolators,
+                                      const int numinterpolators,
+                                      const float fraction) // static
+{
+  SoDB::startNotify();
+  for (int i = 0; i < numinterpolators; i++) {
+    interpolators[i]->set_fraction.setValue(fraction);
+  }
+  int segment = -1;
+  for (int i = 0; i < numinterpolators; i++) {
+    SoVRMLInterpolatorP * pimpl = PRIVATE(interpolators[i]);
+    pimpl->batchsegment = segment;
+    // writes the values, and clears the dirty flag of the connected
+    // fields, so they are not evaluated again when read
+    interpolators[i]->evaluateWrapper();
+    pimpl->batchsegment = -1;
+    segment = pimpl->lastsegment;
+  }
+  SoDB::endNotify();
+}
+
+// Doc in parent
+void
+SoVRMLInterpolator::inputChanged(SoField * which)
+{
+  if (which == &this->key) {
+    PRIVATE(this)->numsortedkeys = -1;
+  }
+}
+
+// Returns TRUE if \a i is the index of the first of the \a num sorted
+// keys \a t larger than \a fraction.
+static SbBool
+interpolator_segment_matches(const float * t, const int num, const int i,
+                             const float fraction)
+{
+  if (i < 0 || i > num) return FALSE;
+  return (i == 0 || t[i-1] <= fraction) && (i == num || fraction < t[i]);
 }
 
 /*!
@@ -126,25 +227,397 @@ SoVRMLInterpolator::getKeyValueIndex(float & interp, int numvalues)
   const int n = this->key.getNum();
   if (n == 0 || numvalues == 0) return -1;
 
-  const float * t = this->key.getValues(0); 
-  for (int i = 0; i < SbMin(n, numvalues); i++) {
-    if (fraction < t[i]) {
-      if (i == 0) {
-        interp = 0.0f;
-        return 0;
-      }
-      else {
-        float delta = t[i] - t[i-1];
-        if (delta > 0.0f) {
-          interp = (fraction - t[i-1]) / delta;
+  const float * t = this->key.getValues(0);
+  const int num = SbMin(n, numvalues);
+  SoVRMLInterpolatorP * pimpl = PRIVATE(this);
+
+  // The keys should be non-decreasing, but a linear search is kept for
+  // keys that are not, so that the result does not depend on the
+  // search method.
+  if (pimpl->numsortedkeys != n) {
+    pimpl->keyssorted = TRUE;
+    for (int i = 1; i < n && pimpl->keyssorted; i++) {
+      if (t[i] < t[i-1]) pimpl->keyssorted = FALSE;
+    }
+    pimpl->numsortedkeys = n;
+    pimpl->lastsegment = 0;
+  }
+
+  // find the first key larger than fraction, or num if there is none
+  int i;
+  if (pimpl->keyssorted) {
+    i = pimpl->batchsegment;
+    if (!interpolator_segment_matches(t, num, i, fraction)) {
+      i = pimpl->lastsegment;
+      if (!interpolator_segment_matches(t, num, i, fraction)) {
+        // try the next segment before doing a full search
+        i++;
+        if (!interpolator_segment_matches(t, num, i, fraction)) {
+          i = int(std::upper_bound(t, t + num, fraction) - t);
         }
-        else interp = 0.0f;
       }
-      return i-1;
     }
+    pimpl->lastsegment = i;
+  }
+  else {
+    for (i = 0; i < num; i++) {
+      if (fraction < t[i]) break;
+    }
+  }
+
+  if (i == 0) {
+    interp = 0.0f;
+    return 0;
+  }
+  if (i == num) {
+    interp = 0.0f;
+    return num-1;
+  }
+  float delta = t[i] - t[i-1];
+  if (delta > 0.0f) {
+    interp = (fraction - t[i-1]) / delta;
+  }
+  else interp = 0.0f;
+  return i-1;
+}
+
+#undef PRIVATE
+
+// *************************************************************************
+
+namespace {
+
+// Below this number of vectors, interpolation is done in the calling
+// thread only.
+const int LERP_MIN_THREAD_SIZE = 64 * 1024;
+
+// Interpolates n floats. Kept as a flat loop over plain float
+// pointers so that the compiler can vectorize it.
+void
+lerp_floats(float * dst, const float * a, const float * b, const float t, const int n)
+{
+  for (int i = 0; i < n; i++) {
+    dst[i] = a[i] + (b[i] - a[i]) * t;
+  }
+}
+
+struct LerpJob {
+  float * dst;
+  const float * a;
+  const float * b;
+  float t;
+  int n;
+};
+
+void
+lerp_job(void * closure)
+{
+  LerpJob * job = static_cast<LerpJob *>(closure);
+  lerp_floats(job->dst, job->a, job->b, job->t, job->n);
+}
+
+#ifdef HAVE_THREADS
+
+cc_wpool * lerppool = NULL;
+int lerpthreads = -1;
+
+void
+lerp_pool_cleanup(void)
+{
+  if (lerppool) cc_wpool_destruct(lerppool);
+  lerppool = NULL;
+  lerpthreads = -1;
+}
+
+// The number of threads used for interpolating large value arrays. Can
+// be set with the COIN_VRML_INTERPOLATOR_THREADS environment variable.
+int
+lerp_num_threads(void)
+{
+  CC_GLOBAL_LOCK;
+  if (lerpthreads < 0) {
+    const char * env = coin_getenv("COIN_VRML_INTERPOLATOR_THREADS");
+    lerpthreads = env ? atoi(env) : 4;
+    if (lerpthreads < 1) lerpthreads = 1;
+  }
+  const int numthreads = lerpthreads;
+  CC_GLOBAL_UNLOCK;
+  return numthreads;
+}
+
+cc_wpool *
+lerp_pool(const int numthreads)
+{
+  CC_GLOBAL_LOCK;
+  if (lerppool == NULL) {
+    lerppool = cc_wpool_construct(numthreads - 1);
+    coin_atexit((coin_atexit_f*) lerp_pool_cleanup, CC_ATEXIT_NORMAL);
   }
-  interp = 0.0f;
-  return SbMin(numvalues,n)-1;
+  CC_GLOBAL_UNLOCK;
+  return lerppool;
 }
 
+#endif // HAVE_THREADS
+
+void
+lerp_vec3f(SbVec3f * dst, const SbVec3f * v0, const SbVec3f * v1, const float t, const int num)
+{
+  if (v0 == v1 || t == 0.0f) {
+    memcpy(dst, v0, num * sizeof(SbVec3f));
+    return;
+  }
+
+  int numjobs = 1;
+#ifdef HAVE_THREADS
+  int numthreads = 1;
+  if (num >= 2 * LERP_MIN_THREAD_SIZE) {
+    numthreads = lerp_num_threads();
+    numjobs = SbMin(numthreads, num / LERP_MIN_THREAD_SIZE);
+  }
+#endif // HAVE_THREADS
+
+  SbList <LerpJob> jobs(numjobs);
+  const int chunk = (num + numjobs - 1) / numjobs;
+  for (int i = 0; i < numjobs; i++) {
+    LerpJob job;
+    job.dst = &dst[i * chunk][0];
+    job.a = v0[i * chunk].getValue();
+    job.b = v1[i * chunk].getValue();
+    job.t = t;
+    job.n = SbMin(chunk, num - i * chunk) * 3;
+    jobs.append(job);
+  }
+
+#ifdef HAVE_THREADS
+  cc_wpool * pool = NULL;
+  if (numjobs > 1) {
+    pool = lerp_pool(numthreads);
+    cc_wpool_begin(pool, numjobs - 1);
+    for (int i = 1; i < numjobs; i++) {
+      cc_wpool_start_worker(pool, lerp_job, &jobs[i]);
+    }
+    cc_wpool_end(pool);
+  }
+#endif // HAVE_THREADS
+  lerp_job(&jobs[0]);
+#ifdef HAVE_THREADS
+  if (pool) cc_wpool_wait_all(pool);
+#endif // HAVE_THREADS
+}
+
+} // namespace
+
+// The interpolated values are written straight into the storage of
+// the first writable connected field, and copied from there into any
+// other connected fields. This avoids building the result in a
+// temporary list first.
+void
+sovrml_interpolate_mfvec3f(SoEngineOutput & output,
+                           const SbVec3f * v0, const SbVec3f * v1,
+                           const float t, const int num)
+{
+  if (!output.isEnabled()) return;
+
+  SoMFVec3f * first = NULL;
+  const int numconnections = output.getNumConnections();
+  for (int i = 0; i < numconnections; i++) {
+    SoMFVec3f * field = static_cast<SoMFVec3f *>(output[i]);
+    if (field->isReadOnly()) continue;
+
+    field->setNum(num);
+    if (first == NULL) {
+      if (num > 0) {
+        lerp_vec3f(field->startEditing(), v0, v1, t, num);
+        field->finishEditing();
+      }
+      first = field;
+    }
+    else {
+      field->setValues(0, num, first->getValues(0));
+    }
+  }
+}
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/VRMLnodes/SoVRMLCoordinateInterpolator.h>
+#include <Inventor/VRMLnodes/SoVRMLScalarInterpolator.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/fields/SoSFFloat.h>
+
+static SbVec3f
+interpolator_test_value(const int key, const int i)
+{
+  return SbVec3f(float(i % 1000) * (key ? 0.5f : 1.0f),
+                 float(key * 3 - i % 7),
+                 float(i % 13) * (key ? -1.0f : 2.0f));
+}
+
+// checks the interpolated values of a coordinate interpolator with
+// two keys against a plain SbVec3f lerp of each value
+static SbBool
+interpolator_test_lerp(const int num, const float t)
+{
+  SoVRMLCoordinateInterpolator * interp = new SoVRMLCoordinateInterpolator;
+  interp->ref();
+  interp->key.set1Value(0, 0.0f);
+  interp->key.set1Value(1, 1.0f);
+  interp->keyValue.setNum(num * 2);
+  SbVec3f * kv = interp->keyValue.startEditing();
+  for (int i = 0; i < num; i++) {
+    kv[i] = interpolator_test_value(0, i);
+    kv[num + i] = interpolator_test_value(1, i);
+  }
+  interp->keyValue.finishEditing();
+  interp->set_fraction = t;
+
+  // the values are copied from the first connected field to the others
+  SoMFVec3f first, second;
+  first.connectFrom(&interp->value_changed);
+  second.connectFrom(&interp->value_changed);
+
+  SbBool ok = (first.getNum() == num) && (second.getNum() == num);
+  for (int i = 0; ok && i < num; i++) {
+    const SbVec3f v0 = interpolator_test_value(0, i);
+    const SbVec3f v1 = interpolator_test_value(1, i);
+    const SbVec3f expected = v0 + (v1 - v0) * t;
+    if (!first[i].equals(expected, 1e-4f) || second[i] != first[i]) ok = FALSE;
+  }
+  first.disconnect();
+  second.disconnect();
+  interp->unref();
+  return ok;
+}
+
+BOOST_AUTO_TEST_CASE(batchedLerp)
+{
+  BOOST_CHECK_MESSAGE(interpolator_test_lerp(10, 0.0f), "t == 0 should copy the first key");
+  BOOST_CHECK_MESSAGE(interpolator_test_lerp(10, 0.3f), "lerp of few values");
+  BOOST_CHECK_MESSAGE(interpolator_test_lerp(1000, 1.0f), "t == 1 should give the last key");
+  // large enough to be split over several threads, and not a
+  // multiple of the number of jobs
+  BOOST_CHECK_MESSAGE(interpolator_test_lerp(300001, 0.7f), "threaded lerp of many values");
+}
+
+// the index of the first key larger than the fraction, found with a
+// linear search like the one used for unsorted keys
+static float
+interpolator_test_scalar(const SoMFFloat & key, const SoMFFloat & keyvalue, const float fraction)
+{
+  const float * t = key.getValues(0);
+  const float * v = keyvalue.getValues(0);
+  const int num = SbMin(key.getNum(), keyvalue.getNum());
+  int i;
+  for (i = 0; i < num; i++) {
+    if (fraction < t[i]) break;
+  }
+  if (i == 0) return v[0];
+  if (i == num) return v[num-1];
+  const float delta = t[i] - t[i-1];
+  const float interp = (delta > 0.0f) ? (fraction - t[i-1]) / delta : 0.0f;
+  return (interp > 0.0f) ? v[i-1] + (v[i] - v[i-1]) * interp : v[i-1];
+}
+
+static int
+interpolator_test_key_search(const float * keys, const int numkeys)
+{
+  SoVRMLScalarInterpolator * interp = new SoVRMLScalarInterpolator;
+  interp->ref();
+  interp->key.setValues(0, numkeys, keys);
+  for (int i = 0; i < numkeys; i++) {
+    interp->keyValue.set1Value(i, float(i * i + 1));
+  }
+  SoSFFloat value;
+  value.connectFrom(&interp->value_changed);
+
+  // before the first key, on and between keys, after the last key,
+  // steps backwards, and small steps in both directions
+  SbList <float> fractions;
+  const float jumps[] = {
+    -0.5f, 0.0f, 0.05f, 0.1f, 0.2f, 0.25f, 0.3f, 0.8f, 0.9f, 1.0f, 1.5f,
+    0.7f, 0.26f, 0.25f, 0.24f, 0.0f, -1.0f, 0.8f, 0.79f, 0.8f, 1.0f, 0.99f
+  };
+  for (int i = 0; i < int(sizeof(jumps) / sizeof(jumps[0])); i++) fractions.append(jumps[i]);
+  for (int i = 0; i <= 100; i++) fractions.append(float(i) * 0.01f);
+  for (int i = 100; i >= 0; i--) fractions.append(float(i) * 0.01f);
+
+  int numerrors = 0;
+  for (int i = 0; i < fractions.getLength(); i++) {
+    interp->set_fraction = fractions[i];
+    const float expected = interpolator_test_scalar(interp->key, interp->keyValue, fractions[i]);
+    if (value.getValue() != expected) numerrors++;
+  }
+  value.disconnect();
+  interp->unref();
+  return numerrors;
+}
+
+BOOST_AUTO_TEST_CASE(keyValueIndex)
+{
+  // sorted keys, with two and three equal keys
+  const float sorted[] = { 0.0f, 0.1f, 0.25f, 0.25f, 0.5f, 0.8f, 0.8f, 0.8f, 1.0f };
+  BOOST_CHECK_EQUAL(interpolator_test_key_search(sorted, 9), 0);
+  // keys starting after 0 and ending before 1
+  const float inner[] = { 0.2f, 0.4f, 0.6f };
+  BOOST_CHECK_EQUAL(interpolator_test_key_search(inner, 3), 0);
+  // a single key
+  const float single[] = { 0.5f };
+  BOOST_CHECK_EQUAL(interpolator_test_key_search(single, 1), 0);
+  // unsorted keys use a linear search
+  const float unsorted[] = { 0.0f, 0.5f, 0.3f, 0.9f, 1.0f };
+  BOOST_CHECK_EQUAL(interpolator_test_key_search(unsorted, 5), 0);
+}
+
+// evaluates interpolators with shared, different and unsorted keys as
+// one batch, and counts the fields that are left dirty or differ from
+// a linear key search
+static int
+interpolator_test_batch(void)
+{
+  const float shared[] = { 0.0f, 0.1f, 0.25f, 0.25f, 0.5f, 0.8f, 1.0f };
+  const float other[] = { 0.2f, 0.4f, 0.6f };
+  const float unsorted[] = { 0.0f, 0.5f, 0.3f, 0.9f, 1.0f };
+  const float * keys[] = { shared, shared, other, shared, unsorted, shared };
+  const int numkeys[] = { 7, 7, 3, 7, 5, 4 };
+  const int num = int(sizeof(keys) / sizeof(keys[0]));
+
+  SoVRMLInterpolator * interps[num];
+  SoSFFloat values[num];
+  for (int i = 0; i < num; i++) {
+    SoVRMLScalarInterpolator * interp = new SoVRMLScalarInterpolator;
+    interp->ref();
+    interp->key.setValues(0, numkeys[i], keys[i]);
+    for (int j = 0; j < numkeys[i]; j++) {
+      interp->keyValue.set1Value(j, float(i * 10 + j * j + 1));
+    }
+    values[i].connectFrom(&interp->value_changed);
+    interps[i] = interp;
+  }
+
+  const float fractions[] = {
+    -0.5f, 0.0f, 0.05f, 0.25f, 0.3f, 0.45f, 0.5f, 0.7f, 1.0f, 1.5f, 0.26f, 0.0f
+  };
+  int numerrors = 0;
+  for (int f = 0; f < int(sizeof(fractions) / sizeof(fractions[0])); f++) {
+    SoVRMLInterpolator::evaluateFractions(interps, num, fractions[f]);
+    for (int i = 0; i < num; i++) {
+      SoVRMLScalarInterpolator * interp = static_cast<SoVRMLScalarInterpolator *>(interps[i]);
+      if (values[i].getDirty()) numerrors++;
+      const float expected = interpolator_test_scalar(interp->key, interp->keyValue, fractions[f]);
+      if (values[i].getValue() != expected) numerrors++;
+    }
+  }
+  for (int i = 0; i < num; i++) {
+    values[i].disconnect();
+    interps[i]->unref();
+  }
+  return numerrors;
+}
+
+BOOST_AUTO_TEST_CASE(evaluateFractions)
+{
+  BOOST_CHECK_EQUAL(interpolator_test_batch(), 0);
+}
+
+#endif // COIN_TEST_SUITE
+
 #endif // HAVE_VRML97
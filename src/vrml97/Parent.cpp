@@ -31,7 +31,7 @@
 \**************************************************************************/
 
 #ifdef HAVE_CONFIG_H
-#include <config.h>
+#include "config.h"
 #endif // HAVE_CONFIG_H
 
 #ifdef HAVE_VRML97
@@ -45,6 +45,7 @@
 
 #include <Inventor/VRMLnodes/SoVRMLMacros.h>
 #include <Inventor/misc/SoChildList.h>
+#include <Inventor/misc/SoNotification.h>
 #include <Inventor/fields/SoSFNode.h>
 #include <Inventor/sensors/SoFieldSensor.h>
 #include <Inventor/fields/SoFieldData.h>
@@ -204,8 +205,19 @@ SoVRMLParent::affectsState(void) const
 void
 SoVRMLParent::addChild(SoNode * child)
 {
+  const SbBool wasvalid = PRIVATE(this)->childlistvalid;
   this->children.addNode(child);
-  PRIVATE(this)->childlistvalid = FALSE;
+
+  // Append to a valid child list, instead of having getChildren()
+  // compare and copy all of it. Makes building large groups linear.
+  SoChildList * cl = SoGroup::children;
+  if (wasvalid && cl->getLength() == this->children.getNum() - 1) {
+    cl->append(child ? child : SoVRMLParentP::getNullNode());
+    PRIVATE(this)->childlistvalid = TRUE;
+  }
+  else {
+    PRIVATE(this)->childlistvalid = FALSE;
+  }
 }
 
 // Doc in parent
@@ -362,7 +374,13 @@ SoVRMLParent::notify(SoNotList * list)
 {
   SoField * f = list->getLastField();
   if (f == &this->children) {
-    PRIVATE(this)->childlistvalid = FALSE;
+    // Notifications relayed from the nodes inside the field have a
+    // record before the field's own. They don't change the child
+    // list, unless the field is connected to some other field.
+    const SoNotRec * rec = list->getLastRec();
+    if (rec->getPrevious() == NULL || this->children.isConnected()) {
+      PRIVATE(this)->childlistvalid = FALSE;
+    }
   }
   inherited::notify(list);
 }
@@ -532,3 +550,69 @@ SoVRMLParent::makeWriteData(void)
 #undef PRIVATE
 
 #endif // HAVE_VRML97
+
+#ifdef COIN_TEST_SUITE
+#include <Inventor/VRMLnodes/SoVRMLGroup.h>
+#include <Inventor/VRMLnodes/SoVRMLTransform.h>
+#include <Inventor/misc/SoChildList.h>
+
+// checks that the child list matches the children field
+static SbBool
+parent_test_children_match(SoVRMLParent * parent)
+{
+  const SoChildList * cl = parent->getChildren();
+  if (cl->getLength() != parent->children.getNum()) return FALSE;
+  for (int i = 0; i < cl->getLength(); i++) {
+    if ((*cl)[i] != parent->children[i]) return FALSE;
+  }
+  return TRUE;
+}
+
+BOOST_AUTO_TEST_CASE(childList)
+{
+  SoVRMLGroup * group = new SoVRMLGroup;
+  group->ref();
+  SoNode * nodes[6];
+  for (int i = 0; i < 6; i++) {
+    nodes[i] = new SoVRMLTransform;
+    nodes[i]->ref();
+  }
+
+  group->addChild(nodes[0]);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after addChild() to an empty group");
+  group->addChild(nodes[1]);
+  group->addChild(nodes[2]);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after addChild() to a valid list");
+  group->insertChild(nodes[3], 1);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after insertChild()");
+  group->addChild(nodes[4]);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after addChild() following insertChild()");
+  group->removeChild(0);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after removeChild()");
+
+  const SoNode * values[] = { nodes[4], nodes[5], nodes[0] };
+  group->children.setValues(0, 2, values);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after setting the field");
+  group->children.setValues(group->children.getNum(), 1, values + 2);
+  group->addChild(nodes[1]);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after addChild() following a field edit");
+  group->removeChild(nodes[4]);
+  group->addChild(nodes[4]);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after removeChild() and addChild()");
+
+  // edits of the children notify the group through the field, but
+  // don't change the child list
+  const SoChildList * cl = group->getChildren();
+  static_cast<SoVRMLTransform *>(nodes[1])->translation = SbVec3f(1.0f, 2.0f, 3.0f);
+  BOOST_CHECK_MESSAGE(group->getChildren() == cl && parent_test_children_match(group),
+                      "after editing a child");
+  group->addChild(nodes[2]);
+  BOOST_CHECK_MESSAGE(parent_test_children_match(group), "after addChild() following a child edit");
+
+  for (int i = 0; i < 6; i++) {
+    nodes[i]->unref();
+  }
+  group->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -48,4 +48,14 @@
 #define SO_INTERPOLATOR_INTERNAL_INIT_ABSTRACT_CLASS(classname) \
   SO_NODE_INTERNAL_INIT_ABSTRACT_CLASS(classname)
 
+class SbVec3f;
+class SoEngineOutput;
+
+// Writes the linear interpolation between the num vectors in v0 and
+// v1 directly into the storage of the SoMFVec3f fields connected to
+// output. Implemented in Interpolator.cpp.
+void sovrml_interpolate_mfvec3f(SoEngineOutput & output,
+                                const SbVec3f * v0, const SbVec3f * v1,
+                                const float t, const int num);
+
 #endif // ! COIN_SOVRMLSUBINTERPOLATORP_H
@@ -0,0 +1,101 @@
+/************************************************************************
+ *
+ * Nodekit construction and part access micro-benchmark
+ *
+ * Build with:
+ *
+ *   coin-config --build benchmark benchmark.cpp
+ *
+ * Run with an optional number of kits as the argument. Prints the
+ * average time per kit for constructing SoShapeKit instances, for
+ * setting and getting parts by (compound) part name, and for
+ * constructing and destructing a couple of the larger draggers.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInteraction.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodekits/SoNodeKit.h>
+#include <Inventor/nodekits/SoShapeKit.h>
+#include <Inventor/draggers/SoTransformerDragger.h>
+#include <Inventor/draggers/SoCenterballDragger.h>
+
+static void
+report(const char * what, const SbTime & start, const int calls)
+{
+  const double us = (SbTime::getTimeOfDay() - start).getValue() * 1.0e6 / calls;
+  (void)fprintf(stdout, "%-40s %8.2f us/call\n", what, us);
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+  SoNodeKit::init();
+  SoInteraction::init();
+
+  const int numkits = (argc > 1) ? atoi(argv[1]) : 10000;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+
+  SbTime start = SbTime::getTimeOfDay();
+  for (int i = 0; i < numkits; i++) {
+    root->addChild(new SoShapeKit);
+  }
+  report("new SoShapeKit", start, numkits);
+
+  start = SbTime::getTimeOfDay();
+  for (int i = 0; i < numkits; i++) {
+    SoShapeKit * kit = (SoShapeKit *)root->getChild(i);
+    kit->setPart("appearance.material", new SoMaterial);
+  }
+  report("setPart(\"appearance.material\")", start, numkits);
+
+  int hits = 0;
+  start = SbTime::getTimeOfDay();
+  for (int i = 0; i < numkits; i++) {
+    SoShapeKit * kit = (SoShapeKit *)root->getChild(i);
+    if (kit->getPart("material", FALSE)) hits++;
+    if (kit->getPart("appearance.material", FALSE)) hits++;
+    if (kit->getPart("transform", TRUE)) hits++;
+  }
+  report("getPart()", start, numkits * 3);
+  if (hits != numkits * 3) {
+    (void)fprintf(stderr, "unexpected number of parts found: %d\n", hits);
+  }
+
+  start = SbTime::getTimeOfDay();
+  root->removeAllChildren();
+  report("~SoShapeKit", start, numkits);
+
+  // The first instance of each dragger class reads its default parts.
+  start = SbTime::getTimeOfDay();
+  SoTransformerDragger * firsttransformer = new SoTransformerDragger;
+  firsttransformer->ref();
+  firsttransformer->unref();
+  SoCenterballDragger * firstcenterball = new SoCenterballDragger;
+  firstcenterball->ref();
+  firstcenterball->unref();
+  report("first transformer + centerball", start, 1);
+
+  const int numdraggers = numkits / 200 + 1;
+  start = SbTime::getTimeOfDay();
+  for (int i = 0; i < numdraggers; i++) {
+    SoTransformerDragger * transformer = new SoTransformerDragger;
+    transformer->ref();
+    transformer->unref();
+    SoCenterballDragger * centerball = new SoCenterballDragger;
+    centerball->ref();
+    centerball->unref();
+  }
+  report("new/delete transformer + centerball", start, numdraggers);
+
+  root->unref();
+  return 0;
+}
@@ -0,0 +1,130 @@
+/************************************************************************
+ *
+ * Callback action micro-benchmark
+ *
+ * Build with:
+ *
+ *   coin-config --build benchmark benchmark.cpp
+ *
+ * Run with an optional grid size and an optional number of shapes as
+ * the arguments. Collects the triangles of a number of instanced
+ * SoIndexedFaceSet grids, with a triangle callback doing some work on
+ * each triangle, and prints the time for one to four threads
+ * invoking the callbacks.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/details/SoFaceDetail.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+struct Result {
+  Result(void) : numtriangles(0), area(0.0), indexsum(0) { }
+  int numtriangles;
+  double area;
+  long indexsum;
+  // keep the results of the threads on separate cache lines
+  char padding[64];
+};
+
+static void
+triangle_cb(void * userdata, SoCallbackAction * action,
+            const SoPrimitiveVertex * v1,
+            const SoPrimitiveVertex * v2,
+            const SoPrimitiveVertex * v3)
+{
+  Result * result = static_cast<Result *>(userdata) + action->getThreadIndex();
+  const SbMatrix & m = action->getModelMatrix();
+  SbVec3f p1, p2, p3;
+  m.multVecMatrix(v1->getPoint(), p1);
+  m.multVecMatrix(v2->getPoint(), p2);
+  m.multVecMatrix(v3->getPoint(), p3);
+  result->area += 0.5 * (p2 - p1).cross(p3 - p1).length();
+  result->numtriangles++;
+
+  // the face set vertices have face details
+  const SoFaceDetail * fd = static_cast<const SoFaceDetail *>(v1->getDetail());
+  if (fd && fd->isOfType(SoFaceDetail::getClassTypeId())) {
+    result->indexsum += fd->getFaceIndex();
+    for (int i = 0; i < fd->getNumPoints(); i++) {
+      result->indexsum += fd->getPoint(i)->getCoordinateIndex();
+    }
+  }
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int size = (argc > 1) ? atoi(argv[1]) : 200;
+  const int numshapes = (argc > 2) ? atoi(argv[2]) : 20;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setNum((size + 1) * (size + 1));
+  SbVec3f * points = coords->point.startEditing();
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      points[y * (size + 1) + x].setValue(float(x) / size, float(y) / size,
+                                          0.01f * ((x * y) % 7));
+    }
+  }
+  coords->point.finishEditing();
+  root->addChild(coords);
+
+  SoIndexedFaceSet * faceset = new SoIndexedFaceSet;
+  faceset->coordIndex.setNum(size * size * 5);
+  int32_t * indices = faceset->coordIndex.startEditing();
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const int corner = y * (size + 1) + x;
+      *indices++ = corner;
+      *indices++ = corner + 1;
+      *indices++ = corner + size + 2;
+      *indices++ = corner + size + 1;
+      *indices++ = -1;
+    }
+  }
+  faceset->coordIndex.finishEditing();
+
+  for (int i = 0; i < numshapes; i++) {
+    SoTranslation * t = new SoTranslation;
+    t->translation = SbVec3f(1.0f, 0.0f, 0.0f);
+    root->addChild(t);
+    root->addChild(faceset);
+  }
+
+  for (int numthreads = 1; numthreads <= 4; numthreads++) {
+    Result results[4];
+    SoCallbackAction cba;
+    cba.setNumThreads(numthreads);
+    cba.addTriangleCallback(SoIndexedFaceSet::getClassTypeId(), triangle_cb, results);
+
+    const SbTime start = SbTime::getTimeOfDay();
+    cba.apply(root);
+    const double ms = (SbTime::getTimeOfDay() - start).getValue() * 1.0e3;
+
+    Result total;
+    for (int i = 0; i < numthreads; i++) {
+      total.numtriangles += results[i].numtriangles;
+      total.area += results[i].area;
+      total.indexsum += results[i].indexsum;
+    }
+    (void)fprintf(stdout, "%d thread(s) %10.2f ms, %d triangles, area %.4f, index sum %ld\n",
+                  numthreads, ms, total.numtriangles, total.area, total.indexsum);
+  }
+
+  root->unref();
+  return 0;
+}
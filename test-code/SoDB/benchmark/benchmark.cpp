@@ -0,0 +1,59 @@
+/************************************************************************
+ *
+ * SoDB::init() startup time benchmark
+ *
+ * Build with:
+ *
+ *   coin-config --build benchmark benchmark.cpp
+ *
+ * Run with an optional number of init/finish cycles as the argument.
+ * Prints the time spent in the first SoDB::init() of the process,
+ * the average time of subsequent SoDB::finish() + SoDB::init()
+ * cycles, and the time spent the first time something which is
+ * initialized on demand is used (field converters).
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/fields/SoSFFloat.h>
+#include <Inventor/fields/SoMFFloat.h>
+
+static double
+cputime(void)
+{
+  return double(clock()) / CLOCKS_PER_SEC;
+}
+
+static void
+report(const char * what, const double start, const int calls)
+{
+  const double ms = (cputime() - start) * 1.0e3 / calls;
+  (void)fprintf(stdout, "%-40s %8.3f ms\n", what, ms);
+}
+
+int
+main(int argc, char ** argv)
+{
+  const int cycles = (argc > 1) ? atoi(argv[1]) : 100;
+
+  double start = cputime();
+  SoDB::init();
+  report("first SoDB::init()", start, 1);
+
+  start = cputime();
+  (void)SoDB::getConverter(SoSFFloat::getClassTypeId(),
+                           SoMFFloat::getClassTypeId());
+  report("first SoDB::getConverter()", start, 1);
+
+  start = cputime();
+  for (int i = 0; i < cycles; i++) {
+    SoDB::finish();
+    SoDB::init();
+  }
+  report("SoDB::finish() + SoDB::init()", start, cycles);
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+/************************************************************************
+ *
+ * Ray picking micro-benchmark
+ *
+ * Build with:
+ *
+ *   coin-config --build benchmark benchmark.cpp
+ *
+ * Run with an optional grid size as the argument. Picks an
+ * SoIndexedFaceSet with two triangles per grid cell, and prints the
+ * time for the first pick, for the pick which builds the pick cache
+ * of the shape, and the average time of the following picks.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+
+static void
+report(const char * what, const SbTime & start, const int calls)
+{
+  const double ms = (SbTime::getTimeOfDay() - start).getValue() * 1.0e3 / calls;
+  (void)fprintf(stdout, "%-40s %10.4f ms/pick\n", what, ms);
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int size = (argc > 1) ? atoi(argv[1]) : 500;
+  const int numpicks = 1000;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setNum((size + 1) * (size + 1));
+  SbVec3f * points = coords->point.startEditing();
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      points[y * (size + 1) + x].setValue(float(x) / size, float(y) / size,
+                                          0.01f * ((x * y) % 7));
+    }
+  }
+  coords->point.finishEditing();
+  root->addChild(coords);
+
+  SoIndexedFaceSet * faceset = new SoIndexedFaceSet;
+  faceset->coordIndex.setNum(size * size * 5);
+  int32_t * indices = faceset->coordIndex.startEditing();
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const int corner = y * (size + 1) + x;
+      *indices++ = corner;
+      *indices++ = corner + 1;
+      *indices++ = corner + size + 2;
+      *indices++ = corner + size + 1;
+      *indices++ = -1;
+    }
+  }
+  faceset->coordIndex.finishEditing();
+  root->addChild(faceset);
+
+  SbViewportRegion vp(640, 480);
+  SoRayPickAction rp(vp);
+  int hits = 0;
+
+  rp.setRay(SbVec3f(0.5f, 0.5f, 5.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  SbTime start = SbTime::getTimeOfDay();
+  rp.apply(root);
+  report("first pick", start, 1);
+  if (rp.getPickedPoint()) hits++;
+
+  start = SbTime::getTimeOfDay();
+  rp.apply(root);
+  report("second pick (builds pick cache)", start, 1);
+  if (rp.getPickedPoint()) hits++;
+
+  start = SbTime::getTimeOfDay();
+  for (int i = 0; i < numpicks; i++) {
+    const float t = float(i) / numpicks;
+    rp.setRay(SbVec3f(t, 1.0f - t, 5.0f), SbVec3f(0.01f, 0.02f, -1.0f));
+    rp.apply(root);
+    if (rp.getPickedPoint()) hits++;
+  }
+  report("cached picks", start, numpicks);
+
+  rp.setPickAll(TRUE);
+  start = SbTime::getTimeOfDay();
+  for (int i = 0; i < numpicks; i++) {
+    const float t = float(i) / numpicks;
+    rp.setRay(SbVec3f(t, 0.5f, 5.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+    rp.apply(root);
+    hits += rp.getPickedPointList().getLength();
+  }
+  report("cached picks, pick all", start, numpicks);
+
+  (void)fprintf(stdout, "%d points picked\n", hits);
+
+  root->unref();
+  return 0;
+}
@@ -0,0 +1,118 @@
+/************************************************************************
+ *
+ * VRML2 conversion micro-benchmark
+ *
+ * Build with:
+ *
+ *   coin-config --build benchmark benchmark.cpp
+ *
+ * Run with an optional number of shapes and an optional number of
+ * different coordinate arrays as the arguments. Converts a scene of
+ * SoIndexedFaceSet nodes, each with its own SoCoordinate3 node, with
+ * and without reuse of property nodes, and prints the time and the
+ * number of coordinate nodes in the converted scene.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/actions/SoToVRML2Action.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/VRMLnodes/SoVRMLGroup.h>
+#include <Inventor/VRMLnodes/SoVRMLIndexedFaceSet.h>
+#include <Inventor/VRMLnodes/SoVRMLShape.h>
+
+static const int GRID = 20;
+
+static SoSeparator *
+make_shape(const int variant)
+{
+  SoSeparator * sep = new SoSeparator;
+
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setNum((GRID + 1) * (GRID + 1));
+  SbVec3f * points = coords->point.startEditing();
+  for (int y = 0; y <= GRID; y++) {
+    for (int x = 0; x <= GRID; x++) {
+      points[y * (GRID + 1) + x].setValue(float(x), float(y), float(variant));
+    }
+  }
+  coords->point.finishEditing();
+  sep->addChild(coords);
+
+  SoIndexedFaceSet * faceset = new SoIndexedFaceSet;
+  faceset->coordIndex.setNum(GRID * GRID * 5);
+  int32_t * indices = faceset->coordIndex.startEditing();
+  for (int y = 0; y < GRID; y++) {
+    for (int x = 0; x < GRID; x++) {
+      const int corner = y * (GRID + 1) + x;
+      *indices++ = corner;
+      *indices++ = corner + 1;
+      *indices++ = corner + GRID + 2;
+      *indices++ = corner + GRID + 1;
+      *indices++ = -1;
+    }
+  }
+  faceset->coordIndex.finishEditing();
+  sep->addChild(faceset);
+  return sep;
+}
+
+static int
+count_coordinates(SoNode * root)
+{
+  SoSearchAction sa;
+  sa.setType(SoVRMLShape::getClassTypeId());
+  sa.setInterest(SoSearchAction::ALL);
+  sa.apply(root);
+
+  SbList <SoNode *> coords;
+  for (int i = 0; i < sa.getPaths().getLength(); i++) {
+    const SoVRMLShape * shape =
+      static_cast<const SoVRMLShape *>(sa.getPaths()[i]->getTail());
+    const SoVRMLIndexedFaceSet * faceset =
+      static_cast<const SoVRMLIndexedFaceSet *>(shape->geometry.getValue());
+    SoNode * coord = faceset->coord.getValue();
+    if (coords.find(coord) < 0) coords.append(coord);
+  }
+  return coords.getLength();
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int numshapes = (argc > 1) ? atoi(argv[1]) : 2000;
+  const int numvariants = (argc > 2) ? atoi(argv[2]) : 10;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  for (int i = 0; i < numshapes; i++) {
+    root->addChild(make_shape(i % numvariants));
+  }
+
+  for (int reuse = 0; reuse < 2; reuse++) {
+    SoToVRML2Action tovrml2;
+    tovrml2.reusePropertyNodes(reuse ? TRUE : FALSE);
+
+    const SbTime start = SbTime::getTimeOfDay();
+    tovrml2.apply(root);
+    const double ms = (SbTime::getTimeOfDay() - start).getValue() * 1.0e3;
+
+    SoVRMLGroup * vrml2 = tovrml2.getVRML2SceneGraph();
+    vrml2->ref();
+    (void)fprintf(stdout, "%-28s %10.2f ms, %d coordinate nodes\n",
+                  reuse ? "reuse property nodes" : "no reuse", ms,
+                  count_coordinates(vrml2));
+    vrml2->unref();
+  }
+
+  root->unref();
+  return 0;
+}
@@ -0,0 +1,93 @@
+/************************************************************************
+ *
+ * SoType::isDerivedFrom() and SoType::fromName() micro-benchmark
+ *
+ * Build with:
+ *
+ *   coin-config --build benchmark benchmark.cpp
+ *
+ * Run with an optional number of iterations as the argument. Prints
+ * the average time per call for type derivation tests against types
+ * at different depths in the hierarchy, and for name lookups with and
+ * without the "So" prefix.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoType.h>
+#include <Inventor/SbName.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/lists/SoTypeList.h>
+#include <Inventor/nodes/SoNode.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodekits/SoNodeKit.h>
+
+static void
+report(const char * what, const SbTime & start, const int calls, const int hits)
+{
+  const double ns = (SbTime::getTimeOfDay() - start).getValue() * 1.0e9 / calls;
+  (void)fprintf(stdout, "%-40s %8.2f ns/call  (%d hits)\n", what, ns, hits);
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+  SoNodeKit::init();
+
+  const int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+
+  SoTypeList types;
+  SoType::getAllDerivedFrom(SoNode::getClassTypeId(), types);
+  const int numtypes = types.getLength();
+
+  const SoType parents[] = {
+    SoNode::getClassTypeId(),
+    SoGroup::getClassTypeId(),
+    SoShape::getClassTypeId()
+  };
+  const char * parentnames[] = {
+    "isDerivedFrom(SoNode)",
+    "isDerivedFrom(SoGroup)",
+    "isDerivedFrom(SoShape)"
+  };
+
+  for (int p = 0; p < 3; p++) {
+    int hits = 0;
+    const SbTime start = SbTime::getTimeOfDay();
+    for (int n = 0; n < iterations; n++) {
+      for (int i = 0; i < numtypes; i++) {
+        if (types[i].isDerivedFrom(parents[p])) hits++;
+      }
+    }
+    report(parentnames[p], start, iterations * numtypes, hits);
+  }
+
+  SbList<SbName> names(numtypes);
+  SbList<SbName> prefixednames(numtypes);
+  for (int i = 0; i < numtypes; i++) {
+    const SbName name = types[i].getName();
+    names.append(name);
+    SbString prefixed("So");
+    prefixed += name.getString();
+    prefixednames.append(SbName(prefixed.getString()));
+  }
+
+  for (int p = 0; p < 2; p++) {
+    const SbList<SbName> & list = p ? prefixednames : names;
+    int hits = 0;
+    const SbTime start = SbTime::getTimeOfDay();
+    for (int n = 0; n < iterations; n++) {
+      for (int i = 0; i < numtypes; i++) {
+        if (SoType::fromName(list[i]) == types[i]) hits++;
+      }
+    }
+    report(p ? "fromName(\"So\" + name)" : "fromName(name)",
+           start, iterations * numtypes, hits);
+  }
+
+  return 0;
+}
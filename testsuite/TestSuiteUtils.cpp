@@ -49,7 +49,12 @@
 #include <Inventor/SoDB.h>
 #include <Inventor/SoInput.h>
 #include <Inventor/SoOutput.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoRayPickAction.h>
 #include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/details/SoFaceDetail.h>
+#include <Inventor/details/SoPointDetail.h>
 #include <Inventor/nodes/SoSeparator.h>
 
 #include <TestSuiteUtils.h>
@@ -430,6 +435,86 @@ TestSuite::test_all_files(const std::string & search_directory,
     }
 }
 
+namespace {
+
+// describes the first point picked along a vertical ray through (x, y)
+std::string
+describe_pick(SoNode * root, const float x, const float y)
+{
+  SoRayPickAction rp(SbViewportRegion(100, 100));
+  rp.setRay(SbVec3f(x, y, 10.0f), SbVec3f(0.0f, 0.0f, -1.0f));
+  rp.apply(root);
+  const SoPickedPoint * pp = rp.getPickedPoint();
+  if (!pp) return "";
+
+  SbString str;
+  const SbVec3f & p = pp->getPoint();
+  const SbVec3f & n = pp->getNormal();
+  const SbVec4f & t = pp->getTextureCoords();
+  str.sprintf("point %g %g %g normal %g %g %g texcoord %g %g material %d",
+              p[0], p[1], p[2], n[0], n[1], n[2], t[0], t[1],
+              pp->getMaterialIndex());
+  const SoFaceDetail * fd = dynamic_cast<const SoFaceDetail *>(pp->getDetail());
+  if (fd) {
+    SbString tmp;
+    tmp.sprintf(" face %d part %d", fd->getFaceIndex(), fd->getPartIndex());
+    str += tmp;
+    for (int i = 0; i < fd->getNumPoints(); i++) {
+      const SoPointDetail * pd = fd->getPoint(i);
+      tmp.sprintf(" [%d %d %d %d]", pd->getCoordinateIndex(),
+                  pd->getMaterialIndex(), pd->getNormalIndex(),
+                  pd->getTextureCoordIndex());
+      str += tmp;
+    }
+  }
+  return str.getString();
+}
+
+} // namespace
+
+/*
+  Picks \a root along vertical rays through two points in each unit
+  cell of a \a cells x \a cells grid in the z = 0 plane, and compares
+  the picked points and details of the pick cache for \a shape with
+  those picked without the cache. The reference picks touch \a shape
+  first, so that it never builds a pick cache, while the picks after
+  that are made with an unchanged shape, so the cache is built by the
+  second of them and used by the rest.
+
+  Returns the number of picks which differ from, or miss, the
+  reference.
+*/
+int
+TestSuite::CountPickCacheMismatches(SoNode * root, SoNode * shape, int cells)
+{
+  std::vector<SbVec2f> rays;
+  for (int j = 0; j < cells; j++) {
+    for (int i = 0; i < cells; i++) {
+      rays.push_back(SbVec2f(i + 0.3f, j + 0.6f));
+      rays.push_back(SbVec2f(i + 0.7f, j + 0.2f));
+    }
+  }
+  std::vector<std::string> reference;
+  for (size_t i = 0; i < rays.size(); i++) {
+    shape->touch();
+    reference.push_back(describe_pick(root, rays[i][0], rays[i][1]));
+  }
+
+  int mismatches = 0;
+  shape->touch();
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < rays.size(); i++) {
+      const std::string pick = describe_pick(root, rays[i][0], rays[i][1]);
+      if (reference[i].empty() || pick != reference[i]) {
+        BOOST_TEST_MESSAGE("pick " << i << ": expected '" << reference[i]
+                           << "', got '" << pick << "'");
+        mismatches++;
+      }
+    }
+  }
+  return mismatches;
+}
+
 bool
 TestSuite::testCorrectFile(SoNode * root, const std::string & filename) {
     BOOST_CHECK_MESSAGE((root != NULL) && (GetReadErrorCount() == 0), (std::string("failed to read file ") + filename).c_str());
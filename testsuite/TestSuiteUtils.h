@@ -74,6 +74,8 @@ bool testCorrectFile(SoNode * root, const std::string & filename);
 bool testIncorrectFile(SoNode * root, const std::string & filename);
 bool testOutOfSpecFile(SoNode * root, const std::string & filename);
 
+int CountPickCacheMismatches(SoNode * root, SoNode * shape, int cells);
+
 } } } } // namespace
 
 #endif // !COIN_TESTSUITEUTILS_H